@@ -0,0 +1,289 @@
+"""cluster_incremental.py
+
+Clusterização incremental: atribui cada coredump novo ao cluster mais próximo sem rodar
+a DAMICORE sobre o conjunto inteiro.
+
+A distância é a mesma da DAMICORE (NCD com zlib nível 9) entre relatórios:
+  NCD(x, y) = (C(xy) - min(C(x), C(y))) / max(C(x), C(y))
+O tamanho comprimido de cada relatório e a distância de cada par já calculado ficam em
+cache (CACHE_FILE_PATH). Cada cluster é representado por alguns medoides, escolhidos
+depois de cada rodada completa; um coredump novo só é comparado com eles, e entra no
+cluster mais próximo se a distância couber no raio do cluster. Os que não couberem em
+nenhum continuam sem cluster e contam para a próxima rodada completa.
+
+Fluxo resumido:
+1. refresh_representatives(): após uma rodada completa, escolhe medoides e raios.
+2. assign_new_coredumps(): a cada verificação, atribui os coredumps sem cluster.
+
+Variáveis de ambiente relevantes:
+  COREDUMP_CLUSTER_MAX_DISTANCE -> maior NCD aceita numa atribuição (padrão 0.8).
+"""
+
+from __future__ import annotations
+
+import json
+import logging
+import os
+import threading
+import zlib
+from pathlib import Path
+from typing import Any, Dict, List, Optional, Sequence, Set, Tuple
+
+try:
+    from .ports import IDataRepository
+except ImportError as e:  # pragma: no cover
+    logging.error("Erro ao importar IDataRepository: %s", e)
+    raise SystemExit(1)
+
+logger = logging.getLogger("backend.cluster_incremental")
+
+# ---------------------------------------------------------------------------
+# Constantes de Configuração
+# ---------------------------------------------------------------------------
+CACHE_FILE_PATH: Path = Path("db/damicore/ncd_cache.json")
+
+# Mesmo compressor e nível passados à DAMICORE (--compressor zlib --level 9)
+COMPRESSION_LEVEL: int = 9
+
+# Medoides por cluster e membros amostrados para escolhê-los (custo quadrático na amostra)
+REPRESENTATIVES_PER_CLUSTER: int = 3
+MEDOID_SAMPLE_SIZE: int = 12
+
+# Critério de atribuição: distância ao medoide mais próximo até o raio do cluster mais a margem,
+# limitada por MAX_ASSIGN_DISTANCE. Clusters de um só membro usam SINGLETON_RADIUS.
+MAX_ASSIGN_DISTANCE: float = float(os.getenv("COREDUMP_CLUSTER_MAX_DISTANCE", "0.8"))
+SINGLETON_RADIUS: float = 0.25
+RADIUS_MARGIN: float = 0.05
+
+# Type alias para registros de coredump retornados pelo banco.
+CoredumpRecord = Sequence[Any]
+
+
+def _file_key(path: Path) -> str:
+    """Chave de cache de um relatório; um arquivo regravado recebe outra chave."""
+    st = path.stat()
+    return f"{path.name}:{st.st_size}:{int(st.st_mtime)}"
+
+
+class NcdCache:
+    """Tamanhos comprimidos, distâncias por par e medoides por cluster, persistidos em JSON."""
+
+    def __init__(self, path: Path = CACHE_FILE_PATH) -> None:
+        self.path = path
+        self._lock = threading.RLock()
+        self._save_lock = threading.Lock()  # Serializa as gravações do arquivo
+        self.sizes: Dict[str, int] = {}
+        self.pairs: Dict[str, float] = {}
+        self.representatives: Dict[str, List[str]] = {}  # cluster_id -> caminhos dos medoides
+        self.radius: Dict[str, float] = {}  # cluster_id -> maior distância medoide-membro na amostra
+        self.assigned_since_full: int = 0  # Atribuições incrementais desde a última rodada completa
+        self._dirty = False
+        self._load()
+
+    def _load(self) -> None:
+        try:
+            data = json.loads(self.path.read_text(encoding="utf-8"))
+        except FileNotFoundError:
+            return
+        except (OSError, ValueError):
+            logger.warning("Cache de distâncias ilegível em %s; recomeçando vazio.", self.path)
+            return
+        self.sizes = data.get("sizes", {})
+        self.pairs = data.get("pairs", {})
+        self.representatives = data.get("representatives", {})
+        self.radius = data.get("radius", {})
+        self.assigned_since_full = int(data.get("assigned_since_full", 0))
+
+    def save(self) -> None:
+        """Grava o cache de forma atômica, se mudou.
+
+        Um gravador por vez, da cópia à troca do arquivo: um 'save' mais antigo não sobrescreve
+        um mais novo nem disputa o mesmo temporário. Só a serialização segura '_lock'.
+        """
+        with self._save_lock:
+            with self._lock:
+                if not self._dirty:
+                    return
+                text = json.dumps({
+                    "sizes": self.sizes,
+                    "pairs": self.pairs,
+                    "representatives": self.representatives,
+                    "radius": self.radius,
+                    "assigned_since_full": self.assigned_since_full,
+                })
+                self._dirty = False
+            try:
+                self.path.parent.mkdir(parents=True, exist_ok=True)
+                tmp_path = self.path.with_suffix(self.path.suffix + ".tmp")
+                tmp_path.write_text(text, encoding="utf-8")
+                tmp_path.replace(self.path)
+            except OSError:
+                self.mark_dirty()  # A próxima gravação tenta de novo
+                raise
+
+    def mark_dirty(self) -> None:
+        with self._lock:
+            self._dirty = True
+
+    def compressed_size(self, path: Path, key: Optional[str] = None) -> int:
+        key = key or _file_key(path)
+        with self._lock:
+            size = self.sizes.get(key)
+        if size is None:
+            size = len(zlib.compress(path.read_bytes(), COMPRESSION_LEVEL))
+            with self._lock:
+                self.sizes[key] = size
+                self._dirty = True
+        return size
+
+    def ncd(self, a: Path, b: Path) -> float:
+        ka, kb = _file_key(a), _file_key(b)
+        if ka == kb:
+            return 0.0
+        if kb < ka:
+            a, b, ka, kb = b, a, kb, ka
+        pair = f"{ka}|{kb}"
+        with self._lock:
+            cached = self.pairs.get(pair)
+        if cached is not None:
+            return cached
+        ca, cb = self.compressed_size(a, ka), self.compressed_size(b, kb)
+        cab = len(zlib.compress(a.read_bytes() + b.read_bytes(), COMPRESSION_LEVEL))
+        value = (cab - min(ca, cb)) / max(ca, cb, 1)
+        with self._lock:
+            self.pairs[pair] = value
+            self._dirty = True
+        return value
+
+    def prune(self, live_keys: Set[str]) -> None:
+        """Descarta tamanhos e pares de relatórios que não estão mais no banco."""
+        with self._lock:
+            self.sizes = {k: v for k, v in self.sizes.items() if k in live_keys}
+            self.pairs = {
+                k: v for k, v in self.pairs.items()
+                if k.split("|", 1)[0] in live_keys and k.split("|", 1)[1] in live_keys
+            }
+            self._dirty = True
+
+
+_cache: Optional[NcdCache] = None
+_cache_lock = threading.Lock()
+
+
+def get_cache() -> NcdCache:
+    global _cache
+    with _cache_lock:
+        if _cache is None:
+            _cache = NcdCache()
+        return _cache
+
+
+def _report_path(record: CoredumpRecord) -> Optional[Path]:
+    """Relatório do registro (índice 5 = log_path), se existir em disco."""
+    try:
+        raw = record[5]
+    except IndexError:
+        return None
+    if raw is None:
+        return None
+    path = Path(str(raw))
+    return path if path.is_file() else None
+
+
+def _choose_medoids(cache: NcdCache, members: List[Path]) -> Tuple[List[Path], float]:
+    """Medoides (menor soma de distâncias na amostra) e o raio do cluster."""
+    sample = members[:MEDOID_SAMPLE_SIZE]
+    if len(sample) == 1:
+        return sample, 0.0
+    totals = []
+    for a in sample:
+        totals.append((sum(cache.ncd(a, b) for b in sample if b != a), str(a), a))
+    totals.sort()
+    medoids = [item[2] for item in totals[:REPRESENTATIVES_PER_CLUSTER]]
+    radius = max(min(cache.ncd(m, b) for m in medoids) for b in sample)
+    return medoids, radius
+
+
+def refresh_representatives(repo: IDataRepository, cache: Optional[NcdCache] = None) -> int:
+    """Escolhe os medoides de cada cluster do banco; retorna quantos clusters foram representados.
+
+    Chamado após cada rodada completa da DAMICORE, quando a composição dos clusters muda.
+    """
+    cache = cache or get_cache()
+    members: Dict[str, List[Path]] = {}
+    live_keys: Set[str] = set()
+    for record in repo.list_all_coredumps():
+        path = _report_path(record)
+        if path is None:
+            continue
+        live_keys.add(_file_key(path))
+        cluster_id = record[3]
+        if cluster_id is not None:
+            members.setdefault(str(cluster_id), []).append(path)
+    cache.prune(live_keys)
+
+    representatives: Dict[str, List[str]] = {}
+    radius: Dict[str, float] = {}
+    for cluster_id, paths in members.items():
+        medoids, cluster_radius = _choose_medoids(cache, sorted(paths, key=lambda p: p.name))
+        representatives[cluster_id] = [str(p) for p in medoids]
+        radius[cluster_id] = cluster_radius
+    with cache._lock:
+        cache.representatives = representatives
+        cache.radius = radius
+        cache.assigned_since_full = 0
+        cache.mark_dirty()
+    cache.save()
+    logger.info("Medoides atualizados para %d clusters.", len(representatives))
+    return len(representatives)
+
+
+def assign_new_coredumps(repo: IDataRepository, cache: Optional[NcdCache] = None) -> Tuple[int, int]:
+    """Atribui os coredumps sem cluster ao cluster mais próximo; retorna (atribuídos, pendentes).
+
+    Pendentes são os coredumps com relatório que não couberam em nenhum cluster (ou
+    ainda não há clusters); ficam para a próxima rodada completa.
+    """
+    cache = cache or get_cache()
+    unclustered = repo.get_unclustered_coredumps()
+    if not unclustered:
+        return 0, 0
+    with cache._lock:
+        representatives = {cid: [Path(p) for p in paths] for cid, paths in cache.representatives.items()}
+        radius = dict(cache.radius)
+
+    assigned = pending = 0
+    for record in unclustered:
+        path = _report_path(record)
+        if path is None:
+            continue  # Sem relatório ainda: a interpretação não terminou
+        best: Optional[Tuple[float, str]] = None
+        for cluster_id, medoids in representatives.items():
+            medoids = [m for m in medoids if m.is_file()]
+            if not medoids:
+                continue
+            distance = min(cache.ncd(path, m) for m in medoids)
+            if best is None or distance < best[0]:
+                best = (distance, cluster_id)
+        if best is not None:
+            distance, cluster_id = best
+            cluster_radius = radius.get(cluster_id) or SINGLETON_RADIUS
+            limit = min(MAX_ASSIGN_DISTANCE, cluster_radius + RADIUS_MARGIN)
+            if distance <= limit and repo.assign_cluster_to_coredump(int(record[0]), int(cluster_id)):
+                assigned += 1
+                logger.info(
+                    "Coredump %s atribuído ao cluster %s (ncd=%.3f limite=%.3f)",
+                    record[0], cluster_id, distance, limit,
+                )
+                continue
+            logger.debug("Coredump %s sem cluster próximo (ncd=%.3f cluster=%s limite=%.3f)", record[0], distance, cluster_id, limit)
+        pending += 1
+
+    if assigned:
+        with cache._lock:
+            cache.assigned_since_full += assigned
+            cache.mark_dirty()
+    cache.save()
+    if assigned or pending:
+        logger.info("Clusterização incremental: %d atribuídos, %d pendentes.", assigned, pending)
+    return assigned, pending
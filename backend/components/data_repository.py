@@ -49,6 +49,18 @@ class SqliteDataRepository(IDataRepository):
         """Associa um coredump a um cluster (ou desassocia se cluster_id=None)."""
         return db_manager.assign_cluster_to_coredump(coredump_id, cluster_id)
 
+    def save_crash_fingerprint(self, mac: str, fingerprint: str, coredump_id: int) -> None:
+        """Associa a impressão digital da falha ao coredump completo recebido."""
+        db_manager.add_crash_fingerprint(mac, fingerprint, coredump_id)
+
+    def bump_crash_fingerprint(self, mac: str, fingerprint: str) -> Optional[tuple[int, Optional[int], int]]:
+        """Conta uma ocorrência repetida; retorna (coredump_id, cluster_id, ocorrências) ou None."""
+        return db_manager.bump_crash_fingerprint(mac, fingerprint)
+
+    def save_boot_metrics(self, mac: str, metrics: dict[str, Any], received_at: int) -> None:
+        """Grava os tempos do boot ao fim do upload publicados pelo dispositivo."""
+        db_manager.add_boot_metrics(mac, metrics, received_at)
+
     # ---- CRUD usados pela GUI ----
     def create_database(self) -> None:
         db_manager.create_database()
@@ -4,7 +4,7 @@ from pathlib import Path
 from typing import Optional
 
 from ..ports import ICoreDumpParser
-from ..coredump_interpreter import generate_coredump_report_docker
+from ..coredump_interpreter import generate_coredump_report
 
 
 class DockerCoredumpParser(ICoreDumpParser):
@@ -14,12 +14,14 @@ class DockerCoredumpParser(ICoreDumpParser):
         elf_path: Path,
         out_dir: Path,
         chip_type: Optional[str],
+        core_format: str = "raw",
     ) -> Path:
-        return generate_coredump_report_docker(
+        return generate_coredump_report(
             coredump_path=raw_path,
             elf_path=elf_path,
             output_dir=out_dir,
             chip_type=chip_type,
+            core_format=core_format,
         )
 
 
@@ -0,0 +1,158 @@
+"""Fila limitada de processamento de coredumps (cadastro e relatórios).
+
+Os receptores entregam aqui cada coredump gravado; um número fixo de workers o cadastra e
+interpreta. Com a fila cheia, 'submit' bloqueia quem entrega: os handlers HTTP param de ler e
+o próprio transporte segura os dispositivos, em vez de o backend acumular threads e imagens
+sem limite. O receptor MQTT não bloqueia o laço de rede: entrega por 'submit_nowait', numa
+espera de ingestão sem limite (o que aguarda vaga já está gravado em disco) cuja profundidade
+entra nas estatísticas e gera um aviso ao passar de PROCESSING_BACKLOG_WARN.
+"""
+from __future__ import annotations
+
+import logging
+import os
+import queue
+import threading
+import time
+from dataclasses import dataclass
+from typing import Any, Callable, Dict, List, Optional, Tuple
+
+logger = logging.getLogger("backend.components.processing_pool")
+
+# Workers simultâneos (padrão: núcleos da máquina) e tarefas aguardando na fila
+PROCESSING_WORKERS: int = max(1, int(os.getenv("COREDUMP_PROCESSING_WORKERS", "0")) or (os.cpu_count() or 1))
+PROCESSING_QUEUE: int = max(1, int(os.getenv("COREDUMP_PROCESSING_QUEUE", "64")))
+# Entregas sem bloqueio aguardando vaga na fila a partir das quais o backend avisa
+PROCESSING_BACKLOG_WARN: int = max(1, int(os.getenv("COREDUMP_PROCESSING_BACKLOG_WARN", "64")))
+
+
+@dataclass
+class PoolStats:
+    """Contadores de uso da fila, para acompanhar a contrapressão."""
+
+    queued: int = 0  # Tarefas aguardando agora
+    peak_queued: int = 0  # Maior fila observada
+    running: int = 0  # Tarefas em execução agora
+    submitted: int = 0
+    completed: int = 0
+    failed: int = 0
+    blocked: int = 0  # Entregas que encontraram a fila cheia
+    blocked_seconds: float = 0.0  # Tempo total que os receptores ficaram bloqueados
+    max_wait_seconds: float = 0.0  # Maior espera entre a entrega e o início da tarefa
+    backlog: int = 0  # Entregas sem bloqueio aguardando vaga na fila agora
+    peak_backlog: int = 0  # Maior espera de ingestão observada
+
+
+class ProcessingPool:
+    def __init__(
+        self,
+        workers: int = PROCESSING_WORKERS,
+        max_queued: int = PROCESSING_QUEUE,
+        name: str = "coredump_proc",
+        backlog_warn: int = PROCESSING_BACKLOG_WARN,
+    ) -> None:
+        self.workers = workers
+        self._queue: "queue.Queue[Tuple[float, str, Callable[..., Any], tuple]]" = queue.Queue(maxsize=max_queued)
+        self._stats = PoolStats()
+        self._lock = threading.Lock()
+        self._threads: List[threading.Thread] = []
+        self._name = name
+        # Entregas de submit_nowait: a thread de ingestão espera pela fila no lugar de quem entrega
+        self._backlog: "queue.SimpleQueue[Tuple[str, Callable[..., Any], tuple]]" = queue.SimpleQueue()
+        self._backlog_warn = backlog_warn
+        self._backlog_warned = False
+        self._ingest: Optional[threading.Thread] = None
+
+    def _start(self) -> None:
+        """Cria os workers na primeira entrega (chamado com o lock)."""
+        for i in range(self.workers):
+            thread = threading.Thread(target=self._worker, name=f"{self._name}_{i}", daemon=True)
+            thread.start()
+            self._threads.append(thread)
+        logger.info("processamento.iniciado workers=%d fila=%d", self.workers, self._queue.maxsize)
+
+    def submit(self, label: str, fn: Callable[..., Any], *args: Any) -> None:
+        """Enfileira 'fn(*args)'; bloqueia enquanto a fila estiver cheia."""
+        item = (time.monotonic(), label, fn, args)
+        with self._lock:
+            if not self._threads:
+                self._start()
+            self._stats.submitted += 1
+        try:
+            self._queue.put_nowait(item)
+        except queue.Full:
+            started = time.monotonic()
+            logger.warning("processamento.fila_cheia tarefa=%s fila=%d aguardando", label, self._queue.maxsize)
+            self._queue.put(item)
+            waited = time.monotonic() - started
+            with self._lock:
+                self._stats.blocked += 1
+                self._stats.blocked_seconds += waited
+        with self._lock:
+            self._stats.peak_queued = max(self._stats.peak_queued, self._queue.qsize())
+
+    def submit_nowait(self, label: str, fn: Callable[..., Any], *args: Any) -> None:
+        """Enfileira 'fn(*args)' sem bloquear: com a fila cheia, aguarda na espera de ingestão."""
+        with self._lock:
+            if self._ingest is None:
+                self._ingest = threading.Thread(target=self._ingest_loop, name=f"{self._name}_ingest", daemon=True)
+                self._ingest.start()
+            self._stats.backlog += 1
+            backlog = self._stats.backlog
+            self._stats.peak_backlog = max(self._stats.peak_backlog, backlog)
+            warn = backlog > self._backlog_warn and not self._backlog_warned
+            if warn:
+                self._backlog_warned = True
+        self._backlog.put((label, fn, args))
+        if warn:
+            logger.warning(
+                "processamento.ingestao_acumulada tarefa=%s aguardando=%d limite_aviso=%d fila=%d",
+                label, backlog, self._backlog_warn, self._queue.maxsize,
+            )
+
+    def _ingest_loop(self) -> None:
+        while True:
+            label, fn, args = self._backlog.get()
+            self.submit(label, fn, *args)
+            with self._lock:
+                self._stats.backlog -= 1
+                if self._stats.backlog <= self._backlog_warn // 2:
+                    self._backlog_warned = False  # Avisa de novo se voltar a acumular
+
+    def stats(self) -> Dict[str, Any]:
+        with self._lock:
+            self._stats.queued = self._queue.qsize()
+            return dict(vars(self._stats), workers=self.workers, capacity=self._queue.maxsize)
+
+    def _worker(self) -> None:
+        while True:
+            submitted_at, label, fn, args = self._queue.get()
+            wait = time.monotonic() - submitted_at
+            with self._lock:
+                self._stats.running += 1
+                self._stats.max_wait_seconds = max(self._stats.max_wait_seconds, wait)
+            ok = False
+            try:
+                fn(*args)
+                ok = True
+            except Exception:
+                logger.exception("processamento.excecao tarefa=%s", label)
+            finally:
+                with self._lock:
+                    self._stats.running -= 1
+                    if ok:
+                        self._stats.completed += 1
+                    else:
+                        self._stats.failed += 1
+                self._queue.task_done()
+
+
+def format_stats(stats: Dict[str, Any]) -> str:
+    """Linha de log com os contadores de 'ProcessingPool.stats()'."""
+    return (
+        "workers={workers} fila={queued}/{capacity} pico={peak_queued} executando={running} "
+        "entregues={submitted} concluidas={completed} falhas={failed} bloqueios={blocked} "
+        "bloqueado_s={blocked_seconds:.1f} espera_max_s={max_wait_seconds:.1f} "
+        "ingestao={backlog} pico_ingestao={peak_backlog}".format(**stats)
+    )
+
@@ -0,0 +1,314 @@
+"""Receptor HTTP(S) de coredumps.
+
+Alternativa ao protocolo por partes do MQTT para o transporte HTTP do firmware
+(main/coredump_uploader/coredump_http.c): cada coredump chega num único
+`POST <COREDUMP_HTTP_PATH>/<mac>`, normalmente com "Transfer-Encoding: chunked".
+Os metadados da mensagem inicial do MQTT vêm em cabeçalhos:
+
+  X-Coredump-Bytes  tamanho do fluxo enviado (obrigatório)
+  X-Coredump-Size   tamanho da imagem descomprimida
+  X-Coredump-Crc    CRC32 da imagem descomprimida (hex)
+  X-Coredump-Id     checksum gravado no fim da imagem (hex)
+  X-Coredump-Enc    "raw" (único aceito: o corpo HTTP é binário)
+  X-Coredump-Comp   "deflate" para raw deflate (RFC 1951)
+  X-Coredump-Fp     impressão digital da falha, para deduplicação
+  X-Coredump-Prefix tamanho do prefixo com a task que falhou (imagem reordenada)
+  X-Coredump-First  índices dos program headers do prefixo, separados por vírgula
+
+O corpo é descomprimido e gravado em disco à medida que chega, sem montar a
+imagem em memória; o CRC é conferido antes de o arquivo ganhar o nome final.
+Com X-Coredump-Prefix, o prefixo gera um relatório preliminar assim que chega e
+a imagem volta à ordem da flash depois de conferida.
+O cadastro e o relatório seguem o mesmo caminho dos coredumps recebidos via MQTT.
+"""
+from __future__ import annotations
+
+import json
+import logging
+import os
+import ssl
+import struct
+import threading
+import time
+import uuid
+import zlib
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from typing import Any, Dict, Iterator, Optional
+from urllib.parse import urlsplit
+
+from dotenv import load_dotenv
+
+from ..ports import IDataRepository, ICoreDumpParser, ICoreDumpIngestor
+from .receiver_mqtt import (
+    COMPRESSION_DEFLATE,
+    ENCODING_RAW,
+    RAWS_OUTPUT_DIR,
+    SUPPORTED_COMPRESSIONS,
+    InflateLimitError,
+    MemberInflater,
+    _Assembler,
+    raw_coredump_path,
+    restore_image_order,
+)
+
+# Carrega variáveis de ambiente do arquivo .env
+load_dotenv()
+
+logger = logging.getLogger("backend.components.receiver_http")
+
+# Variáveis opcionais - com valores padrão (porta 0 desabilita o receptor HTTP)
+HTTP_PORT: int = int(os.getenv("COREDUMP_HTTP_PORT", "0"))
+HTTP_BIND: str = os.getenv("COREDUMP_HTTP_BIND", "0.0.0.0")
+HTTP_PATH: str = "/" + os.getenv("COREDUMP_HTTP_PATH", "/coredump").strip("/")
+HTTP_TOKEN: str = os.getenv("COREDUMP_HTTP_TOKEN", "")
+HTTP_CERTFILE: str = os.getenv("COREDUMP_HTTP_CERTFILE", "")
+HTTP_KEYFILE: str = os.getenv("COREDUMP_HTTP_KEYFILE", "")
+HTTP_MAX_BYTES: int = int(os.getenv("COREDUMP_HTTP_MAX_BYTES", str(8 * 1024 * 1024)))
+# Maior imagem descomprimida aceita: limita o inflate quando X-Coredump-Size não vem ou é exagerado
+HTTP_MAX_IMAGE_BYTES: int = int(os.getenv("COREDUMP_HTTP_MAX_IMAGE_BYTES", str(16 * 1024 * 1024)))
+
+# Leitura do corpo em blocos: limita a memória por requisição independentemente do tamanho do dump
+READ_BLOCK: int = 64 * 1024
+
+
+class RequestError(Exception):
+    def __init__(self, status: int, reason: str) -> None:
+        super().__init__(reason)
+        self.status = status
+        self.reason = reason
+
+
+def iter_chunked(rfile: Any) -> Iterator[bytes]:
+    """Itera sobre os dados de um corpo "Transfer-Encoding: chunked" (RFC 9112, seção 7.1)."""
+    while True:
+        line = rfile.readline(1024)
+        if not line.endswith(b"\n"):
+            raise RequestError(400, "cabeçalho de chunk inválido")
+        try:
+            size = int(line.split(b";", 1)[0].strip(), 16)
+        except ValueError:
+            raise RequestError(400, "tamanho de chunk inválido") from None
+        if size == 0:
+            # Trailers opcionais até a linha vazia
+            while rfile.readline(1024) not in (b"\r\n", b"\n", b""):
+                pass
+            return
+        remaining = size
+        while remaining:
+            data = rfile.read(min(remaining, READ_BLOCK))
+            if not data:
+                raise RequestError(400, "corpo truncado")
+            remaining -= len(data)
+            yield data
+        if rfile.readline(1024) not in (b"\r\n", b"\n"):
+            raise RequestError(400, "fim de chunk inválido")
+
+
+def iter_sized(rfile: Any, length: int) -> Iterator[bytes]:
+    """Itera sobre um corpo com Content-Length."""
+    remaining = length
+    while remaining:
+        data = rfile.read(min(remaining, READ_BLOCK))
+        if not data:
+            raise RequestError(400, "corpo truncado")
+        remaining -= len(data)
+        yield data
+
+
+class _Handler(BaseHTTPRequestHandler):
+    # HTTP/1.1: a conexão (e a sessão TLS) permanece aberta entre uploads do mesmo dispositivo
+    protocol_version = "HTTP/1.1"
+    server_version = "CoredumpReceiver/1.0"
+
+    def log_message(self, fmt: str, *args: Any) -> None:
+        logger.debug("http.%s %s", self.address_string(), fmt % args)
+
+    def _reply(self, status: int, body: Dict[str, Any]) -> None:
+        data = json.dumps(body).encode("utf-8")
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        if self.close_connection:
+            self.send_header("Connection", "close")
+        self.end_headers()
+        self.wfile.write(data)
+
+    def do_POST(self) -> None:
+        receiver: HttpReceiver = self.server.receiver  # type: ignore[attr-defined]
+        try:
+            self._reply(200, receiver.ingest(self))
+        except RequestError as exc:
+            # O corpo pode não ter sido lido até o fim: a conexão não é reaproveitável
+            self.close_connection = True
+            logger.warning("http.requisicao_rejeitada cliente=%s status=%d motivo=%s", self.client_address[0], exc.status, exc.reason)
+            self._reply(exc.status, {"error": exc.reason})
+        except Exception:
+            self.close_connection = True
+            logger.exception("http.excecao cliente=%s path=%s", self.client_address[0], self.path)
+            self._reply(500, {"error": "erro interno"})
+
+
+class HttpReceiver(ICoreDumpIngestor):
+    def __init__(
+        self,
+        repo: IDataRepository,
+        parser: ICoreDumpParser,
+        assembler: Optional[_Assembler] = None,
+        port: int = HTTP_PORT,
+    ) -> None:
+        self.repo = repo
+        self.parser = parser
+        # Compartilhado com o receptor MQTT: mesmo cadastro e mesmas assinaturas de resumo
+        self.assembler = assembler or _Assembler(repo, parser)
+        self.port = port
+        self.server: Optional[ThreadingHTTPServer] = None
+
+    def start(self) -> None:
+        if self.server is not None:
+            return
+        server = ThreadingHTTPServer((HTTP_BIND, self.port), _Handler)
+        server.daemon_threads = True
+        server.receiver = self  # type: ignore[attr-defined]
+        scheme = "http"
+        if HTTP_CERTFILE:
+            context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+            context.load_cert_chain(HTTP_CERTFILE, HTTP_KEYFILE or None)
+            server.socket = context.wrap_socket(server.socket, server_side=True)
+            scheme = "https"
+        self.server = server
+        threading.Thread(target=server.serve_forever, name="coredump_http", daemon=True).start()
+        logger.info("http.escutando %s://%s:%d%s", scheme, HTTP_BIND, server.server_address[1], HTTP_PATH)
+
+    def stop(self) -> None:
+        if self.server is None:
+            return
+        try:
+            self.server.shutdown()
+            self.server.server_close()
+        finally:
+            self.server = None
+
+    def ingest(self, req: BaseHTTPRequestHandler) -> Dict[str, Any]:
+        """Valida a requisição, grava o coredump em disco em fluxo e dispara o cadastro."""
+        path = urlsplit(req.path).path.rstrip("/")
+        prefix, _, mac = path.rpartition("/")
+        if prefix != HTTP_PATH or not mac:
+            raise RequestError(404, "caminho desconhecido")
+        if HTTP_TOKEN and req.headers.get("Authorization", "") != f"Bearer {HTTP_TOKEN}":
+            raise RequestError(401, "não autorizado")
+
+        headers = req.headers
+        try:
+            stream_bytes = int(headers["X-Coredump-Bytes"])
+            raw_size = int(headers["X-Coredump-Size"]) if headers.get("X-Coredump-Size") else None
+            image_crc = int(headers["X-Coredump-Crc"], 16) if headers.get("X-Coredump-Crc") else None
+        except (KeyError, TypeError, ValueError):
+            raise RequestError(400, "cabeçalhos X-Coredump-* ausentes ou inválidos") from None
+        encoding = headers.get("X-Coredump-Enc", ENCODING_RAW)
+        if encoding != ENCODING_RAW:
+            raise RequestError(415, f"codificação {encoding} não suportada via HTTP")
+        compression = headers.get("X-Coredump-Comp")
+        if compression is not None and compression not in SUPPORTED_COMPRESSIONS:
+            raise RequestError(415, f"compressão {compression} desconhecida")
+        if stream_bytes <= 0 or stream_bytes > HTTP_MAX_BYTES:
+            raise RequestError(413, f"fluxo de {stream_bytes} bytes fora do limite")
+        if raw_size is not None and not 0 < raw_size <= HTTP_MAX_IMAGE_BYTES:
+            raise RequestError(413, f"imagem de {raw_size} bytes fora do limite")
+        # Teto da saída do inflate: o tamanho declarado ou, sem ele, o maior aceito
+        image_limit = raw_size if raw_size is not None else HTTP_MAX_IMAGE_BYTES
+        fingerprint = headers.get("X-Coredump-Fp")
+        try:
+            prefix_size = int(headers["X-Coredump-Prefix"]) if headers.get("X-Coredump-Prefix") else 0
+            first = [int(i) for i in headers.get("X-Coredump-First", "").split(",") if i.strip()]
+        except ValueError:
+            raise RequestError(400, "X-Coredump-Prefix ou X-Coredump-First inválido") from None
+        if not first or (raw_size is not None and prefix_size > raw_size):
+            prefix_size = 0
+
+        if "chunked" in headers.get("Transfer-Encoding", "").lower():
+            body = iter_chunked(req.rfile)
+        elif headers.get("Content-Length"):
+            length = int(headers["Content-Length"])
+            if length != stream_bytes:
+                raise RequestError(400, f"Content-Length {length} difere de X-Coredump-Bytes {stream_bytes}")
+            body = iter_sized(req.rfile, length)
+        else:
+            raise RequestError(411, "corpo sem tamanho")
+
+        started = time.monotonic()
+        safe_mac = mac.replace(":", "").replace("-", "").upper()
+        tmp = RAWS_OUTPUT_DIR / f".{safe_mac}_{uuid.uuid4().hex}.part"
+        inflater = MemberInflater() if compression == COMPRESSION_DEFLATE else None
+        # Só o prefixo fica em memória, até completar
+        prefix = bytearray() if prefix_size else None
+        received = 0
+        size = 0
+        crc = 0
+        try:
+            with tmp.open("wb") as out:
+                for data in body:
+                    received += len(data)
+                    if received > stream_bytes:
+                        raise RequestError(400, f"corpo excede os {stream_bytes} bytes declarados")
+                    if inflater is not None:
+                        try:
+                            data = inflater.decompress(data, image_limit - size)
+                        except InflateLimitError:
+                            raise RequestError(413, f"imagem descomprimida excede {image_limit} bytes") from None
+                        except zlib.error as exc:
+                            raise RequestError(422, f"fluxo deflate inválido: {exc}") from None
+                    size += len(data)
+                    if size > image_limit:
+                        raise RequestError(413 if raw_size is None else 422, f"imagem excede {image_limit} bytes")
+                    crc = zlib.crc32(data, crc)
+                    out.write(data)
+                    if prefix is not None:
+                        prefix += data[: prefix_size - len(prefix)]
+                        if len(prefix) == prefix_size:
+                            self.assembler.register_prefix(mac, bytes(prefix), first)
+                            prefix = None
+                if inflater is not None:
+                    tail = inflater.flush()
+                    size += len(tail)
+                    if size > image_limit:
+                        raise RequestError(413, f"imagem descomprimida excede {image_limit} bytes")
+                    crc = zlib.crc32(tail, crc)
+                    out.write(tail)
+                    if not inflater.eof:
+                        raise RequestError(422, "fluxo deflate truncado")
+            if received != stream_bytes:
+                raise RequestError(400, f"recebidos {received} de {stream_bytes} bytes")
+            if raw_size is not None and size != raw_size:
+                raise RequestError(422, f"tamanho {size} difere do declarado {raw_size}")
+            if image_crc is not None and crc != image_crc:
+                raise RequestError(422, f"crc {crc:08x} difere do declarado {image_crc:08x}")
+            if prefix_size:
+                try:
+                    tmp.write_bytes(restore_image_order(tmp.read_bytes(), first))
+                except (ValueError, struct.error) as exc:
+                    raise RequestError(422, f"ordem de envio inválida: {exc}") from None
+            received_at = int(time.time())
+            filepath = raw_coredump_path(mac, received_at)
+            tmp.replace(filepath)
+        finally:
+            tmp.unlink(missing_ok=True)
+
+        elapsed = time.monotonic() - started
+        logger.info(
+            "http.coredump_recebido mac=%s arquivo=%s bytes=%d tamanho=%d comp=%s duracao_ms=%d",
+            mac, filepath, received, size, compression, int(elapsed * 1000),
+        )
+        self.assembler.register_coredump(mac, str(filepath), received_at, fingerprint)
+        return {"bytes": received, "size": size, "crc": f"{crc:08x}"}
+
+
+def create_http_receiver(
+    repo: IDataRepository, parser: ICoreDumpParser, assembler: Optional[_Assembler] = None
+) -> Optional[HttpReceiver]:
+    """Cria o receptor HTTP se COREDUMP_HTTP_PORT estiver definido (porta > 0)."""
+    if HTTP_PORT <= 0:
+        return None
+    return HttpReceiver(repo, parser, assembler)
+
+
+__all__ = ["HttpReceiver", "create_http_receiver"]
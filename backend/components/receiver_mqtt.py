@@ -1,21 +1,27 @@
 from __future__ import annotations
 
 import base64
+import hashlib
 import json
 import logging
 import os
+import struct
 import threading
 import time
+import zlib
 from dataclasses import dataclass, field
 from datetime import datetime, timezone, timedelta
 from pathlib import Path
-from typing import Any, Dict, Optional, Tuple
+from typing import Any, Callable, Dict, List, Optional, Sequence, Tuple
 
 from dotenv import load_dotenv
 from paho import mqtt
 import paho.mqtt.client as paho
+from paho.mqtt.packettypes import PacketTypes
+from paho.mqtt.properties import Properties
 
 from ..ports import IDataRepository, ICoreDumpParser, ICoreDumpIngestor
+from .processing_pool import ProcessingPool, format_stats
 
 # Carrega variáveis de ambiente do arquivo .env
 load_dotenv()
@@ -41,34 +47,275 @@ MQTT_PORT: int = int(MQTT_PORT_STR)
 
 # Variáveis opcionais - com valores padrão
 BASE_TOPIC: str = os.getenv("MQTT_BASE_TOPIC", "coredump")
+METRICS_TOPIC: str = os.getenv("MQTT_METRICS_TOPIC", "metrics")
 SESSION_TIMEOUT: int = int(os.getenv("COREDUMP_TIMEOUT_SECONDS", "600"))
+RESUME_TTL: int = int(os.getenv("COREDUMP_RESUME_TTL_SECONDS", "86400"))
+ACK_EVERY: int = max(1, int(os.getenv("COREDUMP_ACK_EVERY", "8")))
 RAWS_OUTPUT_DIR: Path = Path(os.getenv("COREDUMP_RAWS_OUTPUT_DIR", "db/coredumps/raws"))
 REPORTS_OUTPUT_DIR: Path = Path(os.getenv("COREDUMP_REPORTS_OUTPUT_DIR", "db/coredumps/reports"))
+SUMMARIES_OUTPUT_DIR: Path = Path(os.getenv("COREDUMP_SUMMARIES_OUTPUT_DIR", "db/coredumps/summaries"))
+# Armazenamento de blocos endereçados pelo conteúdo (firmware com CONFIG_COREDUMP_UPLOADER_BLOCK_DEDUP)
+BLOCKS_OUTPUT_DIR: Path = Path(os.getenv("COREDUMP_BLOCKS_OUTPUT_DIR", "db/coredumps/blocks"))
 ACCEPT_BASE64: bool = os.getenv("COREDUMP_ACCEPT_BASE64", "1") not in ("0", "false", "False")
+# Relatório preliminar a partir do prefixo (task que falhou), antes da imagem completa
+PREFIX_REPORTS: bool = os.getenv("COREDUMP_PREFIX_REPORTS", "1") not in ("0", "false", "False")
+# Transporte por busca: imagem completa (1) ou só cabeçalhos e segmentos da task que falhou (0)
+PULL_FULL: bool = os.getenv("COREDUMP_PULL_FULL", "1") not in ("0", "false", "False")
+# Pedidos de intervalo sem resposta ao mesmo tempo, por dispositivo
+PULL_WINDOW: int = max(1, int(os.getenv("COREDUMP_PULL_WINDOW", "4")))
+# Intervalo pedido e não recebido após este tempo é pedido de novo
+PULL_RETRY_SECONDS: int = int(os.getenv("COREDUMP_PULL_RETRY_SECONDS", "15"))
+# MQTT 5: partes em <BASE_TOPIC>/<mac>/part com propriedades de usuário (firmware com CONFIG_MQTT_APP_PROTOCOL_V5)
+MQTT_PROTOCOL_V5: bool = os.getenv("MQTT_PROTOCOL_V5", "0") not in ("0", "false", "False")
+# Receive Maximum anunciado ao broker: publicações QoS>0 entregues ao backend sem confirmação
+MQTT_RECEIVE_MAXIMUM: int = max(1, min(65535, int(os.getenv("MQTT_RECEIVE_MAXIMUM", "64"))))
 
 RAWS_OUTPUT_DIR.mkdir(parents=True, exist_ok=True)
 REPORTS_OUTPUT_DIR.mkdir(parents=True, exist_ok=True)
+SUMMARIES_OUTPUT_DIR.mkdir(parents=True, exist_ok=True)
+BLOCKS_OUTPUT_DIR.mkdir(parents=True, exist_ok=True)
+
+
+# Codificações declaradas pelo firmware no campo "enc" da mensagem inicial
+ENCODING_RAW: str = "raw"
+ENCODING_BASE64: str = "base64"
+SUPPORTED_ENCODINGS = (ENCODING_RAW, ENCODING_BASE64)
+
+# Sufixo do tópico onde o backend confirma as partes recebidas: <BASE_TOPIC>/<mac>/ack
+ACK_TOPIC_SUFFIX: str = "ack"
+
+# Sufixo do tópico do resumo da falha, publicado antes da imagem: <BASE_TOPIC>/<mac>/summary
+SUMMARY_TOPIC_SUFFIX: str = "summary"
+
+# Sufixo do tópico de ocorrências repetidas (só contador, sem imagem): <BASE_TOPIC>/<mac>/dup
+DUP_TOPIC_SUFFIX: str = "dup"
+
+# Sufixo do tópico único das partes no MQTT 5: <BASE_TOPIC>/<mac>/part, com índice, CRC32 do payload
+# e, se o particionamento for fixo, total nos dados de correlação (uint32 big-endian cada); firmwares
+# anteriores usam as propriedades de usuário "n", "crc" (em hex) e "of"
+PART_TOPIC_SUFFIX: str = "part"
+
+# Transporte por busca: pedidos {"off","len","id"}, "index" e {"release": id} em <BASE_TOPIC>/<mac>/fetch,
+# respostas em <BASE_TOPIC>/<mac>/range/<offset>/<crc32 em hex> e liberação ou pedido recusado em
+# <BASE_TOPIC>/<mac>/pull. O "id" é o do anúncio: o dispositivo recusa pedidos e liberações de outra imagem.
+FETCH_TOPIC_SUFFIX: str = "fetch"
+RANGE_TOPIC_SUFFIX: str = "range"
+PULL_STATUS_TOPIC_SUFFIX: str = "pull"
+PULL_RELEASE_COMMAND: str = "release"
+
+# Envio por blocos: manifesto em <BASE_TOPIC>/<mac>/manifest, blocos faltantes ("need", bitmap em hex)
+# ou conclusão ("done") em <BASE_TOPIC>/<mac>/need e blocos em <BASE_TOPIC>/<mac>/block/<índice>/<crc32>
+MANIFEST_TOPIC_SUFFIX: str = "manifest"
+NEED_TOPIC_SUFFIX: str = "need"
+BLOCK_TOPIC_SUFFIX: str = "block"
+# Bytes do SHA256 que endereçam um bloco (COREDUMP_UPLOADER_BLOCK_HASH_SIZE no firmware)
+BLOCK_HASH_SIZE: int = 8
+
+# Quantidade de endereços do backtrace usados na assinatura do resumo
+SIGNATURE_BT_DEPTH: int = 8
+
+# Compressões declaradas no campo "comp"; "deflate" = raw deflate (RFC 1951, sem cabeçalho zlib)
+COMPRESSION_DEFLATE: str = "deflate"
+SUPPORTED_COMPRESSIONS = (COMPRESSION_DEFLATE,)
+
+# ELF32 gravado pelo esp_core_dump logo após o seu cabeçalho (tamanho variável com a versão)
+ELF_MAGIC: bytes = b"\x7fELF"
+ELF_SEARCH_LIMIT: int = 64
+ELF_EHDR = struct.Struct("<16sHHIIIIIHHHHHH")
+ELF_PHDR = struct.Struct("<IIIIIIII")
 
 
 @dataclass
 class CoreDumpSession:
+    """Upload em partes de um dispositivo.
+
+    Com "bytes" na mensagem inicial, as partes contíguas são gravadas assim que chegam em
+    'stream_path' (preenchido até o tamanho declarado): descomprimidas, na posição final da
+    imagem e com o CRC32 calculado no caminho. Só as partes fora de ordem ficam em memória.
+    Firmware legado (sem "bytes") mantém todas as partes em memória até a montagem.
+    """
+
     mac: str
-    expected_parts: int
+    expected_parts: Optional[int]  # None = particionamento adaptativo; conclusão por stream_bytes
+    stream_bytes: Optional[int] = None  # Bytes do fluxo (antes do Base64) declarados em "bytes"
+    encoding: Optional[str] = None  # None = firmware legado, sem "enc" na mensagem inicial
+    compression: Optional[str] = None  # None = partes concatenadas já formam o coredump
+    raw_size: Optional[int] = None  # Tamanho do coredump descomprimido, se informado
+    image_crc: Optional[int] = None  # CRC32 do coredump descomprimido ("crc"), se informado
+    fingerprint: Optional[str] = None  # Impressão digital da falha ("fp"), para deduplicação
+    image_id: Optional[str] = None  # Checksum da imagem; presente = firmware com suporte a retomada
+    prefix_size: Optional[int] = None  # Bytes do prefixo interpretável ("pfx"), se a imagem vier reordenada
+    first_segments: Tuple[int, ...] = ()  # Program headers enviados no prefixo ("first"), em ordem
+    stream_path: Optional[Path] = None  # Arquivo parcial da gravação em fluxo (None = montagem em memória)
     start_time: float = field(default_factory=time.time)
-    parts: Dict[int, bytes] = field(default_factory=dict)
+    last_activity: float = field(default_factory=time.time)
+    parts: Dict[int, bytes] = field(default_factory=dict)  # Partes ainda não gravadas
     completed: bool = False
+    acked: int = -1  # Última marca d'água publicada no tópico de ACK
+    resend: bool = False  # Parte rejeitada por CRC: próximo ACK pede reenvio
+    prefix_taken: bool = False  # Prefixo já entregue para o relatório preliminar
+    prefix_data: bytearray = field(default_factory=bytearray)
+    prefix_fed: int = 0  # Sem gravação em fluxo: partes contíguas já consumidas na montagem do prefixo
+    prefix_inflater: Optional["MemberInflater"] = None
+    flushed_parts: int = 0  # Partes contíguas já gravadas em 'stream_path'
+    flushed_bytes: int = 0  # Bytes do fluxo que elas somam
+    raw_written: int = 0  # Bytes da imagem (descomprimida, na ordem de envio) já gravados
+    raw_crc: int = 0  # CRC32 parcial desses bytes
+    inflater: Optional["MemberInflater"] = None
+    layout: Optional[List[Tuple[int, int, Optional[int]]]] = None  # (início no fluxo, offset na imagem, tamanho)
+    pending_raw: bytearray = field(default_factory=bytearray)  # Início da imagem reordenada, até conhecer 'layout'
+
+    @property
+    def streaming(self) -> bool:
+        return self.stream_path is not None
+
+    def open_stream(self, path: Path) -> None:
+        """Cria o arquivo parcial, preenchido até o tamanho final da imagem quando declarado."""
+        with open(path, "wb") as f:
+            if self.raw_size:
+                f.truncate(self.raw_size)
+        self.stream_path = path
+
+    def discard(self) -> None:
+        """Apaga o arquivo parcial de uma sessão abandonada."""
+        if self.stream_path is not None and not self.completed:
+            self.stream_path.unlink(missing_ok=True)
+
+    def same_upload(
+        self,
+        expected_parts: Optional[int],
+        stream_bytes: Optional[int],
+        encoding: Optional[str],
+        compression: Optional[str],
+        image_id: Optional[str],
+    ) -> bool:
+        """Indica se uma nova mensagem inicial se refere a esta mesma imagem e fluxo."""
+        return (
+            image_id is not None
+            and self.image_id == image_id
+            and self.expected_parts == expected_parts
+            and self.stream_bytes == stream_bytes
+            and self.encoding == encoding
+            and self.compression == compression
+        )
+
+    def contiguous(self) -> Tuple[int, int]:
+        """Partes contíguas recebidas a partir da parte 1 e total de bytes (decodificados) que somam."""
+        n = self.flushed_parts
+        total = self.flushed_bytes
+        while (n + 1) in self.parts:
+            n += 1
+            total += len(self.parts[n])
+        return n, total
+
+    def discard_after_contiguous(self) -> int:
+        """Descarta partes além do prefixo contíguo; retorna quantas foram descartadas.
+
+        Na retomada o dispositivo reenvia a partir da primeira parte faltante, possivelmente
+        com outro particionamento (modo adaptativo), então partes soltas não são reaproveitáveis.
+        """
+        count, _ = self.contiguous()
+        stale = [i for i in self.parts if i > count]
+        for i in stale:
+            del self.parts[i]
+        return len(stale)
 
     def add_part(self, index: int, data: bytes) -> None:
-        if index < 0 or index >= self.expected_parts + 1:
+        if self.expected_parts is not None:
+            out_of_range = index < 0 or index >= self.expected_parts + 1
+        else:
+            # Sem quantidade declarada: partes numeradas a partir de 1, cada uma com ao menos 1 byte
+            out_of_range = index < 1 or index > (self.stream_bytes or 0)
+        if out_of_range:
             logger.warning("parte.fora_intervalo mac=%s index=%s", self.mac, index)
             return
-        if index in self.parts:
+        if index in self.parts or (self.streaming and index <= self.flushed_parts):
             return
         self.parts[index] = data
 
+    def flush(self) -> None:
+        """Grava as partes contíguas pendentes. Lança ValueError se o fluxo for inválido."""
+        if not self.streaming:
+            return
+        with open(self.stream_path, "r+b") as f:
+            while (self.flushed_parts + 1) in self.parts:
+                data = self.parts.pop(self.flushed_parts + 1)
+                self.flushed_parts += 1
+                self.flushed_bytes += len(data)
+                if self.compression == COMPRESSION_DEFLATE:
+                    if self.inflater is None:
+                        self.inflater = MemberInflater()
+                    try:
+                        data = self.inflater.decompress(data)
+                    except zlib.error as exc:
+                        raise ValueError(f"fluxo deflate inválido: {exc}") from exc
+                self._emit(f, data)
+
+    def _emit(self, f: Any, raw: bytes) -> None:
+        """Grava bytes da imagem na ordem de envio, já na posição final."""
+        if not raw:
+            return
+        self.raw_crc = zlib.crc32(raw, self.raw_crc)
+        if self.prefix_size is not None and not self.prefix_taken and len(self.prefix_data) < self.prefix_size:
+            self.prefix_data += raw[: self.prefix_size - len(self.prefix_data)]
+        start = self.raw_written
+        self.raw_written += len(raw)
+        if self.raw_size is not None and self.raw_written > self.raw_size:
+            raise ValueError(f"imagem com mais de {self.raw_size} bytes declarados")
+        if not self.first_segments:
+            f.seek(start)
+            f.write(raw)
+            return
+        if self.layout is None:
+            self.pending_raw += raw
+            self._locate_layout()
+            if self.layout is None:
+                return
+            start, raw = 0, bytes(self.pending_raw)
+            self.pending_raw = bytearray()
+        end = start + len(raw)
+        for s_start, offset, size in self.layout:
+            s_end = end if size is None else s_start + size
+            a, b = max(start, s_start), min(end, s_end)
+            if a < b:
+                f.seek(offset + (a - s_start))
+                f.write(raw[a - start : b - start])
+
+    def _locate_layout(self) -> None:
+        """Com os cabeçalhos recebidos, mapeia cada trecho do fluxo para sua posição na imagem."""
+        head = bytes(self.pending_raw)
+        try:
+            _, _, header_end = _elf_layout(head, partial=True)
+        except (ValueError, struct.error):
+            if len(head) >= ELF_SEARCH_LIMIT + ELF_EHDR.size:
+                raise ValueError("ELF não encontrado na imagem reordenada")
+            return
+        if len(head) < header_end:
+            return
+        header_end, ranges = _first_ranges(head, self.first_segments)
+        layout: List[Tuple[int, int, Optional[int]]] = [(0, 0, header_end)]
+        pos = header_end
+        for offset, size in ranges:
+            if offset < header_end or (self.raw_size is not None and offset + size > self.raw_size):
+                raise ValueError(f"segmento fora da imagem (offset {offset}, {size} bytes)")
+            layout.append((pos, offset, size))
+            pos += size
+        cursor = header_end
+        for offset, size in sorted(ranges):
+            if offset < cursor:
+                raise ValueError(f"segmentos sobrepostos no offset {offset}")
+            if offset > cursor:
+                layout.append((pos, cursor, offset - cursor))
+                pos += offset - cursor
+            cursor = offset + size
+        layout.append((pos, cursor, None))  # Restante, até o fim da imagem
+        self.layout = layout
+
     def is_complete(self) -> bool:
         if self.completed:
             return True
+        if self.stream_bytes is not None:
+            return self.contiguous()[1] >= self.stream_bytes
         if len(self.parts) < self.expected_parts:
             return False
         idxs = sorted(self.parts.keys())
@@ -78,11 +325,275 @@ class CoreDumpSession:
             idxs[0] == 1 and idxs[-1] == self.expected_parts and len(idxs) == self.expected_parts
         )
 
+    def take_prefix(self) -> Optional[bytes]:
+        """Retorna o prefixo uma única vez, assim que as partes gravadas o cobrem.
+
+        Com compressão, o prefixo é um fluxo deflate próprio, descomprimido à medida que as
+        partes chegam: sai sem esperar o restante da imagem.
+        """
+        if self.prefix_size is None or self.prefix_taken:
+            return None
+        if not self.streaming:
+            self._feed_prefix()
+        if self.prefix_taken or len(self.prefix_data) < self.prefix_size:
+            return None
+        self.prefix_taken = True
+        prefix = bytes(self.prefix_data[: self.prefix_size])
+        self.prefix_data = bytearray()
+        self.prefix_inflater = None
+        return prefix
+
+    def _feed_prefix(self) -> None:
+        """Sem gravação em fluxo: descomprime as partes contíguas ainda em memória até cobrir o prefixo."""
+        count, _ = self.contiguous()
+        try:
+            while self.prefix_fed < count and len(self.prefix_data) < self.prefix_size:
+                self.prefix_fed += 1
+                data = self.parts[self.prefix_fed]
+                if self.compression == COMPRESSION_DEFLATE:
+                    if self.prefix_inflater is None:
+                        self.prefix_inflater = MemberInflater()
+                    data = self.prefix_inflater.decompress(data)
+                self.prefix_data += data
+        except zlib.error as exc:
+            logger.warning("prefixo_invalido mac=%s erro=%s", self.mac, exc)
+            self.prefix_taken = True
+
+    def finish(self) -> None:
+        """Confere a imagem gravada em fluxo: tamanho, fim do deflate, CRC32 e reordenação."""
+        if self.stream_bytes is not None and self.flushed_bytes != self.stream_bytes:
+            raise ValueError(f"fluxo com {self.flushed_bytes} bytes difere do declarado {self.stream_bytes}")
+        if self.compression == COMPRESSION_DEFLATE:
+            inflater = self.inflater or MemberInflater()
+            with open(self.stream_path, "r+b") as f:
+                self._emit(f, inflater.flush())
+            if not inflater.eof:
+                raise ValueError("fluxo deflate truncado")
+        if self.raw_size is not None and self.raw_written != self.raw_size:
+            raise ValueError(f"tamanho {self.raw_written} difere do declarado {self.raw_size}")
+        if self.image_crc is not None and self.raw_crc != self.image_crc:
+            raise ValueError(f"crc {self.raw_crc:08x} difere do declarado {self.image_crc:08x}")
+        if self.first_segments and self.layout is None:
+            raise ValueError("cabeçalhos do ELF incompletos")
+
     def assemble(self) -> bytes:
+        """Montagem em memória das sessões de firmware legado."""
         idxs = sorted(self.parts.keys())
         base = idxs[0]
-        ordered = [self.parts[i] for i in range(base, base + self.expected_parts)]
-        return b"".join(ordered)
+        blob = b"".join(self.parts[i] for i in range(base, base + self.expected_parts))
+        if self.compression == COMPRESSION_DEFLATE:
+            blob = inflate_raw(blob)
+        if self.raw_size is not None and len(blob) != self.raw_size:
+            raise ValueError(f"tamanho {len(blob)} difere do declarado {self.raw_size}")
+        if self.image_crc is not None and zlib.crc32(blob) != self.image_crc:
+            raise ValueError(f"crc {zlib.crc32(blob):08x} difere do declarado {self.image_crc:08x}")
+        if self.first_segments:
+            blob = restore_image_order(blob, self.first_segments)
+        return blob
+
+
+@dataclass
+class PullSession:
+    """Imagem anunciada por firmware com transporte por busca; o backend pede os intervalos.
+
+    Com 'first_segments', os cabeçalhos e os segmentos da task que falhou vêm antes; o
+    restante só é pedido com PULL_FULL. Os bytes recebidos ficam numa imagem esparsa.
+    """
+
+    mac: str
+    size: int
+    image_id: Optional[str]
+    max_range: int
+    first_segments: Tuple[int, ...] = ()
+    fingerprint: Optional[str] = None
+    header_end: Optional[int] = None  # Fim dos program headers, conhecido após o primeiro intervalo
+    segments: List[Tuple[int, int]] = field(default_factory=list)  # (offset, tamanho) dos segmentos de 'first'
+    filled: List[Tuple[int, int]] = field(default_factory=list)  # Intervalos recebidos [início, fim), disjuntos e ordenados
+    in_flight: Dict[int, Tuple[int, float]] = field(default_factory=dict)  # offset -> (tamanho, instante do pedido)
+    prefix_taken: bool = False
+    completed: bool = False  # Tudo recebido: falta apenas a liberação
+    last_activity: float = field(default_factory=time.time)
+    image: bytearray = field(init=False)
+
+    def __post_init__(self) -> None:
+        self.image = bytearray(self.size)
+
+    def missing(self, start: int, end: int) -> List[Tuple[int, int]]:
+        """Trechos de [start, end) ainda não recebidos."""
+        gaps, cursor = [], start
+        for a, b in self.filled:
+            if b <= cursor:
+                continue
+            if a >= end:
+                break
+            if a > cursor:
+                gaps.append((cursor, a))
+            cursor = max(cursor, b)
+        if cursor < end:
+            gaps.append((cursor, end))
+        return gaps
+
+    def targets(self) -> List[Tuple[int, int]]:
+        """Trechos [início, fim) necessários na etapa atual da busca."""
+        if self.first_segments and not self.prefix_taken:
+            if self.header_end is None:
+                return [(0, min(self.size, self.max_range))]  # Descobre os cabeçalhos
+            if not self.segments:
+                return [(0, self.header_end)]
+            return [(0, self.header_end)] + [(o, o + n) for o, n in self.segments]
+        if PULL_FULL or not self.first_segments:
+            return [(0, self.size)]
+        return []
+
+    def requests(self, now: float) -> List[Tuple[int, int]]:
+        """Novos pedidos (offset, tamanho) até PULL_WINDOW sem resposta; inclui os expirados."""
+        for off, (n, at) in list(self.in_flight.items()):
+            if now - at > PULL_RETRY_SECONDS:
+                del self.in_flight[off]
+        out: List[Tuple[int, int]] = []
+        for start, end in self.targets():
+            for a, b in self.missing(start, end):
+                for off in range(a, b, self.max_range):
+                    if len(self.in_flight) >= PULL_WINDOW:
+                        return out
+                    if off in self.in_flight:
+                        continue
+                    n = min(self.max_range, b - off)
+                    self.in_flight[off] = (n, now)
+                    out.append((off, n))
+        return out
+
+    def add_range(self, off: int, data: bytes) -> None:
+        end = min(self.size, off + len(data))
+        self.in_flight.pop(off, None)
+        if off >= end:
+            return
+        self.image[off:end] = data[: end - off]
+        merged: List[Tuple[int, int]] = []
+        for a, b in sorted(self.filled + [(off, end)]):
+            if merged and a <= merged[-1][1]:
+                merged[-1] = (merged[-1][0], max(merged[-1][1], b))
+            else:
+                merged.append((a, b))
+        self.filled = merged
+        self.last_activity = time.time()
+        if self.first_segments and not self.segments:
+            self._locate_segments()
+
+    def _locate_segments(self) -> None:
+        """Com os cabeçalhos recebidos, obtém os segmentos de 'first'; sem ELF válido, busca a imagem inteira."""
+        received = self.filled[0][1] if self.filled and self.filled[0][0] == 0 else 0
+        try:
+            _, _, self.header_end = _elf_layout(bytes(self.image[:received]), partial=True)
+            if self.header_end > self.size:
+                raise ValueError(f"cabeçalhos além da imagem ({self.header_end} bytes)")
+            if received < self.header_end:
+                return
+            _, ranges = _first_ranges(bytes(self.image), self.first_segments)
+            for off, n in ranges:
+                if off < self.header_end or off + n > self.size:
+                    raise ValueError(f"segmento fora da imagem (offset {off}, {n} bytes)")
+            self.segments = ranges
+        except (ValueError, struct.error) as exc:
+            if received < min(self.size, ELF_SEARCH_LIMIT + ELF_EHDR.size):
+                return
+            logger.warning("pull.cabecalhos_invalidos mac=%s erro=%s buscando a imagem inteira", self.mac, exc)
+            self.first_segments = ()
+
+    def take_prefix(self) -> Optional[bytes]:
+        """Cabeçalhos seguidos dos segmentos de 'first', uma única vez, assim que todos chegarem."""
+        if not self.first_segments or self.prefix_taken or not self.segments:
+            return None
+        if any(self.missing(start, end) for start, end in [(0, self.header_end)] + [(o, o + n) for o, n in self.segments]):
+            return None
+        self.prefix_taken = True
+        return bytes(self.image[: self.header_end]) + b"".join(bytes(self.image[o : o + n]) for o, n in self.segments)
+
+    def is_complete(self) -> bool:
+        return not self.missing(0, self.size)
+
+
+def block_address(data: bytes) -> str:
+    """Endereço de um bloco no armazenamento: SHA256 truncado, em hex."""
+    return hashlib.sha256(data).digest()[:BLOCK_HASH_SIZE].hex()
+
+
+class BlockStore:
+    """Blocos de coredump endereçados pelo conteúdo, um arquivo por bloco em <raiz>/<2 hex>/<endereço>.
+
+    Imagens do mesmo firmware e da mesma falha repetem a maior parte dos blocos (cabeçalhos do ELF,
+    notas, pilhas de tasks ociosas), que ficam guardados uma única vez para todos os dispositivos.
+    """
+
+    def __init__(self, root: Path) -> None:
+        self.root = root
+
+    def _path(self, address: str) -> Path:
+        return self.root / address[:2] / address
+
+    def has(self, address: str) -> bool:
+        return self._path(address).is_file()
+
+    def get(self, address: str) -> Optional[bytes]:
+        try:
+            return self._path(address).read_bytes()
+        except OSError:
+            return None
+
+    def put(self, address: str, data: bytes) -> None:
+        path = self._path(address)
+        if path.is_file():
+            return
+        path.parent.mkdir(parents=True, exist_ok=True)
+        # Grava e renomeia: um bloco nunca fica parcial para quem o lê em paralelo
+        tmp = path.with_suffix(f".{threading.get_ident()}.tmp")
+        tmp.write_bytes(data)
+        os.replace(tmp, path)
+
+
+@dataclass
+class BlockSession:
+    """Imagem anunciada por manifesto de blocos; guarda os blocos até remontá-la."""
+
+    mac: str
+    image_id: Optional[str]
+    size: int
+    image_crc: int  # CRC32 da imagem inteira ("crc"), conferido na remontagem
+    block_size: int
+    addresses: List[str]  # Endereço de cada bloco, na ordem da imagem
+    fingerprint: Optional[str] = None
+    blocks: Dict[int, bytes] = field(default_factory=dict)
+    awaiting: set = field(default_factory=set)  # Blocos pedidos ao dispositivo e ainda não recebidos
+    from_store: int = 0  # Blocos obtidos do armazenamento
+    trust_store: bool = True  # False após uma remontagem divergente: tudo vem do dispositivo
+    completed: bool = False
+    last_activity: float = field(default_factory=time.time)
+
+    def block_length(self, index: int) -> int:
+        return min(self.block_size, self.size - index * self.block_size)
+
+    def fill_from_store(self, store: BlockStore) -> None:
+        if not self.trust_store:
+            return
+        for i, address in enumerate(self.addresses):
+            if i in self.blocks:
+                continue
+            data = store.get(address)
+            if data is not None and len(data) == self.block_length(i):
+                self.blocks[i] = data
+                self.from_store += 1
+
+    def missing(self) -> List[int]:
+        return [i for i in range(len(self.addresses)) if i not in self.blocks]
+
+    def need_bitmap(self, missing: Sequence[int]) -> str:
+        bitmap = bytearray((len(self.addresses) + 7) // 8)
+        for i in missing:
+            bitmap[i // 8] |= 1 << (i % 8)
+        return bitmap.hex()
+
+    def assemble(self) -> bytes:
+        return b"".join(self.blocks[i] for i in range(len(self.addresses)))
 
 
 BASE64_CHARS = set(b"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=")
@@ -107,29 +618,334 @@ def maybe_decode_base64(data: bytes) -> Tuple[bytes, bool]:
     return data, False
 
 
+def decode_part(encoding: Optional[str], data: bytes) -> Optional[bytes]:
+    """Decodifica uma parte conforme a codificação negociada na sessão.
+
+    Sem codificação declarada (firmware legado) recorre à heurística de
+    `maybe_decode_base64`. Retorna None se a parte não for válida.
+    """
+    if encoding == ENCODING_RAW:
+        return data
+    if encoding == ENCODING_BASE64:
+        try:
+            return base64.b64decode(data, validate=True)
+        except (ValueError, TypeError):
+            return None
+    decoded, _ = maybe_decode_base64(data)
+    return decoded
+
+
+class InflateLimitError(ValueError):
+    """Fluxo deflate cuja saída passa do tamanho permitido (possível bomba de descompressão)."""
+
+
+class MemberInflater:
+    """Descompressor raw deflate incremental que aceita fluxos concatenados.
+
+    Com a imagem reordenada, o firmware encerra o fluxo deflate no fim do prefixo e
+    começa outro para o restante; cada fluxo termina em zlib com 'eof' e o seguinte
+    fica em 'unused_data'.
+    """
+
+    def __init__(self) -> None:
+        self._inflater = zlib.decompressobj(-zlib.MAX_WBITS)
+
+    def decompress(self, data: bytes, max_length: Optional[int] = None) -> bytes:
+        """Descomprime 'data'; com 'max_length', lança InflateLimitError se a saída passar dele."""
+        if max_length is None:
+            out = self._inflater.decompress(data)
+            while self._inflater.eof and self._inflater.unused_data:
+                pending = self._inflater.unused_data
+                self._inflater = zlib.decompressobj(-zlib.MAX_WBITS)
+                out += self._inflater.decompress(pending)
+            return out
+        # Um byte além do limite basta para detectar o excesso sem descomprimir o resto
+        out = self._inflater.decompress(data, max(0, max_length) + 1)
+        while len(out) <= max_length and self._inflater.eof and self._inflater.unused_data:
+            pending = self._inflater.unused_data
+            self._inflater = zlib.decompressobj(-zlib.MAX_WBITS)
+            out += self._inflater.decompress(pending, max_length - len(out) + 1)
+        if len(out) > max_length or self._inflater.unconsumed_tail:
+            raise InflateLimitError(f"saída descomprimida excede {max_length} bytes")
+        return out
+
+    def flush(self) -> bytes:
+        return self._inflater.flush()
+
+    @property
+    def eof(self) -> bool:
+        return self._inflater.eof
+
+
+def inflate_raw(data: bytes) -> bytes:
+    """Descomprime um fluxo raw deflate completo. Lança ValueError se truncado ou inválido."""
+    inflater = MemberInflater()
+    try:
+        out = inflater.decompress(data) + inflater.flush()
+    except zlib.error as exc:
+        raise ValueError(f"fluxo deflate inválido: {exc}") from exc
+    if not inflater.eof:
+        raise ValueError("fluxo deflate truncado")
+    return out
+
+
+def _elf_layout(image: bytes, partial: bool = False) -> Tuple[int, List[Any], int]:
+    """Localiza o ELF na imagem: (posição, campos do cabeçalho, fim da tabela de program headers).
+
+    Com 'partial', 'image' pode terminar antes do fim dos program headers (início da busca).
+    """
+    for elf in range(0, min(ELF_SEARCH_LIMIT, len(image) - 3), 4):
+        if image[elf : elf + 4] != ELF_MAGIC:
+            continue
+        if elf + ELF_EHDR.size > len(image):
+            break
+        ehdr = list(ELF_EHDR.unpack_from(image, elf))
+        phoff, phentsize, phnum = ehdr[5], ehdr[9], ehdr[10]
+        if phentsize != ELF_PHDR.size:
+            break
+        header_end = elf + phoff + phnum * phentsize
+        if header_end > len(image) and not partial:
+            break
+        return elf, ehdr, header_end
+    raise ValueError("ELF não encontrado na imagem")
+
+
+def _first_ranges(image: bytes, first: Sequence[int]) -> Tuple[int, List[Tuple[int, int]]]:
+    """Fim dos cabeçalhos e (offset na imagem, tamanho) de cada segmento do prefixo."""
+    elf, ehdr, header_end = _elf_layout(image)
+    phoff, phnum = ehdr[5], ehdr[10]
+    ranges = []
+    for index in first:
+        if index >= phnum:
+            raise ValueError(f"segmento {index} inexistente ({phnum} program headers)")
+        ph = ELF_PHDR.unpack_from(image, elf + phoff + index * ELF_PHDR.size)
+        ranges.append((elf + ph[1], ph[4]))
+    return header_end, ranges
+
+
+def prefix_elf(prefix: bytes, first: Sequence[int]) -> bytes:
+    """Monta um ELF core com apenas os segmentos do prefixo, para esp-coredump --core-format elf.
+
+    O prefixo traz o cabeçalho do esp_core_dump, o ELF com todos os program headers e,
+    em seguida, os dados dos segmentos de 'first' na mesma ordem.
+    """
+    elf, ehdr, header_end = _elf_layout(prefix)
+    phoff = ehdr[5]
+    offset = ELF_EHDR.size + len(first) * ELF_PHDR.size
+    pos = header_end
+    phdrs, body = [], []
+    for index in first:
+        ph = list(ELF_PHDR.unpack_from(prefix, elf + phoff + index * ELF_PHDR.size))
+        size = ph[4]
+        if pos + size > len(prefix):
+            raise ValueError(f"prefixo truncado no segmento {index}")
+        body.append(prefix[pos : pos + size])
+        pos += size
+        ph[1] = offset
+        offset += size
+        phdrs.append(ph)
+    # Sem seções: e_shoff, e_shnum e e_shstrndx zerados
+    ehdr[5], ehdr[6], ehdr[8], ehdr[10], ehdr[12], ehdr[13] = ELF_EHDR.size, 0, ELF_EHDR.size, len(first), 0, 0
+    return ELF_EHDR.pack(*ehdr) + b"".join(ELF_PHDR.pack(*ph) for ph in phdrs) + b"".join(body)
+
+
+def restore_image_order(stream: bytes, first: Sequence[int]) -> bytes:
+    """Desfaz a ordem de envio: cabeçalhos, segmentos de 'first' e o restante na ordem da flash."""
+    header_end, ranges = _first_ranges(stream, first)
+    image = bytearray(len(stream))
+    image[:header_end] = stream[:header_end]
+    pos = header_end
+    for offset, size in ranges:
+        if offset < header_end or offset + size > len(stream):
+            raise ValueError(f"segmento fora da imagem (offset {offset}, {size} bytes)")
+        image[offset : offset + size] = stream[pos : pos + size]
+        pos += size
+    cursor = header_end
+    for offset, size in sorted(ranges):
+        if offset < cursor:
+            raise ValueError(f"segmentos sobrepostos no offset {offset}")
+        gap = offset - cursor
+        image[cursor:offset] = stream[pos : pos + gap]
+        pos += gap
+        cursor = offset + size
+    image[cursor:] = stream[pos:]
+    return bytes(image)
+
+
+def raw_coredump_path(mac: str, received_at: int) -> Path:
+    """Caminho em RAWS_OUTPUT_DIR do coredump bruto de um dispositivo recebido em 'received_at'."""
+    try:
+        from zoneinfo import ZoneInfo  # Python 3.9+
+        tz_sp = ZoneInfo("America/Sao_Paulo")
+    except Exception:
+        tz_sp = timezone(timedelta(hours=-3))
+    ts = datetime.fromtimestamp(received_at, tz=tz_sp).strftime("%Y-%m-%d_%H-%M-%S")
+    safe_mac = mac.replace(":", "").replace("-", "").upper()
+    return RAWS_OUTPUT_DIR / f"{ts}_{safe_mac}.cdmp"
+
+
+def crash_signature(summary: Dict[str, Any]) -> str:
+    """Assinatura curta de uma falha a partir do resumo: causa, PC e topo do backtrace.
+
+    Falhas com a mesma assinatura tendem a cair no mesmo cluster, o que permite uma
+    triagem preliminar antes da interpretação do coredump completo.
+    """
+    bt = [str(a).lower() for a in summary.get("bt") or []][:SIGNATURE_BT_DEPTH]
+    key = "|".join([str(summary.get("cause")), str(summary.get("pc", "")).lower(), ",".join(bt)])
+    return hashlib.sha1(key.encode("utf-8")).hexdigest()[:12]
+
+
+def partial_coredump_path(mac: str, image_id: Optional[str]) -> Path:
+    """Arquivo em RAWS_OUTPUT_DIR onde uma sessão em andamento grava a imagem."""
+    safe_mac = mac.replace(":", "").replace("-", "").upper()
+    return RAWS_OUTPUT_DIR / f".{safe_mac}_{image_id or 'legado'}.partial"
+
+
 class _Assembler:
-    def __init__(self, repo: IDataRepository, parser: ICoreDumpParser) -> None:
+    """Monta as imagens recebidas e entrega cada coredump à fila de processamento.
+
+    O estado de cada dispositivo tem lock próprio: as mensagens de um não esperam a gravação
+    das partes de outro. O lock global guarda apenas os dicionários de locks e de assinaturas.
+    """
+
+    def __init__(self, repo: IDataRepository, parser: ICoreDumpParser, pool: Optional[ProcessingPool] = None) -> None:
         self.repo = repo
         self.parser = parser
+        self.pool = pool or ProcessingPool()
         self._sessions: Dict[str, CoreDumpSession] = {}
+        self._pulls: Dict[str, PullSession] = {}  # Imagens buscadas por intervalos (transporte por busca)
+        self._block_sessions: Dict[str, BlockSession] = {}  # Imagens enviadas por manifesto de blocos
+        self._block_store = BlockStore(BLOCKS_OUTPUT_DIR)
+        self._signatures: Dict[str, int] = {}  # Ocorrências de cada assinatura de resumo
+        self._last_signature: Dict[str, str] = {}  # Assinatura do último resumo por dispositivo
         self._lock = threading.Lock()
+        self._device_locks: Dict[str, threading.Lock] = {}
+        # Sessões ficam só em memória: arquivos parciais de uma execução anterior não têm mais dono
+        for stale in RAWS_OUTPUT_DIR.glob(".*.partial"):
+            stale.unlink(missing_ok=True)
+
+    def _device_lock(self, mac: str) -> threading.Lock:
+        with self._lock:
+            lock = self._device_locks.get(mac)
+            if lock is None:
+                lock = self._device_locks[mac] = threading.Lock()
+            return lock
+
+    def _submit(self, label: str, fn: Callable[..., Any], *args: Any, wait: bool) -> None:
+        """Entrega uma tarefa à fila de processamento.
+
+        Com 'wait', bloqueia enquanto a fila estiver cheia (handlers HTTP). Sem, a espera fica com
+        a thread de ingestão do pool: o laço do MQTT, que chama com o lock do dispositivo, nunca para.
+        """
+        if wait:
+            self.pool.submit(label, fn, *args)
+        else:
+            self.pool.submit_nowait(label, fn, *args)
 
-    def start_session(self, mac: str, expected_parts: int) -> bool:
-        """Inicia nova sessão de coredump. Retorna True se criou, False se já existe sessão ativa."""
+    def record_summary(self, mac: str, summary: Dict[str, Any]) -> Tuple[str, int]:
+        """Registra o resumo publicado antes da imagem; retorna (assinatura, ocorrências).
+
+        O resumo é gravado em SUMMARIES_OUTPUT_DIR e a assinatura associada ao
+        dispositivo, para ser relacionada ao coredump completo quando chegar.
+        """
+        signature = crash_signature(summary)
         with self._lock:
+            count = self._signatures.get(signature, 0) + 1
+            self._signatures[signature] = count
+            self._last_signature[mac] = signature
+        received_at = int(time.time())
+        safe_mac = mac.replace(":", "").replace("-", "").upper()
+        path = SUMMARIES_OUTPUT_DIR / f"{received_at}_{safe_mac}.json"
+        path.write_text(
+            json.dumps({"mac": mac, "received_at": received_at, "signature": signature, **summary}),
+            encoding="utf-8",
+        )
+        logger.info(
+            "resumo_recebido mac=%s task=%s pc=%s cause=%s assinatura=%s ocorrencias=%d",
+            mac, summary.get("task"), summary.get("pc"), summary.get("cause"), signature, count,
+        )
+        return signature, count
+
+    def start_session(
+        self,
+        mac: str,
+        expected_parts: Optional[int],
+        encoding: Optional[str] = None,
+        compression: Optional[str] = None,
+        raw_size: Optional[int] = None,
+        image_id: Optional[str] = None,
+        stream_bytes: Optional[int] = None,
+        image_crc: Optional[int] = None,
+        fingerprint: Optional[str] = None,
+        prefix_size: Optional[int] = None,
+        first_segments: Sequence[int] = (),
+    ) -> bool:
+        """Inicia (ou retoma) sessão de coredump.
+
+        Retorna True se criou ou retomou a sessão, False se já existe outra sessão
+        ativa de firmware legado. Uma sessão parcial da mesma imagem é mantida e
+        retomada; uma imagem diferente substitui a sessão parcial anterior.
+        """
+        with self._device_lock(mac):
             existing = self._sessions.get(mac)
-            if existing and not existing.completed:
+            # Mesma imagem: retoma a sessão parcial ou reconfirma a já concluída (dispositivo não chegou a apagá-la)
+            if existing and existing.same_upload(expected_parts, stream_bytes, encoding, compression, image_id):
+                existing.last_activity = time.time()
+                existing.acked = -1  # Força novo ACK com o ponto de retomada
+                existing.resend = False
+                discarded = existing.discard_after_contiguous()
+                count, received = existing.contiguous()
+                logger.info(
+                    "sessao_retomada mac=%s id=%s partes_recebidas=%d bytes=%d/%s descartadas=%d",
+                    mac, image_id, count, received, stream_bytes, discarded,
+                )
+                return True
+            if existing and not existing.completed and existing.image_id is not None and image_id is not None:
+                logger.warning(
+                    "sessao_substituida mac=%s id_anterior=%s id=%s partes_descartadas=%d",
+                    mac, existing.image_id, image_id, existing.contiguous()[0] + len(existing.parts),
+                )
+                existing.discard()
+            elif existing and not existing.completed:
                 logger.warning(
                     "sessao_ja_existe mac=%s expected_parts=%s partes_recebidas=%d ignorando nova sessão", 
                     mac, expected_parts, len(existing.parts)
                 )
                 return False
-            self._sessions[mac] = CoreDumpSession(mac=mac, expected_parts=expected_parts)
-            logger.debug("sessao_iniciada mac=%s expected_parts=%s", mac, expected_parts)
+            sess = CoreDumpSession(
+                mac=mac,
+                expected_parts=expected_parts,
+                stream_bytes=stream_bytes,
+                encoding=encoding,
+                compression=compression,
+                raw_size=raw_size,
+                image_id=image_id,
+                image_crc=image_crc,
+                fingerprint=fingerprint,
+                prefix_size=prefix_size if first_segments else None,
+                first_segments=tuple(first_segments),
+            )
+            if stream_bytes is not None:
+                # Fluxo com tamanho declarado: as partes vão para o disco assim que ficam contíguas
+                sess.open_stream(partial_coredump_path(mac, image_id))
+            self._sessions[mac] = sess
+            logger.debug(
+                "sessao_iniciada mac=%s expected_parts=%s bytes=%s enc=%s comp=%s size=%s id=%s crc=%s pfx=%s first=%s",
+                mac, expected_parts, stream_bytes, encoding, compression, raw_size, image_id,
+                f"{image_crc:08x}" if image_crc is not None else None, prefix_size, list(first_segments),
+            )
             return True
 
-    def add_part(self, mac: str, index: int, data: bytes) -> Optional[str]:
-        with self._lock:
+    def add_part(
+        self, mac: str, index: int, data: bytes, crc: Optional[int] = None, total: Optional[int] = None
+    ) -> Optional[str]:
+        """Adiciona uma parte à sessão; retorna o arquivo gravado se o coredump ficou completo.
+
+        Com 'crc' (CRC32 do payload, informado no tópico ou nas propriedades MQTT 5), uma
+        parte corrompida é descartada na chegada e o próximo ACK pede o reenvio a partir dela.
+        'total' (propriedade "of") é apenas conferido com a quantidade da mensagem inicial.
+        """
+        with self._device_lock(mac):
             sess = self._sessions.get(mac)
             if not sess:
                 logger.debug("parte_rejeitada_sem_sessao mac=%s index=%s", mac, index)
@@ -138,60 +954,441 @@ class _Assembler:
             if sess.completed:
                 logger.debug("parte_rejeitada_sessao_completa mac=%s index=%s", mac, index)
                 return None
-            sess.add_part(index, data)
+            if total is not None and sess.expected_parts is not None and total != sess.expected_parts:
+                logger.warning(
+                    "parte_total_divergente mac=%s index=%s of=%d esperado=%d ignorada",
+                    mac, index, total, sess.expected_parts,
+                )
+                return None
+            if crc is not None and zlib.crc32(data) != crc:
+                logger.warning(
+                    "parte_crc_invalido mac=%s index=%s crc=%08x esperado=%08x reenvio solicitado",
+                    mac, index, zlib.crc32(data), crc,
+                )
+                sess.resend = True
+                sess.last_activity = time.time()
+                return None
+            decoded = decode_part(sess.encoding, data)
+            if decoded is None:
+                logger.warning("parte_invalida mac=%s index=%s enc=%s", mac, index, sess.encoding)
+                return None
+            sess.add_part(index, decoded)
+            sess.last_activity = time.time()
+            try:
+                sess.flush()
+                prefix = sess.take_prefix()
+                complete = sess.is_complete()
+                if complete:
+                    # Marcar como completado ANTES de iniciar processamento assíncrono
+                    # Isso evita que múltiplas threads processem o mesmo coredump
+                    if sess.streaming:
+                        sess.finish()
+                    else:
+                        blob = sess.assemble()
+                    sess.completed = True
+            except (ValueError, OSError) as exc:
+                logger.error("coredump_invalido mac=%s comp=%s erro=%s sessão descartada", mac, sess.compression, exc)
+                sess.discard()
+                del self._sessions[mac]
+                return None
             logger.debug(
-                "parte_adicionada mac=%s index=%s partes_recebidas=%d/%d", 
-                mac, index, len(sess.parts), sess.expected_parts
+                "parte_adicionada mac=%s index=%s partes_recebidas=%d/%s",
+                mac, index, sess.contiguous()[0], sess.expected_parts
             )
-            if not sess.is_complete():
+            if prefix is not None and not complete:
+                self.register_prefix(mac, prefix, sess.first_segments, wait=False)
+            if not complete:
                 return None
-            # Marcar como completado ANTES de iniciar processamento assíncrono
-            # Isso evita que múltiplas threads processem o mesmo coredump
-            sess.completed = True
-            blob = sess.assemble()
             received_at = int(time.time())
-            filepath = self._write_coredump(mac, blob, received_at)
-            logger.info("coredump_montado mac=%s arquivo=%s tamanho=%d bytes", mac, filepath, len(blob))
-            threading.Thread(
-                target=self._process_and_register,
-                args=(mac, filepath, received_at),
-                daemon=True,
-            ).start()
+            if sess.streaming:
+                filepath = str(raw_coredump_path(mac, received_at))
+                os.replace(sess.stream_path, filepath)
+                size = sess.raw_written
+            else:
+                filepath = self._write_coredump(mac, blob, received_at)
+                size = len(blob)
+            logger.info(
+                "coredump_montado mac=%s arquivo=%s tamanho=%d bytes assinatura=%s",
+                mac, filepath, size, self._last_signature.get(mac),
+            )
+            self.register_coredump(mac, filepath, received_at, sess.fingerprint, wait=False)
             return filepath
 
-    def cleanup(self, older_than: float) -> None:
-        with self._lock:
-            stale = [m for m, s in self._sessions.items() if (time.time() - s.start_time) > older_than and not s.completed]
-            for mac in stale:
-                del self._sessions[mac]
+    def register_coredump(
+        self,
+        mac: str,
+        filepath: str,
+        received_at: int,
+        fingerprint: Optional[str] = None,
+        core_format: str = "raw",
+        wait: bool = True,
+    ) -> None:
+        """Cadastra em segundo plano um coredump já gravado em disco e gera seu relatório.
 
-    def _write_coredump(self, mac: str, data: bytes, received_at: int) -> str:
+        A tarefa entra na fila de processamento; com a fila cheia, esta chamada bloqueia, a não
+        ser com wait=False (laço do MQTT), em que a espera fica com a thread de ingestão.
+
+        Usado também pelos receptores que gravam a imagem por conta própria (HTTP).
+        'core_format' é "elf" quando o arquivo é um ELF core parcial (busca só do prefixo).
+        """
+        self._submit(f"coredump:{mac}", self._process_and_register, mac, filepath, received_at, fingerprint, core_format, wait=wait)
+
+    def register_prefix(self, mac: str, prefix: bytes, first: Sequence[int], wait: bool = True) -> None:
+        """Gera em segundo plano o relatório preliminar do prefixo (task que falhou).
+
+        O prefixo vira um ELF core só com as notas e os segmentos de 'first', gravado em
+        RAWS_OUTPUT_DIR ao lado do coredump; o relatório completo chega com a imagem inteira.
+        """
+        if not PREFIX_REPORTS:
+            return
         try:
-            from zoneinfo import ZoneInfo  # Python 3.9+
-            tz_sp = ZoneInfo("America/Sao_Paulo")
-        except Exception:
-            tz_sp = timezone(timedelta(hours=-3))
-        ts = datetime.fromtimestamp(received_at, tz=tz_sp).strftime("%Y-%m-%d_%H-%M-%S")
-        safe_mac = mac.replace(":", "").replace("-", "").upper()
-        filename = RAWS_OUTPUT_DIR / f"{ts}_{safe_mac}.cdmp"
+            elf = prefix_elf(prefix, first)
+        except (ValueError, struct.error) as exc:
+            logger.warning("prefixo_invalido mac=%s erro=%s", mac, exc)
+            return
+        received_at = int(time.time())
+        path = raw_coredump_path(mac, received_at).with_suffix(".prefix.elf")
+        path.write_bytes(elf)
+        logger.info("prefixo_recebido mac=%s arquivo=%s tamanho=%d segmentos=%s", mac, path, len(elf), list(first))
+        self._submit(f"prefixo:{mac}", self._process_prefix, mac, path, wait=wait)
+
+    def record_repeat(self, mac: str, fingerprint: str, count: Optional[int]) -> bool:
+        """Conta uma ocorrência repetida reportada pelo firmware sem reenviar a imagem.
+
+        Retorna True se a falha é conhecida (ocorrência contada para o coredump e o
+        cluster existentes) ou False se o backend precisa da imagem completa.
+        """
+        known = self.repo.bump_crash_fingerprint(mac, fingerprint)
+        if known is None:
+            logger.info("ocorrencia_desconhecida mac=%s fp=%s contador=%s imagem_solicitada", mac, fingerprint, count)
+            return False
+        coredump_id, cluster_id, occurrences = known
+        logger.info(
+            "ocorrencia_repetida mac=%s fp=%s contador=%s coredump_id=%d cluster_id=%s ocorrencias=%d",
+            mac, fingerprint, count, coredump_id, cluster_id, occurrences,
+        )
+        return True
+
+    def start_pull(
+        self,
+        mac: str,
+        size: int,
+        image_id: Optional[str],
+        max_range: int,
+        first_segments: Sequence[int] = (),
+        fingerprint: Optional[str] = None,
+    ) -> Tuple[List[Tuple[int, int]], bool]:
+        """Registra o anúncio de uma imagem para busca; retorna (pedidos, liberar).
+
+        Um novo anúncio da mesma imagem (dispositivo reiniciado) retoma a busca com os
+        bytes já recebidos; se ela já estava completa, só a liberação é repetida.
+        """
+        with self._device_lock(mac):
+            sess = self._pulls.get(mac)
+            if sess and sess.image_id == image_id and sess.size == size:
+                if sess.completed:
+                    logger.info("pull.liberacao_repetida mac=%s id=%s", mac, image_id)
+                    return [], True
+                sess.in_flight.clear()  # Pedidos anteriores ao reinício se perderam
+                sess.max_range = max_range
+                logger.info("pull.retomado mac=%s id=%s recebidos=%s", mac, image_id, sess.filled)
+            else:
+                sess = PullSession(mac, size, image_id, max_range, tuple(first_segments), fingerprint)
+                self._pulls[mac] = sess
+                logger.info("pull.anunciado mac=%s size=%d id=%s max=%d first=%s", mac, size, image_id, max_range, list(first_segments))
+            sess.last_activity = time.time()
+            return sess.requests(sess.last_activity), False
+
+    def add_range(self, mac: str, offset: int, data: bytes, crc: Optional[int] = None) -> Tuple[List[Tuple[int, int]], bool]:
+        """Guarda um intervalo recebido; retorna (próximos pedidos, liberar).
+
+        Um intervalo com CRC divergente é pedido de novo. Concluída a busca, a imagem
+        (ou, sem PULL_FULL, o ELF core do prefixo) é gravada e cadastrada.
+        """
+        with self._device_lock(mac):
+            sess = self._pulls.get(mac)
+            if not sess or sess.completed:
+                logger.debug("pull.intervalo_sem_sessao mac=%s offset=%d", mac, offset)
+                return [], False
+            if crc is not None and zlib.crc32(data) != crc:
+                logger.warning("pull.intervalo_crc_invalido mac=%s offset=%d crc=%08x esperado=%08x", mac, offset, zlib.crc32(data), crc)
+                sess.in_flight.pop(offset, None)
+                return sess.requests(time.time()), False
+            sess.add_range(offset, data)
+            prefix = sess.take_prefix()
+            received_at = int(time.time())
+            if prefix is not None and not PULL_FULL:
+                # Só o prefixo: o ELF core com a task que falhou é o coredump cadastrado
+                sess.completed = True
+                try:
+                    elf = prefix_elf(prefix, sess.first_segments)
+                except (ValueError, struct.error) as exc:
+                    logger.error("pull.prefixo_invalido mac=%s erro=%s", mac, exc)
+                    del self._pulls[mac]
+                    return [], False
+                path = raw_coredump_path(mac, received_at).with_suffix(".elf")
+                path.write_bytes(elf)
+                logger.info("pull.prefixo_recebido mac=%s arquivo=%s tamanho=%d de %d bytes", mac, path, len(elf), sess.size)
+                self.register_coredump(mac, str(path), received_at, sess.fingerprint, core_format="elf", wait=False)
+                return [], True
+            if prefix is not None:
+                self.register_prefix(mac, prefix, sess.first_segments, wait=False)
+            if not sess.is_complete():
+                return sess.requests(time.time()), False
+            sess.completed = True
+            filepath = self._write_coredump(mac, bytes(sess.image), received_at)
+            logger.info("pull.coredump_recebido mac=%s arquivo=%s tamanho=%d", mac, filepath, sess.size)
+            self.register_coredump(mac, filepath, received_at, sess.fingerprint, wait=False)
+            return [], True
+
+    def start_blocks(self, mac: str, manifest: Dict[str, Any]) -> Optional[Dict[str, Any]]:
+        """Registra o manifesto de blocos de uma imagem; retorna a resposta ao dispositivo.
+
+        Os blocos já guardados saem do armazenamento; a resposta pede os demais ("need") ou, se
+        nenhum faltar, confirma a remontagem ("done"). Um novo manifesto da mesma imagem recalcula
+        o que falta a partir do que já chegou.
+        """
+        try:
+            image_id = manifest.get("id")
+            size = int(manifest["size"])
+            image_crc = int(manifest["crc"], 16)
+            block_size = int(manifest["bs"])
+            hashes = bytes.fromhex(manifest["h"])
+        except (KeyError, TypeError, ValueError) as exc:
+            logger.error("blocos.manifesto_invalido mac=%s erro=%s", mac, exc)
+            return None
+        count = (size + block_size - 1) // block_size if block_size > 0 else 0
+        if count == 0 or len(hashes) != count * BLOCK_HASH_SIZE:
+            logger.error("blocos.manifesto_invalido mac=%s size=%d bs=%d enderecos=%d", mac, size, block_size, len(hashes) // BLOCK_HASH_SIZE)
+            return None
+        addresses = [hashes[i : i + BLOCK_HASH_SIZE].hex() for i in range(0, len(hashes), BLOCK_HASH_SIZE)]
+        with self._device_lock(mac):
+            sess = self._block_sessions.get(mac)
+            if sess and sess.image_id == image_id and sess.addresses == addresses:
+                if sess.completed:
+                    logger.info("blocos.conclusao_repetida mac=%s id=%s", mac, image_id)
+                    return {"id": image_id, "done": 1}
+            else:
+                sess = BlockSession(mac, image_id, size, image_crc, block_size, addresses, manifest.get("fp"))
+                self._block_sessions[mac] = sess
+            sess.last_activity = time.time()
+            sess.fill_from_store(self._block_store)
+            logger.info(
+                "blocos.manifesto mac=%s id=%s size=%d blocos=%d do_armazenamento=%d faltantes=%d",
+                mac, image_id, size, count, sess.from_store, len(sess.missing()),
+            )
+            return self._blocks_reply(sess)
+
+    def add_block(self, mac: str, index: int, data: bytes, crc: Optional[int] = None) -> Optional[Dict[str, Any]]:
+        """Guarda um bloco recebido; retorna a resposta ao dispositivo quando nenhum pedido estiver pendente.
+
+        O bloco só é aceito se o CRC32 e o endereço conferirem com o manifesto; os rejeitados
+        entram no próximo "need".
+        """
+        with self._device_lock(mac):
+            sess = self._block_sessions.get(mac)
+            if not sess or sess.completed or not 0 <= index < len(sess.addresses):
+                logger.debug("blocos.bloco_sem_sessao mac=%s indice=%d", mac, index)
+                return None
+            sess.last_activity = time.time()
+            sess.awaiting.discard(index)
+            if crc is not None and zlib.crc32(data) != crc:
+                logger.warning("blocos.crc_invalido mac=%s indice=%d", mac, index)
+            elif len(data) != sess.block_length(index) or block_address(data) != sess.addresses[index]:
+                logger.warning("blocos.endereco_divergente mac=%s indice=%d tamanho=%d", mac, index, len(data))
+            else:
+                sess.blocks[index] = data
+                self._block_store.put(sess.addresses[index], data)
+            if sess.awaiting:
+                return None
+            return self._blocks_reply(sess)
+
+    def _blocks_reply(self, sess: BlockSession) -> Dict[str, Any]:
+        """Pede os blocos que faltam ou, com todos presentes, remonta a imagem. Chamado com o lock do dispositivo."""
+        missing = sess.missing()
+        if missing:
+            sess.awaiting = set(missing)
+            return {"id": sess.image_id, "need": sess.need_bitmap(missing)}
+        image = sess.assemble()
+        if zlib.crc32(image) != sess.image_crc:
+            # Colisão de endereço ou bloco corrompido no armazenamento: só vale o que o dispositivo enviar
+            logger.error(
+                "blocos.remontagem_divergente mac=%s id=%s crc=%08x esperado=%08x pedindo a imagem inteira",
+                sess.mac, sess.image_id, zlib.crc32(image), sess.image_crc,
+            )
+            sess.trust_store = False
+            sess.blocks.clear()
+            sess.from_store = 0
+            missing = sess.missing()
+            sess.awaiting = set(missing)
+            return {"id": sess.image_id, "need": sess.need_bitmap(missing)}
+        sess.completed = True
+        received_at = int(time.time())
+        filepath = self._write_coredump(sess.mac, image, received_at)
+        logger.info(
+            "blocos.coredump_remontado mac=%s arquivo=%s tamanho=%d blocos=%d do_armazenamento=%d",
+            sess.mac, filepath, sess.size, len(sess.addresses), sess.from_store,
+        )
+        self.register_coredump(sess.mac, filepath, received_at, sess.fingerprint, wait=False)
+        return {"id": sess.image_id, "done": 1}
+
+    def pull_retries(self) -> Dict[str, Tuple[List[Tuple[int, int]], bool]]:
+        """Pedidos expirados a repetir e liberações sem confirmação, por dispositivo."""
+        now = time.time()
+        out: Dict[str, Tuple[List[Tuple[int, int]], bool]] = {}
+        for mac in list(self._pulls):
+            with self._device_lock(mac):
+                sess = self._pulls.get(mac)
+                if sess is None:
+                    continue
+                if sess.completed:
+                    if now - sess.last_activity > PULL_RETRY_SECONDS:
+                        sess.last_activity = now
+                        out[mac] = ([], True)
+                    continue
+                requests = sess.requests(now)
+                if requests:
+                    out[mac] = (requests, False)
+        return out
+
+    def pull_image_id(self, mac: str) -> Optional[str]:
+        """Id da imagem em busca no dispositivo, repetido nos pedidos e na liberação."""
+        with self._device_lock(mac):
+            sess = self._pulls.get(mac)
+            return sess.image_id if sess else None
+
+    def pull_status(self, mac: str, status: Dict[str, Any]) -> None:
+        """Resposta do dispositivo em <BASE_TOPIC>/<mac>/pull: liberação ou pedido recusado."""
+        with self._device_lock(mac):
+            if status.get("released"):
+                self._pulls.pop(mac, None)
+                logger.info("pull.liberado mac=%s", mac)
+            elif status.get("error") == "no_image":
+                sess = self._pulls.pop(mac, None)
+                logger.warning("pull.sem_imagem mac=%s sessao_descartada=%s", mac, sess is not None)
+            else:
+                logger.warning("pull.pedido_recusado mac=%s status=%s", mac, status)
+
+    def pending_ack(self, mac: str) -> Optional[Tuple[int, int, bool]]:
+        """Retorna (partes, bytes, reenvio) a confirmar ao dispositivo, ou None se não houver ACK devido.
+
+        Sessões de firmware legado (sem "id") não recebem ACK. O ACK é devido logo
+        após a mensagem inicial, a cada ACK_EVERY partes contíguas, na conclusão
+        e imediatamente após uma parte rejeitada por CRC (com reenvio=True).
+        """
+        with self._device_lock(mac):
+            sess = self._sessions.get(mac)
+            if not sess or sess.image_id is None:
+                return None
+            hwm, received = sess.contiguous()
+            if sess.resend:
+                sess.resend = False
+                sess.acked = hwm
+                return hwm, received, True
+            if hwm == sess.acked:
+                return None
+            if sess.acked >= 0 and not sess.completed and hwm - sess.acked < ACK_EVERY:
+                return None
+            sess.acked = hwm
+            return hwm, received, False
+
+    def cleanup(self, older_than: float, resumable_older_than: float = RESUME_TTL) -> None:
+        """Remove sessões incompletas inativas.
+
+        Sessões com suporte a retomada são mantidas por 'resumable_older_than'
+        segundos desde a última atividade, para sobreviverem a reconexões e
+        reinicializações do dispositivo.
+        """
+        now = time.time()
+
+        def expired(sessions: Dict[str, Any], mac: str, ttl: Callable[[Any], float]) -> Optional[Any]:
+            # Chamado com o lock do dispositivo: a sessão pode ter recebido dados desde a leitura da lista
+            sess = sessions.get(mac)
+            if sess is not None and (now - sess.last_activity) > ttl(sess):
+                return sessions.pop(mac)
+            return None
+
+        for mac in list(self._sessions):
+            with self._device_lock(mac):
+                sess = expired(
+                    self._sessions, mac,
+                    lambda s: float("inf") if s.completed else (resumable_older_than if s.image_id is not None else older_than),
+                )
+                if sess is not None:
+                    logger.debug("sessao_expirada mac=%s partes_recebidas=%d", mac, sess.contiguous()[0] + len(sess.parts))
+                    sess.discard()
+        # A imagem fica na flash do dispositivo até a liberação: a busca expira como as sessões retomáveis
+        for mac in list(self._pulls):
+            with self._device_lock(mac):
+                pull = expired(self._pulls, mac, lambda p: resumable_older_than)
+                if pull is not None:
+                    logger.debug("pull.expirado mac=%s recebidos=%s", mac, pull.filled)
+        # Blocos recebidos já estão no armazenamento: uma sessão expirada não perde o que chegou
+        for mac in list(self._block_sessions):
+            with self._device_lock(mac):
+                blocks = expired(self._block_sessions, mac, lambda b: older_than)
+                if blocks is not None:
+                    logger.debug("blocos.expirado mac=%s recebidos=%d", mac, len(blocks.blocks))
+
+    def _write_coredump(self, mac: str, data: bytes, received_at: int) -> str:
+        filename = raw_coredump_path(mac, received_at)
         filename.write_bytes(data)
         return str(filename)
 
-    def _process_and_register(self, mac: str, coredump_filepath: str, received_at: int) -> None:
+    def _device_firmware(self, mac: str, coredump_filepath: str) -> Optional[Tuple[int, tuple]]:
+        """Retorna (firmware_id, registro do firmware) do dispositivo, ou None com o motivo no log."""
+        device_info = self.repo.get_device(mac)
+        if not device_info:
+            logger.error("dispositivo.nao_encontrado mac=%s arquivo=%s - coredump não será cadastrado", mac, coredump_filepath)
+            return None
+        _, firmware_id, chip_type = device_info
+        if not firmware_id:
+            logger.error("dispositivo.sem_firmware mac=%s arquivo=%s - coredump não será cadastrado", mac, coredump_filepath)
+            return None
+        fw = self.repo.get_firmware_by_id(int(firmware_id))
+        if not fw:
+            logger.error("firmware.nao_encontrado id=%s mac=%s arquivo=%s - coredump não será cadastrado", firmware_id, mac, coredump_filepath)
+            return None
+        return int(firmware_id), fw
+
+    def _process_prefix(self, mac: str, prefix_path: Path) -> None:
         try:
-            logger.debug("processando_coredump mac=%s arquivo=%s", mac, coredump_filepath)
-            device_info = self.repo.get_device(mac)
-            if not device_info:
-                logger.error("dispositivo.nao_encontrado mac=%s arquivo=%s - coredump não será cadastrado", mac, coredump_filepath)
+            found = self._device_firmware(mac, str(prefix_path))
+            if not found:
                 return
-            _, firmware_id, chip_type = device_info
-            if not firmware_id:
-                logger.error("dispositivo.sem_firmware mac=%s arquivo=%s - coredump não será cadastrado", mac, coredump_filepath)
+            _, fw = found
+            elf_path = Path(str(fw[3]))
+            if not elf_path.exists():
+                logger.error("elf.inexistente path=%s mac=%s prefixo=%s", elf_path, mac, prefix_path)
                 return
-            fw = self.repo.get_firmware_by_id(int(firmware_id))
-            if not fw:
-                logger.error("firmware.nao_encontrado id=%s mac=%s arquivo=%s - coredump não será cadastrado", firmware_id, mac, coredump_filepath)
+            started = time.monotonic()
+            report = self.parser.generate_report(
+                raw_path=prefix_path,
+                elf_path=elf_path,
+                out_dir=REPORTS_OUTPUT_DIR,
+                chip_type=fw[2] if len(fw) > 2 else None,
+                core_format="elf",
+            )
+            logger.info(
+                "relatorio_preliminar mac=%s report=%s duracao_ms=%d", mac, report, int((time.monotonic() - started) * 1000)
+            )
+        except Exception:
+            logger.exception("receiver.prefixo_excecao mac=%s arquivo=%s", mac, prefix_path)
+
+    def _process_and_register(
+        self,
+        mac: str,
+        coredump_filepath: str,
+        received_at: int,
+        fingerprint: Optional[str] = None,
+        core_format: str = "raw",
+    ) -> None:
+        try:
+            logger.debug("processando_coredump mac=%s arquivo=%s", mac, coredump_filepath)
+            found = self._device_firmware(mac, coredump_filepath)
+            if not found:
                 return
+            firmware_id, fw = found
             elf_path = Path(str(fw[3]))
 
             # Primeiro, registra o coredump bruto
@@ -203,6 +1400,8 @@ class _Assembler:
                 received_at=received_at,
             )
             logger.info("coredump_cadastrado coredump_id=%d mac=%s arquivo=%s", coredump_id, mac, coredump_filepath)
+            if fingerprint and coredump_id:
+                self.repo.save_crash_fingerprint(mac, fingerprint, coredump_id)
 
             # Depois, se possível, gera relatório e atualiza o registro
             if elf_path.exists():
@@ -211,6 +1410,7 @@ class _Assembler:
                     elf_path=elf_path,
                     out_dir=REPORTS_OUTPUT_DIR,
                     chip_type=fw[2] if len(fw) > 2 else None,
+                    core_format=core_format,
                 )
                 self.repo.save_coredump_report(coredump_id=coredump_id, report_path=report)
                 logger.debug("relatorio_gerado coredump_id=%d report=%s", coredump_id, report)
@@ -231,12 +1431,21 @@ class MqttReceiver(ICoreDumpIngestor):
         if self.client is not None:
             return
         self._start_cleanup_thread()
-        client = paho.Client(callback_api_version=paho.CallbackAPIVersion.VERSION2)
+        if MQTT_PROTOCOL_V5:
+            client = paho.Client(callback_api_version=paho.CallbackAPIVersion.VERSION2, protocol=paho.MQTTv5)
+        else:
+            client = paho.Client(callback_api_version=paho.CallbackAPIVersion.VERSION2)
         client.on_connect = self._on_connect
         client.on_message = self._on_message
         client.username_pw_set(MQTT_USER, MQTT_PASS)
         client.tls_set(tls_version=mqtt.client.ssl.PROTOCOL_TLS)
-        client.connect(MQTT_HOST, MQTT_PORT, 60)
+        if MQTT_PROTOCOL_V5:
+            # O broker não entrega mais que MQTT_RECEIVE_MAXIMUM partes sem confirmação ao backend
+            connect_props = Properties(PacketTypes.CONNECT)
+            connect_props.ReceiveMaximum = MQTT_RECEIVE_MAXIMUM
+            client.connect(MQTT_HOST, MQTT_PORT, 60, properties=connect_props)
+        else:
+            client.connect(MQTT_HOST, MQTT_PORT, 60)
         self.client = client
         client.loop_start()
 
@@ -253,15 +1462,25 @@ class MqttReceiver(ICoreDumpIngestor):
         threading.Thread(target=self._cleanup_loop, name="coredump_session_gc", daemon=True).start()
 
     def _cleanup_loop(self) -> None:
+        last_stats: Dict[str, Any] = {}
         while True:
-            time.sleep(30)
+            time.sleep(min(30, max(1, PULL_RETRY_SECONDS)))
             self.assembler.cleanup(SESSION_TIMEOUT)
+            # Uso da fila de processamento, só quando algo mudou desde o último registro
+            stats = self.assembler.pool.stats()
+            if stats["submitted"] and stats != last_stats:
+                logger.info("processamento.estatisticas %s", format_stats(stats))
+                last_stats = stats
+            if self.client is not None:
+                for mac, (requests, release) in self.assembler.pull_retries().items():
+                    self._publish_fetch(self.client, mac, requests, release)
 
     # MQTT callbacks
     def _on_connect(self, client: paho.Client, userdata: Any, flags: Dict[str, Any], rc: int, properties: Any | None = None) -> None:
         if rc == 0:
             logger.info("mqtt.conectado rc=%s", rc)
             client.subscribe(f"{BASE_TOPIC}/#", qos=2)
+            client.subscribe(f"{METRICS_TOPIC}/+", qos=1)
         else:
             logger.error("mqtt.falha_conexao rc=%s", rc)
 
@@ -270,28 +1489,196 @@ class MqttReceiver(ICoreDumpIngestor):
             topic = msg.topic
             payload = msg.payload
             seg = topic.split("/")
+            if len(seg) == 2 and seg[0] == METRICS_TOPIC:
+                metrics = json.loads(payload.decode("utf-8"))
+                if isinstance(metrics, dict):
+                    self._record_metrics(seg[1], metrics)
+                return
             if len(seg) < 2 or seg[0] != BASE_TOPIC:
                 return
             mac = seg[1]
             if len(seg) == 2:
                 meta = json.loads(payload.decode("utf-8"))
-                expected = int(meta.get("parts"))
-                if expected > 0:
-                    created = self.assembler.start_session(mac, expected)
+                if meta.get("seq") is not None:
+                    # Imagem do spool do dispositivo: falhas ocorridas sem rede chegam em sequência, da mais antiga
+                    logger.info(
+                        "coredump_do_spool mac=%s id=%s seq=%s reset=%s uptime_s=%s fila=%s",
+                        mac, meta.get("id"), meta.get("seq"), meta.get("rst"), meta.get("up"), meta.get("queued"),
+                    )
+                if meta.get("pull"):
+                    requests, release = self.assembler.start_pull(
+                        mac, int(meta["size"]), meta.get("id"), int(meta["max"]),
+                        [int(i) for i in meta.get("first") or []], meta.get("fp"),
+                    )
+                    self._publish_fetch(client, mac, requests, release)
+                    return
+                expected = int(meta["parts"]) if meta.get("parts") is not None else None
+                stream_bytes = int(meta["bytes"]) if meta.get("bytes") is not None else None
+                encoding = meta.get("enc")
+                if encoding is not None and encoding not in SUPPORTED_ENCODINGS:
+                    logger.error("codificacao_desconhecida mac=%s enc=%s sessão ignorada", mac, encoding)
+                    return
+                if encoding == ENCODING_BASE64 and not ACCEPT_BASE64:
+                    logger.error("base64_desabilitado mac=%s sessão ignorada", mac)
+                    return
+                compression = meta.get("comp")
+                if compression is not None and compression not in SUPPORTED_COMPRESSIONS:
+                    logger.error("compressao_desconhecida mac=%s comp=%s sessão ignorada", mac, compression)
+                    return
+                raw_size = meta.get("size")
+                raw_size = int(raw_size) if raw_size is not None else None
+                image_id = meta.get("id")
+                image_crc = int(meta["crc"], 16) if meta.get("crc") is not None else None
+                fingerprint = meta.get("fp")
+                prefix_size = int(meta["pfx"]) if meta.get("pfx") is not None else None
+                first_segments = [int(i) for i in meta.get("first") or []]
+                if (expected or 0) > 0 or (stream_bytes or 0) > 0:
+                    created = self.assembler.start_session(
+                        mac, expected, encoding, compression, raw_size, image_id, stream_bytes, image_crc, fingerprint,
+                        prefix_size, first_segments,
+                    )
                     if not created:
                         logger.warning("mensagem_meta_duplicada mac=%s expected_parts=%s ignorada", mac, expected)
+                    self._publish_ack(client, mac)
+                return
+            if len(seg) == 3 and seg[2] == SUMMARY_TOPIC_SUFFIX:
+                summary = json.loads(payload.decode("utf-8"))
+                if isinstance(summary, dict):
+                    self.assembler.record_summary(mac, summary)
+                return
+            if len(seg) == 5 and seg[2] == RANGE_TOPIC_SUFFIX:
+                try:
+                    offset = int(seg[3])
+                    crc = int(seg[4], 16)
+                except ValueError:
+                    return
+                requests, release = self.assembler.add_range(mac, offset, payload, crc)
+                self._publish_fetch(client, mac, requests, release)
+                return
+            if len(seg) == 3 and seg[2] == MANIFEST_TOPIC_SUFFIX:
+                manifest = json.loads(payload.decode("utf-8"))
+                if isinstance(manifest, dict):
+                    self._publish_need(client, mac, self.assembler.start_blocks(mac, manifest))
                 return
-            if len(seg) == 3:
+            if len(seg) == 5 and seg[2] == BLOCK_TOPIC_SUFFIX:
+                try:
+                    index = int(seg[3])
+                    crc = int(seg[4], 16)
+                except ValueError:
+                    return
+                self._publish_need(client, mac, self.assembler.add_block(mac, index, payload, crc))
+                return
+            if len(seg) == 3 and seg[2] == PULL_STATUS_TOPIC_SUFFIX:
+                status = json.loads(payload.decode("utf-8"))
+                if isinstance(status, dict):
+                    self.assembler.pull_status(mac, status)
+                return
+            if len(seg) == 3 and seg[2] == DUP_TOPIC_SUFFIX:
+                meta = json.loads(payload.decode("utf-8"))
+                fingerprint = meta.get("fp")
+                if not fingerprint:
+                    return
+                known = self.assembler.record_repeat(mac, fingerprint, meta.get("count"))
+                # Responde sempre: o firmware só descarta a imagem se a falha for conhecida
+                client.publish(
+                    f"{BASE_TOPIC}/{mac}/{ACK_TOPIC_SUFFIX}",
+                    json.dumps({"fp": fingerprint, "full": 0 if known else 1}),
+                    qos=1,
+                )
+                return
+            if len(seg) == 3 and seg[2] == PART_TOPIC_SUFFIX:
+                part = self._part_properties(msg)
+                if part is None:
+                    logger.warning("parte_sem_propriedades mac=%s ignorada", mac)
+                    return
+                index, crc, total = part
+                self.assembler.add_part(mac, index, payload, crc, total)
+                self._publish_ack(client, mac)
+                return
+            if len(seg) in (3, 4):
+                # <BASE_TOPIC>/<mac>/<n>[/<crc32 do payload em hex>]
                 try:
                     index = int(seg[2])
+                    crc = int(seg[3], 16) if len(seg) == 4 else None
                 except ValueError:
                     return
-                decoded_payload, _ = maybe_decode_base64(payload)
-                self.assembler.add_part(mac, index, decoded_payload)
+                self.assembler.add_part(mac, index, payload, crc)
+                self._publish_ack(client, mac)
         except Exception:
             logger.exception("mqtt.on_message_excecao")
 
+    @staticmethod
+    def _part_properties(msg: paho.MQTTMessage) -> Optional[Tuple[int, Optional[int], Optional[int]]]:
+        """Extrai (índice, crc, total) de uma parte MQTT 5.
+
+        O firmware os envia nos dados de correlação (uint32 big-endian: índice, CRC32 e, com
+        particionamento fixo, total); versões anteriores usavam as propriedades de usuário.
+        """
+        props = getattr(msg, "properties", None)
+        correlation = getattr(props, "CorrelationData", None)
+        if correlation is not None:
+            if len(correlation) not in (8, 12):
+                return None
+            index, crc, *total = struct.unpack(f">{len(correlation) // 4}I", correlation)
+            return index, crc, total[0] if total else None
+        user = dict(getattr(props, "UserProperty", None) or [])
+        try:
+            index = int(user["n"])
+            crc = int(user["crc"], 16) if "crc" in user else None
+            total = int(user["of"]) if "of" in user else None
+        except (KeyError, ValueError):
+            return None
+        return index, crc, total
+
+    def _record_metrics(self, mac: str, metrics: Dict[str, Any]) -> None:
+        """Grava os tempos do boot ao fim do upload publicados pelo firmware em <METRICS_TOPIC>/<mac>."""
+        self.repo.save_boot_metrics(mac, metrics, int(time.time()))
+        # Tempo até recuperar: imagem apagada (enviada ou descartada) ou, sem apagamento, fim do envio
+        recovered = metrics.get("erase_ms", metrics.get("end_ms"))
+        # Tempo de conexão Wi-Fi: de esp_wifi_start() ao IP; 'wifi_path' 1 = reconexão rápida pelo cache
+        wifi_start, ip_ms = metrics.get("wifi_ms"), metrics.get("ip_ms")
+        wifi_connect = ip_ms - wifi_start if isinstance(wifi_start, int) and isinstance(ip_ms, int) else None
+        logger.info(
+            "metricas_recebidas mac=%s ip_ms=%s wifi_conexao_ms=%s wifi_caminho=%s tls_us=%s tls_retomada=%s mqtt_ms=%s "
+            "recuperacao_ms=%s imagens=%s partes=%s pub_us=%s resultado=%s",
+            mac, ip_ms, wifi_connect, metrics.get("wifi_path"), metrics.get("tls_us"), metrics.get("tls_resume"),
+            metrics.get("mqtt_ms"), recovered, metrics.get("images"), metrics.get("parts"), metrics.get("pub_us"), metrics.get("result"),
+        )
+
+    def _publish_fetch(self, client: paho.Client, mac: str, requests: Sequence[Tuple[int, int]], release: bool) -> None:
+        """Publica pedidos de intervalo e, concluída a busca, a liberação da imagem no dispositivo."""
+        if not requests and not release:
+            return
+        topic = f"{BASE_TOPIC}/{mac}/{FETCH_TOPIC_SUFFIX}"
+        image_id = self.assembler.pull_image_id(mac)
+        for offset, length in requests:
+            client.publish(topic, json.dumps({"off": offset, "len": length, "id": image_id}, separators=(",", ":")), qos=1)
+        if requests:
+            logger.debug("pull.pedidos mac=%s id=%s intervalos=%s", mac, image_id, list(requests))
+        if release:
+            client.publish(topic, json.dumps({PULL_RELEASE_COMMAND: image_id}, separators=(",", ":")), qos=1)
+            logger.info("pull.liberacao_solicitada mac=%s id=%s", mac, image_id)
+
+    def _publish_need(self, client: paho.Client, mac: str, reply: Optional[Dict[str, Any]]) -> None:
+        """Publica ao dispositivo os blocos faltantes ou a conclusão da remontagem."""
+        if reply is None:
+            return
+        client.publish(f"{BASE_TOPIC}/{mac}/{NEED_TOPIC_SUFFIX}", json.dumps(reply, separators=(",", ":")), qos=1)
+        logger.debug("blocos.resposta mac=%s resposta=%s", mac, reply)
+
+    def _publish_ack(self, client: paho.Client, mac: str) -> None:
+        """Publica no tópico de ACK quantas partes contíguas já foram recebidas, se devido."""
+        ack = self.assembler.pending_ack(mac)
+        if ack is None:
+            return
+        hwm, received, resend = ack
+        body: Dict[str, int] = {"next": hwm, "bytes": received}
+        if resend:
+            body["resend"] = hwm + 1  # Primeira parte faltante, de onde o dispositivo deve retomar
+        client.publish(f"{BASE_TOPIC}/{mac}/{ACK_TOPIC_SUFFIX}", json.dumps(body), qos=1)
+        logger.debug("ack_publicado mac=%s next=%d bytes=%d reenvio=%s", mac, hwm, received, resend)
+
 
-__all__ = ["MqttReceiver"]
+__all__ = ["MqttReceiver", "prefix_elf", "restore_image_order"]
 
 
@@ -10,11 +10,16 @@ Fluxo:
 4. aplica CSV de clusters.
 5. atualiza estado.
 
+No modo incremental (padrão), cada verificação só atribui os coredumps novos ao cluster
+mais próximo (cluster_incremental.py); a rodada completa acima roda em segundo plano, quando
+há coredumps que não couberam em nenhum cluster ou a cada FULL_RECLUSTER_INTERVAL_SECONDS.
+
 Formato esperado de cada registro de coredump (tupla retornada pelo repositório):
  (coredump_id, device_mac_address, firmware_id_on_crash, cluster_id, raw_dump_path, log_path, received_at)
  O índice 5 (log_path) contém o caminho do relatório processado (pode ser None se não foi processado).
 
-Variáveis de ambiente relevantes: (nenhuma obrigatória por enquanto)
+Variáveis de ambiente relevantes: (nenhuma obrigatória)
+  COREDUMP_CLUSTER_INCREMENTAL -> 0 volta a rodar a DAMICORE completa a cada gatilho.
 
 TODO: Permitir sobreposição da imagem Docker via variável de ambiente.
 TODO: Tratar montagem do volume Docker quando o caminho do projeto contém espaços.
@@ -23,8 +28,10 @@ TODO: Tratar montagem do volume Docker quando o caminho do projeto contém espa
 from __future__ import annotations
 
 import logging
+import os
 import shutil
 import subprocess
+import threading
 import time
 from datetime import datetime
 from pathlib import Path
@@ -52,6 +59,12 @@ except ImportError as e:
     logging.error("Erro ao importar cluster_sincronyzer: %s", e)
     raise SystemExit(1)
 
+try:  # Atribuição incremental aos clusters existentes
+    from . import cluster_incremental as incremental
+except ImportError as e:
+    logging.error("Erro ao importar cluster_incremental: %s", e)
+    raise SystemExit(1)
+
 # ---------------------------------------------------------------------------
 # Constantes de Configuração
 # ---------------------------------------------------------------------------
@@ -65,6 +78,13 @@ MIN_NEW_COREDUMPS_TRIGGER: int = 10
 # Tempo máximo (segundos) desde a última execução antes de forçar nova rodada.
 MAX_TIME_SINCE_LAST_RUN_SECONDS: int = 60 * 5  # 5 minutos
 
+# Modo incremental: atribui coredumps novos aos clusters existentes a cada verificação e
+# deixa a DAMICORE completa para o segundo plano.
+INCREMENTAL_CLUSTERING: bool = os.getenv("COREDUMP_CLUSTER_INCREMENTAL", "1") not in ("0", "false", "False")
+
+# No modo incremental, intervalo máximo entre rodadas completas (se houve mudança desde a última).
+FULL_RECLUSTER_INTERVAL_SECONDS: int = 60 * 60 * 6  # 6 horas
+
 # Intervalo do loop principal (quando executado como script).
 MAIN_LOOP_INTERVAL_SECONDS: int = 60
 
@@ -80,11 +100,18 @@ DAMICORE_DOCKER_TIMEOUT_S: int = 600
 CoredumpRecord: TypeAlias = Sequence[Any]
 
 
-def check_trigger(repo: IDataRepository) -> bool:
+def check_trigger(
+    repo: IDataRepository,
+    max_interval_s: int = MAX_TIME_SINCE_LAST_RUN_SECONDS,
+    changed_since_last_run: int = 0,
+) -> bool:
     """Decide se a clusterização deve iniciar (quantidade ou tempo).
     
     Args:
         repo: Repositório de dados para acessar coredumps.
+        max_interval_s: Tempo máximo desde a última rodada antes de forçar outra.
+        changed_since_last_run: Coredumps atribuídos fora da DAMICORE desde a última
+            rodada; contam para o gatilho por tempo como os não clusterizados.
     
     Returns:
         True se o gatilho foi ativado, False caso contrário.
@@ -98,7 +125,7 @@ def check_trigger(repo: IDataRepository) -> bool:
 
     unclustered = repo.get_unclustered_coredumps()
     unclustered_count = len(unclustered)
-    if unclustered_count == 0:
+    if unclustered_count == 0 and changed_since_last_run == 0:
         logger.debug("Nenhum coredump novo desde a última execução.")
         return False
 
@@ -118,11 +145,11 @@ def check_trigger(repo: IDataRepository) -> bool:
         last_run_timestamp = 0.0  # nunca executou
 
     elapsed = time.time() - last_run_timestamp
-    if elapsed > MAX_TIME_SINCE_LAST_RUN_SECONDS:
+    if elapsed > max_interval_s:
         logger.info(
             "Gatilho por tempo: %.0fs desde última execução (limite=%ds)",
             elapsed,
-            MAX_TIME_SINCE_LAST_RUN_SECONDS,
+            max_interval_s,
         )
         return True
 
@@ -283,43 +310,88 @@ def cleanup(remove_cluster_file: bool = False) -> None:
         logger.debug("Removido arquivo de cluster '%s'", CLUSTER_OUTPUT_FILE)
 
 
-def main(repo: IDataRepository) -> None:
-    """Executa uma rodada de clusterização completa se gatilho ativo.
-    
-    Args:
-        repo: Repositório de dados para acessar e atualizar coredumps.
-    """
-    logger.info(
-        "Iniciando rodada de verificação em %s",
-        datetime.now().isoformat(timespec="seconds"),
-    )
-
-    repo.create_database()  # Garantir estrutura
-
-    if not check_trigger(repo):
-        return
-
+def run_full_clustering(repo: IDataRepository) -> bool:
+    """Snapshot, DAMICORE e reconciliação sobre todos os coredumps; retorna sucesso."""
     try:
         copied = prepare_snapshot_directory(repo)
         if copied == 0:
             logger.info("Nenhum arquivo disponível para processar.")
-            return
+            return False
         
         if copied < 2:
             logger.warning(
                 "DAMICORE requer pelo menos 2 coredumps para clusterização. Encontrados: %d. "
                 "Aguardando mais coredumps...", copied
             )
-            return
+            return False
 
         if run_damicore_clustering_docker():
             process_clustering_results(repo)
-        else:
-            logger.error("Execução da DAMICORE falhou; resultados não aplicados.")
+            return True
+        logger.error("Execução da DAMICORE falhou; resultados não aplicados.")
     except Exception as e:  # noqa: BLE001
         logger.exception("Erro crítico durante a rodada: %s", e)
     finally:
         cleanup(remove_cluster_file=False)
+    return False
+
+
+_full_run_lock = threading.Lock()
+
+
+def _background_full_clustering(repo: IDataRepository) -> None:
+    try:
+        started = time.monotonic()
+        if run_full_clustering(repo):
+            incremental.refresh_representatives(repo)
+            logger.info("Rodada completa em segundo plano concluída em %.1fs.", time.monotonic() - started)
+    except Exception:  # noqa: BLE001
+        logger.exception("Erro na rodada completa em segundo plano")
+    finally:
+        _full_run_lock.release()
+
+
+def main(repo: IDataRepository) -> None:
+    """Executa uma rodada de clusterização se gatilho ativo.
+    
+    No modo incremental, atribui os coredumps novos aos clusters existentes e, se o
+    gatilho da rodada completa disparar, roda a DAMICORE numa thread própria; as
+    verificações seguintes continuam atribuindo enquanto ela roda.
+    
+    Args:
+        repo: Repositório de dados para acessar e atualizar coredumps.
+    """
+    logger.info(
+        "Iniciando rodada de verificação em %s",
+        datetime.now().isoformat(timespec="seconds"),
+    )
+
+    repo.create_database()  # Garantir estrutura
+
+    if not INCREMENTAL_CLUSTERING:
+        if check_trigger(repo):
+            run_full_clustering(repo)
+        return
+
+    cache = incremental.get_cache()
+    if not cache.representatives and repo.get_clustered_coredumps():
+        # Clusters de uma rodada anterior ao cache (ou cache apagado)
+        incremental.refresh_representatives(repo, cache)
+    incremental.assign_new_coredumps(repo, cache)
+
+    if _full_run_lock.locked():
+        logger.debug("Rodada completa em andamento; apenas atribuição incremental.")
+        return
+    # Sem clusters ainda, nada é atribuído: vale o intervalo normal até a primeira rodada
+    interval = FULL_RECLUSTER_INTERVAL_SECONDS if cache.representatives else MAX_TIME_SINCE_LAST_RUN_SECONDS
+    if not check_trigger(repo, interval, cache.assigned_since_full):
+        return
+    if not _full_run_lock.acquire(blocking=False):
+        return
+    logger.info("Iniciando rodada completa da DAMICORE em segundo plano.")
+    threading.Thread(
+        target=_background_full_clustering, args=(repo,), name="damicore-full", daemon=True
+    ).start()
 
 
 if __name__ == "__main__":
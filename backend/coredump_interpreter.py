@@ -9,9 +9,15 @@ Fluxo resumido:
 3. Extrai bloco entre marcadores pré-definidos; se ausentes, usa saída completa.
 4. Salva relatório .txt e retorna o caminho.
 
+Com COREDUMP_WARM_WORKERS > 0, generate_coredump_report() usa contêineres de longa
+duração (interpreter_worker.py) em vez de um docker run por coredump: o ambiente do IDF e
+o esp_coredump já estão carregados e o ELF de cada firmware é enviado e analisado uma vez.
+
 Variáveis de ambiente relevantes:
   COREDUMP_DOCKER_IMAGE  -> sobrescreve a imagem Docker padrão.
   COREDUMP_DOCKER_TIMEOUT -> timeout (segundos) da execução do docker run.
+  COREDUMP_WARM_WORKERS -> contêineres interpretadores mantidos vivos (0 = docker run por coredump).
+  COREDUMP_WORKER_ELF_CACHE -> firmwares mantidos em cache por contêiner.
 
 Formato esperado do coredump: arquivo raw (.cdmp) exportado pelo ESP-IDF.
 Formato esperado do ELF: firmware compilado correspondente ao coredump.
@@ -22,11 +28,17 @@ TODO: permitir extração incremental (stream) para coredumps muito grandes.
 
 from __future__ import annotations
 
+import atexit
+import base64
+import json
 import logging
 import os
+import queue
 import subprocess
+import threading
+import time
 from pathlib import Path
-from typing import Optional, Union, Sequence, List
+from typing import Any, Dict, Optional, Union, Sequence, List, Tuple
 
 # ---------------------------------------------------------------------------
 # Constantes configuráveis (podem ser sobrescritas por variáveis de ambiente)
@@ -38,6 +50,16 @@ END_MARKER: str = "===================== ESP32 CORE DUMP END ===================
 
 ENV_DOCKER_IMAGE: str = os.getenv("COREDUMP_DOCKER_IMAGE", DEFAULT_DOCKER_IMAGE)
 ENV_TIMEOUT: int = int(os.getenv("COREDUMP_DOCKER_TIMEOUT", str(DEFAULT_TIMEOUT_SECONDS)))
+ENV_WARM_WORKERS: int = max(0, int(os.getenv("COREDUMP_WARM_WORKERS", "2")))
+ENV_WORKER_ELF_CACHE: int = max(1, int(os.getenv("COREDUMP_WORKER_ELF_CACHE", "8")))
+
+# Script do interpretador de longa duração, montado no contêiner
+WORKER_SCRIPT: Path = Path(__file__).resolve().with_name("interpreter_worker.py")
+WORKER_SCRIPT_IN_CONTAINER: str = "/opt/coredump/interpreter_worker.py"
+# Tempo para o contêiner subir e carregar o esp_coredump
+WORKER_START_TIMEOUT_SECONDS: int = 120
+# Após uma falha ao iniciar, o contêiner só é tentado de novo depois deste intervalo
+WORKER_RETRY_SECONDS: int = 60
 
 logger = logging.getLogger("backend.coredump_interpreter")
 
@@ -46,6 +68,10 @@ class CoreDumpProcessingError(Exception):
     """Erro durante o processamento do coredump (execução Docker ou parsing)."""
 
 
+class WorkerUnavailableError(CoreDumpProcessingError):
+    """Interpretador de longa duração não iniciou ou parou de responder."""
+
+
 def _build_docker_command(
     coredump_file: Path,
     elf_file: Path,
@@ -53,6 +79,7 @@ def _build_docker_command(
     chip_type: Optional[str],
     start_marker: str = START_MARKER,
     end_marker: str = END_MARKER,
+    core_format: str = "raw",
 ) -> List[str]:
     """Monta a lista de argumentos para execução do Docker.
 
@@ -63,7 +90,7 @@ def _build_docker_command(
 
     command_parts: List[str] = [
         "esp-coredump", "info_corefile",
-        "--core-format", "raw",
+        "--core-format", core_format,
         "--core", container_core_filename,
     ]
     if chip_type:
@@ -112,6 +139,30 @@ def _extract_report(stdout: str, start_marker: str, end_marker: str) -> str:
         return stdout
 
 
+def _save_report(stdout: str, output_report_path: Path, start_marker: str, end_marker: str) -> Path:
+    clean_report = _extract_report(stdout, start_marker, end_marker)
+    output_report_path.write_text(clean_report, encoding="utf-8")
+    logger.info("Relatório salvo em %s (%d chars)", output_report_path, len(clean_report))
+    return output_report_path
+
+
+def _validate_paths(
+    coredump_path: Union[str, Path], elf_path: Union[str, Path], output_dir: Union[str, Path]
+) -> Tuple[Path, Path, Path]:
+    """Resolve e valida os caminhos de entrada; retorna (coredump, elf, diretório de saída)."""
+    coredump_file = Path(coredump_path).resolve()
+    elf_file = Path(elf_path).resolve()
+    output_path = Path(output_dir).resolve()
+
+    if not coredump_file.is_file():  # valida arquivo de coredump
+        raise FileNotFoundError(f"Arquivo de coredump não encontrado: {coredump_file}")
+    if not elf_file.is_file():  # valida ELF
+        raise FileNotFoundError(f"Arquivo ELF não encontrado: {elf_file}")
+    if not output_path.is_dir():  # valida diretório de saída
+        raise FileNotFoundError(f"Diretório de destino inexistente: {output_path}")
+    return coredump_file, elf_file, output_path
+
+
 def generate_coredump_report_docker(
     coredump_path: Union[str, Path],
     elf_path: Union[str, Path],
@@ -121,6 +172,7 @@ def generate_coredump_report_docker(
     timeout_seconds: int | None = None,
     start_marker: str = START_MARKER,
     end_marker: str = END_MARKER,
+    core_format: str = "raw",
 ) -> Path:
     """Gera relatório de coredump a partir de arquivo raw e ELF.
 
@@ -132,19 +184,11 @@ def generate_coredump_report_docker(
       chip_type: ex: 'esp32'; acrescenta ROM ELF se fornecido.
       timeout_seconds: override do timeout (segundos).
       start_marker/end_marker: delimitadores do bloco de interesse.
+      core_format: 'raw' (imagem da partição) ou 'elf' (ELF core, ex.: prefixo parcial).
     Retorna: Path do arquivo de relatório gerado.
     Lança: FileNotFoundError, CoreDumpProcessingError.
     """
-    coredump_file = Path(coredump_path).resolve()
-    elf_file = Path(elf_path).resolve()
-    output_path = Path(output_dir).resolve()
-
-    if not coredump_file.is_file():  # valida arquivo de coredump
-        raise FileNotFoundError(f"Arquivo de coredump não encontrado: {coredump_file}")
-    if not elf_file.is_file():  # valida ELF
-        raise FileNotFoundError(f"Arquivo ELF não encontrado: {elf_file}")
-    if not output_path.is_dir():  # valida diretório de saída
-        raise FileNotFoundError(f"Diretório de destino inexistente: {output_path}")
+    coredump_file, elf_file, output_path = _validate_paths(coredump_path, elf_path, output_dir)
 
     image_to_use = docker_image or ENV_DOCKER_IMAGE
     effective_timeout = timeout_seconds or ENV_TIMEOUT
@@ -162,6 +206,7 @@ def generate_coredump_report_docker(
         chip_type=chip_type,
         start_marker=start_marker,
         end_marker=end_marker,
+        core_format=core_format,
     )
 
     try:
@@ -174,12 +219,7 @@ def generate_coredump_report_docker(
             timeout=effective_timeout,
         )
         logger.debug("Execução Docker concluída: returncode=%d", result.returncode)
-        report_content = result.stdout
-
-        clean_report = _extract_report(report_content, start_marker, end_marker)
-        output_report_path.write_text(clean_report, encoding="utf-8")
-        logger.info("Relatório salvo em %s (%d chars)", output_report_path, len(clean_report))
-        return output_report_path
+        return _save_report(result.stdout, output_report_path, start_marker, end_marker)
 
     except subprocess.CalledProcessError as e:  # erro no esp-coredump
         logger.error(
@@ -208,6 +248,233 @@ def generate_coredump_report_docker(
         raise CoreDumpProcessingError("Erro inesperado ao processar coredump.") from e
 
 
+# ---------------------------------------------------------------------------
+# Interpretadores de longa duração
+# ---------------------------------------------------------------------------
+def _elf_key(elf_file: Path) -> str:
+    """Identifica o firmware no cache do worker; um ELF regravado no mesmo caminho é outro firmware."""
+    st = elf_file.stat()
+    return f"{elf_file}:{st.st_size}:{st.st_mtime_ns}"
+
+
+class _WarmWorker:
+    """Um contêiner com interpreter_worker.py, falando JSON por linha no stdin/stdout do docker run."""
+
+    def __init__(self, index: int, docker_image: str) -> None:
+        self.name = f"coredump-interpreter-{os.getpid()}-{index}"
+        self.docker_image = docker_image
+        self.elf_keys: set = set()  # Firmwares já enviados a este contêiner
+        self.proc: Optional[subprocess.Popen] = None
+        self._lines: "queue.Queue[Optional[str]]" = queue.Queue()
+        self._next_id = 0
+        self._retry_at = 0.0  # Fim da espera após uma falha ao iniciar
+
+    @property
+    def alive(self) -> bool:
+        return self.proc is not None and self.proc.poll() is None
+
+    def start(self) -> None:
+        if time.monotonic() < self._retry_at:
+            raise WorkerUnavailableError("Interpretador falhou ao iniciar há pouco")
+        self._retry_at = time.monotonic() + WORKER_RETRY_SECONDS
+        cmd = [
+            "docker", "run", "-i", "--rm",
+            "--name", self.name,
+            "-e", f"COREDUMP_WORKER_ELF_CACHE={ENV_WORKER_ELF_CACHE}",
+            "-v", f"{WORKER_SCRIPT}:{WORKER_SCRIPT_IN_CONTAINER}:ro",
+            self.docker_image,
+            "bash", "-c", f"exec python {WORKER_SCRIPT_IN_CONTAINER}",
+        ]
+        logger.debug("Iniciando interpretador: %s", " ".join(cmd))
+        started = time.monotonic()
+        try:
+            self.proc = subprocess.Popen(
+                cmd, stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                text=True, encoding="utf-8", bufsize=1,
+            )
+        except FileNotFoundError as e:
+            raise WorkerUnavailableError("Comando 'docker' não encontrado.") from e
+        self.elf_keys.clear()
+        self._lines = queue.Queue()
+        threading.Thread(target=self._read_stdout, args=(self.proc, self._lines), name=f"{self.name}-out", daemon=True).start()
+        threading.Thread(target=self._drain_stderr, args=(self.proc,), name=f"{self.name}-err", daemon=True).start()
+        ready = self._await(lambda m: "ready" in m, WORKER_START_TIMEOUT_SECONDS)
+        if not ready.get("ready"):
+            self.stop()
+            raise WorkerUnavailableError(f"Interpretador não iniciou: {ready.get('error')}")
+        self._retry_at = 0.0
+        logger.info("Interpretador pronto name=%s duracao_ms=%d", self.name, int((time.monotonic() - started) * 1000))
+
+    def stop(self) -> None:
+        proc, self.proc = self.proc, None
+        if proc is None:
+            return
+        try:
+            proc.stdin.close()
+            proc.wait(timeout=5)
+        except (OSError, subprocess.TimeoutExpired):
+            proc.kill()
+            # Matar o cliente não para o contêiner de imediato
+            subprocess.run(["docker", "rm", "-f", self.name], capture_output=True, check=False)
+
+    @staticmethod
+    def _read_stdout(proc: subprocess.Popen, lines: "queue.Queue[Optional[str]]") -> None:
+        for line in proc.stdout:
+            lines.put(line)
+        lines.put(None)
+
+    def _drain_stderr(self, proc: subprocess.Popen) -> None:
+        for line in proc.stderr:
+            logger.debug("%s: %s", self.name, line.rstrip())
+
+    def _await(self, match: Any, timeout: float) -> Dict[str, Any]:
+        """Próxima mensagem JSON que satisfaz 'match'; linhas que não são do protocolo são ignoradas."""
+        deadline = time.monotonic() + timeout
+        while True:
+            remaining = deadline - time.monotonic()
+            try:
+                line = self._lines.get(timeout=max(0.0, remaining))
+            except queue.Empty:
+                self.stop()
+                raise WorkerUnavailableError(f"Interpretador sem resposta em {timeout:.0f}s") from None
+            if line is None:
+                self.stop()
+                raise WorkerUnavailableError("Interpretador encerrou")
+            try:
+                msg = json.loads(line)
+            except ValueError:
+                continue  # Saída do entrypoint da imagem (export.sh)
+            if isinstance(msg, dict) and match(msg):
+                return msg
+
+    def interpret(self, core: bytes, elf_file: Path, chip_type: Optional[str], core_format: str, timeout: float) -> str:
+        key = _elf_key(elf_file)
+        self._next_id += 1
+        rid = self._next_id
+        request: Dict[str, Any] = {
+            "id": rid, "elf": key, "core": base64.b64encode(core).decode("ascii"), "format": core_format, "chip": chip_type,
+        }
+        for _ in range(2):
+            if key not in self.elf_keys:
+                # Firmware novo para este contêiner: vai junto com o coredump e fica no cache
+                request["elf_data"] = base64.b64encode(elf_file.read_bytes()).decode("ascii")
+            try:
+                self.proc.stdin.write(json.dumps(request) + "\n")
+                self.proc.stdin.flush()
+            except (OSError, AttributeError) as e:
+                self.stop()
+                raise WorkerUnavailableError("Falha ao enviar ao interpretador") from e
+            reply = self._await(lambda m: m.get("id") == rid, timeout)
+            if reply.get("need_elf"):
+                self.elf_keys.discard(key)  # Saiu do cache do contêiner
+                continue
+            self.elf_keys.add(key)
+            if not reply.get("ok"):
+                raise CoreDumpProcessingError(f"Falha ao executar esp-coredump\n{reply.get('error')}")
+            logger.debug("Interpretado por %s em %sms", self.name, reply.get("ms"))
+            return reply.get("stdout", "")
+        raise CoreDumpProcessingError("Interpretador recusou o ELF do firmware")
+
+
+class WarmInterpreterPool:
+    """Contêineres interpretadores vivos; cada coredump vai preferencialmente para um que já tem o firmware.
+
+    Os contêineres sobem sob demanda; um que trave ou encerre é descartado e recriado
+    no coredump seguinte.
+    """
+
+    def __init__(self, size: int = ENV_WARM_WORKERS, docker_image: Optional[str] = None) -> None:
+        self._workers = [_WarmWorker(i, docker_image or ENV_DOCKER_IMAGE) for i in range(size)]
+        self._idle = list(self._workers)
+        self._cond = threading.Condition()
+
+    def _acquire(self, key: str) -> _WarmWorker:
+        with self._cond:
+            while not self._idle:
+                self._cond.wait()
+            # Afinidade por firmware: o ELF dele já está analisado naquele contêiner
+            worker = next((w for w in self._idle if key in w.elf_keys and w.alive), None)
+            worker = worker or next((w for w in self._idle if w.alive), self._idle[0])
+            self._idle.remove(worker)
+            return worker
+
+    def _release(self, worker: _WarmWorker) -> None:
+        with self._cond:
+            self._idle.append(worker)
+            self._cond.notify()
+
+    def interpret(self, core: bytes, elf_file: Path, chip_type: Optional[str], core_format: str, timeout: float) -> str:
+        worker = self._acquire(_elf_key(elf_file))
+        try:
+            if not worker.alive:
+                worker.start()
+            return worker.interpret(core, elf_file, chip_type, core_format, timeout)
+        finally:
+            self._release(worker)
+
+    def close(self) -> None:
+        for worker in self._workers:
+            worker.stop()
+
+
+_warm_pool: Optional[WarmInterpreterPool] = None
+_warm_pool_lock = threading.Lock()
+
+
+def _get_warm_pool() -> WarmInterpreterPool:
+    global _warm_pool
+    with _warm_pool_lock:
+        if _warm_pool is None:
+            _warm_pool = WarmInterpreterPool()
+            atexit.register(_warm_pool.close)
+        return _warm_pool
+
+
+def generate_coredump_report_warm(
+    coredump_path: Union[str, Path],
+    elf_path: Union[str, Path],
+    output_dir: Union[str, Path],
+    chip_type: Optional[str] = None,
+    timeout_seconds: int | None = None,
+    start_marker: str = START_MARKER,
+    end_marker: str = END_MARKER,
+    core_format: str = "raw",
+) -> Path:
+    """Como generate_coredump_report_docker, mas num interpretador de longa duração.
+
+    Lança WorkerUnavailableError se nenhum contêiner puder atender (o chamador pode
+    recorrer ao docker run); FileNotFoundError e CoreDumpProcessingError como a versão Docker.
+    """
+    coredump_file, elf_file, output_path = _validate_paths(coredump_path, elf_path, output_dir)
+    effective_timeout = timeout_seconds or ENV_TIMEOUT
+    started = time.monotonic()
+    stdout = _get_warm_pool().interpret(coredump_file.read_bytes(), elf_file, chip_type, core_format, effective_timeout)
+    logger.info(
+        "Coredump interpretado name=%s duracao_ms=%d", coredump_file.name, int((time.monotonic() - started) * 1000),
+    )
+    return _save_report(stdout, output_path / f"{coredump_file.stem}.txt", start_marker, end_marker)
+
+
+def generate_coredump_report(
+    coredump_path: Union[str, Path],
+    elf_path: Union[str, Path],
+    output_dir: Union[str, Path],
+    chip_type: Optional[str] = None,
+    core_format: str = "raw",
+) -> Path:
+    """Gera o relatório pelos interpretadores de longa duração ou, sem eles, com docker run."""
+    if ENV_WARM_WORKERS > 0:
+        try:
+            return generate_coredump_report_warm(
+                coredump_path, elf_path, output_dir, chip_type=chip_type, core_format=core_format,
+            )
+        except WorkerUnavailableError as e:
+            logger.warning("Interpretador de longa duração indisponível (%s); usando docker run.", e)
+    return generate_coredump_report_docker(
+        coredump_path, elf_path, output_dir, chip_type=chip_type, core_format=core_format,
+    )
+
+
 def main() -> int:
     """Função principal para execução direta via CLI (uso manual/teste)."""
     # Caminhos de teste padrão (ajuste conforme necessidade local)
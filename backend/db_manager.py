@@ -22,6 +22,9 @@ Formato dos registros (rows):
     clusters: (cluster_id, name)
     coredumps: (coredump_id, device_mac_address, firmware_id_on_crash,
                 cluster_id, raw_dump_path, log_path, received_at)
+    crash_fingerprints: (device_mac_address, fingerprint, coredump_id, occurrences, last_seen)
+    boot_metrics: (metric_id, device_mac_address, received_at, reset_reason, result, ip_ms, mqtt_ms,
+                   upload_start_ms, upload_end_ms, erase_ms, parts, bytes, payload)
 
 TODO: - Validar/sanitizar `elf_path` (evitar path traversal / apontar para fora da base).
 TODO: - Converter Rows para dataclasses / objetos de domínio.
@@ -37,6 +40,7 @@ Notas rápidas:
 
 from __future__ import annotations
 
+import json
 import sqlite3
 from pathlib import Path
 from datetime import datetime
@@ -133,6 +137,42 @@ def create_database() -> None:
                 );
                 """
             )
+            # Impressões digitais de falhas: ocorrências repetidas reportadas pelo firmware
+            # sem reenviar a imagem contam para o coredump (e o cluster) já recebido
+            conn.execute(
+                """
+                CREATE TABLE IF NOT EXISTS crash_fingerprints (
+                    device_mac_address TEXT NOT NULL,
+                    fingerprint TEXT NOT NULL,
+                    coredump_id INTEGER NOT NULL,
+                    occurrences INTEGER NOT NULL DEFAULT 1,
+                    last_seen INTEGER,
+                    PRIMARY KEY(device_mac_address, fingerprint),
+                    FOREIGN KEY(coredump_id) REFERENCES coredumps(coredump_id) ON DELETE CASCADE
+                );
+                """
+            )
+            # Tempos do boot ao fim do upload (ms desde o boot); 'payload' guarda a mensagem completa,
+            # incluindo os tempos por etapa, para análises de p50/p99 de recuperação
+            conn.execute(
+                """
+                CREATE TABLE IF NOT EXISTS boot_metrics (
+                    metric_id INTEGER PRIMARY KEY AUTOINCREMENT,
+                    device_mac_address TEXT NOT NULL,
+                    received_at INTEGER NOT NULL,
+                    reset_reason INTEGER,
+                    result INTEGER,
+                    ip_ms INTEGER,
+                    mqtt_ms INTEGER,
+                    upload_start_ms INTEGER,
+                    upload_end_ms INTEGER,
+                    erase_ms INTEGER,
+                    parts INTEGER,
+                    bytes INTEGER,
+                    payload TEXT NOT NULL
+                );
+                """
+            )
             logger.info("Banco de dados e tabelas verificados/criados (path=%s)", DB_PATH)
     except sqlite3.Error:  # pragma: no cover - loga contexto
         logger.exception("Falha ao criar/verificar estrutura do banco")
@@ -385,6 +425,93 @@ def delete_coredump(coredump_id: int) -> bool:
     logger.info("Deletando coredump id=%s", coredump_id)
     _execute_query("DELETE FROM coredumps WHERE coredump_id = ?", (coredump_id,))
     return True
+
+
+## ---------------------------------------------------------------------------
+# CRUD: Impressões digitais de falhas
+## ---------------------------------------------------------------------------
+def add_crash_fingerprint(
+    device_mac: str,
+    fingerprint: str,
+    coredump_id: int,
+    seen_at: Optional[int] = None,
+) -> None:
+    """Associa a impressão digital ao coredump completo recebido (conta como uma ocorrência)."""
+    if seen_at is None:
+        seen_at = int(datetime.now().timestamp())
+    _execute_query(
+        """
+        INSERT INTO crash_fingerprints (device_mac_address, fingerprint, coredump_id, occurrences, last_seen)
+        VALUES (?, ?, ?, 1, ?)
+        ON CONFLICT(device_mac_address, fingerprint) DO UPDATE SET
+            coredump_id = excluded.coredump_id,
+            occurrences = occurrences + 1,
+            last_seen = excluded.last_seen
+        """,
+        (device_mac, fingerprint, coredump_id, seen_at),
+    )
+
+
+def bump_crash_fingerprint(
+    device_mac: str,
+    fingerprint: str,
+    seen_at: Optional[int] = None,
+) -> Optional[tuple[int, Optional[int], int]]:
+    """Conta uma ocorrência repetida da falha.
+
+    Retorna (coredump_id, cluster_id, ocorrências) do coredump que representa a falha,
+    ou None se a impressão digital não for conhecida.
+    """
+    row = _execute_query(
+        """
+        SELECT f.coredump_id, c.cluster_id, f.occurrences
+        FROM crash_fingerprints f JOIN coredumps c ON c.coredump_id = f.coredump_id
+        WHERE f.device_mac_address = ? AND f.fingerprint = ?
+        """,
+        (device_mac, fingerprint),
+        fetch="one",
+    )
+    if not row:
+        return None
+    if seen_at is None:
+        seen_at = int(datetime.now().timestamp())
+    _execute_query(
+        "UPDATE crash_fingerprints SET occurrences = occurrences + 1, last_seen = ? WHERE device_mac_address = ? AND fingerprint = ?",
+        (seen_at, device_mac, fingerprint),
+    )
+    return int(row[0]), row[1], int(row[2]) + 1  # type: ignore[index]
+
+
+## ---------------------------------------------------------------------------
+# CRUD: Métricas de boot/upload
+## ---------------------------------------------------------------------------
+def add_boot_metrics(device_mac: str, metrics: dict[str, Any], received_at: Optional[int] = None) -> Optional[int]:
+    """Grava a mensagem de métricas publicada pelo firmware após um boot com coredump."""
+    if received_at is None:
+        received_at = int(datetime.now().timestamp())
+    return _execute_query(
+        """
+        INSERT INTO boot_metrics (device_mac_address, received_at, reset_reason, result, ip_ms, mqtt_ms,
+                                  upload_start_ms, upload_end_ms, erase_ms, parts, bytes, payload)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+        """,
+        (
+            device_mac,
+            received_at,
+            metrics.get("reset"),
+            metrics.get("result"),
+            metrics.get("ip_ms"),
+            metrics.get("mqtt_ms"),
+            metrics.get("start_ms"),
+            metrics.get("end_ms"),
+            metrics.get("erase_ms"),
+            metrics.get("parts"),
+            metrics.get("bytes"),
+            json.dumps(metrics),
+        ),
+    )  # type: ignore[return-value]
+
+
 ## ---------------------------------------------------------------------------
 # Bloco de demonstração (executado somente se rodar diretamente)
 ## ---------------------------------------------------------------------------
@@ -393,7 +520,7 @@ def _demo() -> None:
     create_database()
 
     logger.info("Limpando dados anteriores (ordem importa por FK)...")
-    for table in ("coredumps", "clusters", "devices", "firmwares"):
+    for table in ("boot_metrics", "crash_fingerprints", "coredumps", "clusters", "devices", "firmwares"):
         _execute_query(f"DELETE FROM {table}")
 
     fw_id_1 = add_firmware("SensorApp", "1.0.0", "storage/elfs/SensorApp/1.0.0/firmware.elf")
@@ -0,0 +1,171 @@
+"""interpreter_worker.py
+
+Interpretador de coredumps de longa duração, executado dentro do contêiner da Espressif.
+
+Em vez de um 'docker run esp-coredump' por coredump, o backend mantém alguns destes
+processos vivos (ver WarmInterpreterPool em coredump_interpreter.py) e conversa com cada
+um por stdin/stdout, uma requisição JSON por linha. O ambiente do ESP-IDF e o módulo
+esp_coredump ficam carregados, e cada firmware é recebido uma única vez: o ELF fica em
+disco no contêiner e o ELF já analisado fica em memória, por firmware.
+
+Protocolo (uma linha JSON por mensagem):
+  <- {"ready": true, "pid": ...}                          ao iniciar
+  -> {"id": 1, "elf": "<chave>", "core": "<base64>", "format": "raw", "chip": "esp32"}
+  <- {"id": 1, "need_elf": true}                          firmware ausente do cache
+  -> {"id": 1, "elf": "<chave>", "elf_data": "<base64>", "core": ..., ...}
+  <- {"id": 1, "ok": true, "stdout": "...", "ms": 42}
+  <- {"id": 1, "ok": false, "error": "..."}
+
+Este arquivo não importa nada do backend: é montado no contêiner e roda no Python do IDF.
+"""
+
+from __future__ import annotations
+
+import base64
+import contextlib
+import hashlib
+import io
+import json
+import os
+import sys
+import tempfile
+import time
+from collections import OrderedDict
+from typing import Any, Callable, Dict, Optional
+
+# Firmwares mantidos por processo (ELF em disco e ELF analisado em memória)
+CACHE_SIZE: int = max(1, int(os.getenv("COREDUMP_WORKER_ELF_CACHE", "8")))
+
+WORK_DIR: str = tempfile.mkdtemp(prefix="coredump_worker_")
+
+
+class ElfCache:
+    """Firmwares recebidos, do menos ao mais recente; os mais antigos saem do cache."""
+
+    def __init__(self, size: int) -> None:
+        self.size = size
+        self._paths: "OrderedDict[str, str]" = OrderedDict()
+        self._parsed: Dict[str, Any] = {}
+
+    def get(self, key: str) -> Optional[str]:
+        path = self._paths.get(key)
+        if path is not None:
+            self._paths.move_to_end(key)
+        return path
+
+    def put(self, key: str, data: bytes) -> str:
+        # Nome pelo hash da chave inteira: firmwares distintos nunca dividem um arquivo
+        path = os.path.join(WORK_DIR, f"{hashlib.sha256(key.encode('utf-8')).hexdigest()}.elf")
+        with open(path, "wb") as f:
+            f.write(data)
+        self._parsed.pop(path, None)  # O arquivo mudou: a análise anterior não vale mais
+        self._paths[key] = path
+        self._paths.move_to_end(key)
+        while len(self._paths) > self.size:
+            _, old = self._paths.popitem(last=False)
+            self._parsed.pop(old, None)
+            with contextlib.suppress(OSError):
+                os.unlink(old)
+        return path
+
+    def holds(self, path: str) -> bool:
+        return path in self._paths.values()
+
+    def parsed(self, path: str, factory: Callable[..., Any], *args: Any, **kwargs: Any) -> Any:
+        """ELF analisado pelo esp_coredump, reaproveitado entre coredumps do mesmo firmware."""
+        if path not in self._parsed:
+            self._parsed[path] = factory(path, *args, **kwargs)
+        return self._parsed[path]
+
+
+CACHE = ElfCache(CACHE_SIZE)
+
+
+def _install_elf_cache() -> None:
+    """Faz o carregador do esp_coredump reaproveitar o ELF do programa já analisado.
+
+    A análise do ELF (seções, símbolos e SHA256 da aplicação) é refeita a cada
+    'info_corefile'; só o ELF do programa, que está no cache, é memorizado. Sem o
+    ponto de extensão esperado, o worker segue sem memorizar.
+    """
+    try:
+        from esp_coredump.corefile import loader  # type: ignore
+    except ImportError:
+        return
+    original = getattr(loader, "ElfFile", None)
+    if original is None:
+        return
+
+    def elf_file(path: Any = None, *args: Any, **kwargs: Any) -> Any:
+        if isinstance(path, str) and CACHE.holds(path):
+            return CACHE.parsed(path, original, *args, **kwargs)
+        return original(path, *args, **kwargs)
+
+    loader.ElfFile = elf_file
+
+
+def _interpret(core_path: str, elf_path: str, core_format: str, chip: Optional[str]) -> str:
+    from esp_coredump import CoreDump  # type: ignore
+
+    kwargs: Dict[str, Any] = {"core": core_path, "core_format": core_format, "prog": elf_path}
+    if chip:
+        kwargs["rom_elf"] = os.path.expandvars(f"$IDF_PATH/components/esp_rom/rom_elfs/{chip}.elf")
+    out = io.StringIO()
+    with contextlib.redirect_stdout(out):
+        try:
+            CoreDump(**kwargs).info_corefile()
+        except SystemExit as exc:
+            if exc.code not in (None, 0):
+                raise RuntimeError(f"esp-coredump encerrou com {exc.code}: {out.getvalue()[-2000:]}") from None
+    return out.getvalue()
+
+
+def handle(request: Dict[str, Any]) -> Dict[str, Any]:
+    rid = request.get("id")
+    key = str(request["elf"])
+    elf_path = CACHE.get(key)
+    if elf_path is None:
+        if "elf_data" not in request:
+            return {"id": rid, "need_elf": True}
+        elf_path = CACHE.put(key, base64.b64decode(request["elf_data"]))
+    core_path = os.path.join(WORK_DIR, f"core_{rid}.bin")
+    with open(core_path, "wb") as f:
+        f.write(base64.b64decode(request["core"]))
+    started = time.monotonic()
+    try:
+        stdout = _interpret(core_path, elf_path, request.get("format", "raw"), request.get("chip"))
+    except Exception as exc:
+        return {"id": rid, "ok": False, "error": f"{type(exc).__name__}: {exc}"}
+    finally:
+        with contextlib.suppress(OSError):
+            os.unlink(core_path)
+    return {"id": rid, "ok": True, "stdout": stdout, "ms": int((time.monotonic() - started) * 1000)}
+
+
+def main() -> int:
+    # O protocolo usa o stdout original; qualquer print solto vai para o stderr
+    channel = sys.stdout
+    sys.stdout = sys.stderr
+    _install_elf_cache()
+    try:
+        import esp_coredump  # noqa: F401  # type: ignore  # carregado antes do primeiro coredump
+    except ImportError as exc:
+        channel.write(json.dumps({"ready": False, "error": str(exc)}) + "\n")
+        channel.flush()
+        return 1
+    channel.write(json.dumps({"ready": True, "pid": os.getpid(), "cache": CACHE_SIZE}) + "\n")
+    channel.flush()
+    for line in sys.stdin:
+        if not line.strip():
+            continue
+        try:
+            reply = handle(json.loads(line))
+        except (KeyError, ValueError) as exc:
+            reply = {"id": None, "ok": False, "error": f"requisição inválida: {exc}"}
+        channel.write(json.dumps(reply) + "\n")
+        channel.flush()
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -39,6 +39,18 @@ class IDataRepository(Protocol):
         """Associa um coredump a um cluster (ou desassocia se cluster_id=None)."""
         ...
 
+    def save_crash_fingerprint(self, mac: str, fingerprint: str, coredump_id: int) -> None:
+        """Associa a impressão digital da falha ao coredump completo recebido."""
+        ...
+
+    def bump_crash_fingerprint(self, mac: str, fingerprint: str) -> Optional[tuple[int, Optional[int], int]]:
+        """Conta uma ocorrência repetida; retorna (coredump_id, cluster_id, ocorrências) ou None."""
+        ...
+
+    def save_boot_metrics(self, mac: str, metrics: dict[str, Any], received_at: int) -> None:
+        """Grava os tempos do boot ao fim do upload publicados pelo dispositivo."""
+        ...
+
     # CRUD usados pela GUI
     def create_database(self) -> None:
         ...
@@ -99,6 +111,7 @@ class ICoreDumpParser(Protocol):
         elf_path: Path,
         out_dir: Path,
         chip_type: Optional[str],
+        core_format: str = "raw",
     ) -> Path:
         ...
 
@@ -7,6 +7,7 @@ Este módulo é responsável por:
 
 Arquitetura:
 - Receptor (MqttReceiver): Recebe coredumps via MQTT
+- Receptor HTTP (HttpReceiver): Recebe coredumps num único POST, se COREDUMP_HTTP_PORT definido
 - Interpretador (DockerCoredumpParser): Gera relatórios de coredumps
 - Repositório (SqliteDataRepository): Gerencia persistência de dados
 - Clusterizador (ClusterizerControl): Agrupa coredumps similares
@@ -20,12 +21,14 @@ try:
     from .components.data_repository import create_repository
     from .components.interpreter import create_parser
     from .components.receiver_mqtt import MqttReceiver
+    from .components.receiver_http import create_http_receiver
     from .components.clusterizer import create_clusterizer_control
 except Exception:
     # Fallback for execution as a script: python backend/wiring.py
     from backend.components.data_repository import create_repository  # type: ignore
     from backend.components.interpreter import create_parser  # type: ignore
     from backend.components.receiver_mqtt import MqttReceiver  # type: ignore
+    from backend.components.receiver_http import create_http_receiver  # type: ignore
     from backend.components.clusterizer import create_clusterizer_control  # type: ignore
 
 
@@ -46,11 +49,15 @@ def create_backend_components():
     
     # 3. Cria o receptor MQTT (depende de repo e parser)
     receiver = MqttReceiver(repo=repo, parser=parser)
+
+    # 4. Receptor HTTP opcional, compartilhando o montador (cadastro e assinaturas) do MQTT
+    http_receiver = create_http_receiver(repo, parser, receiver.assembler)
     
     return {
         "repository": repo,
         "parser": parser,
         "receiver": receiver,
+        "http_receiver": http_receiver,
         "clusterizer": clusterizer,
     }
 
@@ -73,6 +80,12 @@ def main() -> None:
     receiver = components["receiver"]
     logger.info("Iniciando receptor MQTT...")
     receiver.start()
+
+    # Inicia receptor HTTP, se configurado
+    http_receiver = components["http_receiver"]
+    if http_receiver is not None:
+        logger.info("Iniciando receptor HTTP...")
+        http_receiver.start()
     
     # Inicia clusterizador
     clusterizer = components["clusterizer"]
@@ -88,6 +101,8 @@ def main() -> None:
     except KeyboardInterrupt:
         logger.info("Recebido sinal de interrupção. Encerrando...")
         receiver.stop()
+        if http_receiver is not None:
+            http_receiver.stop()
         clusterizer.stop()
         logger.info("Backend encerrado com sucesso.")
         close_logging(logger)
@@ -4,29 +4,407 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "mqtt_client.h"
+#include "mqtt_tls.h"
 #include "sdkconfig.h"
 #include <stdio.h>
 #include <string.h>
 
 static const char *TAG_MQTT = "MQTT";
 static esp_mqtt_client_handle_t mqtt_client = NULL;
-static QueueHandle_t mqtt_queue = NULL; // Fila para mensagens recebidas
 
-bool publish_message(const char *topic, const char *message, int len, uint8_t qos) {
+// Pool de mensagens recebidas: a task MQTT copia cada mensagem uma vez para um buffer livre e
+// as filas transportam só ponteiros, sem bloquear a task MQTT
+static mqtt_message_t rx_pool[CONFIG_MQTT_APP_RX_POOL_SIZE];
+static QueueHandle_t rx_free = NULL;  // Buffers disponíveis
+static QueueHandle_t rx_ready = NULL; // Mensagens aguardando mqtt_app_receive()
+static mqtt_app_rx_stats_t rx_stats;
+static portMUX_TYPE rx_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Tópicos tratados diretamente por callback, sem passar pela fila
+#define MQTT_APP_MAX_TOPIC_HANDLERS 4
+
+typedef struct {
+    char topic[128];
+    mqtt_topic_handler_t handler;
+    void *arg;
+} topic_handler_entry_t;
+
+static topic_handler_entry_t topic_handlers[MQTT_APP_MAX_TOPIC_HANDLERS];
+static portMUX_TYPE topic_handlers_lock = portMUX_INITIALIZER_UNLOCKED;
+
+bool mqtt_app_set_topic_handler(const char *topic, mqtt_topic_handler_t handler, void *arg) {
+    if (!topic || strlen(topic) >= sizeof(topic_handlers[0].topic))
+        return false;
+    bool ok = false;
+    taskENTER_CRITICAL(&topic_handlers_lock);
+    topic_handler_entry_t *slot = NULL;
+    for (int i = 0; i < MQTT_APP_MAX_TOPIC_HANDLERS; ++i) {
+        if (topic_handlers[i].handler && strcmp(topic_handlers[i].topic, topic) == 0) {
+            slot = &topic_handlers[i];
+            break;
+        }
+        if (!slot && !topic_handlers[i].handler)
+            slot = &topic_handlers[i];
+    }
+    if (slot) {
+        strcpy(slot->topic, topic);
+        slot->handler = handler;
+        slot->arg = arg;
+        ok = true;
+    }
+    taskEXIT_CRITICAL(&topic_handlers_lock);
+    if (!ok)
+        ESP_LOGE(TAG_MQTT, "Tabela de callbacks cheia, tópico %s não registrado", topic);
+    return ok;
+}
+
+// Entrega a mensagem ao callback registrado para o tópico, se houver
+static bool dispatch_topic_handler(const esp_mqtt_event_t *event) {
+    mqtt_topic_handler_t handler = NULL;
+    void *arg = NULL;
+    taskENTER_CRITICAL(&topic_handlers_lock);
+    for (int i = 0; i < MQTT_APP_MAX_TOPIC_HANDLERS; ++i) {
+        const topic_handler_entry_t *e = &topic_handlers[i];
+        if (e->handler && (int)strlen(e->topic) == event->topic_len && memcmp(e->topic, event->topic, event->topic_len) == 0) {
+            handler = e->handler;
+            arg = e->arg;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&topic_handlers_lock);
+    if (!handler)
+        return false;
+    handler(event->data, event->data_len, arg);
+    return true;
+}
+
+// Cria as filas do pool na primeira chamada: o consumidor pode aguardar antes de o cliente iniciar
+static bool rx_pool_init(void) {
+    if (rx_ready)
+        return true;
+    QueueHandle_t free_q = xQueueCreate(CONFIG_MQTT_APP_RX_POOL_SIZE, sizeof(mqtt_message_t *));
+    QueueHandle_t ready_q = xQueueCreate(CONFIG_MQTT_APP_RX_POOL_SIZE, sizeof(mqtt_message_t *));
+    if (!free_q || !ready_q) {
+        if (free_q)
+            vQueueDelete(free_q);
+        if (ready_q)
+            vQueueDelete(ready_q);
+        return false;
+    }
+    for (int i = 0; i < CONFIG_MQTT_APP_RX_POOL_SIZE; ++i) {
+        mqtt_message_t *msg = &rx_pool[i];
+        xQueueSend(free_q, &msg, 0);
+    }
+    rx_free = free_q;
+    rx_ready = ready_q;
+    return true;
+}
+
+// Copia a mensagem para um buffer do pool e a entrega ao consumidor; nunca bloqueia
+static void rx_enqueue(const char *topic, int topic_len, const char *data, int data_len, bool truncated) {
+    mqtt_message_t *msg = NULL;
+    if (!rx_free || xQueueReceive(rx_free, &msg, 0) != pdTRUE) {
+        taskENTER_CRITICAL(&rx_stats_lock);
+        rx_stats.dropped++;
+        taskEXIT_CRITICAL(&rx_stats_lock);
+        ESP_LOGW(TAG_MQTT, "Pool de mensagens esgotado — mensagem de %.*s descartada", topic_len, topic);
+        return;
+    }
+    if (topic_len > (int)sizeof(msg->topic) - 1) {
+        topic_len = sizeof(msg->topic) - 1;
+        truncated = true;
+    }
+    if (data_len > (int)sizeof(msg->payload) - 1) {
+        data_len = sizeof(msg->payload) - 1;
+        truncated = true;
+    }
+    memcpy(msg->topic, topic, topic_len);
+    msg->topic[topic_len] = '\0';
+    memcpy(msg->payload, data, data_len);
+    msg->payload[data_len] = '\0';
+    msg->topic_len = (uint16_t)topic_len;
+    msg->payload_len = (uint16_t)data_len;
+
+    taskENTER_CRITICAL(&rx_stats_lock);
+    rx_stats.received++;
+    if (truncated)
+        rx_stats.truncated++;
+    rx_stats.in_use++;
+    if (rx_stats.in_use > rx_stats.peak_in_use)
+        rx_stats.peak_in_use = rx_stats.in_use;
+    taskEXIT_CRITICAL(&rx_stats_lock);
+    // A fila comporta o pool inteiro: com um buffer em mãos o envio não falha
+    xQueueSend(rx_ready, &msg, 0);
+}
+
+bool mqtt_app_receive(mqtt_message_t **out, TickType_t timeout) {
+    if (!out || !rx_pool_init())
+        return false;
+    return xQueueReceive(rx_ready, out, timeout) == pdTRUE;
+}
+
+void mqtt_app_release(mqtt_message_t *msg) {
+    if (!msg || !rx_free)
+        return;
+    taskENTER_CRITICAL(&rx_stats_lock);
+    if (rx_stats.in_use > 0)
+        rx_stats.in_use--;
+    taskEXIT_CRITICAL(&rx_stats_lock);
+    xQueueSend(rx_free, &msg, 0);
+}
+
+void mqtt_app_get_rx_stats(mqtt_app_rx_stats_t *out) {
+    if (!out)
+        return;
+    taskENTER_CRITICAL(&rx_stats_lock);
+    *out = rx_stats;
+    taskEXIT_CRITICAL(&rx_stats_lock);
+}
+
+// Janela de publicações QoS>0 sem confirmação do broker
+static mqtt_app_publish_stats_t publish_stats = {.window = CONFIG_MQTT_APP_PUBLISH_WINDOW};
+static portMUX_TYPE publish_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t publish_credit = NULL; // Sinalizado quando a janela libera espaço
+static int publish_window_setting = CONFIG_MQTT_APP_PUBLISH_WINDOW; // Janela configurada (sem limite do broker)
+
+#if CONFIG_MQTT_APP_PROTOCOL_V5
+// Alias das publicações com propriedades; o mapeamento só existe dentro de uma conexão
+#define MQTT_APP_TOPIC_ALIAS 1
+
+static SemaphoreHandle_t publish_lock = NULL;  // Propriedades valem para a próxima publicação do cliente
+static volatile uint32_t connection_count = 0; // Incrementado a cada MQTT_EVENT_CONNECTED
+static volatile uint32_t alias_connection = 0; // Conexão em que o alias foi associado a 'alias_topic' (0 = nenhuma)
+static char alias_topic[160];
+static bool alias_refused = false;             // Broker recusou o alias nesta conexão (Topic Alias Maximum 0)
+static uint32_t alias_refused_connection = 0;
+#endif
+
+// Reserva uma posição na janela, bloqueando até 'timeout' se estiver cheia
+static bool publish_window_acquire(TickType_t timeout) {
+    TickType_t start = xTaskGetTickCount();
+    bool stalled = false;
+    for (;;) {
+        bool reserved = false;
+        taskENTER_CRITICAL(&publish_stats_lock);
+        if (publish_stats.in_flight < publish_stats.window) {
+            publish_stats.in_flight++;
+            if (publish_stats.in_flight > publish_stats.peak_in_flight)
+                publish_stats.peak_in_flight = publish_stats.in_flight;
+            reserved = true;
+        }
+        taskEXIT_CRITICAL(&publish_stats_lock);
+
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (reserved || elapsed >= timeout) {
+            taskENTER_CRITICAL(&publish_stats_lock);
+            if (stalled) {
+                publish_stats.stalls++;
+                publish_stats.stall_ms += pdTICKS_TO_MS(elapsed);
+            }
+            if (!reserved)
+                publish_stats.timeouts++;
+            taskEXIT_CRITICAL(&publish_stats_lock);
+            return reserved;
+        }
+        stalled = true;
+        xSemaphoreTake(publish_credit, timeout - elapsed);
+    }
+}
+
+// Libera uma posição da janela (confirmação recebida, descarte ou falha ao publicar)
+static void publish_window_release(bool acked) {
+    taskENTER_CRITICAL(&publish_stats_lock);
+    if (publish_stats.in_flight > 0)
+        publish_stats.in_flight--;
+    if (acked)
+        publish_stats.acked++;
+    taskEXIT_CRITICAL(&publish_stats_lock);
+    if (publish_credit)
+        xSemaphoreGive(publish_credit);
+}
+
+size_t mqtt_app_max_payload(size_t topic_len) {
+    // Cabeçalho fixo (até 5 bytes) + tamanho do tópico (2) + tópico + packet id (2)
+    size_t overhead = 5 + 2 + topic_len + 2;
+    return (CONFIG_MQTT_APP_OUT_BUFFER_SIZE > overhead) ? CONFIG_MQTT_APP_OUT_BUFFER_SIZE - overhead : 0;
+}
+
+esp_err_t mqtt_app_set_publish_window(int window) {
+    if (window < 1 || window > CONFIG_MQTT_APP_PUBLISH_WINDOW_MAX)
+        return ESP_ERR_INVALID_ARG;
+    taskENTER_CRITICAL(&publish_stats_lock);
+    publish_stats.window = window;
+    publish_window_setting = window;
+    taskEXIT_CRITICAL(&publish_stats_lock);
+    if (publish_credit)
+        xSemaphoreGive(publish_credit); // Janela maior pode liberar quem está aguardando
+    return ESP_OK;
+}
+
+void mqtt_app_get_publish_stats(mqtt_app_publish_stats_t *out) {
+    if (!out)
+        return;
+    taskENTER_CRITICAL(&publish_stats_lock);
+    *out = publish_stats;
+    taskEXIT_CRITICAL(&publish_stats_lock);
+}
+
+#if CONFIG_MQTT_APP_PROTOCOL_V5
+// Retorno de client_publish() quando as propriedades não puderam ser instaladas: erro definitivo,
+// diferente do -1 do esp-mqtt (que pode ser o Receive Maximum do broker)
+#define MQTT_APP_PROPERTY_ERROR (-2)
+
+// Desiste do alias até a próxima conexão (chamado com publish_lock)
+static void refuse_alias(uint32_t conn) {
+    alias_refused = true;
+    alias_refused_connection = conn;
+    ESP_LOGW(TAG_MQTT, "Broker recusou alias de tópico; publicando com o nome completo");
+}
+
+// Publica no cliente MQTT 5: propriedades e envio sob o mesmo mutex, pois se aplicam à publicação seguinte
+static int client_publish(const char *topic, const char *message, int len, uint8_t qos,
+                          const mqtt_app_user_property_t *props, int prop_count,
+                          const uint8_t *correlation, uint16_t correlation_len) {
+    if (prop_count > MQTT_APP_MAX_USER_PROPERTIES)
+        return -1;
+    esp_mqtt5_user_property_item_t items[MQTT_APP_MAX_USER_PROPERTIES];
+    for (int i = 0; i < prop_count; ++i)
+        items[i] = (esp_mqtt5_user_property_item_t){.key = props[i].key, .value = props[i].value};
+
+    xSemaphoreTake(publish_lock, portMAX_DELAY);
+    uint32_t conn = connection_count;
+    // Publicações sem propriedades (publish_message) não usam alias: tópicos variados, uso esporádico.
+    // Só QoS 0 usa alias: publicações QoS>0 ficam no outbox do esp-mqtt e são reenviadas depois de
+    // uma reconexão, quando o broker já esqueceu o alias (erro de protocolo); levam sempre o nome,
+    // e o alias só acrescentaria 3 bytes a cada uma.
+    bool use_alias = (props || correlation) && qos == 0 && !(alias_refused && alias_refused_connection == conn);
+    bool aliased = use_alias && alias_connection == conn && strcmp(alias_topic, topic) == 0;
+    esp_mqtt5_publish_property_config_t property = {
+        .topic_alias = use_alias ? MQTT_APP_TOPIC_ALIAS : 0,
+        .correlation_data = (const char *)correlation,
+        .correlation_data_len = correlation ? correlation_len : 0,
+    };
+    if (prop_count > 0 && esp_mqtt5_client_set_user_property(&property.user_property, items, (uint8_t)prop_count) != ESP_OK) {
+        xSemaphoreGive(publish_lock);
+        return -1;
+    }
+    // O esp-mqtt confere o alias contra o Topic Alias Maximum do broker aqui, não na publicação:
+    // recusado, nenhuma propriedade fica instalada e a mensagem sairia sem elas
+    int msg_id = MQTT_APP_PROPERTY_ERROR;
+    esp_err_t err = esp_mqtt5_client_set_publish_property(mqtt_client, &property);
+    if (err != ESP_OK && use_alias) {
+        refuse_alias(conn);
+        use_alias = aliased = false;
+        property.topic_alias = 0;
+        err = esp_mqtt5_client_set_publish_property(mqtt_client, &property);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG_MQTT, "Falha ao definir as propriedades da publicação no tópico %s (%s)", topic, esp_err_to_name(err));
+        goto done;
+    }
+    // Com o alias já associado nesta conexão, o nome do tópico é omitido
+    msg_id = esp_mqtt_client_publish(mqtt_client, aliased ? "" : topic, message, len, (int)qos, 0);
+    if (msg_id == -1 && use_alias && !aliased) {
+        // Broker pode não aceitar alias: repete sem ele e, se passar, desiste do alias até reconectar
+        property.topic_alias = 0;
+        if (esp_mqtt5_client_set_publish_property(mqtt_client, &property) != ESP_OK) {
+            msg_id = MQTT_APP_PROPERTY_ERROR;
+            goto done;
+        }
+        msg_id = esp_mqtt_client_publish(mqtt_client, topic, message, len, (int)qos, 0);
+        if (msg_id != -1)
+            refuse_alias(conn);
+    } else if (msg_id != -1 && use_alias && !aliased) {
+        snprintf(alias_topic, sizeof(alias_topic), "%s", topic);
+        alias_connection = conn;
+    }
+done:
+    if (property.user_property)
+        esp_mqtt5_client_delete_user_property(property.user_property);
+    xSemaphoreGive(publish_lock);
+    return msg_id;
+}
+
+// esp-mqtt recusa QoS>0 além do Receive Maximum do broker: adota como janela as publicações
+// ainda em voo (sem contar a atual) e aguarda uma confirmação antes de repetir
+static bool publish_window_adopt_receive_maximum(void) {
+    int limit;
+    taskENTER_CRITICAL(&publish_stats_lock);
+    limit = publish_stats.in_flight - 1;
+    if (limit >= 1 && limit < publish_stats.window)
+        publish_stats.window = limit;
+    taskEXIT_CRITICAL(&publish_stats_lock);
+    if (limit < 1)
+        return false;
+    ESP_LOGW(TAG_MQTT, "Receive Maximum do broker atingido, janela reduzida para %d", limit);
+    publish_window_release(false);
+    return publish_window_acquire(pdMS_TO_TICKS(CONFIG_MQTT_APP_PUBLISH_TIMEOUT_MS));
+}
+#else
+static int client_publish(const char *topic, const char *message, int len, uint8_t qos,
+                          const mqtt_app_user_property_t *props, int prop_count,
+                          const uint8_t *correlation, uint16_t correlation_len) {
+    (void)props;
+    (void)prop_count;
+    (void)correlation;
+    (void)correlation_len;
+    return esp_mqtt_client_publish(mqtt_client, topic, message, len, (int)qos, 0);
+}
+#endif
+
+static bool publish_with_properties(const char *topic, const char *message, int len, uint8_t qos,
+                                    const mqtt_app_user_property_t *props, int prop_count,
+                                    const uint8_t *correlation, uint16_t correlation_len) {
     if (!mqtt_client) {
         ESP_LOGE(TAG_MQTT, "Cliente MQTT não está inicializado");
         return false;
     }
-    int msg_id = esp_mqtt_client_publish(mqtt_client, topic, message, len, (int)qos, 0);
-    if (msg_id == -1) {
+    // Apenas QoS>0 gera MQTT_EVENT_PUBLISHED e permanece no outbox até a confirmação
+    bool windowed = qos > 0;
+    if (windowed && !publish_window_acquire(pdMS_TO_TICKS(CONFIG_MQTT_APP_PUBLISH_TIMEOUT_MS))) {
+        ESP_LOGE(TAG_MQTT, "Timeout aguardando confirmações do broker (%d em voo)", publish_stats.in_flight);
+        return false;
+    }
+    int msg_id = client_publish(topic, message, len, qos, props, prop_count, correlation, correlation_len);
+#if CONFIG_MQTT_APP_PROTOCOL_V5
+    if (msg_id == -1 && windowed) {
+        if (!publish_window_adopt_receive_maximum()) {
+            ESP_LOGE(TAG_MQTT, "Falha ao publicar mensagem no tópico %s", topic);
+            return false; // Reserva já liberada
+        }
+        msg_id = client_publish(topic, message, len, qos, props, prop_count, correlation, correlation_len);
+    }
+#endif
+    if (msg_id < 0) {
         ESP_LOGE(TAG_MQTT, "Falha ao publicar mensagem no tópico %s", topic);
+        if (windowed)
+            publish_window_release(false);
         return false;
     }
-    ESP_LOGI(TAG_MQTT, "Mensagem publicada no tópico %s, msg_id=%d", topic, msg_id);
+    if (windowed) {
+        taskENTER_CRITICAL(&publish_stats_lock);
+        publish_stats.published++;
+        taskEXIT_CRITICAL(&publish_stats_lock);
+    }
+    // Uma linha por publicação, inclusive cada parte do upload: só no nível de depuração
+    ESP_LOGD(TAG_MQTT, "Mensagem publicada no tópico %s, msg_id=%d", topic, msg_id);
     return true;
 }
 
+bool publish_message(const char *topic, const char *message, int len, uint8_t qos) {
+    return publish_with_properties(topic, message, len, qos, NULL, 0, NULL, 0);
+}
+
+#if CONFIG_MQTT_APP_PROTOCOL_V5
+bool publish_message_v5(const char *topic, const char *message, int len, uint8_t qos,
+                        const mqtt_app_user_property_t *props, int prop_count,
+                        const void *correlation, uint16_t correlation_len) {
+    return publish_with_properties(topic, message, len, qos, props, prop_count, (const uint8_t *)correlation, correlation_len);
+}
+#endif
+
 bool subscribe_to_topic(const char *topic, uint8_t qos) {
     if (!mqtt_client) {
         ESP_LOGE(TAG_MQTT, "Cliente MQTT não está inicializado");
@@ -47,36 +425,49 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
     switch (event_id) {
     case MQTT_EVENT_CONNECTED:
         ESP_LOGI(TAG_MQTT, "MQTT conectado");
-        mqtt_message_t msg = {
-            .topic = {0},
-            .payload = "client_connected"
-        };
-        xQueueSend(mqtt_queue, &msg, pdMS_TO_TICKS(100));
+#if CONFIG_MQTT_APP_PROTOCOL_V5
+        // Nova conexão: aliases de tópico e Receive Maximum do broker são renegociados
+        connection_count++;
+        alias_connection = 0;
+        taskENTER_CRITICAL(&publish_stats_lock);
+        publish_stats.window = publish_window_setting;
+        taskEXIT_CRITICAL(&publish_stats_lock);
+        xSemaphoreGive(publish_credit);
+#endif
+        rx_enqueue("", 0, "client_connected", strlen("client_connected"), false);
         break;
 
     case MQTT_EVENT_DISCONNECTED:
         ESP_LOGW(TAG_MQTT, "MQTT desconectado");
+#if CONFIG_MQTT_APP_PROTOCOL_V5
+        alias_connection = 0; // O broker descarta os aliases com a conexão
+#endif
         break;
 
     case MQTT_EVENT_ERROR:
         ESP_LOGE(TAG_MQTT, "Erro MQTT");
         break;
 
-    case MQTT_EVENT_DATA:
-        ESP_LOGI(TAG_MQTT, "Mensagem recebida no tópico: %.*s", event->topic_len, event->topic);
+    case MQTT_EVENT_PUBLISHED:
+        ESP_LOGD(TAG_MQTT, "Publicação confirmada, msg_id=%d", event->msg_id);
+        publish_window_release(true);
+        break;
 
-        if (mqtt_queue) {
-            mqtt_message_t msg = {0};
+    case MQTT_EVENT_DELETED:
+        // Mensagem expirou no outbox sem confirmação: não ocupa mais a janela
+        ESP_LOGW(TAG_MQTT, "Publicação descartada do outbox, msg_id=%d", event->msg_id);
+        publish_window_release(false);
+        break;
 
-            snprintf(msg.topic, sizeof(msg.topic), "%.*s", event->topic_len, event->topic);
-            snprintf(msg.payload, sizeof(msg.payload), "%.*s", event->data_len, event->data);
+    case MQTT_EVENT_DATA:
+        ESP_LOGD(TAG_MQTT, "Mensagem recebida no tópico: %.*s", event->topic_len, event->topic);
 
-            if (xQueueSend(mqtt_queue, &msg, pdMS_TO_TICKS(100)) != pdTRUE) {
-                ESP_LOGW(TAG_MQTT, "Fila cheia — mensagem descartada");
-            } else {
-                ESP_LOGI(TAG_MQTT, "Mensagem enfileirada");
-            }
-        }
+        if (dispatch_topic_handler(event))
+            break;
+
+        // Mensagens maiores que o buffer do cliente chegam em fragmentos: só o primeiro é entregue
+        if (event->current_data_offset == 0)
+            rx_enqueue(event->topic, event->topic_len, event->data, event->data_len, event->data_len < event->total_data_len);
         break;
 
     default:
@@ -84,21 +475,47 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
     }
 }
 
-esp_err_t mqtt_app_start(QueueHandle_t queue) {
-    if (queue == NULL) {
-        ESP_LOGE(TAG_MQTT, "Fila MQTT inválida");
-        return ESP_ERR_INVALID_ARG;
+esp_err_t mqtt_app_start(void) {
+    if (!rx_pool_init()) {
+        ESP_LOGE(TAG_MQTT, "Falha ao criar filas do pool de mensagens");
+        return ESP_ERR_NO_MEM;
     }
 
-    mqtt_queue = queue;
+    if (!publish_credit)
+        publish_credit = xSemaphoreCreateBinary();
+    if (!publish_credit) {
+        ESP_LOGE(TAG_MQTT, "Falha ao criar semáforo da janela de publicação");
+        return ESP_ERR_NO_MEM;
+    }
+#if CONFIG_MQTT_APP_PROTOCOL_V5
+    if (!publish_lock)
+        publish_lock = xSemaphoreCreateMutex();
+    if (!publish_lock) {
+        ESP_LOGE(TAG_MQTT, "Falha ao criar mutex de publicação");
+        return ESP_ERR_NO_MEM;
+    }
+#endif
 
     esp_mqtt_client_config_t mqtt_cfg = {
         .broker.address.uri = CONFIG_MQTT_BROKER_URI,
         .credentials.username = CONFIG_MQTT_USERNAME,
         .credentials.authentication.password = CONFIG_MQTT_PASSWORD,
         .credentials.set_null_client_id = false,
+        .buffer.out_size = CONFIG_MQTT_APP_OUT_BUFFER_SIZE,
+#if CONFIG_MQTT_APP_PROTOCOL_V5
+        .session.protocol_ver = MQTT_PROTOCOL_V_5,
+#endif
     };
 
+    // mqtts: transporte próprio, que mede o handshake e retoma a sessão TLS entre boots
+    if (strncmp(CONFIG_MQTT_BROKER_URI, "mqtts://", 8) == 0) {
+        mqtt_cfg.network.transport = mqtt_tls_transport_create();
+        if (!mqtt_cfg.network.transport) {
+            ESP_LOGE(TAG_MQTT, "Falha ao criar transporte TLS");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
     mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
     if (!mqtt_client) {
         ESP_LOGE(TAG_MQTT, "esp_mqtt_client_init retornou NULL");
@@ -2,6 +2,7 @@
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "sdkconfig.h"
 #include <stdbool.h>
 
 #ifdef __cplusplus
@@ -10,23 +11,108 @@ extern "C" {
 
 /**
  * @brief Estrutura para representar uma mensagem MQTT.
+ *
+ * Mensagens recebidas ocupam um buffer do pool do mqtt_app e são entregues por
+ * ponteiro (mqtt_app_receive()); 'topic' e 'payload' terminam em NUL.
  */
 typedef struct {
     char topic[128];
     char payload[256];
+    uint16_t topic_len;     // Comprimento de 'topic', sem o NUL
+    uint16_t payload_len;   // Comprimento de 'payload', sem o NUL (o payload pode conter NULs)
 } mqtt_message_t;
 
+/**
+ * @brief Contadores das mensagens recebidas entregues pelo pool.
+ */
+typedef struct {
+    uint32_t received;      // Mensagens colocadas na fila de consumo
+    uint32_t dropped;       // Descartadas por falta de buffer livre no pool
+    uint32_t truncated;     // Tópico ou payload maior que o buffer (entregues truncadas)
+    int in_use;             // Buffers fora do pool (na fila ou com o consumidor)
+    int peak_in_use;        // Maior valor de in_use observado
+} mqtt_app_rx_stats_t;
+
+/**
+ * @brief Estatísticas da janela de publicações QoS>0 aguardando confirmação do broker.
+ */
+typedef struct {
+    int window;             // Máximo de publicações sem confirmação (K)
+    int in_flight;          // Publicações atualmente sem confirmação
+    int peak_in_flight;     // Maior valor de in_flight observado
+    uint32_t published;     // Publicações QoS>0 aceitas pelo cliente
+    uint32_t acked;         // Confirmações recebidas (MQTT_EVENT_PUBLISHED) ou descartes do outbox
+    uint32_t stalls;        // Vezes em que publish_message() bloqueou por janela cheia
+    uint32_t stall_ms;      // Tempo total bloqueado por janela cheia
+    uint32_t timeouts;      // Publicações abandonadas por falta de confirmação
+} mqtt_app_publish_stats_t;
+
+/**
+ * @brief Propriedade de usuário MQTT 5 (par chave/valor de texto).
+ */
+typedef struct {
+    const char *key;
+    const char *value;
+} mqtt_app_user_property_t;
+
+// Máximo de propriedades de usuário por publicação
+#define MQTT_APP_MAX_USER_PROPERTIES 4
+
+/**
+ * @brief Callback para mensagens recebidas em um tópico registrado.
+ *
+ * Executado na task do cliente MQTT: deve ser rápido e não bloquear.
+ *
+ * @param data Conteúdo da mensagem (não terminado em NUL).
+ * @param len Tamanho da mensagem.
+ * @param arg Argumento informado no registro.
+ */
+typedef void (*mqtt_topic_handler_t)(const char *data, int len, void *arg);
+
 /**
  * @brief Inicializa e inicia o cliente MQTT.
  *
- * @param queue Ponteiro para a fila onde mensagens recebidas serão colocadas.
- * 
+ * Mensagens recebidas em tópicos sem callback registrado, e o aviso de conexão
+ * (payload "client_connected", tópico vazio), ficam disponíveis em mqtt_app_receive().
+ *
  * @return ESP_OK se a inicialização for bem-sucedida, caso contrário retorna um código de erro esp_err_t.
  */
-esp_err_t mqtt_app_start(QueueHandle_t queue);
+esp_err_t mqtt_app_start(void);
+
+/**
+ * @brief Obtém a próxima mensagem recebida.
+ *
+ * A mensagem é copiada uma única vez, na task MQTT, para um buffer do pool de
+ * CONFIG_MQTT_APP_RX_POOL_SIZE posições; com o pool esgotado novas mensagens são
+ * descartadas e contadas. O buffer deve ser devolvido com mqtt_app_release().
+ *
+ * @param out Recebe o ponteiro para a mensagem.
+ * @param timeout Tempo máximo de espera.
+ *
+ * @return true se uma mensagem foi obtida, false em timeout.
+ */
+bool mqtt_app_receive(mqtt_message_t **out, TickType_t timeout);
+
+/**
+ * @brief Devolve ao pool um buffer obtido com mqtt_app_receive().
+ */
+void mqtt_app_release(mqtt_message_t *msg);
+
+/**
+ * @brief Obtém os contadores das mensagens recebidas.
+ *
+ * @param out Estrutura de saída.
+ */
+void mqtt_app_get_rx_stats(mqtt_app_rx_stats_t *out);
 
 /**
  * @brief Publica uma mensagem em um tópico MQTT.
+ *
+ * Publicações com QoS>0 respeitam uma janela de K mensagens sem confirmação:
+ * com a janela cheia a chamada bloqueia até um MQTT_EVENT_PUBLISHED liberar
+ * espaço (ou até CONFIG_MQTT_APP_PUBLISH_TIMEOUT_MS), limitando o outbox do
+ * esp-mqtt independentemente do volume publicado. Não chamar a partir de
+ * callbacks registrados com mqtt_app_set_topic_handler().
  * 
  * @param topic Tópico onde a mensagem será publicada.
  * @param message Conteúdo da mensagem a ser publicada.
@@ -37,6 +123,31 @@ esp_err_t mqtt_app_start(QueueHandle_t queue);
  */
 bool publish_message(const char *topic, const char *message, int len, uint8_t qos);
 
+#if CONFIG_MQTT_APP_PROTOCOL_V5
+/**
+ * @brief Publica uma mensagem com propriedades de usuário e dados de correlação MQTT 5.
+ *
+ * Publicações QoS 0 usam alias de tópico: associado na primeira após cada conexão (ou
+ * quando o tópico muda), as seguintes levam apenas o alias. As QoS>0 levam sempre o nome
+ * completo e nenhum alias, pois podem ser reenviadas do outbox numa conexão nova. Respeita
+ * a mesma janela de publish_message(), limitada também pelo Receive Maximum do broker.
+ *
+ * @param topic Tópico onde a mensagem será publicada.
+ * @param message Conteúdo da mensagem a ser publicada.
+ * @param len Tamanho da mensagem.
+ * @param qos Nível de QoS para a publicação.
+ * @param props Propriedades de usuário anexadas à publicação.
+ * @param prop_count Quantidade de propriedades, até MQTT_APP_MAX_USER_PROPERTIES.
+ * @param correlation Dados de correlação (binários), ou NULL.
+ * @param correlation_len Tamanho dos dados de correlação.
+ *
+ * @return true se a publicação foi bem-sucedida, false caso contrário.
+ */
+bool publish_message_v5(const char *topic, const char *message, int len, uint8_t qos,
+                        const mqtt_app_user_property_t *props, int prop_count,
+                        const void *correlation, uint16_t correlation_len);
+#endif
+
 /** 
  * @brief Inscreve-se em um tópico MQTT. 
  * 
@@ -47,6 +158,45 @@ bool publish_message(const char *topic, const char *message, int len, uint8_t qo
  */
 bool subscribe_to_topic(const char *topic, uint8_t qos);
 
+/**
+ * @brief Registra um callback para um tópico exato.
+ *
+ * Mensagens desse tópico são entregues ao callback em vez de irem para a fila
+ * de mensagens. A inscrição no broker continua a cargo de subscribe_to_topic().
+ *
+ * @param topic Tópico exato (sem curingas), até 127 caracteres.
+ * @param handler Callback a ser chamado; NULL remove o registro do tópico.
+ * @param arg Argumento repassado ao callback.
+ *
+ * @return true se o registro foi realizado, false se a tabela estiver cheia.
+ */
+bool mqtt_app_set_topic_handler(const char *topic, mqtt_topic_handler_t handler, void *arg);
+
+/**
+ * @brief Maior payload que cabe inteiro no buffer de saída do cliente MQTT.
+ *
+ * @param topic_len Comprimento do tópico da publicação.
+ *
+ * @return Tamanho máximo do payload em bytes.
+ */
+size_t mqtt_app_max_payload(size_t topic_len);
+
+/**
+ * @brief Altera o tamanho da janela de publicações sem confirmação (K).
+ *
+ * @param window Novo tamanho, entre 1 e CONFIG_MQTT_APP_PUBLISH_WINDOW_MAX.
+ *
+ * @return ESP_OK em caso de sucesso, ESP_ERR_INVALID_ARG se fora do intervalo.
+ */
+esp_err_t mqtt_app_set_publish_window(int window);
+
+/**
+ * @brief Obtém as estatísticas da janela de publicações.
+ *
+ * @param out Estrutura de saída.
+ */
+void mqtt_app_get_publish_stats(mqtt_app_publish_stats_t *out);
+
 #ifdef __cplusplus
 }
 #endif
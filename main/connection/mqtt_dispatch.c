@@ -0,0 +1,112 @@
+#include "mqtt_dispatch.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include <string.h>
+
+static const char *TAG_DISPATCH = "MQTT_DISPATCH";
+
+// Tabela hash com sondagem linear, ocupação máxima de 50%
+#define DISPATCH_SLOTS (2 * CONFIG_MQTT_DISPATCH_MAX_COMMANDS)
+
+typedef struct {
+    const char *topic;
+    const char *command; // NULL: qualquer payload do tópico
+    uint32_t hash;
+    mqtt_command_handler_t handler;
+    void *arg;
+} dispatch_entry_t;
+
+static dispatch_entry_t entries[CONFIG_MQTT_DISPATCH_MAX_COMMANDS];
+static int entry_count = 0;
+static uint8_t slots[DISPATCH_SLOTS]; // Índice + 1 em 'entries'; 0 = posição livre
+static mqtt_dispatch_stats_t stats;
+
+// FNV-1a de tópico e comando; o byte separador distingue o handler do tópico (comando NULL)
+static uint32_t key_hash(const char *topic, size_t topic_len, const char *command, size_t command_len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < topic_len; ++i)
+        h = (h ^ (uint8_t)topic[i]) * 16777619u;
+    h = (h ^ (command ? 1u : 0u)) * 16777619u;
+    for (size_t i = 0; command && i < command_len; ++i)
+        h = (h ^ (uint8_t)command[i]) * 16777619u;
+    return h;
+}
+
+static bool key_equal(const char *key, const char *s, size_t len) {
+    return strncmp(key, s, len) == 0 && key[len] == '\0';
+}
+
+// Retorna a posição da chave em 'slots', ou a primeira posição livre da sequência de sondagem
+static size_t find_slot(const char *topic, size_t topic_len, const char *command, size_t command_len, uint32_t h) {
+    size_t pos = h % DISPATCH_SLOTS;
+    for (int probe = 0; probe < DISPATCH_SLOTS; ++probe, pos = (pos + 1) % DISPATCH_SLOTS) {
+        if (slots[pos] == 0)
+            return pos;
+        const dispatch_entry_t *e = &entries[slots[pos] - 1];
+        if (e->hash == h && key_equal(e->topic, topic, topic_len) && (e->command == NULL) == (command == NULL) &&
+            (!command || key_equal(e->command, command, command_len)))
+            return pos;
+    }
+    return DISPATCH_SLOTS; // Inalcançável com ocupação limitada a 50%
+}
+
+static const dispatch_entry_t *lookup(const char *topic, size_t topic_len, const char *command, size_t command_len) {
+    size_t pos = find_slot(topic, topic_len, command, command_len, key_hash(topic, topic_len, command, command_len));
+    if (pos >= DISPATCH_SLOTS || slots[pos] == 0)
+        return NULL;
+    return &entries[slots[pos] - 1];
+}
+
+esp_err_t mqtt_dispatch_register(const char *topic, const char *command, mqtt_command_handler_t handler, void *arg) {
+    if (!topic || !handler)
+        return ESP_ERR_INVALID_ARG;
+    size_t topic_len = strlen(topic);
+    size_t command_len = command ? strlen(command) : 0;
+    uint32_t h = key_hash(topic, topic_len, command, command_len);
+    size_t pos = find_slot(topic, topic_len, command, command_len, h);
+    if (pos < DISPATCH_SLOTS && slots[pos] != 0) {
+        dispatch_entry_t *e = &entries[slots[pos] - 1];
+        e->handler = handler;
+        e->arg = arg;
+        return ESP_OK;
+    }
+    if (pos >= DISPATCH_SLOTS || entry_count >= CONFIG_MQTT_DISPATCH_MAX_COMMANDS) {
+        ESP_LOGE(TAG_DISPATCH, "Tabela de comandos cheia, %s:%s não registrado", topic, command ? command : "*");
+        return ESP_ERR_NO_MEM;
+    }
+    entries[entry_count] = (dispatch_entry_t){
+        .topic = topic,
+        .command = command,
+        .hash = h,
+        .handler = handler,
+        .arg = arg,
+    };
+    slots[pos] = (uint8_t)(++entry_count);
+    return ESP_OK;
+}
+
+bool mqtt_dispatch_process(TickType_t timeout) {
+    mqtt_message_t *msg;
+    if (!mqtt_app_receive(&msg, timeout))
+        return false;
+    const dispatch_entry_t *e = lookup(msg->topic, msg->topic_len, msg->payload, msg->payload_len);
+    if (!e)
+        e = lookup(msg->topic, msg->topic_len, NULL, 0);
+    if (e) {
+        stats.dispatched++;
+        e->handler(msg, e->arg);
+    } else {
+        stats.unhandled++;
+        ESP_LOGW(TAG_DISPATCH, "Sem handler para o tópico %s: %s", msg->topic, msg->payload);
+    }
+    mqtt_app_release(msg);
+    return true;
+}
+
+void mqtt_dispatch_get_stats(mqtt_dispatch_stats_t *out) {
+    if (!out)
+        return;
+    out->dispatched = stats.dispatched;
+    out->unhandled = stats.unhandled;
+    mqtt_app_get_rx_stats(&out->rx);
+}
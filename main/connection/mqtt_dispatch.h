@@ -0,0 +1,69 @@
+#pragma once
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "mqtt_app.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Handler de um comando recebido via MQTT.
+ *
+ * Executado na task que chama mqtt_dispatch_process(). 'msg' só é válida
+ * durante a chamada: o buffer volta ao pool do mqtt_app em seguida.
+ *
+ * @param msg Mensagem recebida (tópico e payload terminados em NUL).
+ * @param arg Argumento informado no registro.
+ */
+typedef void (*mqtt_command_handler_t)(const mqtt_message_t *msg, void *arg);
+
+/**
+ * @brief Contadores do despacho de comandos.
+ */
+typedef struct {
+    uint32_t dispatched;        // Mensagens entregues a um handler
+    uint32_t unhandled;         // Mensagens sem handler para o tópico+comando nem para o tópico
+    mqtt_app_rx_stats_t rx;     // Pool de mensagens do mqtt_app (descartes, truncamentos, ocupação)
+} mqtt_dispatch_stats_t;
+
+/**
+ * @brief Registra o handler de um comando (payload exato) recebido em um tópico.
+ *
+ * A busca é feita por hash de tópico+comando, em tempo constante. Com 'command'
+ * NULL o handler atende qualquer payload do tópico que não tenha handler próprio.
+ * Registrar de novo o mesmo par substitui o handler. As strings não são copiadas
+ * e devem permanecer válidas; registrar antes de iniciar mqtt_dispatch_process()
+ * ou na mesma task.
+ *
+ * @param topic Tópico exato (o aviso de conexão do mqtt_app usa o tópico "").
+ * @param command Payload exato do comando, ou NULL para qualquer payload.
+ * @param handler Callback a ser chamado.
+ * @param arg Argumento repassado ao callback.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG ou ESP_ERR_NO_MEM (tabela com
+ *         CONFIG_MQTT_DISPATCH_MAX_COMMANDS entradas cheia).
+ */
+esp_err_t mqtt_dispatch_register(const char *topic, const char *command, mqtt_command_handler_t handler, void *arg);
+
+/**
+ * @brief Aguarda uma mensagem recebida e a entrega ao handler registrado.
+ *
+ * @param timeout Tempo máximo de espera por uma mensagem.
+ *
+ * @return true se uma mensagem foi processada (com ou sem handler), false em timeout.
+ */
+bool mqtt_dispatch_process(TickType_t timeout);
+
+/**
+ * @brief Obtém os contadores do despacho e do pool de mensagens.
+ *
+ * @param out Estrutura de saída.
+ */
+void mqtt_dispatch_get_stats(mqtt_dispatch_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
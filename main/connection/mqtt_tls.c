@@ -0,0 +1,218 @@
+#include "mqtt_tls.h"
+#include "esp_attr.h"
+#include "esp_crt_bundle.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_tls.h"
+#include "lwip/sockets.h"
+#include "sdkconfig.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if CONFIG_MQTT_APP_TLS_SESSION_RESUMPTION
+#include "esp_app_desc.h"
+#include "esp_rom_crc.h"
+#include "mbedtls/ssl.h"
+#include <stddef.h>
+#endif
+
+static const char *TAG_TLS = "MQTT_TLS";
+
+static mqtt_tls_stats_t s_stats;
+
+#if CONFIG_MQTT_APP_TLS_SESSION_RESUMPTION
+#define TLS_SESSION_CACHE_MAGIC 0x544c5331 // "TLS1"
+#define TLS_SESSION_APP_ID_SIZE 8          // Prefixo do SHA256 do ELF que identifica o firmware
+
+// Sessão serializada com mbedtls_ssl_session_save(). RTC_NOINIT sobrevive a panic e
+// watchdog; o CRC descarta o conteúdo aleatório após power-on.
+typedef struct {
+    uint32_t magic;
+    uint8_t app_id[TLS_SESSION_APP_ID_SIZE];
+    uint16_t len;
+    uint16_t reserved;
+    uint32_t crc;
+    uint8_t data[CONFIG_MQTT_APP_TLS_SESSION_CACHE_SIZE];
+} tls_session_cache_t;
+
+static RTC_NOINIT_ATTR tls_session_cache_t s_session_cache;
+
+static uint32_t _cache_crc(const tls_session_cache_t *c) {
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)c, offsetof(tls_session_cache_t, crc));
+    return esp_rom_crc32_le(crc, c->data, c->len);
+}
+
+static void _cache_invalidate(void) {
+    s_session_cache.magic = 0;
+}
+
+// Sessão guardada por este mesmo firmware, ou NULL
+static esp_tls_client_session_t *_session_restore(void) {
+    const esp_app_desc_t *app = esp_app_get_description();
+    if (s_session_cache.magic != TLS_SESSION_CACHE_MAGIC || s_session_cache.len > sizeof(s_session_cache.data) ||
+        s_session_cache.crc != _cache_crc(&s_session_cache))
+        return NULL;
+    if (memcmp(s_session_cache.app_id, app->app_elf_sha256, TLS_SESSION_APP_ID_SIZE) != 0) {
+        ESP_LOGI(TAG_TLS, "Firmware mudou, sessão TLS do cache descartada");
+        _cache_invalidate();
+        return NULL;
+    }
+    esp_tls_client_session_t *s = calloc(1, sizeof(*s));
+    if (!s)
+        return NULL;
+    mbedtls_ssl_session_init(&s->saved_session);
+    if (mbedtls_ssl_session_load(&s->saved_session, s_session_cache.data, s_session_cache.len) != 0) {
+        esp_tls_free_client_session(s);
+        _cache_invalidate();
+        return NULL;
+    }
+    return s;
+}
+
+static void _session_store(esp_tls_t *tls) {
+    esp_tls_client_session_t *s = esp_tls_get_client_session(tls);
+    if (!s)
+        return;
+    size_t len = 0;
+    int ret = mbedtls_ssl_session_save(&s->saved_session, s_session_cache.data, sizeof(s_session_cache.data), &len);
+    esp_tls_free_client_session(s);
+    if (ret != 0) {
+        // Com MBEDTLS_SSL_KEEP_PEER_CERTIFICATE a sessão leva o certificado do broker
+        ESP_LOGW(TAG_TLS, "Sessão TLS de %u bytes não cabe no cache (%u bytes)", (unsigned)len, (unsigned)sizeof(s_session_cache.data));
+        _cache_invalidate();
+        return;
+    }
+    memcpy(s_session_cache.app_id, esp_app_get_description()->app_elf_sha256, TLS_SESSION_APP_ID_SIZE);
+    s_session_cache.len = (uint16_t)len;
+    s_session_cache.reserved = 0;
+    s_session_cache.magic = TLS_SESSION_CACHE_MAGIC;
+    s_session_cache.crc = _cache_crc(&s_session_cache);
+}
+#endif
+
+static esp_tls_t *_tls(esp_transport_handle_t t) {
+    return (esp_tls_t *)esp_transport_get_context_data(t);
+}
+
+static int _poll(esp_transport_handle_t t, int timeout_ms, bool write) {
+    int fd;
+    esp_tls_t *tls = _tls(t);
+    if (!tls || esp_tls_get_conn_sockfd(tls, &fd) != ESP_OK)
+        return -1;
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(fd, &set);
+    struct timeval tv = {.tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000};
+    return select(fd + 1, write ? NULL : &set, write ? &set : NULL, NULL, timeout_ms < 0 ? NULL : &tv);
+}
+
+static int _tls_poll_read(esp_transport_handle_t t, int timeout_ms) {
+    // Registros já decifrados pelo mbedtls não aparecem no socket
+    esp_tls_t *tls = _tls(t);
+    if (tls && esp_tls_get_bytes_avail(tls) > 0)
+        return 1;
+    return _poll(t, timeout_ms, false);
+}
+
+static int _tls_poll_write(esp_transport_handle_t t, int timeout_ms) {
+    return _poll(t, timeout_ms, true);
+}
+
+static int _tls_close(esp_transport_handle_t t) {
+    esp_tls_t *tls = _tls(t);
+    esp_transport_set_context_data(t, NULL);
+    return tls ? esp_tls_conn_destroy(tls) : 0;
+}
+
+static int _tls_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms) {
+    _tls_close(t);
+    esp_tls_t *tls = esp_tls_init();
+    if (!tls)
+        return -1;
+    esp_tls_cfg_t cfg = {
+        .crt_bundle_attach = esp_crt_bundle_attach,
+        .timeout_ms = timeout_ms,
+    };
+#if CONFIG_MQTT_APP_TLS_SESSION_RESUMPTION
+    esp_tls_client_session_t *session = _session_restore();
+    cfg.client_session = session;
+#endif
+
+    int64_t start = esp_timer_get_time();
+    int ret = esp_tls_conn_new_sync(host, strlen(host), port, &cfg, tls);
+    int64_t elapsed = esp_timer_get_time() - start;
+#if CONFIG_MQTT_APP_TLS_SESSION_RESUMPTION
+    // mbedtls_ssl_set_session() copia a sessão: a nossa pode ser liberada já
+    bool offered = session != NULL;
+    if (session)
+        esp_tls_free_client_session(session);
+#else
+    bool offered = false;
+#endif
+    if (ret != 1) {
+        ESP_LOGE(TAG_TLS, "Handshake TLS com %s:%d falhou após %lld ms", host, port, (long long)(elapsed / 1000));
+        s_stats.failures++;
+        esp_tls_conn_destroy(tls);
+#if CONFIG_MQTT_APP_TLS_SESSION_RESUMPTION
+        // A próxima tentativa sai com handshake completo
+        _cache_invalidate();
+#endif
+        return -1;
+    }
+    s_stats.handshake_us = elapsed;
+    s_stats.session_offered = offered;
+    s_stats.handshakes++;
+    ESP_LOGI(TAG_TLS, "Handshake TLS em %lld ms (%s)", (long long)(elapsed / 1000), offered ? "sessão do cache oferecida" : "completo");
+#if CONFIG_MQTT_APP_TLS_SESSION_RESUMPTION
+    _session_store(tls);
+#endif
+    esp_transport_set_context_data(t, tls);
+    return 0;
+}
+
+static int _tls_read(esp_transport_handle_t t, char *buffer, int len, int timeout_ms) {
+    esp_tls_t *tls = _tls(t);
+    if (!tls)
+        return ERR_TCP_TRANSPORT_CONNECTION_FAILED;
+    if (esp_tls_get_bytes_avail(tls) <= 0) {
+        int ready = _poll(t, timeout_ms, false);
+        if (ready <= 0)
+            return ready == 0 ? ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT : ERR_TCP_TRANSPORT_CONNECTION_FAILED;
+    }
+    int ret = esp_tls_conn_read(tls, buffer, len);
+    if (ret == ESP_TLS_ERR_SSL_WANT_READ || ret == ESP_TLS_ERR_SSL_WANT_WRITE)
+        return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+    if (ret == 0)
+        return ERR_TCP_TRANSPORT_CONNECTION_CLOSED_BY_FIN;
+    return ret < 0 ? ERR_TCP_TRANSPORT_CONNECTION_FAILED : ret;
+}
+
+static int _tls_write(esp_transport_handle_t t, const char *buffer, int len, int timeout_ms) {
+    esp_tls_t *tls = _tls(t);
+    if (!tls)
+        return ERR_TCP_TRANSPORT_CONNECTION_FAILED;
+    int ready = _poll(t, timeout_ms, true);
+    if (ready <= 0)
+        return ready == 0 ? ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT : ERR_TCP_TRANSPORT_CONNECTION_FAILED;
+    int ret = esp_tls_conn_write(tls, buffer, len);
+    if (ret == ESP_TLS_ERR_SSL_WANT_READ || ret == ESP_TLS_ERR_SSL_WANT_WRITE)
+        return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+    return ret < 0 ? ERR_TCP_TRANSPORT_CONNECTION_FAILED : ret;
+}
+
+static int _tls_destroy(esp_transport_handle_t t) {
+    return _tls_close(t);
+}
+
+esp_transport_handle_t mqtt_tls_transport_create(void) {
+    esp_transport_handle_t t = esp_transport_init();
+    if (!t)
+        return NULL;
+    esp_transport_set_func(t, _tls_connect, _tls_read, _tls_write, _tls_close, _tls_poll_read, _tls_poll_write, _tls_destroy);
+    esp_transport_set_default_port(t, 8883);
+    return t;
+}
+
+void mqtt_tls_get_stats(mqtt_tls_stats_t *out) {
+    *out = s_stats;
+}
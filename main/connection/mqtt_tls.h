@@ -0,0 +1,48 @@
+#pragma once
+#include "esp_err.h"
+#include "esp_transport.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Transporte TLS do cliente MQTT sobre esp-tls, com retomada de sessão.
+ *
+ * Substitui o transporte "mqtts" interno do esp-mqtt (esp_mqtt_client_config_t
+ * network.transport) para ter acesso à sessão negociada. Com
+ * CONFIG_MQTT_APP_TLS_SESSION_RESUMPTION, a sessão de cada handshake (ticket ou
+ * ID de sessão) é serializada em memória RTC, que sobrevive a panic e watchdog, e
+ * oferecida ao broker na próxima conexão, inclusive no boot seguinte a uma falha.
+ * O cache é descartado quando o firmware muda (SHA256 do ELF) ou um handshake falha.
+ */
+
+/**
+ * @brief Tempos do último handshake TLS.
+ */
+typedef struct {
+    int64_t handshake_us;  // Duração do último handshake (conexão TCP incluída)
+    bool session_offered;  // O último handshake ofereceu uma sessão do cache
+    uint32_t handshakes;   // Handshakes concluídos desde o boot
+    uint32_t failures;     // Handshakes que falharam desde o boot
+} mqtt_tls_stats_t;
+
+/**
+ * @brief Cria o transporte; o esp-mqtt o destrói junto com o cliente.
+ *
+ * O servidor é verificado com o bundle de certificados do ESP-IDF.
+ *
+ * @return Handle do transporte ou NULL sem memória.
+ */
+esp_transport_handle_t mqtt_tls_transport_create(void);
+
+/**
+ * @brief Copia os tempos do último handshake.
+ */
+void mqtt_tls_get_stats(mqtt_tls_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
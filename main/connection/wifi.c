@@ -1,26 +1,106 @@
 #include "wifi.h"
+#include "esp_attr.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_mac.h"
 #include "esp_netif.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
 #include "esp_wifi.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "sdkconfig.h"
+#include <inttypes.h>
+#include <stddef.h>
 #include <string.h>
 
 static const char *TAG_WIFI = "WIFI";
 
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT BIT1
+#define WIFI_CONNECT_TIMEOUT_MS 15000
 
 static EventGroupHandle_t s_wifi_event_group;
 static int s_retry_num = 0;
 static const int MAX_RETRY = 5;
+static wifi_config_t s_wifi_config;
+static wifi_connect_info_t s_connect_info;
+
+#if CONFIG_WIFI_FAST_CONNECT
+#define WIFI_AP_CACHE_MAGIC 0x57464331 // "WFC1"
+
+// AP da última conexão. RTC_NOINIT sobrevive a panic e watchdog, mas não a power-on
+// nem a brownout; o CRC (que inclui o SSID configurado) descarta lixo e cache de outra rede.
+typedef struct {
+    uint32_t magic;
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t reserved;
+    uint32_t crc;
+} wifi_ap_cache_t;
+
+static RTC_NOINIT_ATTR wifi_ap_cache_t s_ap_cache;
+static bool s_fast_pending; // Tentativa direta no AP do cache ainda sem resultado
+
+static uint32_t _ap_cache_crc(const wifi_ap_cache_t *c) {
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)CONFIG_WIFI_SSID, strlen(CONFIG_WIFI_SSID));
+    return esp_rom_crc32_le(crc, (const uint8_t *)c, offsetof(wifi_ap_cache_t, crc));
+}
+
+static bool _ap_cache_valid(void) {
+    return s_ap_cache.magic == WIFI_AP_CACHE_MAGIC && s_ap_cache.channel != 0 && s_ap_cache.crc == _ap_cache_crc(&s_ap_cache);
+}
+
+static void _ap_cache_store(void) {
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK)
+        return;
+    wifi_ap_cache_t c = {.magic = WIFI_AP_CACHE_MAGIC, .channel = ap.primary};
+    memcpy(c.bssid, ap.bssid, sizeof(c.bssid));
+    c.crc = _ap_cache_crc(&c);
+    s_ap_cache = c;
+}
+
+// Só vale a pena pular a varredura quando o boot veio de uma falha: é quando há coredump
+// esperando a rede e o AP provavelmente é o mesmo de segundos atrás
+static bool _is_crash_reset(void) {
+    switch (esp_reset_reason()) {
+    case ESP_RST_PANIC:
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// O AP do cache não respondeu: volta à configuração só com SSID (varredura completa)
+static void _fast_connect_fallback(void) {
+    s_fast_pending = false;
+    s_ap_cache.magic = 0;
+    s_connect_info.path = WIFI_CONNECT_FAST_FALLBACK;
+    s_wifi_config.sta.bssid_set = false;
+    memset(s_wifi_config.sta.bssid, 0, sizeof(s_wifi_config.sta.bssid));
+    s_wifi_config.sta.channel = 0;
+    esp_wifi_set_config(WIFI_IF_STA, &s_wifi_config);
+    s_retry_num = 0;
+    esp_wifi_connect();
+}
+#endif
 
 static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
         esp_wifi_connect();
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+#if CONFIG_WIFI_FAST_CONNECT
+        if (s_fast_pending) {
+            ESP_LOGW(TAG_WIFI, "AP do cache não respondeu, fazendo varredura completa");
+            _fast_connect_fallback();
+            return;
+        }
+#endif
         if (s_retry_num < MAX_RETRY) {
             esp_wifi_connect();
             s_retry_num++;
@@ -33,6 +113,12 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
         ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
         ESP_LOGI(TAG_WIFI, "Endereço IP obtido: " IPSTR, IP2STR(&event->ip_info.ip));
         s_retry_num = 0;
+        if (!s_connect_info.connected_us)
+            s_connect_info.connected_us = esp_timer_get_time();
+#if CONFIG_WIFI_FAST_CONNECT
+        s_fast_pending = false;
+        _ap_cache_store();
+#endif
         xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
     }
 }
@@ -51,22 +137,51 @@ esp_err_t wifi_init_start(void) {
     ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL, &instance_any_id));
     ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &event_handler, NULL, &instance_got_ip));
 
-    wifi_config_t wifi_config = {0};
-    strncpy((char *)wifi_config.sta.ssid, CONFIG_WIFI_SSID, sizeof(wifi_config.sta.ssid));
-    strncpy((char *)wifi_config.sta.password, CONFIG_WIFI_PASSWORD, sizeof(wifi_config.sta.password));
-    wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
-    wifi_config.sta.sae_pwe_h2e = WPA3_SAE_PWE_UNSPECIFIED;
+    wifi_config_t *wifi_config = &s_wifi_config;
+    memset(wifi_config, 0, sizeof(*wifi_config));
+    strncpy((char *)wifi_config->sta.ssid, CONFIG_WIFI_SSID, sizeof(wifi_config->sta.ssid));
+    strncpy((char *)wifi_config->sta.password, CONFIG_WIFI_PASSWORD, sizeof(wifi_config->sta.password));
+    wifi_config->sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+    wifi_config->sta.sae_pwe_h2e = WPA3_SAE_PWE_UNSPECIFIED;
+
+    s_connect_info = (wifi_connect_info_t){.path = WIFI_CONNECT_FULL};
+#if CONFIG_WIFI_FAST_CONNECT
+    // BSSID e canal fixos: o driver associa direto, sem varrer os demais canais.
+    // O IP anterior volta pelo DHCP (LWIP_DHCP_RESTORE_LAST_IP), que pula o DISCOVER.
+    if (_is_crash_reset() && _ap_cache_valid()) {
+        wifi_config->sta.bssid_set = true;
+        memcpy(wifi_config->sta.bssid, s_ap_cache.bssid, sizeof(wifi_config->sta.bssid));
+        wifi_config->sta.channel = s_ap_cache.channel;
+        s_fast_pending = true;
+        s_connect_info.path = WIFI_CONNECT_FAST;
+        ESP_LOGI(TAG_WIFI, "Reconexão rápida: BSSID " MACSTR ", canal %u", MAC2STR(s_ap_cache.bssid), s_ap_cache.channel);
+    }
+#endif
 
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, wifi_config));
+    s_connect_info.start_us = esp_timer_get_time();
     ESP_ERROR_CHECK(esp_wifi_start());
 
     ESP_LOGI(TAG_WIFI, "wifi_init_sta finalizado. SSID:%s", CONFIG_WIFI_SSID);
 
-    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT, pdFALSE, pdFALSE, pdMS_TO_TICKS(15000));
+    TickType_t timeout = pdMS_TO_TICKS(WIFI_CONNECT_TIMEOUT_MS);
+    EventBits_t bits;
+#if CONFIG_WIFI_FAST_CONNECT
+    if (s_fast_pending) {
+        // Sem resposta do AP do cache no prazo: derrubar a tentativa leva o handler à varredura
+        bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT, pdFALSE, pdFALSE, pdMS_TO_TICKS(CONFIG_WIFI_FAST_CONNECT_TIMEOUT_MS));
+        if (!(bits & WIFI_CONNECTED_BIT) && s_fast_pending) {
+            ESP_LOGW(TAG_WIFI, "Reconexão rápida sem resposta em %d ms", CONFIG_WIFI_FAST_CONNECT_TIMEOUT_MS);
+            esp_wifi_disconnect();
+        }
+    }
+#endif
+    bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT, pdFALSE, pdFALSE, timeout);
 
     if (bits & WIFI_CONNECTED_BIT) {
-        ESP_LOGI(TAG_WIFI, "Conectado ao AP");
+        ESP_LOGI(TAG_WIFI, "Conectado ao AP em %" PRId64 " ms (%s)", (s_connect_info.connected_us - s_connect_info.start_us) / 1000,
+                 s_connect_info.path == WIFI_CONNECT_FAST ? "reconexão rápida" : "varredura completa");
         return ESP_OK;
     } else if (bits & WIFI_FAIL_BIT) {
         ESP_LOGE(TAG_WIFI, "Falha ao conectar ao AP");
@@ -76,3 +191,7 @@ esp_err_t wifi_init_start(void) {
         return ESP_ERR_TIMEOUT;
     }
 }
+
+void wifi_get_connect_info(wifi_connect_info_t *out) {
+    *out = s_connect_info;
+}
@@ -1,13 +1,36 @@
 #pragma once
 #include "esp_err.h"
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/** Inicializa Wi-Fi em modo station usando as configs do menuconfig. */
+/** Caminho usado pela conexão do boot atual. */
+typedef enum {
+    WIFI_CONNECT_FULL = 0,      // Varredura completa pelo SSID
+    WIFI_CONNECT_FAST,          // BSSID e canal do cache (boot após falha)
+    WIFI_CONNECT_FAST_FALLBACK, // O cache falhou e a varredura completa assumiu
+} wifi_connect_path_t;
+
+/** Tempos da conexão do boot atual (esp_timer_get_time; 0 se ainda não ocorreu). */
+typedef struct {
+    int64_t start_us;     // esp_wifi_start()
+    int64_t connected_us; // Primeiro IP obtido
+    wifi_connect_path_t path;
+} wifi_connect_info_t;
+
+/**
+ * Inicializa Wi-Fi em modo station usando as configs do menuconfig.
+ *
+ * Com WIFI_FAST_CONNECT, num boot após panic ou watchdog associa direto ao BSSID e
+ * canal da última conexão (guardados em RTC) e só varre os canais se isso falhar.
+ */
 esp_err_t wifi_init_start(void);
 
+/** Copia os tempos e o caminho da conexão do boot atual. */
+void wifi_get_connect_info(wifi_connect_info_t *out);
+
 #ifdef __cplusplus
 }
 #endif
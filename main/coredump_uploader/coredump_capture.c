@@ -0,0 +1,199 @@
+#include "coredump_capture.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+static const char *TAG = "COREDUMP_CAPTURE";
+
+#if CONFIG_COREDUMP_UPLOADER_CAPTURE_FILTER
+
+#define CAPTURE_STATS_MAGIC 0x43415031 // "CAP1"
+
+// Limite por pilha, alinhado a 16 bytes como os frames salvos
+#define CAPTURE_STACK_MAX ((uint32_t)CONFIG_COREDUMP_UPLOADER_CAPTURE_STACK_MAX & ~15u)
+_Static_assert(CAPTURE_STACK_MAX == 0 || CAPTURE_STACK_MAX >= 512, "limite de pilha menor que o contexto salvo da task");
+
+// Com o handler de panic na IRAM, o ESP-IDF tira o coredump da flash; o filtro acompanha
+#if CONFIG_ESP_PANIC_HANDLER_IRAM
+#define CAPTURE_TEXT IRAM_ATTR
+#define CAPTURE_RODATA DRAM_ATTR
+#else
+#define CAPTURE_TEXT
+#define CAPTURE_RODATA
+#endif
+
+// Mesmo leiaute de core_dump_task_header_t (cabeçalho privado do componente espcoredump)
+typedef struct {
+    void *tcb_addr;
+    uint32_t stack_start; // Ponteiro de pilha da task (endereço mais baixo salvo)
+    uint32_t stack_end;   // Fim da pilha (endereço mais alto)
+} capture_task_header_t;
+
+bool __real_esp_core_dump_get_task_snapshot(void *handle, capture_task_header_t *task, void *interrupted_stack);
+bool __wrap_esp_core_dump_get_task_snapshot(void *handle, capture_task_header_t *task, void *interrupted_stack);
+
+static CAPTURE_RODATA const char s_allow[] = CONFIG_COREDUMP_UPLOADER_CAPTURE_ALLOW;
+static CAPTURE_RODATA const char s_deny[] = CONFIG_COREDUMP_UPLOADER_CAPTURE_DENY;
+
+// Efeito da captura. RTC_NOINIT sobrevive ao reset do panic; o CRC descarta o lixo do power-on.
+typedef struct {
+    uint32_t magic;
+    coredump_capture_stats_t stats;
+    uint32_t crc;
+} capture_record_t;
+
+static RTC_NOINIT_ATTR capture_record_t s_record;
+
+// O ESP-IDF consulta cada task mais de uma vez (registradores, cálculo do tamanho e gravação):
+// só a primeira consulta de cada TCB entra nos contadores
+static void *s_seen[CONFIG_ESP_COREDUMP_MAX_TASKS_NUM];
+static size_t s_seen_count;
+
+// Resultado do boot anterior, copiado por coredump_capture_init()
+static coredump_capture_stats_t s_last;
+static bool s_has_last;
+
+static CAPTURE_TEXT uint32_t _record_crc(const capture_record_t *r) {
+    return esp_rom_crc32_le(0, (const uint8_t *)&r->stats, sizeof(r->stats));
+}
+
+// 'name' está em 'list' ("a,b*,c")? Um '*' no fim do item casa por prefixo.
+static CAPTURE_TEXT bool _name_in_list(const char *name, const char *list) {
+    const char *item = list;
+    while (*item) {
+        const char *end = item;
+        while (*end && *end != ',')
+            ++end;
+        const char *s = item, *e = end;
+        while (s < e && *s == ' ')
+            ++s;
+        while (e > s && e[-1] == ' ')
+            --e;
+        bool prefix = e > s && e[-1] == '*';
+        if (prefix)
+            --e;
+        if (s < e || prefix) {
+            size_t len = (size_t)(e - s), i = 0;
+            while (i < len && name[i] == s[i])
+                ++i;
+            if (i == len && (prefix || name[len] == '\0'))
+                return true;
+        }
+        item = *end ? end + 1 : end;
+    }
+    return false;
+}
+
+#if CONFIG_COREDUMP_UPLOADER_CAPTURE_MIN_PRIORITY > 0
+// Prioridade atual (com herança) lida direto do TCB: uxTaskPriorityGet() entra numa seção
+// crítica, e no panic o spinlock pode ter ficado com o núcleo parado. StaticTask_t espelha o
+// leiaute do TCB, e uxDummy5 corresponde a uxPriority.
+static CAPTURE_TEXT UBaseType_t _task_priority(void *handle) {
+    return ((const StaticTask_t *)handle)->uxDummy5;
+}
+#endif
+
+// Task em execução em algum núcleo no instante da falha
+static CAPTURE_TEXT bool _is_running(void *handle) {
+    for (BaseType_t core = 0; core < portNUM_PROCESSORS; ++core) {
+        if (xTaskGetCurrentTaskHandleForCore(core) == handle)
+            return true;
+    }
+    return false;
+}
+
+static CAPTURE_TEXT bool _keep_task(void *handle) {
+    const char *name = pcTaskGetName((TaskHandle_t)handle);
+    if (!name)
+        return true;
+    if (_name_in_list(name, s_deny))
+        return false;
+    if (s_allow[0])
+        return _name_in_list(name, s_allow);
+#if CONFIG_COREDUMP_UPLOADER_CAPTURE_MIN_PRIORITY > 0
+    return _task_priority(handle) >= CONFIG_COREDUMP_UPLOADER_CAPTURE_MIN_PRIORITY;
+#else
+    return true;
+#endif
+}
+
+// Registra o TCB; false se já foi contado
+static CAPTURE_TEXT bool _first_sighting(void *handle) {
+    if (s_record.magic != CAPTURE_STATS_MAGIC) {
+        memset(&s_record.stats, 0, sizeof(s_record.stats));
+        s_record.magic = CAPTURE_STATS_MAGIC;
+    }
+    for (size_t i = 0; i < s_seen_count; ++i) {
+        if (s_seen[i] == handle)
+            return false;
+    }
+    if (s_seen_count == sizeof(s_seen) / sizeof(s_seen[0]))
+        return false;
+    s_seen[s_seen_count++] = handle;
+    return true;
+}
+
+bool CAPTURE_TEXT __wrap_esp_core_dump_get_task_snapshot(void *handle, capture_task_header_t *task, void *interrupted_stack) {
+    if (!__real_esp_core_dump_get_task_snapshot(handle, task, interrupted_stack))
+        return false;
+    uint32_t stack_len = task->stack_end > task->stack_start ? task->stack_end - task->stack_start : 0;
+    bool first = _first_sighting(handle);
+    bool crashed = handle == xTaskGetCurrentTaskHandleForCore(esp_cpu_get_core_id());
+    bool keep = crashed || _is_running(handle) || _keep_task(handle);
+    if (first) {
+        s_record.stats.tasks++;
+        if (!keep) {
+            s_record.stats.dropped++;
+            s_record.stats.saved_bytes += sizeof(StaticTask_t) + stack_len;
+        } else if (!crashed && CAPTURE_STACK_MAX && stack_len > CAPTURE_STACK_MAX) {
+            s_record.stats.capped++;
+            s_record.stats.saved_bytes += stack_len - CAPTURE_STACK_MAX;
+        }
+        s_record.crc = _record_crc(&s_record);
+    }
+    if (!keep)
+        return false;
+    // A pilha cresce para baixo: o corte preserva o contexto salvo e os frames mais recentes
+    if (!crashed && CAPTURE_STACK_MAX && stack_len > CAPTURE_STACK_MAX)
+        task->stack_end = task->stack_start + CAPTURE_STACK_MAX;
+    return true;
+}
+
+void coredump_capture_init(void) {
+    // O registro só é escrito durante a captura e é invalidado a cada boot: válido aqui,
+    // descreve a imagem gravada pela falha do boot anterior
+    if (s_record.magic == CAPTURE_STATS_MAGIC && s_record.crc == _record_crc(&s_record)) {
+        s_last = s_record.stats;
+        s_has_last = true;
+        ESP_LOGI(TAG, "Captura da última falha: %u tasks, %u omitidas, %u pilhas cortadas, %" PRIu32 " bytes economizados",
+                 (unsigned)s_last.tasks, (unsigned)s_last.dropped, (unsigned)s_last.capped, s_last.saved_bytes);
+    }
+    s_record.magic = 0;
+}
+
+esp_err_t coredump_capture_last(coredump_capture_stats_t *out) {
+    if (!out)
+        return ESP_ERR_INVALID_ARG;
+    if (!s_has_last)
+        return ESP_ERR_NOT_FOUND;
+    *out = s_last;
+    return ESP_OK;
+}
+
+#else
+
+void coredump_capture_init(void) {
+}
+
+esp_err_t coredump_capture_last(coredump_capture_stats_t *out) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
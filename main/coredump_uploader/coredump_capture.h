@@ -0,0 +1,57 @@
+#ifndef COREDUMP_CAPTURE_H
+#define COREDUMP_CAPTURE_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Captura reduzida do coredump (CONFIG_COREDUMP_UPLOADER_CAPTURE_FILTER).
+ *
+ * Durante o panic, o ESP-IDF obtém cada task por esp_core_dump_get_task_snapshot(); o
+ * link envolve essa função (-Wl,--wrap) e, antes de a imagem ser gravada:
+ *  - omite as tasks da lista de exclusão, as fora da lista de inclusão (se houver) e as
+ *    de prioridade abaixo do mínimo;
+ *  - limita a pilha das demais aos CONFIG_COREDUMP_UPLOADER_CAPTURE_STACK_MAX bytes a
+ *    partir do topo (frames mais recentes e o contexto salvo).
+ * A task que falhou e as que estavam executando nos outros núcleos nunca são omitidas,
+ * e a pilha da task que falhou vai inteira.
+ *
+ * O quanto foi cortado fica em RTC_NOINIT e é lido no boot seguinte, junto da imagem.
+ */
+
+/**
+ * @brief Efeito da captura reduzida na imagem da última falha.
+ */
+typedef struct {
+    uint16_t tasks;       // Tasks vistas pela captura
+    uint16_t dropped;     // Tasks omitidas
+    uint16_t capped;      // Pilhas cortadas
+    uint32_t saved_bytes; // Bytes de TCB e pilha que deixaram de entrar na imagem (sem os cabeçalhos ELF)
+} coredump_capture_stats_t;
+
+/**
+ * @brief Recupera o efeito da captura do boot anterior e prepara a próxima.
+ *
+ * Deve ser chamada no início do app_main, antes de qualquer leitura do resumo.
+ */
+void coredump_capture_init(void);
+
+/**
+ * @brief Efeito da captura na imagem gravada pela falha do boot anterior.
+ *
+ * @return ESP_OK se disponível.
+ * @return ESP_ERR_NOT_FOUND se o boot anterior não terminou numa falha capturada.
+ * @return ESP_ERR_NOT_SUPPORTED se CONFIG_COREDUMP_UPLOADER_CAPTURE_FILTER estiver desabilitado.
+ */
+esp_err_t coredump_capture_last(coredump_capture_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COREDUMP_CAPTURE_H
@@ -0,0 +1,162 @@
+#include "coredump_deflate.h"
+#include <string.h>
+
+#define HASH_SIZE (1u << COREDUMP_DEFLATE_HASH_BITS)
+#define NO_POS 0xFFFFu
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+
+// Tabelas de comprimento/distância da RFC 1951 (seção 3.2.5)
+static const uint16_t s_len_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t s_len_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t s_dist_base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                         193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                         6145, 8193, 12289, 16385, 24577};
+static const uint8_t s_dist_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                         6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Saída de bits LSB primeiro, com cursor sobre o buffer do chamador
+typedef struct {
+    coredump_deflate_t *d;
+    uint8_t *out;
+    size_t pos;
+} bit_writer_t;
+
+static inline void _put_bits(bit_writer_t *w, uint32_t value, unsigned nbits) {
+    coredump_deflate_t *d = w->d;
+    d->bit_buf |= value << d->bit_count;
+    d->bit_count += nbits;
+    while (d->bit_count >= 8) {
+        w->out[w->pos++] = (uint8_t)d->bit_buf;
+        d->bit_buf >>= 8;
+        d->bit_count -= 8;
+    }
+}
+
+// Códigos Huffman são definidos MSB primeiro; inverte para o fluxo LSB primeiro
+static inline void _put_code(bit_writer_t *w, uint32_t code, unsigned nbits) {
+    uint32_t rev = 0;
+    for (unsigned i = 0; i < nbits; ++i) {
+        rev = (rev << 1) | (code & 1u);
+        code >>= 1;
+    }
+    _put_bits(w, rev, nbits);
+}
+
+// Símbolo literal/comprimento com a tabela Huffman fixa (RFC 1951, 3.2.6)
+static void _put_litlen(bit_writer_t *w, unsigned sym) {
+    if (sym < 144)
+        _put_code(w, 0x30 + sym, 8);
+    else if (sym < 256)
+        _put_code(w, 0x190 + (sym - 144), 9);
+    else if (sym < 280)
+        _put_code(w, sym - 256, 7);
+    else
+        _put_code(w, 0xC0 + (sym - 280), 8);
+}
+
+static void _put_match(bit_writer_t *w, unsigned len, unsigned dist) {
+    unsigned li = 28;
+    while (s_len_base[li] > len)
+        --li;
+    _put_litlen(w, 257 + li);
+    if (s_len_extra[li])
+        _put_bits(w, len - s_len_base[li], s_len_extra[li]);
+
+    unsigned di = 29;
+    while (s_dist_base[di] > dist)
+        --di;
+    _put_code(w, di, 5);
+    if (s_dist_extra[di])
+        _put_bits(w, dist - s_dist_base[di], s_dist_extra[di]);
+}
+
+static inline unsigned _hash3(const uint8_t *p) {
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    return (v * 2654435761u) >> (32 - COREDUMP_DEFLATE_HASH_BITS);
+}
+
+// Descarta o histórico além da janela para abrir espaço ao próximo bloco
+static void _slide(coredump_deflate_t *d) {
+    if (d->window_len <= COREDUMP_DEFLATE_WINDOW_SIZE)
+        return;
+    size_t shift = d->window_len - COREDUMP_DEFLATE_WINDOW_SIZE;
+    memmove(d->window, d->window + shift, COREDUMP_DEFLATE_WINDOW_SIZE);
+    d->window_len = COREDUMP_DEFLATE_WINDOW_SIZE;
+    for (size_t i = 0; i < HASH_SIZE; ++i)
+        d->head[i] = (d->head[i] != NO_POS && d->head[i] >= shift) ? (uint16_t)(d->head[i] - shift) : NO_POS;
+}
+
+void coredump_deflate_init(coredump_deflate_t *d) {
+    d->window_len = 0;
+    d->bit_buf = 0;
+    d->bit_count = 0;
+    d->header_written = false;
+    d->finished = false;
+    for (size_t i = 0; i < HASH_SIZE; ++i)
+        d->head[i] = NO_POS;
+}
+
+size_t coredump_deflate_block(coredump_deflate_t *d, const uint8_t *in, size_t len, bool final, uint8_t *out) {
+    bit_writer_t w = {.d = d, .out = out, .pos = 0};
+    if (d->finished)
+        return 0;
+    if (len > COREDUMP_DEFLATE_BLOCK_SIZE)
+        len = COREDUMP_DEFLATE_BLOCK_SIZE;
+
+    if (!d->header_written) {
+        // Bloco único (BFINAL=1) com Huffman fixo (BTYPE=01)
+        _put_bits(&w, 1, 1);
+        _put_bits(&w, 1, 2);
+        d->header_written = true;
+    }
+
+    _slide(d);
+    memcpy(d->window + d->window_len, in, len);
+    size_t pos = d->window_len;
+    size_t end = d->window_len + len;
+    d->window_len = end;
+
+    while (pos < end) {
+        unsigned best_len = 0;
+        size_t best_dist = 0;
+        if (pos + MIN_MATCH <= end) {
+            unsigned h = _hash3(&d->window[pos]);
+            uint16_t cand = d->head[h];
+            d->head[h] = (uint16_t)pos;
+            if (cand != NO_POS && pos - cand <= COREDUMP_DEFLATE_WINDOW_SIZE) {
+                size_t max_len = end - pos;
+                if (max_len > MAX_MATCH)
+                    max_len = MAX_MATCH;
+                unsigned l = 0;
+                while (l < max_len && d->window[cand + l] == d->window[pos + l])
+                    ++l;
+                if (l >= MIN_MATCH) {
+                    best_len = l;
+                    best_dist = pos - cand;
+                }
+            }
+        }
+
+        if (best_len) {
+            _put_match(&w, best_len, (unsigned)best_dist);
+            // Registra os prefixos cobertos pela referência para as próximas buscas
+            for (size_t k = pos + 1; k < pos + best_len && k + MIN_MATCH <= end; ++k)
+                d->head[_hash3(&d->window[k])] = (uint16_t)k;
+            pos += best_len;
+        } else {
+            _put_litlen(&w, d->window[pos]);
+            ++pos;
+        }
+    }
+
+    if (final) {
+        _put_litlen(&w, 256); // Fim de bloco
+        if (d->bit_count)
+            _put_bits(&w, 0, 8 - d->bit_count);
+        d->finished = true;
+    }
+    return w.pos;
+}
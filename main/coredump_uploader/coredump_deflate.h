@@ -0,0 +1,72 @@
+#ifndef COREDUMP_DEFLATE_H
+#define COREDUMP_DEFLATE_H
+
+#include "sdkconfig.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Compressor "raw deflate" (RFC 1951) em fluxo, com janela pequena e fixa.
+ *
+ * Gera um único bloco com códigos Huffman fixos, o que dispensa tabelas
+ * dinâmicas e mantém a memória limitada ao estado abaixo (alocável estática
+ * ou dinamicamente). A saída é decodificável por qualquer inflate, p.ex.
+ * zlib.decompressobj(-15) no backend.
+ */
+
+/** Distância máxima de referência ao histórico (janela deslizante). */
+#ifdef CONFIG_COREDUMP_UPLOADER_DEFLATE_WINDOW_SIZE
+#define COREDUMP_DEFLATE_WINDOW_SIZE CONFIG_COREDUMP_UPLOADER_DEFLATE_WINDOW_SIZE
+#else
+#define COREDUMP_DEFLATE_WINDOW_SIZE 2048
+#endif
+
+/** Tamanho máximo de cada bloco de entrada passado a coredump_deflate_block(). */
+#define COREDUMP_DEFLATE_BLOCK_SIZE 1024
+
+/** Quantidade de bits da tabela de hash de prefixos de 3 bytes. */
+#define COREDUMP_DEFLATE_HASH_BITS 10
+
+/** Pior caso de saída para um bloco de 'n' bytes (literais de 9 bits + cabeçalho/fim). */
+#define COREDUMP_DEFLATE_MAX_OUTPUT(n) ((((n) * 9) + 24) / 8 + 1)
+
+/**
+ * @brief Estado do compressor. Tratar como opaco.
+ */
+typedef struct {
+    uint8_t window[COREDUMP_DEFLATE_WINDOW_SIZE + COREDUMP_DEFLATE_BLOCK_SIZE]; // Histórico + bloco atual
+    uint16_t head[1 << COREDUMP_DEFLATE_HASH_BITS];                            // Última posição de cada hash
+    size_t window_len;      // Bytes válidos em 'window'
+    uint32_t bit_buf;       // Bits pendentes (LSB primeiro)
+    unsigned bit_count;     // Quantidade de bits pendentes
+    bool header_written;    // Cabeçalho do bloco já emitido
+    bool finished;          // Fim de bloco já emitido
+} coredump_deflate_t;
+
+/**
+ * @brief Inicializa (ou reinicia) o compressor.
+ */
+void coredump_deflate_init(coredump_deflate_t *d);
+
+/**
+ * @brief Comprime um bloco de entrada.
+ *
+ * @param d Estado do compressor.
+ * @param in Dados de entrada (até COREDUMP_DEFLATE_BLOCK_SIZE bytes).
+ * @param len Quantidade de bytes de entrada.
+ * @param final true no último bloco: emite o fim do fluxo e completa o último byte.
+ * @param out Saída com capacidade mínima de COREDUMP_DEFLATE_MAX_OUTPUT(len).
+ * @return Quantidade de bytes escritos em 'out'.
+ */
+size_t coredump_deflate_block(coredump_deflate_t *d, const uint8_t *in, size_t len, bool final, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COREDUMP_DEFLATE_H
@@ -0,0 +1,171 @@
+#include "coredump_http.h"
+#include "esp_crt_bundle.h"
+#include "esp_log.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "coredump_http";
+
+#define HTTP_URL_MAX 192
+#define HTTP_RESPONSE_MAX 128
+
+// Escreve tudo ou falha: esp_http_client_write() retorna -1 em erro de transporte
+static esp_err_t _write_all(coredump_http_transport_t *t, const char *data, size_t len) {
+    while (len > 0) {
+        int n = esp_http_client_write(t->client, data, (int)len);
+        if (n <= 0)
+            return ESP_FAIL;
+        data += n;
+        len -= (size_t)n;
+    }
+    return ESP_OK;
+}
+
+static void _set_header_u32(esp_http_client_handle_t client, const char *key, const char *fmt, uint32_t value) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), fmt, value);
+    esp_http_client_set_header(client, key, buf);
+}
+
+// Abre o POST: metadados da mensagem inicial do MQTT em cabeçalhos, corpo em chunked
+static esp_err_t _http_start(void *priv) {
+    coredump_http_transport_t *t = (coredump_http_transport_t *)priv;
+    const coredump_uploader_info_t *info = t->info;
+    t->sent = 0;
+    t->failed = false;
+    t->status = 0;
+
+    char url[HTTP_URL_MAX];
+    snprintf(url, sizeof(url), "%s/%s", t->cfg.url, t->cfg.device_id);
+    esp_http_client_set_url(t->client, url);
+    esp_http_client_set_method(t->client, HTTP_METHOD_POST);
+    esp_http_client_set_header(t->client, "Content-Type", "application/octet-stream");
+    _set_header_u32(t->client, "X-Coredump-Bytes", "%" PRIu32, (uint32_t)info->compressed_size);
+    _set_header_u32(t->client, "X-Coredump-Size", "%" PRIu32, (uint32_t)info->total_size);
+    _set_header_u32(t->client, "X-Coredump-Id", "%08" PRIx32, info->image_crc);
+    _set_header_u32(t->client, "X-Coredump-Crc", "%08" PRIx32, info->image_digest);
+    esp_http_client_set_header(t->client, "X-Coredump-Enc", info->use_base64 ? "base64" : "raw");
+    if (info->compressed)
+        esp_http_client_set_header(t->client, "X-Coredump-Comp", "deflate");
+    else
+        esp_http_client_delete_header(t->client, "X-Coredump-Comp");
+    if (t->cfg.has_fingerprint)
+        _set_header_u32(t->client, "X-Coredump-Fp", "%08" PRIx32, t->cfg.fingerprint);
+    if (info->prefix_size) {
+        char first[6 * COREDUMP_UPLOADER_MAX_FIRST_SEGMENTS + 1]; // "65535," por índice
+        size_t pos = 0;
+        first[0] = '\0';
+        for (size_t i = 0; i < info->first_count; i++)
+            pos += snprintf(first + pos, sizeof(first) - pos, i ? ",%u" : "%u", (unsigned)info->first_segments[i]);
+        _set_header_u32(t->client, "X-Coredump-Prefix", "%" PRIu32, (uint32_t)info->prefix_size);
+        esp_http_client_set_header(t->client, "X-Coredump-First", first);
+    } else {
+        esp_http_client_delete_header(t->client, "X-Coredump-Prefix");
+        esp_http_client_delete_header(t->client, "X-Coredump-First");
+    }
+
+    // Tamanho -1: o cliente declara "Transfer-Encoding: chunked"; o enquadramento é nosso
+    esp_err_t err = esp_http_client_open(t->client, -1);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Falha ao conectar a %s (%s)", url, esp_err_to_name(err));
+        t->failed = true;
+        return err;
+    }
+    ESP_LOGI(TAG, "POST %s (%u bytes de fluxo)", url, (unsigned)info->compressed_size);
+    return ESP_OK;
+}
+
+// Cada chunk do uploader vira um pedaço do corpo chunked: "<tamanho hex>\r\n<dados>\r\n"
+static esp_err_t _http_write(void *priv, const char *data, size_t len) {
+    coredump_http_transport_t *t = (coredump_http_transport_t *)priv;
+    if (t->failed)
+        return ESP_FAIL;
+    char head[12];
+    int n = snprintf(head, sizeof(head), "%x\r\n", (unsigned)len);
+    if (_write_all(t, head, (size_t)n) != ESP_OK || _write_all(t, data, len) != ESP_OK || _write_all(t, "\r\n", 2) != ESP_OK) {
+        ESP_LOGE(TAG, "Falha ao escrever o corpo após %u bytes.", (unsigned)t->sent);
+        t->failed = true;
+        return ESP_FAIL;
+    }
+    t->sent += len;
+    return ESP_OK;
+}
+
+// Fecha o corpo e confere a resposta; a conexão fica aberta para o próximo POST
+static esp_err_t _http_end(void *priv) {
+    coredump_http_transport_t *t = (coredump_http_transport_t *)priv;
+    if (t->failed || _write_all(t, "0\r\n\r\n", 5) != ESP_OK) {
+        // Corpo truncado: fechar é a única forma de o servidor descartar o POST
+        esp_http_client_close(t->client);
+        return ESP_FAIL;
+    }
+    if (esp_http_client_fetch_headers(t->client) < 0) {
+        ESP_LOGE(TAG, "Sem resposta do servidor.");
+        esp_http_client_close(t->client);
+        return ESP_FAIL;
+    }
+    t->status = esp_http_client_get_status_code(t->client);
+    char body[HTTP_RESPONSE_MAX];
+    int n = esp_http_client_read_response(t->client, body, sizeof(body) - 1);
+    body[n > 0 ? n : 0] = '\0';
+    esp_http_client_flush_response(t->client, NULL);
+    if (t->status != 200) {
+        ESP_LOGE(TAG, "Servidor respondeu %d: %s", t->status, body);
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Coredump aceito (%u bytes): %s", (unsigned)t->sent, body);
+    return ESP_OK;
+}
+
+// Sem confirmação parcial, todo POST envia o fluxo inteiro (ignora checkpoints do MQTT)
+static esp_err_t _http_resume(void *priv, const coredump_uploader_info_t *info, coredump_uploader_resume_t *point) {
+    (void)priv;
+    (void)info;
+    *point = (coredump_uploader_resume_t){0};
+    return ESP_OK;
+}
+
+esp_err_t coredump_http_init(coredump_http_transport_t *t, const coredump_http_config_t *cfg) {
+    if (!t || !cfg || !cfg->url || !cfg->device_id)
+        return ESP_ERR_INVALID_ARG;
+    memset(t, 0, sizeof(*t));
+    t->cfg = *cfg;
+    esp_http_client_config_t http_cfg = {
+        .url = cfg->url,
+        .method = HTTP_METHOD_POST,
+        .timeout_ms = cfg->timeout_ms,
+        .keep_alive_enable = true,
+        .crt_bundle_attach = esp_crt_bundle_attach,
+    };
+    t->client = esp_http_client_init(&http_cfg);
+    if (!t->client) {
+        ESP_LOGE(TAG, "esp_http_client_init retornou NULL");
+        return ESP_ERR_NO_MEM;
+    }
+    if (cfg->token && cfg->token[0]) {
+        char auth[160];
+        snprintf(auth, sizeof(auth), "Bearer %s", cfg->token);
+        esp_http_client_set_header(t->client, "Authorization", auth);
+    }
+    return ESP_OK;
+}
+
+void coredump_http_callbacks(coredump_http_transport_t *t, const coredump_uploader_info_t *info, coredump_uploader_callbacks_t *out) {
+    t->info = info;
+    *out = (coredump_uploader_callbacks_t){
+        .start = _http_start,
+        .write = _http_write,
+        .end = _http_end,
+        .resume = _http_resume,
+        .priv = t,
+    };
+}
+
+void coredump_http_deinit(coredump_http_transport_t *t) {
+    if (!t || !t->client)
+        return;
+    esp_http_client_cleanup(t->client);
+    t->client = NULL;
+    t->info = NULL;
+}
@@ -0,0 +1,77 @@
+#ifndef COREDUMP_HTTP_H
+#define COREDUMP_HTTP_H
+
+#include "coredump_uploader.h"
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Transporte HTTP(S) para coredump_upload(): o fluxo inteiro vai num único POST
+ * com "Transfer-Encoding: chunked", escrito com esp_http_client_write() à medida
+ * que o uploader entrega os chunks. Não há tópico, ACK nem numeração por parte;
+ * os metadados da mensagem inicial do MQTT seguem em cabeçalhos X-Coredump-*.
+ *
+ * O cliente HTTP é criado uma vez e mantido entre tentativas: a conexão (e a
+ * sessão TLS) com o servidor é reaproveitada enquanto o servidor a mantiver
+ * aberta. Um POST interrompido recomeça do início do fluxo.
+ */
+
+/**
+ * @brief Configuração do transporte.
+ */
+typedef struct {
+    const char *url;          // Endpoint base; o POST vai para "<url>/<device_id>"
+    const char *device_id;    // Identificador do dispositivo (MAC), como nos tópicos MQTT
+    const char *token;        // Token "Authorization: Bearer"; NULL ou "" para nenhum
+    int timeout_ms;           // Timeout de rede de cada operação
+    bool has_fingerprint;     // Declara 'fingerprint' (X-Coredump-Fp) para deduplicação
+    uint32_t fingerprint;
+} coredump_http_config_t;
+
+/**
+ * @brief Estado do transporte. Tratar como opaco.
+ */
+typedef struct {
+    coredump_http_config_t cfg;
+    esp_http_client_handle_t client;       // Mantido entre POSTs para reaproveitar a conexão
+    const coredump_uploader_info_t *info;  // Upload em andamento
+    size_t sent;                           // Bytes do corpo já escritos neste POST
+    bool failed;                           // Uma escrita falhou: o POST não pode ser concluído
+    int status;                            // Status HTTP do último POST (0 se nenhum)
+} coredump_http_transport_t;
+
+/**
+ * @brief Cria o cliente HTTP do transporte.
+ *
+ * As strings de 'cfg' devem permanecer válidas até coredump_http_deinit(). URLs
+ * "https://" são verificadas com o bundle de certificados do ESP-IDF.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG (url ou device_id ausente) ou ESP_ERR_NO_MEM.
+ */
+esp_err_t coredump_http_init(coredump_http_transport_t *t, const coredump_http_config_t *cfg);
+
+/**
+ * @brief Preenche os callbacks do uploader para enviar 'info' por este transporte.
+ *
+ * 'info' deve ser a mesma estrutura passada a coredump_upload() e permanecer
+ * válida durante o upload.
+ */
+void coredump_http_callbacks(coredump_http_transport_t *t, const coredump_uploader_info_t *info, coredump_uploader_callbacks_t *out);
+
+/**
+ * @brief Fecha a conexão e libera o cliente HTTP.
+ */
+void coredump_http_deinit(coredump_http_transport_t *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COREDUMP_HTTP_H
@@ -0,0 +1,300 @@
+#include "coredump_spool.h"
+#include "coredump_uploader.h"
+#include "esp_core_dump.h"
+#include "esp_flash.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+static const char *TAG = "coredump_spool";
+
+#define SPOOL_MAGIC 0x53504c31          // "SPL1"
+#define SPOOL_SECTOR_SIZE 4096          // Apagamento mínimo da flash; o primeiro setor do slot é o cabeçalho
+#define SPOOL_STATE_OFFSET 64           // Palavra de estado, fora da área coberta pelo CRC do cabeçalho
+#define SPOOL_SUMMARY_OFFSET 128        // Resumo JSON, até COREDUMP_SPOOL_SUMMARY_MAX bytes
+#define SPOOL_STATE_PENDING 0xffffffffu // Flash apagada: gravar zeros não exige apagar o setor
+#define SPOOL_STATE_SENT 0u
+#define SPOOL_COPY_BLOCK 512            // Bytes por leitura/escrita durante a cópia
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t image_size;
+    uint32_t image_crc;       // Últimos 4 bytes da imagem
+    uint32_t copy_crc;        // CRC32 da imagem copiada, conferido ao reler
+    uint32_t reset_reason;
+    uint32_t uptime_s;
+    uint32_t crashed_tcb;
+    uint32_t fingerprint;
+    uint8_t has_fingerprint;
+    uint8_t reserved;
+    uint16_t summary_len;
+    uint32_t header_crc;      // Campos acima e o resumo
+} spool_header_t;
+
+_Static_assert(sizeof(spool_header_t) <= SPOOL_STATE_OFFSET, "cabeçalho invade a palavra de estado");
+_Static_assert(SPOOL_SUMMARY_OFFSET + COREDUMP_SPOOL_SUMMARY_MAX <= SPOOL_SECTOR_SIZE, "resumo não cabe no setor do cabeçalho");
+
+static const esp_partition_t *s_part;
+static size_t s_slot_size;
+
+static bool _spool_open(void) {
+    if (s_part)
+        return true;
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, CONFIG_COREDUMP_UPLOADER_SPOOL_PARTITION);
+    if (!part) {
+        ESP_LOGW(TAG, "Partição '%s' não encontrada: coredumps seguem sem fila.", CONFIG_COREDUMP_UPLOADER_SPOOL_PARTITION);
+        return false;
+    }
+    size_t slot = (part->size / CONFIG_COREDUMP_UPLOADER_SPOOL_SLOTS) & ~(size_t)(SPOOL_SECTOR_SIZE - 1);
+    if (slot < 2 * SPOOL_SECTOR_SIZE) {
+        ESP_LOGE(TAG, "Partição '%s' pequena demais para %d slots.", CONFIG_COREDUMP_UPLOADER_SPOOL_PARTITION, CONFIG_COREDUMP_UPLOADER_SPOOL_SLOTS);
+        return false;
+    }
+    s_part = part;
+    s_slot_size = slot;
+    return true;
+}
+
+static inline size_t _slot_offset(size_t slot) {
+    return slot * s_slot_size;
+}
+
+static uint32_t _header_crc(const spool_header_t *h, const char *summary) {
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)h, offsetof(spool_header_t, header_crc));
+    return esp_rom_crc32_le(crc, (const uint8_t *)summary, h->summary_len);
+}
+
+// Lê cabeçalho, estado e resumo do slot; false se o slot não guarda uma imagem íntegra
+static bool _slot_load(size_t slot, spool_header_t *h, uint32_t *state, char *summary) {
+    size_t base = _slot_offset(slot);
+    if (esp_partition_read(s_part, base, h, sizeof(*h)) != ESP_OK || h->magic != SPOOL_MAGIC)
+        return false;
+    if (h->summary_len >= COREDUMP_SPOOL_SUMMARY_MAX || h->image_size == 0 || h->image_size > s_slot_size - SPOOL_SECTOR_SIZE)
+        return false;
+    if (esp_partition_read(s_part, base + SPOOL_SUMMARY_OFFSET, summary, h->summary_len) != ESP_OK ||
+        esp_partition_read(s_part, base + SPOOL_STATE_OFFSET, state, sizeof(*state)) != ESP_OK)
+        return false;
+    summary[h->summary_len] = '\0';
+    return h->header_crc == _header_crc(h, summary);
+}
+
+// CRC32 de 'len' bytes a partir de 'offset' (partição do spool) ou de 'flash_addr' (sem partição)
+static esp_err_t _crc_region(const esp_partition_t *part, size_t addr, size_t len, uint32_t *out) {
+    uint8_t buf[SPOOL_COPY_BLOCK];
+    uint32_t crc = 0;
+    for (size_t off = 0; off < len; off += sizeof(buf)) {
+        size_t n = len - off < sizeof(buf) ? len - off : sizeof(buf);
+        esp_err_t err = part ? esp_partition_read(part, addr + off, buf, n) : esp_flash_read(esp_flash_default_chip, buf, addr + off, n);
+        if (err != ESP_OK)
+            return err;
+        crc = esp_rom_crc32_le(crc, buf, n);
+    }
+    *out = crc;
+    return ESP_OK;
+}
+
+static esp_err_t _copy_image(size_t slot, size_t flash_addr, size_t size, uint32_t *out_crc) {
+    size_t base = _slot_offset(slot);
+    size_t erase = (SPOOL_SECTOR_SIZE + size + SPOOL_SECTOR_SIZE - 1) & ~(size_t)(SPOOL_SECTOR_SIZE - 1);
+    esp_err_t err = esp_partition_erase_range(s_part, base, erase);
+    if (err != ESP_OK)
+        return err;
+    uint8_t buf[SPOOL_COPY_BLOCK];
+    uint32_t crc = 0;
+    for (size_t off = 0; off < size; off += sizeof(buf)) {
+        size_t n = size - off < sizeof(buf) ? size - off : sizeof(buf);
+        err = esp_flash_read(esp_flash_default_chip, buf, flash_addr + off, n);
+        if (err == ESP_OK)
+            err = esp_partition_write(s_part, base + SPOOL_SECTOR_SIZE + off, buf, n);
+        if (err != ESP_OK)
+            return err;
+        crc = esp_rom_crc32_le(crc, buf, n);
+    }
+    // Relê a cópia: só com ela íntegra a imagem original pode ser apagada
+    uint32_t check = 0;
+    err = _crc_region(s_part, base + SPOOL_SECTOR_SIZE, size, &check);
+    if (err != ESP_OK)
+        return err;
+    if (check != crc)
+        return ESP_ERR_INVALID_CRC;
+    *out_crc = crc;
+    return ESP_OK;
+}
+
+esp_err_t coredump_spool_ingest(void) {
+    if (!_spool_open() || esp_core_dump_image_check() != ESP_OK)
+        return ESP_ERR_NOT_FOUND;
+    size_t addr = 0, size = 0;
+    uint32_t image_crc = 0;
+    esp_err_t err = esp_core_dump_image_get(&addr, &size);
+    if (err == ESP_OK && size < sizeof(image_crc))
+        err = ESP_ERR_NOT_FOUND;
+    if (err == ESP_OK)
+        err = esp_flash_read(esp_flash_default_chip, &image_crc, addr + size - sizeof(image_crc), sizeof(image_crc));
+    if (err != ESP_OK)
+        return err;
+    if (size > s_slot_size - SPOOL_SECTOR_SIZE) {
+        ESP_LOGW(TAG, "Coredump de %u bytes não cabe num slot (%u): mantido na partição de coredump.", (unsigned)size,
+                 (unsigned)(s_slot_size - SPOOL_SECTOR_SIZE));
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Próximo slot: o seguinte ao mais recente que estiver livre (vazio, inválido ou já enviado)
+    static char summary[COREDUMP_SPOOL_SUMMARY_MAX];
+    spool_header_t h;
+    uint32_t state;
+    uint32_t newest_seq = 0;
+    size_t newest = CONFIG_COREDUMP_UPLOADER_SPOOL_SLOTS - 1;
+    bool used[CONFIG_COREDUMP_UPLOADER_SPOOL_SLOTS] = {0};
+    for (size_t i = 0; i < CONFIG_COREDUMP_UPLOADER_SPOOL_SLOTS; ++i) {
+        if (!_slot_load(i, &h, &state, summary))
+            continue;
+        used[i] = state != SPOOL_STATE_SENT;
+        if (h.seq >= newest_seq) {
+            newest_seq = h.seq;
+            newest = i;
+        }
+        if (h.image_crc == image_crc && h.image_size == size) {
+            // Copiada antes de uma queda de energia que impediu o apagamento
+            ESP_LOGI(TAG, "Coredump %08" PRIx32 " já está no slot %u.", image_crc, (unsigned)i);
+            return esp_core_dump_image_erase();
+        }
+    }
+    size_t slot = CONFIG_COREDUMP_UPLOADER_SPOOL_SLOTS;
+    for (size_t k = 1; k <= CONFIG_COREDUMP_UPLOADER_SPOOL_SLOTS; ++k) {
+        size_t i = (newest + k) % CONFIG_COREDUMP_UPLOADER_SPOOL_SLOTS;
+        if (!used[i]) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot == CONFIG_COREDUMP_UPLOADER_SPOOL_SLOTS) {
+        ESP_LOGW(TAG, "Spool cheio (%d imagens pendentes): coredump mantido na partição de coredump.", CONFIG_COREDUMP_UPLOADER_SPOOL_SLOTS);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Metadados que dependem de esp_core_dump_get_summary(): só existem enquanto a imagem está na partição
+    h = (spool_header_t){
+        .magic = SPOOL_MAGIC,
+        .seq = newest_seq + 1,
+        .image_size = (uint32_t)size,
+        .image_crc = image_crc,
+        .reset_reason = (uint32_t)esp_reset_reason(),
+        .uptime_s = (uint32_t)(esp_timer_get_time() / 1000000),
+    };
+    esp_core_dump_summary_t cd_summary;
+    if (esp_core_dump_get_summary(&cd_summary) == ESP_OK)
+        h.crashed_tcb = cd_summary.exc_tcb;
+    h.has_fingerprint = coredump_uploader_fingerprint(&h.fingerprint) == ESP_OK;
+    size_t summary_len = 0;
+    if (coredump_uploader_summary_json(summary, sizeof(summary), &summary_len) != ESP_OK)
+        summary_len = 0;
+    h.summary_len = (uint16_t)summary_len;
+
+    err = _copy_image(slot, addr, size, &h.copy_crc);
+    if (err == ESP_OK) {
+        h.header_crc = _header_crc(&h, summary);
+        size_t base = _slot_offset(slot);
+        err = esp_partition_write(s_part, base + SPOOL_SUMMARY_OFFSET, summary, summary_len);
+        if (err == ESP_OK)
+            err = esp_partition_write(s_part, base, &h, sizeof(h)); // Cabeçalho por último: confirma o slot
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Falha ao copiar coredump para o slot %u (%s)", (unsigned)slot, esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "Coredump %08" PRIx32 " (%u bytes, reset %u) copiado para o slot %u (seq %" PRIu32 ").", image_crc, (unsigned)size,
+             (unsigned)h.reset_reason, (unsigned)slot, h.seq);
+    err = esp_core_dump_image_erase();
+    if (err != ESP_OK)
+        ESP_LOGW(TAG, "Falha ao apagar a partição de coredump (%s); a cópia não será duplicada.", esp_err_to_name(err));
+    return ESP_OK;
+}
+
+size_t coredump_spool_pending(void) {
+    if (!_spool_open())
+        return 0;
+    static char summary[COREDUMP_SPOOL_SUMMARY_MAX];
+    spool_header_t h;
+    uint32_t state;
+    size_t count = 0;
+    for (size_t i = 0; i < CONFIG_COREDUMP_UPLOADER_SPOOL_SLOTS; ++i) {
+        if (_slot_load(i, &h, &state, summary) && state != SPOOL_STATE_SENT)
+            count++;
+    }
+    return count;
+}
+
+esp_err_t coredump_spool_next(coredump_spool_entry_t *out) {
+    if (!out)
+        return ESP_ERR_INVALID_ARG;
+    if (!_spool_open())
+        return ESP_ERR_NOT_FOUND;
+    spool_header_t h;
+    uint32_t state;
+    bool found = false;
+    uint32_t oldest_seq = 0;
+    size_t oldest = 0;
+    for (size_t i = 0; i < CONFIG_COREDUMP_UPLOADER_SPOOL_SLOTS; ++i) {
+        if (!_slot_load(i, &h, &state, out->summary) || state == SPOOL_STATE_SENT)
+            continue;
+        if (!found || h.seq < oldest_seq) {
+            oldest_seq = h.seq;
+            oldest = i;
+            found = true;
+        }
+    }
+    if (!found || !_slot_load(oldest, &h, &state, out->summary))
+        return ESP_ERR_NOT_FOUND;
+    out->seq = h.seq;
+    out->slot = oldest;
+    out->flash_addr = s_part->address + _slot_offset(oldest) + SPOOL_SECTOR_SIZE;
+    out->size = h.image_size;
+    out->image_crc = h.image_crc;
+    out->reset_reason = h.reset_reason;
+    out->uptime_s = h.uptime_s;
+    out->crashed_tcb = h.crashed_tcb;
+    out->has_fingerprint = h.has_fingerprint;
+    out->fingerprint = h.fingerprint;
+    return ESP_OK;
+}
+
+static esp_err_t _release_cb(void *arg) {
+    return coredump_spool_release((const coredump_spool_entry_t *)arg);
+}
+
+esp_err_t coredump_spool_select(const coredump_spool_entry_t *entry) {
+    if (!entry || !_spool_open())
+        return ESP_ERR_INVALID_ARG;
+    coredump_uploader_image_t image = {
+        .partition = s_part,
+        .flash_addr = entry->flash_addr,
+        .size = entry->size,
+        .crashed_tcb = entry->crashed_tcb,
+        .summary_json = entry->summary[0] ? entry->summary : NULL,
+        .has_fingerprint = entry->has_fingerprint,
+        .fingerprint = entry->fingerprint,
+        .release = _release_cb,
+        .release_arg = (void *)entry,
+    };
+    return coredump_uploader_select_image(&image);
+}
+
+esp_err_t coredump_spool_release(const coredump_spool_entry_t *entry) {
+    if (!entry || !_spool_open() || entry->slot >= CONFIG_COREDUMP_UPLOADER_SPOOL_SLOTS)
+        return ESP_ERR_INVALID_ARG;
+    uint32_t state = SPOOL_STATE_SENT;
+    esp_err_t err = esp_partition_write(s_part, _slot_offset(entry->slot) + SPOOL_STATE_OFFSET, &state, sizeof(state));
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "Falha ao liberar o slot %u (%s)", (unsigned)entry->slot, esp_err_to_name(err));
+    else
+        ESP_LOGI(TAG, "Slot %u (seq %" PRIu32 ") liberado.", (unsigned)entry->slot, entry->seq);
+    return err;
+}
@@ -0,0 +1,91 @@
+#ifndef COREDUMP_SPOOL_H
+#define COREDUMP_SPOOL_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Fila de coredumps: anel de CONFIG_COREDUMP_UPLOADER_SPOOL_SLOTS slots numa partição
+ * própria (CONFIG_COREDUMP_UPLOADER_SPOOL_PARTITION).
+ *
+ * O ESP-IDF guarda uma única imagem e a sobrescreve na falha seguinte. A cada boot,
+ * coredump_spool_ingest() copia essa imagem para o próximo slot livre e libera a
+ * partição de coredump; falhas repetidas sem rede se acumulam até o anel encher e são
+ * enviadas depois, em sequência, numa única sessão.
+ *
+ * Cada slot começa por um setor de cabeçalho (razão do reset, instante, impressão
+ * digital, TCB da task que falhou e o resumo JSON, gerados enquanto a imagem ainda
+ * estava na partição de coredump), seguido da imagem. O cabeçalho é gravado por último;
+ * enviado, o slot é marcado zerando a palavra de estado, sem apagar o setor.
+ */
+
+// Maior resumo JSON guardado por slot (o de coredump_uploader_summary_json() cabe em 512)
+#define COREDUMP_SPOOL_SUMMARY_MAX 512
+
+/**
+ * @brief Imagem pendente no spool.
+ */
+typedef struct {
+    uint32_t seq;               // Ordem de chegada (cresce a cada imagem copiada)
+    size_t slot;                // Índice do slot no anel
+    size_t flash_addr;          // Início da imagem na flash
+    size_t size;                // Tamanho da imagem
+    uint32_t image_crc;         // Últimos 4 bytes da imagem (o "id" do upload)
+    uint32_t reset_reason;      // esp_reset_reason() do boot que copiou a imagem
+    uint32_t uptime_s;          // Segundos desde o boot na cópia (o firmware não acerta o relógio)
+    uint32_t crashed_tcb;       // TCB da task que falhou (0 = desconhecido)
+    bool has_fingerprint;       // 'fingerprint' disponível (CONFIG_COREDUMP_UPLOADER_DEDUP)
+    uint32_t fingerprint;
+    char summary[COREDUMP_SPOOL_SUMMARY_MAX]; // Resumo JSON ("" = indisponível)
+} coredump_spool_entry_t;
+
+/**
+ * @brief Move a imagem da partição de coredump para o spool.
+ *
+ * A cópia é conferida por CRC32 antes de o cabeçalho ser gravado, e só então a partição
+ * de coredump é apagada. Uma imagem já copiada (queda de energia entre a cópia e o
+ * apagamento) não é duplicada. Deve rodar sem imagem selecionada no uploader.
+ *
+ * @return ESP_OK se a imagem foi copiada (ou já estava no spool).
+ * @return ESP_ERR_NOT_FOUND sem imagem válida ou sem a partição do spool.
+ * @return ESP_ERR_NO_MEM se todos os slots estiverem pendentes: a imagem fica na partição de coredump.
+ * @return ESP_ERR_INVALID_SIZE se a imagem não couber num slot (idem).
+ */
+esp_err_t coredump_spool_ingest(void);
+
+/**
+ * @brief Quantidade de imagens aguardando envio.
+ */
+size_t coredump_spool_pending(void);
+
+/**
+ * @brief Obtém a imagem pendente mais antiga.
+ *
+ * @return ESP_OK, ou ESP_ERR_NOT_FOUND se o spool estiver vazio.
+ */
+esp_err_t coredump_spool_next(coredump_spool_entry_t *out);
+
+/**
+ * @brief Seleciona 'entry' no uploader (coredump_uploader_select_image()).
+ *
+ * Enviada ou descartada pelo uploader, a imagem é marcada como enviada. 'entry' deve
+ * permanecer válida até coredump_uploader_select_image(NULL).
+ */
+esp_err_t coredump_spool_select(const coredump_spool_entry_t *entry);
+
+/**
+ * @brief Marca o slot de 'entry' como enviado, liberando-o para uma nova imagem.
+ */
+esp_err_t coredump_spool_release(const coredump_spool_entry_t *entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COREDUMP_SPOOL_H
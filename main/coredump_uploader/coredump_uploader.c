@@ -1,16 +1,91 @@
 #include "coredump_uploader.h"
+#include "coredump_capture.h"
+#include "coredump_deflate.h"
 #include "esp_core_dump.h"
 #include "esp_flash.h"
 #include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
 #include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "mbedtls/base64.h"
+#include "mbedtls/sha256.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 // Tamanho default de chunk (múltiplo de 3 para evitar padding interno em Base64)
 #define COREDUMP_DEFAULT_CHUNK_SIZE (3 * 256) // 768 bytes
 
+// Quantidade de slots (buffers de chunk) usados por um upload
+#if CONFIG_COREDUMP_UPLOADER_PIPELINE
+#define PIPELINE_DEPTH CONFIG_COREDUMP_UPLOADER_PIPELINE_DEPTH
+#else
+#define PIPELINE_DEPTH 1
+#endif
+
+// Orçamentos de banda e de CPU aplicados entre as partes
+#define UPLOAD_PACING (CONFIG_COREDUMP_UPLOADER_RATE_LIMIT > 0 || CONFIG_COREDUMP_UPLOADER_CPU_BUDGET < 100)
+
 static const char *TAG = "COREDUMP_UPLOADER";
 
+// Progresso do último coredump_upload(), exposto pelo status do serviço. Escrito e lido sob
+// s_status_lock, junto com o estado do serviço, para que a leitura do status seja consistente.
+static portMUX_TYPE s_status_lock = portMUX_INITIALIZER_UNLOCKED;
+static size_t s_stream_size;
+static size_t s_stream_sent;
+
+#if CONFIG_COREDUMP_UPLOADER_STATS
+// Contadores do coredump_upload() em andamento ou do último. Leitura e codificação são escritas
+// pela task produtora; publicação e uso de memória, pela chamadora.
+static coredump_uploader_stats_t s_stats;
+
+// Acumula a duração de uma etapa no total e no pior caso por parte
+static inline void _stat_add(uint64_t *total_us, uint32_t *max_us, int64_t us) {
+    *total_us += (uint64_t)us;
+    if ((uint64_t)us > *max_us)
+        *max_us = (uint32_t)us;
+}
+
+static inline void _stat_work_used(size_t used) {
+    if (used > s_stats.peak_work_bytes)
+        s_stats.peak_work_bytes = used;
+}
+#endif
+
+// Imagem fora da partição de coredump, selecionada com coredump_uploader_select_image() (size 0 = nenhuma)
+static coredump_uploader_image_t s_image;
+
+#if CONFIG_COREDUMP_UPLOADER_METRICS
+// Marcos do último get_info() e dos uploads seguintes; as etapas somam as estatísticas de cada tentativa
+static coredump_uploader_metrics_t s_metrics;
+#endif
+
+#if CONFIG_COREDUMP_UPLOADER_RESUME
+// Checkpoint de progresso em NVS
+#define CHECKPOINT_NVS_NAMESPACE "cd_upload"
+#define CHECKPOINT_NVS_KEY "ckpt"
+
+// Identifica a imagem e o fluxo aos quais o progresso se refere
+typedef struct {
+    uint32_t image_crc;
+    uint32_t stream_size;
+    uint8_t use_base64;
+    uint8_t compressed;
+    uint8_t ordered;         // Prefixo da task que falhou primeiro (ocupa o preenchimento: 0 em checkpoints antigos)
+    uint32_t next_chunk;     // Partes confirmadas pelo receptor
+    uint32_t stream_offset;  // Bytes do fluxo confirmados pelo receptor
+} upload_checkpoint_t;
+#endif
+
 bool coredump_uploader_need_upload(void) {
     esp_reset_reason_t reason = esp_reset_reason();
     ESP_LOGI(TAG, "Reset reason: %d", reason);
@@ -32,53 +107,1504 @@ bool coredump_uploader_need_upload(void) {
     }
 }
 
+esp_err_t coredump_uploader_summary_json(char *buf, size_t size, size_t *out_len) {
+#if CONFIG_COREDUMP_UPLOADER_SUMMARY
+    if (!buf || size == 0)
+        return ESP_ERR_INVALID_ARG;
+    if (s_image.size) {
+        // Cópia: o resumo foi gerado quando a imagem ainda estava na partição de coredump
+        if (!s_image.summary_json)
+            return ESP_ERR_NOT_FOUND;
+        size_t len = strlen(s_image.summary_json);
+        if (len >= size)
+            return ESP_ERR_INVALID_SIZE;
+        memcpy(buf, s_image.summary_json, len + 1);
+        if (out_len)
+            *out_len = len;
+        return ESP_OK;
+    }
+    esp_core_dump_summary_t summary;
+    esp_err_t err = esp_core_dump_get_summary(&summary);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Resumo do coredump indisponível (%s)", esp_err_to_name(err));
+        return err;
+    }
+
+    // O nome da task vai entre aspas no JSON: troca caracteres que precisariam de escape
+    char task[sizeof(summary.exc_task) + 1];
+    snprintf(task, sizeof(task), "%.*s", (int)sizeof(summary.exc_task), summary.exc_task);
+    for (char *c = task; *c; ++c) {
+        if (*c == '"' || *c == '\\' || (unsigned char)*c < 0x20)
+            *c = '_';
+    }
+#if CONFIG_IDF_TARGET_ARCH_XTENSA
+    uint32_t cause = summary.ex_info.exc_cause;
+    uint32_t vaddr = summary.ex_info.exc_vaddr;
+#else
+    uint32_t cause = summary.ex_info.mcause;
+    uint32_t vaddr = summary.ex_info.mtval;
+#endif
+
+    size_t n = (size_t)snprintf(buf, size, "{\"task\":\"%s\",\"pc\":\"0x%08" PRIx32 "\",\"cause\":%" PRIu32 ",\"vaddr\":\"0x%08" PRIx32 "\",\"bt\":[",
+                                task, summary.exc_pc, cause, vaddr);
+    uint32_t depth = summary.exc_bt_info.depth;
+    if (depth > sizeof(summary.exc_bt_info.bt) / sizeof(summary.exc_bt_info.bt[0]))
+        depth = sizeof(summary.exc_bt_info.bt) / sizeof(summary.exc_bt_info.bt[0]);
+    for (uint32_t i = 0; i < depth && n < size; ++i)
+        n += (size_t)snprintf(buf + n, size - n, "%s\"0x%08" PRIx32 "\"", i ? "," : "", summary.exc_bt_info.bt[i]);
+    if (n < size)
+        n += (size_t)snprintf(buf + n, size - n, "],\"bt_corrupted\":%s,\"elf\":\"%.*s\"", summary.exc_bt_info.corrupted ? "true" : "false",
+                              (int)sizeof(summary.app_elf_sha256), (const char *)summary.app_elf_sha256);
+    // O que a captura reduzida deixou de fora da imagem (CONFIG_COREDUMP_UPLOADER_CAPTURE_FILTER)
+    coredump_capture_stats_t trim;
+    if (n < size && coredump_capture_last(&trim) == ESP_OK)
+        n += (size_t)snprintf(buf + n, size - n, ",\"trim\":{\"tasks\":%u,\"dropped\":%u,\"capped\":%u,\"saved\":%" PRIu32 "}",
+                              (unsigned)trim.tasks, (unsigned)trim.dropped, (unsigned)trim.capped, trim.saved_bytes);
+    if (n < size)
+        n += (size_t)snprintf(buf + n, size - n, "}");
+    if (n >= size)
+        return ESP_ERR_INVALID_SIZE;
+    if (out_len)
+        *out_len = n;
+    return ESP_OK;
+#else
+    (void)buf;
+    (void)size;
+    (void)out_len;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
 // Função interna para calcular tamanhos Base64 de um bloco
 static inline size_t _b64_encoded_size(size_t in_len) {
     return ((in_len + 2) / 3) * 4; // Sem considerar terminador NUL
 }
 
+// Garante múltiplo de 3 se usar Base64 para minimizar padding interno
+static size_t _align_chunk(size_t chunk, bool use_base64) {
+    if (use_base64 && (chunk % 3) != 0) {
+        chunk -= (chunk % 3); // arredonda para baixo
+        if (chunk == 0)
+            chunk = 3; // mínimo válido
+    }
+    return chunk;
+}
+
+// Preenche chunk_count/last_chunk_size e tamanhos Base64 para um fluxo particionado em 'chunk'
+static void _fill_layout(coredump_uploader_info_t *out, size_t chunk, size_t chunk_count, size_t last_chunk_size) {
+    out->chunk_size = chunk;
+    out->chunk_count = chunk_count;
+    out->last_chunk_size = last_chunk_size;
+    if (out->use_base64) {
+        size_t stream_size = out->compressed_size;
+        out->b64_chunk_size = _b64_encoded_size(chunk);
+        out->b64_last_chunk_size = _b64_encoded_size(last_chunk_size);
+        // Todas as partes exceto a última têm múltiplos de 3 bytes: sem padding interno
+        out->b64_total_size = ((stream_size - last_chunk_size) / 3) * 4 + out->b64_last_chunk_size;
+    }
+}
+
+// --- Memória de trabalho ---
+
+#if CONFIG_COREDUMP_UPLOADER_STATIC_ARENA
+// Arena estática: alocação sequencial, liberada por inteiro a cada get_info/upload. Após um
+// panic o heap costuma estar fragmentado pela inicialização de Wi-Fi/TLS; com a arena o
+// caminho de upload não depende dele.
+#define ARENA_ALIGN(n) (((n) + 7) & ~(size_t)7)
+static uint8_t s_arena[CONFIG_COREDUMP_UPLOADER_ARENA_SIZE] __attribute__((aligned(8)));
+static size_t s_arena_used;
+
+static void *_work_alloc(size_t size) {
+    size = ARENA_ALIGN(size);
+    if (size > sizeof(s_arena) - s_arena_used)
+        return NULL;
+    void *ptr = s_arena + s_arena_used;
+    s_arena_used += size;
+#if CONFIG_COREDUMP_UPLOADER_STATS
+    _stat_work_used(s_arena_used);
+#endif
+    return ptr;
+}
+
+static inline void _work_free(void *ptr) { (void)ptr; }
+
+static inline void _work_reset(void) { s_arena_used = 0; }
+#else
+#if CONFIG_COREDUMP_UPLOADER_STATS
+// Soma das alocações desde _work_reset(): dentro de um upload nada é liberado antes do fim
+static size_t s_work_used;
+
+static void *_work_alloc(size_t size) {
+    void *ptr = malloc(size);
+    if (ptr) {
+        s_work_used += size;
+        _stat_work_used(s_work_used);
+    }
+    return ptr;
+}
+
+static inline void _work_reset(void) { s_work_used = 0; }
+#else
+static inline void *_work_alloc(size_t size) { return malloc(size); }
+
+static inline void _work_reset(void) {}
+#endif
+
+static inline void _work_free(void *ptr) { free(ptr); }
+#endif
+
+// --- Origem dos bytes da imagem ---
+
+// Ordem de envio: trechos da imagem concatenados para formar o fluxo bruto. Cabeçalhos, segmentos
+// do prefixo e os intervalos restantes entre eles: no máximo 2 trechos por segmento do prefixo + 2.
+#define SEGMENT_MAP_MAX (2 * COREDUMP_UPLOADER_MAX_FIRST_SEGMENTS + 2)
+
+typedef struct {
+    size_t offset;  // Posição do trecho na imagem
+    size_t len;     // Tamanho do trecho
+} image_extent_t;
+
+typedef struct {
+    image_extent_t extents[SEGMENT_MAP_MAX];
+    size_t count;
+} segment_map_t;
+
+// Leitura da imagem na flash: cópia via esp_flash_read ou, com CONFIG_COREDUMP_UPLOADER_MMAP,
+// ponteiros diretos para uma janela da partição de coredump mapeada em memória. Os offsets
+// recebidos são do fluxo bruto; com 'map', são convertidos em posições da imagem.
+typedef struct {
+    size_t flash_addr;                      // Início do coredump na flash
+    size_t size;                            // Tamanho da imagem
+    const segment_map_t *map;               // Ordem de envio (NULL = ordem da flash)
+#if CONFIG_COREDUMP_UPLOADER_MMAP
+    const esp_partition_t *part;            // Partição de coredump (NULL = usar esp_flash_read)
+    size_t part_offset;                     // Posição da imagem dentro da partição
+    esp_partition_mmap_handle_t handle;     // Janela mapeada atual
+    const uint8_t *win_ptr;                 // Ponteiro para o início da janela (NULL = nada mapeado)
+    size_t win_offset;                      // Posição da janela na imagem
+    size_t win_len;                         // Tamanho da janela
+#endif
+} image_source_t;
+
+static void _source_init(image_source_t *src, size_t flash_addr, size_t size) {
+    memset(src, 0, sizeof(*src));
+    src->flash_addr = flash_addr;
+    src->size = size;
+#if CONFIG_COREDUMP_UPLOADER_MMAP
+    const esp_partition_t *part = s_image.size ? s_image.partition
+                                               : esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_COREDUMP, NULL);
+    if (part && flash_addr >= part->address && flash_addr + size <= part->address + part->size) {
+        src->part = part;
+        src->part_offset = flash_addr - part->address;
+    } else {
+        ESP_LOGW(TAG, "Partição de coredump não encontrada, lendo com esp_flash_read.");
+    }
+#endif
+}
+
+static void _source_release(image_source_t *src) {
+#if CONFIG_COREDUMP_UPLOADER_MMAP
+    if (src->win_ptr) {
+        esp_partition_munmap(src->handle);
+        src->win_ptr = NULL;
+    }
+#else
+    (void)src;
+#endif
+}
+
+// Indica se _source_view() está disponível (imagem mapeável)
+static inline bool _source_mapped(const image_source_t *src) {
+#if CONFIG_COREDUMP_UPLOADER_MMAP
+    return src->part != NULL;
+#else
+    (void)src;
+    return false;
+#endif
+}
+
+// Converte a posição 'offset' do fluxo bruto na posição da imagem; '*run' recebe quantos bytes
+// seguem contíguos na imagem a partir dela
+static size_t _source_locate(const image_source_t *src, size_t offset, size_t *run) {
+    if (src->map) {
+        for (size_t i = 0; i < src->map->count; ++i) {
+            const image_extent_t *e = &src->map->extents[i];
+            if (offset < e->len) {
+                *run = e->len - offset;
+                return e->offset + offset;
+            }
+            offset -= e->len;
+        }
+        *run = 0;
+        return src->size;
+    }
+    *run = src->size > offset ? src->size - offset : 0;
+    return offset;
+}
+
+#if CONFIG_COREDUMP_UPLOADER_MMAP
+// Retorna em '*out' um ponteiro para [offset, offset + len) do fluxo bruto, remapeando a janela
+// se necessário. O trecho deve ser contíguo na imagem. O ponteiro vale até a próxima chamada
+// (ou _source_release()).
+static esp_err_t _source_view(image_source_t *src, size_t offset, size_t len, const uint8_t **out) {
+    size_t run;
+    offset = _source_locate(src, offset, &run);
+    if (len > run)
+        return ESP_ERR_INVALID_SIZE;
+    if (!src->win_ptr || offset < src->win_offset || offset + len > src->win_offset + src->win_len) {
+        _source_release(src);
+        size_t win_len = src->size - offset;
+        if (win_len > CONFIG_COREDUMP_UPLOADER_MMAP_WINDOW_SIZE)
+            win_len = CONFIG_COREDUMP_UPLOADER_MMAP_WINDOW_SIZE;
+        if (len > win_len)
+            return ESP_ERR_INVALID_SIZE;
+        const void *ptr = NULL;
+        esp_err_t err = esp_partition_mmap(src->part, src->part_offset + offset, win_len, ESP_PARTITION_MMAP_DATA, &ptr, &src->handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Falha ao mapear coredump (offset %u, %s)", (unsigned)offset, esp_err_to_name(err));
+            return err;
+        }
+        src->win_ptr = ptr;
+        src->win_offset = offset;
+        src->win_len = win_len;
+    }
+    *out = src->win_ptr + (offset - src->win_offset);
+    return ESP_OK;
+}
+#endif
+
+// Copia [offset, offset + len) do fluxo bruto para 'dst', um trecho contíguo da imagem por vez
+static esp_err_t _source_read(image_source_t *src, size_t offset, void *dst, size_t len) {
+    uint8_t *out = dst;
+    while (len > 0) {
+        size_t run;
+        size_t pos = _source_locate(src, offset, &run);
+        if (run == 0)
+            return ESP_ERR_INVALID_SIZE;
+        if (run > len)
+            run = len;
+        esp_err_t err;
+#if CONFIG_COREDUMP_UPLOADER_MMAP
+        if (src->part) {
+            const uint8_t *ptr;
+            err = _source_view(src, offset, run, &ptr);
+            if (err == ESP_OK)
+                memcpy(out, ptr, run);
+        } else
+#endif
+        {
+            err = esp_flash_read(esp_flash_default_chip, out, src->flash_addr + pos, run);
+            if (err != ESP_OK)
+                ESP_LOGE(TAG, "Falha ao ler coredump (offset %u)", (unsigned)pos);
+        }
+        if (err != ESP_OK)
+            return err;
+        offset += run;
+        out += run;
+        len -= run;
+    }
+    return ESP_OK;
+}
+
+#if CONFIG_COREDUMP_UPLOADER_CRASH_TASK_FIRST
+// --- Ordem de envio: segmentos da task que falhou primeiro ---
+
+// Cabeçalhos ELF32 (o esp_core_dump grava ELF de 32 bits, little-endian)
+typedef struct {
+    uint8_t ident[16];
+    uint16_t type;
+    uint16_t machine;
+    uint32_t version;
+    uint32_t entry;
+    uint32_t phoff;
+    uint32_t shoff;
+    uint32_t flags;
+    uint16_t ehsize;
+    uint16_t phentsize;
+    uint16_t phnum;
+    uint16_t shentsize;
+    uint16_t shnum;
+    uint16_t shstrndx;
+} elf32_ehdr_t;
+
+typedef struct {
+    uint32_t type;
+    uint32_t offset;
+    uint32_t vaddr;
+    uint32_t paddr;
+    uint32_t filesz;
+    uint32_t memsz;
+    uint32_t flags;
+    uint32_t align;
+} elf32_phdr_t;
+
+#define ELF_PT_LOAD 1
+#define ELF_PT_NOTE 4
+#define ELF_CLASS32 1
+// O ELF começa logo após o cabeçalho do esp_core_dump, que varia com a versão do formato
+#define ELF_SEARCH_LIMIT 64
+
+// Localiza o ELF na imagem; '*out_header_end' recebe o fim da tabela de program headers
+static esp_err_t _elf_locate(image_source_t *src, size_t *out_elf, elf32_ehdr_t *ehdr, size_t *out_header_end) {
+    uint8_t head[ELF_SEARCH_LIMIT];
+    size_t n = src->size < sizeof(head) ? src->size : sizeof(head);
+    esp_err_t err = _source_read(src, 0, head, n);
+    if (err != ESP_OK)
+        return err;
+    for (size_t off = 0; off + 4 <= n; off += 4) {
+        if (memcmp(head + off, "\x7f" "ELF", 4) != 0)
+            continue;
+        if (off + sizeof(*ehdr) > src->size)
+            break;
+        err = _source_read(src, off, ehdr, sizeof(*ehdr));
+        if (err != ESP_OK)
+            return err;
+        size_t header_end = off + ehdr->phoff + (size_t)ehdr->phnum * ehdr->phentsize;
+        if (ehdr->ident[4] != ELF_CLASS32 || ehdr->phentsize != sizeof(elf32_phdr_t) || ehdr->phnum == 0 ||
+            ehdr->phoff < sizeof(*ehdr) || header_end > src->size)
+            break;
+        *out_elf = off;
+        *out_header_end = header_end;
+        return ESP_OK;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+// Escolhe os segmentos do prefixo: notas (registradores de todas as tasks e informações da falha),
+// TCB da task que falhou e a pilha, gravada pelo esp_core_dump logo após o TCB
+static esp_err_t _segment_plan(image_source_t *src, coredump_uploader_info_t *info) {
+    size_t elf, header_end;
+    elf32_ehdr_t ehdr;
+    esp_err_t err = _elf_locate(src, &elf, &ehdr, &header_end);
+    if (err != ESP_OK)
+        return err;
+    esp_core_dump_summary_t summary;
+    uint32_t crashed_tcb = 0;
+    if (s_image.size)
+        crashed_tcb = s_image.crashed_tcb;
+    else if (esp_core_dump_get_summary(&summary) == ESP_OK)
+        crashed_tcb = summary.exc_tcb;
+    if (!crashed_tcb)
+        ESP_LOGW(TAG, "Resumo indisponível: prefixo apenas com as notas.");
+
+    size_t prefix = header_end, last_end = header_end;
+    bool take_next_load = false;
+    info->first_count = 0;
+    for (uint16_t i = 0; i < ehdr.phnum && info->first_count < COREDUMP_UPLOADER_MAX_FIRST_SEGMENTS; ++i) {
+        elf32_phdr_t ph;
+        err = _source_read(src, elf + ehdr.phoff + (size_t)i * sizeof(ph), &ph, sizeof(ph));
+        if (err != ESP_OK)
+            return err;
+        bool wanted = ph.type == ELF_PT_NOTE;
+        if (ph.type == ELF_PT_LOAD) {
+            wanted = take_next_load || (crashed_tcb && ph.vaddr == crashed_tcb);
+            take_next_load = !take_next_load && wanted;
+        }
+        if (!wanted || ph.filesz == 0)
+            continue;
+        size_t start = elf + ph.offset;
+        // Segmentos fora de ordem ou sobrepostos: o prefixo não seria reconstruível
+        if (start < last_end || start + ph.filesz > src->size)
+            return ESP_ERR_INVALID_STATE;
+        last_end = start + ph.filesz;
+        prefix += ph.filesz;
+        info->first_segments[info->first_count++] = i;
+    }
+    if (info->first_count == 0)
+        return ESP_ERR_NOT_FOUND;
+    info->prefix_size = prefix;
+    return ESP_OK;
+}
+
+// Monta a ordem de envio descrita em 'info': cabeçalhos, segmentos do prefixo e os intervalos
+// restantes da imagem, na ordem da flash
+static esp_err_t _segment_map(image_source_t *src, const coredump_uploader_info_t *info, segment_map_t *map) {
+    size_t elf, header_end;
+    elf32_ehdr_t ehdr;
+    map->count = 0;
+    esp_err_t err = _elf_locate(src, &elf, &ehdr, &header_end);
+    if (err != ESP_OK)
+        return err;
+    image_extent_t segments[COREDUMP_UPLOADER_MAX_FIRST_SEGMENTS];
+    size_t prefix = header_end;
+    map->extents[map->count++] = (image_extent_t){.offset = 0, .len = header_end};
+    for (size_t i = 0; i < info->first_count; ++i) {
+        elf32_phdr_t ph;
+        if (info->first_segments[i] >= ehdr.phnum)
+            return ESP_ERR_INVALID_STATE;
+        err = _source_read(src, elf + ehdr.phoff + (size_t)info->first_segments[i] * sizeof(ph), &ph, sizeof(ph));
+        if (err != ESP_OK)
+            return err;
+        segments[i] = (image_extent_t){.offset = elf + ph.offset, .len = ph.filesz};
+        map->extents[map->count++] = segments[i];
+        prefix += ph.filesz;
+    }
+    if (prefix != info->prefix_size)
+        return ESP_ERR_INVALID_STATE; // Imagem alterada desde get_info
+    // _segment_plan() garante segmentos em ordem crescente e sem sobreposição
+    size_t cursor = header_end;
+    for (size_t i = 0; i < info->first_count; ++i) {
+        if (segments[i].offset > cursor)
+            map->extents[map->count++] = (image_extent_t){.offset = cursor, .len = segments[i].offset - cursor};
+        cursor = segments[i].offset + segments[i].len;
+    }
+    if (cursor < src->size)
+        map->extents[map->count++] = (image_extent_t){.offset = cursor, .len = src->size - cursor};
+    return ESP_OK;
+}
+#endif // CONFIG_COREDUMP_UPLOADER_CRASH_TASK_FIRST
+
+#if !CONFIG_COREDUMP_UPLOADER_COMPRESSION
+// CRC32 da imagem inteira na ordem de envio, lida em blocos (sem o compressor não há outra
+// leitura completa)
+static esp_err_t _image_digest(size_t flash_addr, size_t size, const segment_map_t *map, uint32_t *out_digest) {
+    image_source_t src;
+    _source_init(&src, flash_addr, size);
+    src.map = map;
+    uint8_t block[256];
+    uint32_t crc = 0;
+    esp_err_t err = ESP_OK;
+    for (size_t offset = 0; offset < size && err == ESP_OK;) {
+        size_t n = size - offset;
+        if (n > sizeof(block))
+            n = sizeof(block);
+        err = _source_read(&src, offset, block, n);
+        crc = esp_rom_crc32_le(crc, block, n);
+        offset += n;
+    }
+    _source_release(&src);
+    *out_digest = crc;
+    return err;
+}
+#endif
+
+#if CONFIG_COREDUMP_UPLOADER_COMPRESSION
+// Fluxo comprimido: lê a imagem em blocos, comprime e entrega os bytes sob demanda. Com prefixo,
+// o fluxo deflate termina no fim dele e o restante recomeça num fluxo novo, sem histórico: o
+// receptor descomprime o prefixo sem esperar o resto.
+typedef struct {
+    coredump_deflate_t deflate;
+    uint8_t in[COREDUMP_DEFLATE_BLOCK_SIZE];  // Usado apenas sem mapeamento
+    uint8_t pending[COREDUMP_DEFLATE_MAX_OUTPUT(COREDUMP_DEFLATE_BLOCK_SIZE)];
+    size_t pending_len;   // Bytes comprimidos disponíveis em 'pending'
+    size_t pending_pos;   // Bytes de 'pending' já entregues
+    image_source_t *src;  // Origem dos bytes brutos
+    size_t raw_size;      // Tamanho bruto do coredump
+    size_t raw_offset;    // Bytes brutos já comprimidos
+    uint32_t raw_crc;     // CRC32 dos bytes brutos já comprimidos
+    size_t member_end;    // Fim (bruto) do fluxo deflate atual: prefixo ou imagem inteira
+    size_t produced;      // Bytes comprimidos gerados
+    size_t prefix_out;    // Bytes comprimidos até o fim do prefixo (0 = ainda não chegou)
+} deflate_stream_t;
+
+static void _stream_init(deflate_stream_t *s, image_source_t *src, size_t prefix_size) {
+    coredump_deflate_init(&s->deflate);
+    s->pending_len = 0;
+    s->pending_pos = 0;
+    s->src = src;
+    s->raw_size = src->size;
+    s->raw_offset = 0;
+    s->raw_crc = 0;
+    s->member_end = (prefix_size > 0 && prefix_size < src->size) ? prefix_size : src->size;
+    s->produced = 0;
+    s->prefix_out = 0;
+}
+
+// Copia até 'want' bytes do fluxo comprimido para 'dst' (NULL apenas contabiliza).
+// '*got' só fica menor que 'want' ao atingir o fim do fluxo.
+static esp_err_t _stream_read(deflate_stream_t *s, uint8_t *dst, size_t want, size_t *got) {
+    size_t filled = 0;
+    while (filled < want) {
+        if (s->pending_pos < s->pending_len) {
+            size_t n = s->pending_len - s->pending_pos;
+            if (n > want - filled)
+                n = want - filled;
+            if (dst)
+                memcpy(dst + filled, s->pending + s->pending_pos, n);
+            s->pending_pos += n;
+            filled += n;
+            continue;
+        }
+        if (s->deflate.finished) {
+            if (s->raw_offset >= s->raw_size)
+                break;
+            // Fim do prefixo: o restante vai num novo fluxo deflate
+            s->prefix_out = s->produced;
+            s->member_end = s->raw_size;
+            coredump_deflate_init(&s->deflate);
+        }
+        size_t n = s->member_end - s->raw_offset;
+        if (n > COREDUMP_DEFLATE_BLOCK_SIZE)
+            n = COREDUMP_DEFLATE_BLOCK_SIZE;
+        const uint8_t *in = s->in;
+        if (n) {
+            esp_err_t err;
+#if CONFIG_COREDUMP_UPLOADER_STATS
+            int64_t t0 = esp_timer_get_time();
+#endif
+#if CONFIG_COREDUMP_UPLOADER_MMAP
+            // Com mapeamento, o compressor lê direto da janela, sem cópia intermediária. O bloco
+            // termina no fim do trecho contíguo da imagem.
+            if (_source_mapped(s->src)) {
+                size_t run;
+                _source_locate(s->src, s->raw_offset, &run);
+                if (n > run)
+                    n = run;
+                err = n ? _source_view(s->src, s->raw_offset, n, &in) : ESP_ERR_INVALID_SIZE;
+            } else
+#endif
+                err = _source_read(s->src, s->raw_offset, s->in, n);
+#if CONFIG_COREDUMP_UPLOADER_STATS
+            s_stats.read_us += (uint64_t)(esp_timer_get_time() - t0);
+            s_stats.bytes_read += n;
+#endif
+            if (err != ESP_OK)
+                return err;
+        }
+        s->raw_offset += n;
+        s->raw_crc = esp_rom_crc32_le(s->raw_crc, in, n);
+        s->pending_len = coredump_deflate_block(&s->deflate, in, n, s->raw_offset >= s->member_end, s->pending);
+        s->pending_pos = 0;
+        s->produced += s->pending_len;
+    }
+    *got = filled;
+    return ESP_OK;
+}
+
+// Calcula o tamanho do fluxo comprimido com uma passada completa, sem guardar a saída.
+// Com 'map', '*out_prefix' recebe os bytes comprimidos até o fim dos 'prefix_size' bytes brutos.
+static esp_err_t _compressed_size(size_t flash_addr, size_t raw_size, const segment_map_t *map, size_t prefix_size, size_t *out_size,
+                                  size_t *out_prefix, uint32_t *out_digest) {
+    deflate_stream_t *s = _work_alloc(sizeof(*s));
+    if (!s)
+        return ESP_ERR_NO_MEM;
+    image_source_t src;
+    _source_init(&src, flash_addr, raw_size);
+    src.map = map;
+    _stream_init(s, &src, map ? prefix_size : 0);
+    esp_err_t err = _stream_read(s, NULL, SIZE_MAX, out_size);
+    *out_digest = s->raw_crc;
+    *out_prefix = s->prefix_out;
+    _source_release(&src);
+    _work_free(s);
+    _work_reset();
+    return err;
+}
+#endif // CONFIG_COREDUMP_UPLOADER_COMPRESSION
+
+#if CONFIG_COREDUMP_UPLOADER_STATIC_ARENA
+// Parte fixa da arena: estado do compressor e pilha da task produtora
+#if CONFIG_COREDUMP_UPLOADER_COMPRESSION
+#define ARENA_STREAM_BYTES ARENA_ALIGN(sizeof(deflate_stream_t))
+#else
+#define ARENA_STREAM_BYTES 0
+#endif
+#if CONFIG_COREDUMP_UPLOADER_PIPELINE
+#define ARENA_PRODUCER_BYTES ARENA_ALIGN(CONFIG_COREDUMP_UPLOADER_PRODUCER_STACK_SIZE)
+#else
+#define ARENA_PRODUCER_BYTES 0
+#endif
+#define ARENA_FIXED_BYTES (ARENA_STREAM_BYTES + ARENA_PRODUCER_BYTES)
+
+// A arena precisa comportar ao menos o chunk default em Base64 em todos os slots
+_Static_assert(CONFIG_COREDUMP_UPLOADER_ARENA_SIZE >= ARENA_FIXED_BYTES +
+                   ARENA_ALIGN(PIPELINE_DEPTH * (COREDUMP_DEFAULT_CHUNK_SIZE + ((COREDUMP_DEFAULT_CHUNK_SIZE + 2) / 3) * 4 + 1)),
+               "CONFIG_COREDUMP_UPLOADER_ARENA_SIZE pequena demais para o chunk default");
+
+// Maior chunk cujos buffers (leitura + Base64 em todos os slots) cabem na arena
+static size_t _arena_chunk_limit(bool use_base64) {
+    size_t per_slot = (CONFIG_COREDUMP_UPLOADER_ARENA_SIZE - ARENA_FIXED_BYTES) / PIPELINE_DEPTH;
+    per_slot &= ~(size_t)7; // Folga para o alinhamento da alocação
+    if (!use_base64)
+        return per_slot;
+    // chunk + 4 * chunk / 3 + 1 <= per_slot, com chunk múltiplo de 3
+    return _align_chunk(((per_slot - 1) / 7) * 3, true);
+}
+#endif
+
+// Posição e tamanho da imagem na flash e a soma de verificação gravada no fim dela
+static esp_err_t _image_locate(size_t *addr, size_t *size, uint32_t *image_crc) {
+    esp_err_t err = ESP_OK;
+    if (s_image.size) {
+        *addr = s_image.flash_addr;
+        *size = s_image.size;
+    } else {
+        err = esp_core_dump_image_get(addr, size);
+    }
+    if (err != ESP_OK)
+        return err;
+    if (*size == 0)
+        return ESP_ERR_NOT_FOUND;
+
+    // Últimos 4 bytes da imagem: soma de verificação gravada pelo esp_core_dump
+    err = esp_flash_read(esp_flash_default_chip, image_crc, *addr + *size - sizeof(*image_crc), sizeof(*image_crc));
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "Falha ao ler checksum do coredump (%s)", esp_err_to_name(err));
+    return err;
+}
+
+// Apaga a imagem enviada ou descartada: a partição de coredump ou, para uma cópia, quem a selecionou
+static esp_err_t _image_erase(void) {
+    if (s_image.size)
+        return s_image.release ? s_image.release(s_image.release_arg) : ESP_OK;
+    return esp_core_dump_image_erase();
+}
+
+esp_err_t coredump_uploader_get_index(coredump_uploader_info_t *out) {
+    if (!out)
+        return ESP_ERR_INVALID_ARG;
+    memset(out, 0, sizeof(*out));
+    size_t addr = 0, size = 0;
+    uint32_t image_crc = 0;
+    esp_err_t err = _image_locate(&addr, &size, &image_crc);
+    if (err != ESP_OK)
+        return err;
+#if CONFIG_COREDUMP_UPLOADER_CRASH_TASK_FIRST
+    image_source_t src;
+    _source_init(&src, addr, size);
+    err = _segment_plan(&src, out);
+    _source_release(&src);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Segmentos do ELF não reconhecidos (%s), índice sem prefixo.", esp_err_to_name(err));
+        out->prefix_size = 0;
+        out->first_count = 0;
+    }
+#endif
+    out->flash_addr = addr;
+    out->total_size = size;
+    out->image_crc = image_crc;
+    out->compressed_size = size; // Intervalos servidos na ordem da flash, sem compressão
+    out->prefix_stream_size = out->prefix_size;
+    return ESP_OK;
+}
+
+esp_err_t coredump_uploader_read(const coredump_uploader_info_t *info, size_t offset, void *buf, size_t len) {
+    if (!info || !buf || info->total_size == 0)
+        return ESP_ERR_INVALID_ARG;
+    if (offset > info->total_size || len > info->total_size - offset)
+        return ESP_ERR_INVALID_SIZE;
+    image_source_t src;
+    _source_init(&src, info->flash_addr, info->total_size);
+    esp_err_t err = _source_read(&src, offset, buf, len);
+    _source_release(&src);
+    return err;
+}
+
+esp_err_t coredump_uploader_block_hashes(const coredump_uploader_info_t *info, size_t block_size, uint8_t *out, size_t max_blocks,
+                                        size_t *out_count, uint32_t *out_digest) {
+#if CONFIG_COREDUMP_UPLOADER_BLOCK_DEDUP
+    if (!info || !out || !out_count || block_size == 0 || info->total_size == 0)
+        return ESP_ERR_INVALID_ARG;
+    size_t count = (info->total_size + block_size - 1) / block_size;
+    if (count > max_blocks)
+        return ESP_ERR_INVALID_SIZE;
+    image_source_t src;
+    _source_init(&src, info->flash_addr, info->total_size);
+    uint8_t buf[512];
+    uint8_t digest[32];
+    uint32_t crc = 0;
+    esp_err_t err = ESP_OK;
+    for (size_t b = 0; b < count && err == ESP_OK; ++b) {
+        size_t start = b * block_size;
+        size_t end = start + block_size < info->total_size ? start + block_size : info->total_size;
+        mbedtls_sha256_context sha;
+        mbedtls_sha256_init(&sha);
+        mbedtls_sha256_starts(&sha, 0);
+        for (size_t off = start; off < end; off += sizeof(buf)) {
+            size_t n = end - off < sizeof(buf) ? end - off : sizeof(buf);
+            err = _source_read(&src, off, buf, n);
+            if (err != ESP_OK)
+                break;
+            mbedtls_sha256_update(&sha, buf, n);
+            crc = esp_rom_crc32_le(crc, buf, n);
+        }
+        mbedtls_sha256_finish(&sha, digest);
+        mbedtls_sha256_free(&sha);
+        memcpy(out + b * COREDUMP_UPLOADER_BLOCK_HASH_SIZE, digest, COREDUMP_UPLOADER_BLOCK_HASH_SIZE);
+    }
+    _source_release(&src);
+    if (err != ESP_OK)
+        return err;
+    *out_count = count;
+    if (out_digest)
+        *out_digest = crc;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
 esp_err_t coredump_uploader_get_info(coredump_uploader_info_t *out, size_t desired_chunk_size, bool use_base64) {
     if (!out)
         return ESP_ERR_INVALID_ARG;
     memset(out, 0, sizeof(*out));
+#if CONFIG_COREDUMP_UPLOADER_METRICS
+    int64_t info_start = esp_timer_get_time();
+#endif
 
     size_t addr = 0, size = 0;
-    esp_err_t err = esp_core_dump_image_get(&addr, &size);
+    uint32_t image_crc = 0;
+    esp_err_t err = _image_locate(&addr, &size, &image_crc);
     if (err != ESP_OK)
         return err;
-    if (size == 0)
-        return ESP_ERR_NOT_FOUND;
 
-    // Ajuste de chunk size
-    size_t chunk = desired_chunk_size ? desired_chunk_size : COREDUMP_DEFAULT_CHUNK_SIZE;
-    // Garante múltiplo de 3 se usar Base64 para minimizar padding interno
-    if (use_base64 && (chunk % 3) != 0) {
-        chunk -= (chunk % 3); // arredonda para baixo
-        if (chunk == 0)
-            chunk = 3; // mínimo válido
+    // Ordem de envio: sem ELF reconhecível, a imagem segue na ordem da flash
+    const segment_map_t *order = NULL;
+#if CONFIG_COREDUMP_UPLOADER_CRASH_TASK_FIRST
+    segment_map_t map;
+    image_source_t src;
+    _source_init(&src, addr, size);
+    err = _segment_plan(&src, out);
+    if (err == ESP_OK)
+        err = _segment_map(&src, out, &map);
+    _source_release(&src);
+    if (err == ESP_OK) {
+        order = &map;
+        ESP_LOGI(TAG, "Prefixo com %u segmentos: %u de %u bytes", (unsigned)out->first_count, (unsigned)out->prefix_size, (unsigned)size);
+    } else {
+        ESP_LOGW(TAG, "Segmentos do ELF não reconhecidos (%s), enviando na ordem da flash.", esp_err_to_name(err));
+        out->prefix_size = 0;
+        out->first_count = 0;
     }
+#endif
 
-    size_t chunk_count = (size + chunk - 1) / chunk;
-    size_t last_chunk_size = (size % chunk) ? (size % chunk) : chunk;
+    // Fluxo efetivamente transmitido (antes do Base64): bruto ou comprimido
+    size_t stream_size = size;
+    size_t prefix_stream_size = order ? out->prefix_size : 0;
+    bool compressed = false;
+    uint32_t digest = 0;
+#if CONFIG_COREDUMP_UPLOADER_COMPRESSION
+    size_t comp_size = 0, comp_prefix = 0;
+    err = _compressed_size(addr, size, order, out->prefix_size, &comp_size, &comp_prefix, &digest);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Falha ao calcular tamanho comprimido (%s)", esp_err_to_name(err));
+        return err;
+    }
+    // Só compensa comprimir se o fluxo diminuir
+    if (comp_size < size) {
+        stream_size = comp_size;
+        compressed = true;
+        if (order)
+            prefix_stream_size = comp_prefix;
+    }
+#else
+    err = _image_digest(addr, size, order, &digest);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Falha ao calcular digest do coredump (%s)", esp_err_to_name(err));
+        return err;
+    }
+#endif
+
+    // Ajuste de chunk size
+    size_t chunk = _align_chunk(desired_chunk_size ? desired_chunk_size : COREDUMP_DEFAULT_CHUNK_SIZE, use_base64);
+#if CONFIG_COREDUMP_UPLOADER_STATIC_ARENA
+    size_t arena_limit = _arena_chunk_limit(use_base64);
+    if (chunk > arena_limit) {
+        ESP_LOGW(TAG, "Chunk limitado a %u bytes pela arena (pedido %u)", (unsigned)arena_limit, (unsigned)chunk);
+        chunk = arena_limit;
+    }
+#endif
 
     out->flash_addr = addr;
     out->total_size = size;
-    out->chunk_size = chunk;
-    out->chunk_count = chunk_count;
-    out->last_chunk_size = last_chunk_size;
+    out->image_crc = image_crc;
+    out->image_digest = digest;
+    out->compressed = compressed;
+    out->compressed_size = stream_size;
+    out->prefix_stream_size = prefix_stream_size;
     out->use_base64 = use_base64;
+#if CONFIG_COREDUMP_UPLOADER_ADAPTIVE_CHUNK
+    // Começa pelo maior chunk aceito pelo transporte e ajusta durante o envio
+    out->adaptive = true;
+    out->max_chunk_size = chunk;
+    out->min_chunk_size = _align_chunk(CONFIG_COREDUMP_UPLOADER_ADAPTIVE_MIN_CHUNK, use_base64);
+    if (out->min_chunk_size > chunk)
+        out->min_chunk_size = chunk;
+#else
+    out->max_chunk_size = chunk;
+    out->min_chunk_size = chunk;
+#endif
 
-    if (use_base64) {
-        out->b64_chunk_size = _b64_encoded_size(chunk);
-        out->b64_last_chunk_size = _b64_encoded_size(last_chunk_size);
-        out->b64_total_size = (chunk_count > 1) ? (out->b64_chunk_size * (chunk_count - 1) + out->b64_last_chunk_size) : out->b64_last_chunk_size;
+    size_t chunk_count = (stream_size + chunk - 1) / chunk;
+    size_t last_chunk_size = (stream_size % chunk) ? (stream_size % chunk) : chunk;
+    _fill_layout(out, chunk, chunk_count, last_chunk_size);
+#if CONFIG_COREDUMP_UPLOADER_METRICS
+    // Nova imagem: recomeça a contagem (a passada de compressão fica apenas em info_us)
+    s_metrics = (coredump_uploader_metrics_t){.info_us = (uint32_t)(esp_timer_get_time() - info_start)};
+#endif
+    return ESP_OK;
+}
+
+// --- Checkpoint de progresso ---
+
+// Valida um ponto de retomada para o fluxo descrito em 'info'
+static bool _resume_point_valid(const coredump_uploader_info_t *info, const coredump_uploader_resume_t *point) {
+    size_t stream_size = info->compressed_size;
+    if (point->stream_offset > stream_size)
+        return false;
+    // Em Base64 cada parte (exceto a última) tem múltiplos de 3 bytes
+    if (info->use_base64 && point->stream_offset != stream_size && (point->stream_offset % 3) != 0)
+        return false;
+    // Sem adaptação, as fronteiras das partes são fixas
+    if (!info->adaptive && point->stream_offset != stream_size && point->stream_offset != point->next_chunk * info->chunk_size)
+        return false;
+    return true;
+}
+
+#if CONFIG_COREDUMP_UPLOADER_RESUME
+static void _checkpoint_fill(upload_checkpoint_t *ck, const coredump_uploader_info_t *info, const coredump_uploader_resume_t *point) {
+    memset(ck, 0, sizeof(*ck));
+    ck->image_crc = info->image_crc;
+    ck->stream_size = info->compressed_size;
+    ck->use_base64 = info->use_base64;
+    ck->compressed = info->compressed;
+    ck->ordered = info->prefix_size > 0;
+    ck->next_chunk = point->next_chunk;
+    ck->stream_offset = point->stream_offset;
+}
+
+// Carrega o progresso confirmado para esta imagem/fluxo; retorna false se não houver checkpoint válido
+static bool _checkpoint_load(const coredump_uploader_info_t *info, coredump_uploader_resume_t *point) {
+    nvs_handle_t h;
+    if (nvs_open(CHECKPOINT_NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK)
+        return false;
+    upload_checkpoint_t stored, expected;
+    size_t len = sizeof(stored);
+    esp_err_t err = nvs_get_blob(h, CHECKPOINT_NVS_KEY, &stored, &len);
+    nvs_close(h);
+    if (err != ESP_OK || len != sizeof(stored))
+        return false;
+
+    coredump_uploader_resume_t loaded = {
+        .next_chunk = stored.next_chunk,
+        .stream_offset = stored.stream_offset,
+    };
+    _checkpoint_fill(&expected, info, &loaded);
+    if (memcmp(&stored, &expected, sizeof(stored)) != 0 || !_resume_point_valid(info, &loaded)) {
+        ESP_LOGI(TAG, "Checkpoint de outra imagem/fluxo ignorado.");
+        return false;
+    }
+    *point = loaded;
+    return true;
+}
+
+static void _checkpoint_clear(void) {
+    nvs_handle_t h;
+    if (nvs_open(CHECKPOINT_NVS_NAMESPACE, NVS_READWRITE, &h) != ESP_OK)
+        return;
+    if (nvs_erase_key(h, CHECKPOINT_NVS_KEY) == ESP_OK)
+        nvs_commit(h);
+    nvs_close(h);
+}
+#endif // CONFIG_COREDUMP_UPLOADER_RESUME
+
+esp_err_t coredump_uploader_checkpoint_save(const coredump_uploader_info_t *info, const coredump_uploader_resume_t *point) {
+#if CONFIG_COREDUMP_UPLOADER_RESUME
+    if (!info || !point || !_resume_point_valid(info, point))
+        return ESP_ERR_INVALID_ARG;
+    // Evita gravações repetidas na flash quando o receptor reconfirma o mesmo progresso
+    coredump_uploader_resume_t current;
+    if (_checkpoint_load(info, &current) && current.next_chunk == point->next_chunk && current.stream_offset == point->stream_offset)
+        return ESP_OK;
+
+    upload_checkpoint_t ck;
+    _checkpoint_fill(&ck, info, point);
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(CHECKPOINT_NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK)
+        return err;
+    err = nvs_set_blob(h, CHECKPOINT_NVS_KEY, &ck, sizeof(ck));
+    if (err == ESP_OK)
+        err = nvs_commit(h);
+    nvs_close(h);
+    if (err != ESP_OK)
+        ESP_LOGW(TAG, "Falha ao gravar checkpoint (%s)", esp_err_to_name(err));
+    return err;
+#else
+    (void)info;
+    (void)point;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+#if CONFIG_COREDUMP_UPLOADER_DEDUP
+// Tabela em NVS das impressões digitais enviadas recentemente
+#define DEDUP_NVS_NAMESPACE "cd_dedup"
+#define DEDUP_NVS_KEY "table"
+#define DEDUP_BT_DEPTH 8 // Endereços do backtrace considerados (o topo identifica a falha)
+
+typedef struct {
+    uint32_t fingerprint;
+    uint32_t count;  // Ocorrências registradas
+    uint32_t seq;    // Ordem do último uso (descarte do menos recente)
+} dedup_entry_t;
+#endif
+
+esp_err_t coredump_uploader_fingerprint(uint32_t *out) {
+#if CONFIG_COREDUMP_UPLOADER_DEDUP
+    if (!out)
+        return ESP_ERR_INVALID_ARG;
+    if (s_image.size) {
+        if (!s_image.has_fingerprint)
+            return ESP_ERR_NOT_FOUND;
+        *out = s_image.fingerprint;
+        return ESP_OK;
+    }
+    esp_core_dump_summary_t summary;
+    esp_err_t err = esp_core_dump_get_summary(&summary);
+    if (err != ESP_OK)
+        return err;
+#if CONFIG_IDF_TARGET_ARCH_XTENSA
+    uint32_t cause = summary.ex_info.exc_cause;
+#else
+    uint32_t cause = summary.ex_info.mcause;
+#endif
+    // Firmware (SHA do ELF) + causa + topo do backtrace normalizado
+    uint32_t crc = esp_rom_crc32_le(0, summary.app_elf_sha256, sizeof(summary.app_elf_sha256));
+    crc = esp_rom_crc32_le(crc, (const uint8_t *)&cause, sizeof(cause));
+    uint32_t depth = summary.exc_bt_info.depth;
+    if (depth > DEDUP_BT_DEPTH)
+        depth = DEDUP_BT_DEPTH;
+    for (uint32_t i = 0; i < depth; ++i) {
+        uint32_t addr = summary.exc_bt_info.bt[i];
+#if CONFIG_IDF_TARGET_ARCH_XTENSA
+        // Os 2 bits altos do endereço de retorno guardam o incremento da janela de registradores
+        addr = (addr & 0x3fffffffu) | 0x40000000u;
+#endif
+        crc = esp_rom_crc32_le(crc, (const uint8_t *)&addr, sizeof(addr));
+    }
+    *out = crc;
+    return ESP_OK;
+#else
+    (void)out;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t coredump_uploader_dedup_record(uint32_t fingerprint, uint32_t *out_count, bool *out_full) {
+#if CONFIG_COREDUMP_UPLOADER_DEDUP
+    if (!out_count || !out_full)
+        return ESP_ERR_INVALID_ARG;
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(DEDUP_NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK)
+        return err;
+    dedup_entry_t table[CONFIG_COREDUMP_UPLOADER_DEDUP_TABLE_SIZE] = {0};
+    size_t len = sizeof(table);
+    if (nvs_get_blob(h, DEDUP_NVS_KEY, table, &len) != ESP_OK || len != sizeof(table))
+        memset(table, 0, sizeof(table)); // Ausente ou de outra configuração: recomeça
+
+    // Procura a impressão digital; sem ela, ocupa a entrada vazia ou a menos recente
+    uint32_t seq = 0;
+    size_t slot = 0;
+    bool found = false;
+    for (size_t i = 0; i < CONFIG_COREDUMP_UPLOADER_DEDUP_TABLE_SIZE; ++i) {
+        if (table[i].seq > seq)
+            seq = table[i].seq;
+        if (table[i].count && table[i].fingerprint == fingerprint) {
+            slot = i;
+            found = true;
+        }
+    }
+    if (!found) {
+        for (size_t i = 1; i < CONFIG_COREDUMP_UPLOADER_DEDUP_TABLE_SIZE; ++i) {
+            if (table[i].seq < table[slot].seq)
+                slot = i;
+        }
+        table[slot] = (dedup_entry_t){.fingerprint = fingerprint};
+    }
+    table[slot].count++;
+    table[slot].seq = seq + 1;
+
+    err = nvs_set_blob(h, DEDUP_NVS_KEY, table, sizeof(table));
+    if (err == ESP_OK)
+        err = nvs_commit(h);
+    nvs_close(h);
+    if (err != ESP_OK)
+        ESP_LOGW(TAG, "Falha ao gravar tabela de impressões digitais (%s)", esp_err_to_name(err));
+
+    // Primeira ocorrência e uma a cada CONFIG_COREDUMP_UPLOADER_DEDUP_FULL_EVERY: imagem completa
+    *out_count = table[slot].count;
+    *out_full = ((table[slot].count - 1) % CONFIG_COREDUMP_UPLOADER_DEDUP_FULL_EVERY) == 0;
+    ESP_LOGI(TAG, "Impressão digital %08" PRIx32 ": ocorrência %" PRIu32 "%s", fingerprint, table[slot].count,
+             *out_full ? ", envio completo" : ", apenas contador");
+    return ESP_OK;
+#else
+    (void)fingerprint;
+    (void)out_count;
+    (void)out_full;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t coredump_uploader_discard(void) {
+    esp_err_t err = _image_erase();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Falha ao apagar coredump (%s)", esp_err_to_name(err));
+        return err;
+    }
+#if CONFIG_COREDUMP_UPLOADER_METRICS
+    s_metrics.erase_done_us = esp_timer_get_time();
+#endif
+#if CONFIG_COREDUMP_UPLOADER_RESUME
+    _checkpoint_clear();
+#endif
+    return ESP_OK;
+}
+
+esp_err_t coredump_uploader_select_image(const coredump_uploader_image_t *image) {
+    if (!image) {
+        s_image = (coredump_uploader_image_t){0};
+        return ESP_OK;
+    }
+    if (image->size == 0 || !image->partition)
+        return ESP_ERR_INVALID_ARG;
+    s_image = *image;
+    return ESP_OK;
+}
+
+esp_err_t coredump_uploader_get_stats(coredump_uploader_stats_t *out) {
+    if (!out)
+        return ESP_ERR_INVALID_ARG;
+#if CONFIG_COREDUMP_UPLOADER_STATS
+    *out = s_stats;
+    return ESP_OK;
+#else
+    memset(out, 0, sizeof(*out));
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t coredump_uploader_get_metrics(coredump_uploader_metrics_t *out) {
+    if (!out)
+        return ESP_ERR_INVALID_ARG;
+#if CONFIG_COREDUMP_UPLOADER_METRICS
+    *out = s_metrics;
+    return ESP_OK;
+#else
+    memset(out, 0, sizeof(*out));
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+// --- Preparação e envio de chunks ---
+
+// Buffers de um chunk: dados lidos da flash e (opcionalmente) sua codificação Base64
+typedef struct {
+    uint8_t *raw;         // Buffer de leitura (max_chunk_size bytes) ou NULL se lido direto do mapeamento
+    uint8_t *b64;         // Buffer Base64 (b64_capacity bytes) ou NULL
+    const char *data;     // Ponteiro para os dados prontos para envio
+    size_t len;           // Quantidade de bytes prontos para envio
+    size_t raw_len;       // Bytes do fluxo contidos no slot (antes do Base64)
+    size_t offset;        // Posição do slot no fluxo
+    bool last;            // Slot contém o fim do fluxo
+    esp_err_t err;        // Resultado da preparação do chunk
+} chunk_slot_t;
+
+// Estado de um upload. Campos de leitura pertencem à task produtora; os de envio, à chamadora.
+typedef struct {
+    coredump_uploader_info_t *info;
+    size_t b64_capacity;          // Capacidade do buffer Base64 de cada slot
+    volatile size_t chunk_size;   // Tamanho bruto alvo dos próximos chunks (ajustado no modo adaptativo)
+    size_t read_offset;           // Próximo byte do fluxo a preparar
+    size_t next_part;             // Índice (0-based) da próxima parte a enviar
+    size_t sent_offset;           // Bytes do fluxo já entregues ao 'write'
+    size_t last_part_size;        // Tamanho bruto da última parte enviada
+    unsigned failures;            // Falhas consecutivas de 'write' (modo adaptativo)
+    image_source_t src;           // Origem dos bytes da imagem
+#if CONFIG_COREDUMP_UPLOADER_CRASH_TASK_FIRST
+    segment_map_t map;            // Ordem de envio (src.map aponta para cá se houver prefixo)
+    bool prefix_sent;             // Prefixo entregue: restante com CONFIG_COREDUMP_UPLOADER_REST_PRIORITY
+    UBaseType_t base_priority;    // Prioridade da task chamadora antes da troca
+#endif
+#if UPLOAD_PACING
+    int64_t pace_start_us;        // Início da contagem do orçamento de banda
+    size_t paced_bytes;           // Bytes entregues desde pace_start_us
+    int64_t busy_since_us;        // Início do trecho ativo atual (orçamento de CPU)
+#endif
+#if CONFIG_COREDUMP_UPLOADER_COMPRESSION
+    deflate_stream_t *stream;     // Fluxo comprimido (NULL se info->compressed == false)
+#endif
+} upload_ctx_t;
+
+// Lê o próximo chunk (da flash ou do fluxo comprimido) e, se configurado, codifica em Base64 no próprio slot.
+static esp_err_t _prepare_chunk(upload_ctx_t *ctx, chunk_slot_t *slot) {
+    const coredump_uploader_info_t *info = ctx->info;
+    size_t stream_size = info->compressed_size;
+    size_t offset = ctx->read_offset;
+    size_t bytes_to_read = stream_size - offset;
+    if (bytes_to_read > ctx->chunk_size)
+        bytes_to_read = ctx->chunk_size;
+
+    slot->offset = offset;
+    slot->raw_len = bytes_to_read;
+    slot->last = (offset + bytes_to_read == stream_size);
+    esp_err_t err;
+    const uint8_t *raw = slot->raw;
+#if CONFIG_COREDUMP_UPLOADER_STATS
+    int64_t t0 = esp_timer_get_time();
+    uint64_t read_before = s_stats.read_us;
+    bool streamed = false; // _stream_read() contabiliza a própria leitura da flash
+#endif
+#if CONFIG_COREDUMP_UPLOADER_COMPRESSION
+    if (ctx->stream) {
+        size_t got = 0;
+#if CONFIG_COREDUMP_UPLOADER_STATS
+        streamed = true;
+#endif
+        err = _stream_read(ctx->stream, slot->raw, bytes_to_read, &got);
+        if (err == ESP_OK && got != bytes_to_read) {
+            // O compressor é determinístico: divergência indica imagem alterada desde get_info
+            ESP_LOGE(TAG, "Fluxo comprimido divergente (offset %u: %u de %u bytes)", (unsigned)offset, (unsigned)got, (unsigned)bytes_to_read);
+            err = ESP_ERR_INVALID_SIZE;
+        }
+    } else
+#endif
+#if CONFIG_COREDUMP_UPLOADER_MMAP
+    if (!slot->raw) {
+        // Sem cópia: aponta para a janela mapeada (válida até o próximo chunk)
+        err = _source_view(&ctx->src, offset, bytes_to_read, &raw);
+    } else
+#endif
+    {
+        err = _source_read(&ctx->src, offset, slot->raw, bytes_to_read);
+    }
+#if CONFIG_COREDUMP_UPLOADER_STATS
+    if (!streamed && err == ESP_OK) {
+        s_stats.read_us += (uint64_t)(esp_timer_get_time() - t0);
+        s_stats.bytes_read += bytes_to_read;
+    }
+#endif
+    if (err != ESP_OK)
+        return err;
+    ctx->read_offset += bytes_to_read;
+
+    slot->data = (const char *)raw;
+    slot->len = bytes_to_read;
+    if (info->use_base64) {
+        size_t actual_b64_len = 0;
+        int b64_ret = mbedtls_base64_encode(slot->b64, ctx->b64_capacity, &actual_b64_len, raw, bytes_to_read);
+        if (b64_ret != 0) {
+            ESP_LOGE(TAG, "Base64 falhou (offset %u, mbedtls=-0x%04x)", (unsigned)offset, -b64_ret);
+            return ESP_FAIL;
+        }
+        slot->data = (const char *)slot->b64;
+        slot->len = actual_b64_len;
+    }
+#if CONFIG_COREDUMP_UPLOADER_STATS
+    // Pior leitura por chunk; o restante da etapa é compressão e Base64
+    int64_t read_us = (int64_t)(s_stats.read_us - read_before);
+    if ((uint64_t)read_us > s_stats.read_max_us)
+        s_stats.read_max_us = (uint32_t)read_us;
+    _stat_add(&s_stats.encode_us, &s_stats.encode_max_us, esp_timer_get_time() - t0 - read_us);
+#endif
+    return ESP_OK;
+}
+
+#if CONFIG_COREDUMP_UPLOADER_ADAPTIVE_CHUNK
+// Ajusta o chunk para que cada 'write' leve cerca de CONFIG_COREDUMP_UPLOADER_ADAPTIVE_TARGET_MS,
+// variando no máximo 2x por parte para não oscilar com medições isoladas
+static void _adapt_chunk_size(upload_ctx_t *ctx, size_t part_raw, uint32_t elapsed_ms) {
+    const coredump_uploader_info_t *info = ctx->info;
+    size_t current = ctx->chunk_size;
+    if (part_raw < current / 2)
+        return; // Parte final curta: medição pouco representativa
+
+    uint64_t ideal = (uint64_t)part_raw * CONFIG_COREDUMP_UPLOADER_ADAPTIVE_TARGET_MS / (elapsed_ms ? elapsed_ms : 1);
+    if (ideal > (uint64_t)current * 2)
+        ideal = (uint64_t)current * 2;
+    if (ideal < current / 2)
+        ideal = current / 2;
+    if (ideal > info->max_chunk_size)
+        ideal = info->max_chunk_size;
+    if (ideal < info->min_chunk_size)
+        ideal = info->min_chunk_size;
+
+    size_t next = _align_chunk((size_t)ideal, info->use_base64);
+    if (next != current) {
+        ESP_LOGD(TAG, "Chunk %u -> %u bytes (%u bytes em %u ms)", (unsigned)current, (unsigned)next, (unsigned)part_raw, (unsigned)elapsed_ms);
+        ctx->chunk_size = next;
+    }
+}
+
+// Após uma falha de 'write', reduz o chunk pela metade para a nova tentativa
+static void _shrink_chunk_size(upload_ctx_t *ctx) {
+    size_t next = _align_chunk(ctx->chunk_size / 2, ctx->info->use_base64);
+    if (next < ctx->info->min_chunk_size)
+        next = ctx->info->min_chunk_size;
+    ctx->chunk_size = next;
+}
+#endif
+
+#if UPLOAD_PACING
+// Após cada parte, dorme o necessário para que a taxa média não passe de
+// CONFIG_COREDUMP_UPLOADER_RATE_LIMIT e o envio fique ativo no máximo
+// CONFIG_COREDUMP_UPLOADER_CPU_BUDGET% do tempo. Pausas menores que um tick se acumulam.
+static void _pace(upload_ctx_t *ctx, size_t piece) {
+    int64_t now = esp_timer_get_time();
+    int64_t wait_us = 0;
+#if CONFIG_COREDUMP_UPLOADER_RATE_LIMIT > 0
+    ctx->paced_bytes += piece;
+    wait_us = ctx->pace_start_us + (int64_t)ctx->paced_bytes * 1000000 / CONFIG_COREDUMP_UPLOADER_RATE_LIMIT - now;
+#endif
+#if CONFIG_COREDUMP_UPLOADER_CPU_BUDGET < 100
+    int64_t idle_us = (now - ctx->busy_since_us) * (100 - CONFIG_COREDUMP_UPLOADER_CPU_BUDGET) / CONFIG_COREDUMP_UPLOADER_CPU_BUDGET;
+    if (idle_us > wait_us)
+        wait_us = idle_us;
+#endif
+    TickType_t ticks = wait_us > 0 ? pdMS_TO_TICKS(wait_us / 1000) : 0;
+    if (ticks == 0)
+        return;
+    vTaskDelay(ticks);
+    ctx->busy_since_us = esp_timer_get_time();
+#if CONFIG_COREDUMP_UPLOADER_STATS
+    s_stats.throttled_us += (uint64_t)(ctx->busy_since_us - now);
+#endif
+}
+#endif
+
+#if CONFIG_COREDUMP_UPLOADER_CRASH_TASK_FIRST
+// Entregue o prefixo, o restante da imagem cede a CPU às demais tasks. A task produtora não muda:
+// ela só prepara chunks à medida que a chamadora libera slots.
+static void _check_prefix_sent(upload_ctx_t *ctx) {
+    const coredump_uploader_info_t *info = ctx->info;
+    if (ctx->prefix_sent || !ctx->src.map || ctx->sent_offset < info->prefix_stream_size)
+        return;
+    ctx->prefix_sent = true;
+    ctx->base_priority = uxTaskPriorityGet(NULL);
+    UBaseType_t rest = ctx->base_priority;
+    if ((UBaseType_t)CONFIG_COREDUMP_UPLOADER_REST_PRIORITY < rest) {
+        rest = CONFIG_COREDUMP_UPLOADER_REST_PRIORITY;
+        vTaskPrioritySet(NULL, rest);
+    }
+    ESP_LOGI(TAG, "Prefixo entregue (%u bytes do fluxo), restante com prioridade %u", (unsigned)info->prefix_stream_size, (unsigned)rest);
+}
+#endif
+
+// Entrega um chunk preparado ao callback 'write', em uma ou mais partes, e notifica o progresso.
+// Se o chunk alvo diminuiu desde a preparação, o slot é fatiado sem nova leitura: em Base64
+// fatias de 4k caracteres correspondem a 3k bytes do fluxo.
+static esp_err_t _send_chunk(const coredump_uploader_callbacks_t *cbs, upload_ctx_t *ctx, const chunk_slot_t *slot) {
+    const coredump_uploader_info_t *info = ctx->info;
+    size_t pos = 0, raw_pos = 0;
+    while (pos < slot->len) {
+        size_t piece = slot->len - pos;
+        size_t piece_raw = slot->raw_len - raw_pos;
+        size_t limit = ctx->chunk_size;
+        if (piece_raw > limit) {
+            piece_raw = limit;
+            piece = info->use_base64 ? (limit / 3) * 4 : limit;
+        }
+
+        int64_t t0 = esp_timer_get_time();
+        esp_err_t err;
+        if (cbs->write_chunk)
+            err = cbs->write_chunk(cbs->priv, slot->data + pos, piece, esp_rom_crc32_le(0, (const uint8_t *)slot->data + pos, piece));
+        else
+            err = cbs->write(cbs->priv, slot->data + pos, piece);
+        int64_t elapsed_us = esp_timer_get_time() - t0;
+        uint32_t elapsed_ms = (uint32_t)(elapsed_us / 1000);
+        if (err != ESP_OK) {
+#if CONFIG_COREDUMP_UPLOADER_STATS
+            s_stats.failures++;
+#endif
+#if CONFIG_COREDUMP_UPLOADER_ADAPTIVE_CHUNK
+            if (info->adaptive && ctx->failures < CONFIG_COREDUMP_UPLOADER_ADAPTIVE_MAX_RETRIES) {
+                ctx->failures++;
+#if CONFIG_COREDUMP_UPLOADER_STATS
+                s_stats.retries++;
+#endif
+                _shrink_chunk_size(ctx);
+                ESP_LOGW(TAG, "Callback 'write' falhou (parte %u), nova tentativa com %u bytes", (unsigned)ctx->next_part, (unsigned)ctx->chunk_size);
+                continue;
+            }
+#endif
+            ESP_LOGE(TAG, "Callback 'write' falhou (parte %u)", (unsigned)ctx->next_part);
+            return err;
+        }
+
+        size_t part_index = ctx->next_part++;
+        ctx->failures = 0;
+        ctx->sent_offset += piece_raw;
+        taskENTER_CRITICAL(&s_status_lock);
+        s_stream_sent = ctx->sent_offset;
+        taskEXIT_CRITICAL(&s_status_lock);
+        ctx->last_part_size = piece_raw;
+#if CONFIG_COREDUMP_UPLOADER_STATS
+        s_stats.parts++;
+        s_stats.bytes_sent += piece;
+        _stat_add(&s_stats.publish_us, &s_stats.chunk_max_us, elapsed_us);
+        if ((uint64_t)elapsed_us < s_stats.chunk_min_us)
+            s_stats.chunk_min_us = (uint32_t)elapsed_us;
+#endif
+        pos += piece;
+        raw_pos += piece_raw;
+#if CONFIG_COREDUMP_UPLOADER_CRASH_TASK_FIRST
+        _check_prefix_sent(ctx);
+#endif
+#if CONFIG_COREDUMP_UPLOADER_ADAPTIVE_CHUNK
+        if (info->adaptive)
+            _adapt_chunk_size(ctx, piece_raw, elapsed_ms);
+#else
+        (void)elapsed_ms;
+#endif
+
+        if (cbs->progress) {
+            esp_err_t p_err = cbs->progress(cbs->priv, info, part_index, piece);
+            if (p_err != ESP_OK) {
+                ESP_LOGW(TAG, "Upload interrompido pelo callback de progresso (parte %u)", (unsigned)part_index);
+                return p_err;
+            }
+        }
+#if UPLOAD_PACING
+        _pace(ctx, piece);
+#endif
     }
     return ESP_OK;
 }
 
-esp_err_t coredump_upload(const coredump_uploader_callbacks_t *cbs, const coredump_uploader_info_t *info) {
-    if (!cbs || !cbs->write) {
-        ESP_LOGE(TAG, "Callbacks 'write' não pode ser nulo.");
+// Envio sequencial: lê, codifica e publica um chunk por vez
+static esp_err_t _upload_sequential(const coredump_uploader_callbacks_t *cbs, upload_ctx_t *ctx, chunk_slot_t *slot) {
+    esp_err_t err = ESP_OK;
+    while (ctx->read_offset < ctx->info->compressed_size) {
+        err = _prepare_chunk(ctx, slot);
+        if (err != ESP_OK)
+            break;
+        err = _send_chunk(cbs, ctx, slot);
+        if (err != ESP_OK)
+            break;
+    }
+    return err;
+}
+
+#if CONFIG_COREDUMP_UPLOADER_PIPELINE
+
+// Estado compartilhado entre a task produtora (leitura/codificação) e a consumidora (envio)
+typedef struct {
+    upload_ctx_t *ctx;
+    chunk_slot_t *slots;
+    QueueHandle_t free_q;        // Índices de slots livres (consumidor -> produtor)
+    QueueHandle_t ready_q;       // Índices de slots prontos (produtor -> consumidor)
+    SemaphoreHandle_t done;      // Sinalizado quando a task produtora termina
+    volatile bool abort;         // Pedido de parada antecipada do produtor
+#if CONFIG_COREDUMP_UPLOADER_STATIC_ARENA
+    // Objetos do FreeRTOS sem heap: estruturas na pilha do chamador, pilha da task na arena
+    StaticQueue_t free_q_buf;
+    StaticQueue_t ready_q_buf;
+    StaticSemaphore_t done_buf;
+    StaticTask_t producer_tcb;
+    TaskHandle_t producer;
+    uint8_t free_q_storage[PIPELINE_DEPTH];
+    uint8_t ready_q_storage[PIPELINE_DEPTH];
+#endif
+} pipeline_ctx_t;
+
+static void _producer_task(void *arg) {
+    pipeline_ctx_t *p = (pipeline_ctx_t *)arg;
+    while (p->ctx->read_offset < p->ctx->info->compressed_size && !p->abort) {
+        uint8_t idx;
+        if (xQueueReceive(p->free_q, &idx, portMAX_DELAY) != pdTRUE || p->abort)
+            break;
+        chunk_slot_t *slot = &p->slots[idx];
+        slot->err = _prepare_chunk(p->ctx, slot);
+        xQueueSend(p->ready_q, &idx, portMAX_DELAY);
+        if (slot->err != ESP_OK)
+            break;
+    }
+    xSemaphoreGive(p->done);
+#if CONFIG_COREDUMP_UPLOADER_STATIC_ARENA
+    // TCB e pilha estáticos: quem apaga é o consumidor, antes de reaproveitar a memória
+    vTaskSuspend(NULL);
+#else
+    vTaskDelete(NULL);
+#endif
+}
+
+// Envio em pipeline: a task produtora prepara até PIPELINE_DEPTH chunks à frente
+// enquanto a task chamadora publica. Retorna ESP_ERR_NO_MEM se não for possível
+// criar a infraestrutura, permitindo ao chamador cair no modo sequencial.
+static esp_err_t _upload_pipelined(const coredump_uploader_callbacks_t *cbs, upload_ctx_t *ctx, chunk_slot_t *slots) {
+    pipeline_ctx_t p = {
+        .ctx = ctx,
+        .slots = slots,
+        .abort = false,
+    };
+#if CONFIG_COREDUMP_UPLOADER_STATIC_ARENA
+    p.free_q = xQueueCreateStatic(PIPELINE_DEPTH, sizeof(uint8_t), p.free_q_storage, &p.free_q_buf);
+    p.ready_q = xQueueCreateStatic(PIPELINE_DEPTH, sizeof(uint8_t), p.ready_q_storage, &p.ready_q_buf);
+    p.done = xSemaphoreCreateBinaryStatic(&p.done_buf);
+    StackType_t *producer_stack = _work_alloc(CONFIG_COREDUMP_UPLOADER_PRODUCER_STACK_SIZE);
+#else
+    p.free_q = xQueueCreate(PIPELINE_DEPTH, sizeof(uint8_t));
+    p.ready_q = xQueueCreate(PIPELINE_DEPTH, sizeof(uint8_t));
+    p.done = xSemaphoreCreateBinary();
+#endif
+    esp_err_t err = ESP_OK;
+    if (!p.free_q || !p.ready_q || !p.done) {
+        err = ESP_ERR_NO_MEM;
+        goto cleanup;
+    }
+    for (uint8_t i = 0; i < PIPELINE_DEPTH; ++i)
+        xQueueSend(p.free_q, &i, 0);
+
+#if CONFIG_COREDUMP_UPLOADER_PIPELINE_PIN_CORES
+    BaseType_t producer_core = (xPortGetCoreID() == 0) ? 1 : 0;
+#else
+    BaseType_t producer_core = tskNO_AFFINITY;
+#endif
+#if CONFIG_COREDUMP_UPLOADER_STATIC_ARENA
+    if (producer_stack)
+        p.producer = xTaskCreateStaticPinnedToCore(_producer_task, "cd_producer", CONFIG_COREDUMP_UPLOADER_PRODUCER_STACK_SIZE, &p,
+                                                   CONFIG_COREDUMP_UPLOADER_PRODUCER_PRIORITY, producer_stack, &p.producer_tcb,
+                                                   producer_core);
+    if (!p.producer) {
+#else
+    if (xTaskCreatePinnedToCore(_producer_task, "cd_producer", CONFIG_COREDUMP_UPLOADER_PRODUCER_STACK_SIZE, &p,
+                                CONFIG_COREDUMP_UPLOADER_PRODUCER_PRIORITY, NULL, producer_core) != pdPASS) {
+#endif
+        err = ESP_ERR_NO_MEM;
+        goto cleanup;
+    }
+
+    for (;;) {
+        uint8_t idx;
+        xQueueReceive(p.ready_q, &idx, portMAX_DELAY);
+        err = slots[idx].err;
+        bool last = slots[idx].last;
+        if (err == ESP_OK)
+            err = _send_chunk(cbs, ctx, &slots[idx]);
+        xQueueSend(p.free_q, &idx, 0);
+        if (err != ESP_OK || last)
+            break;
+    }
+
+    // Encerra o produtor: devolve slots que ele ainda esteja preenchendo até que termine
+    p.abort = true;
+    while (xSemaphoreTake(p.done, pdMS_TO_TICKS(10)) != pdTRUE) {
+        uint8_t idx;
+        if (xQueueReceive(p.ready_q, &idx, 0) == pdTRUE)
+            xQueueSend(p.free_q, &idx, 0);
+    }
+#if CONFIG_COREDUMP_UPLOADER_STATIC_ARENA
+    while (eTaskGetState(p.producer) != eSuspended)
+        vTaskDelay(1);
+    vTaskDelete(p.producer);
+#endif
+
+cleanup:
+    if (p.free_q)
+        vQueueDelete(p.free_q);
+    if (p.ready_q)
+        vQueueDelete(p.ready_q);
+    if (p.done)
+        vSemaphoreDelete(p.done);
+    return err;
+}
+#endif // CONFIG_COREDUMP_UPLOADER_PIPELINE
+
+esp_err_t coredump_upload(const coredump_uploader_callbacks_t *cbs, coredump_uploader_info_t *info) {
+    if (!cbs || (!cbs->write && !cbs->write_chunk)) {
+        ESP_LOGE(TAG, "Callbacks 'write' e 'write_chunk' não podem ser ambos nulos.");
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -91,87 +1617,159 @@ esp_err_t coredump_upload(const coredump_uploader_callbacks_t *cbs, const coredu
         }
         info = &local_info;
     }
+#if CONFIG_COREDUMP_UPLOADER_STATS
+    s_stats = (coredump_uploader_stats_t){.chunk_min_us = UINT32_MAX};
+#endif
+#if CONFIG_COREDUMP_UPLOADER_METRICS
+    // Novas tentativas sobre a mesma imagem acumulam; o início é o da primeira
+    if (!s_metrics.upload_start_us)
+        s_metrics.upload_start_us = esp_timer_get_time();
+#endif
 
-    ESP_LOGI(TAG, "Coredump: %u bytes @0x%08x em %u chunks (chunk=%u, último=%u) base64=%d", (unsigned)info->total_size, (unsigned)info->flash_addr,
-             (unsigned)info->chunk_count, (unsigned)info->chunk_size, (unsigned)info->last_chunk_size, info->use_base64);
+    ESP_LOGI(TAG, "Coredump: %u bytes @0x%08x em %u chunks (chunk=%u, último=%u) base64=%d comprimido=%d (%u bytes) adaptativo=%d",
+             (unsigned)info->total_size, (unsigned)info->flash_addr, (unsigned)info->chunk_count, (unsigned)info->chunk_size,
+             (unsigned)info->last_chunk_size, info->use_base64, info->compressed, (unsigned)info->compressed_size, info->adaptive);
 
-    // Aloca buffer de leitura
-    uint8_t *read_chunk = malloc(info->chunk_size);
-    if (!read_chunk) {
-        ESP_LOGE(TAG, "Falha ao alocar buffer de leitura.");
-        return ESP_ERR_NO_MEM;
+    upload_ctx_t ctx = {
+        .info = info,
+        .chunk_size = info->chunk_size,
+    };
+    _source_init(&ctx.src, info->flash_addr, info->total_size);
+#if CONFIG_COREDUMP_UPLOADER_CRASH_TASK_FIRST
+    if (info->prefix_size) {
+        esp_err_t map_err = _segment_map(&ctx.src, info, &ctx.map);
+        if (map_err != ESP_OK) {
+            ESP_LOGE(TAG, "Ordem de envio divergente de get_info (%s)", esp_err_to_name(map_err));
+            _source_release(&ctx.src);
+            return map_err;
+        }
+        ctx.src.map = &ctx.map;
     }
+#endif
 
-    // Buffer Base64 se necessário
-    uint8_t *b64_buf = NULL;
-    size_t b64_buf_capacity = 0;
-    if (info->use_base64) {
-        // Capacidade suficiente para o maior chunk (chunk_size) + terminador
-        b64_buf_capacity = _b64_encoded_size(info->chunk_size) + 1;
-        b64_buf = malloc(b64_buf_capacity);
-        if (!b64_buf) {
-            ESP_LOGE(TAG, "Falha ao alocar buffer Base64.");
-            free(read_chunk);
+    // Com a imagem mapeada, o fluxo não comprimido dispensa o buffer de leitura: o Base64 é
+    // gerado direto da janela e, em binário, 'write' recebe ponteiros para a própria flash.
+    // Fora da ordem da flash um chunk pode cruzar trechos da imagem: sempre com cópia.
+    bool need_raw = info->compressed || !_source_mapped(&ctx.src) || ctx.src.map != NULL;
+    bool zero_copy = !need_raw && !info->use_base64;
+
+    // Com um único chunk não há o que sobrepor; sem leitura nem codificação, também não
+    size_t slot_count = (info->compressed_size > info->max_chunk_size && !zero_copy) ? PIPELINE_DEPTH : 1;
+
+    // Buffers dimensionados para o maior chunk possível; Base64 + terminador
+    ctx.b64_capacity = info->use_base64 ? _b64_encoded_size(info->max_chunk_size) + 1 : 0;
+    size_t raw_bytes = need_raw ? info->max_chunk_size : 0;
+    size_t slot_bytes = raw_bytes + ctx.b64_capacity;
+
+    // Um único bloco com os buffers de todos os slots
+    chunk_slot_t slots[PIPELINE_DEPTH];
+    uint8_t *buffers = NULL;
+    _work_reset();
+    if (slot_bytes) {
+        buffers = _work_alloc(slot_bytes * slot_count);
+        if (!buffers) {
+            ESP_LOGE(TAG, "Falha ao alocar buffers de leitura/Base64.");
+            _source_release(&ctx.src);
             return ESP_ERR_NO_MEM;
         }
     }
+    for (size_t i = 0; i < slot_count; ++i) {
+        slots[i] = (chunk_slot_t){
+            .raw = need_raw ? buffers + i * slot_bytes : NULL,
+            .b64 = info->use_base64 ? buffers + i * slot_bytes + raw_bytes : NULL,
+        };
+    }
+    ESP_LOGI(TAG, "Leitura: %s, %u bytes de buffers", zero_copy ? "mapeada sem cópia" : (need_raw ? "com cópia" : "mapeada"),
+             (unsigned)(slot_bytes * slot_count));
 
     esp_err_t err = ESP_OK;
+#if CONFIG_COREDUMP_UPLOADER_COMPRESSION
+    if (info->compressed) {
+        ctx.stream = _work_alloc(sizeof(deflate_stream_t));
+        if (!ctx.stream) {
+            ESP_LOGE(TAG, "Falha ao alocar estado do compressor.");
+            err = ESP_ERR_NO_MEM;
+            goto release;
+        }
+        _stream_init(ctx.stream, &ctx.src, ctx.src.map ? info->prefix_size : 0);
+    }
+#endif
 
     // Callback de início
     if (cbs->start) {
         err = cbs->start(cbs->priv);
         if (err != ESP_OK) {
             ESP_LOGE(TAG, "Callback 'start' falhou.");
-            if (read_chunk)
-                free(read_chunk);
-            if (b64_buf)
-                free(b64_buf);
-            return err;
+            goto release;
         }
     }
 
-    // Loop de envio
-    for (size_t chunk_index = 0; chunk_index < info->chunk_count; ++chunk_index) {
-        size_t offset = chunk_index * info->chunk_size;
-        size_t bytes_to_read = (chunk_index == info->chunk_count - 1) ? info->last_chunk_size : info->chunk_size;
-
-        err = esp_flash_read(esp_flash_default_chip, read_chunk, info->flash_addr + offset, bytes_to_read);
+    // Negocia o ponto de retomada: checkpoint local como sugestão, receptor como autoridade
+    coredump_uploader_resume_t point = {0};
+#if CONFIG_COREDUMP_UPLOADER_RESUME
+    _checkpoint_load(info, &point);
+#endif
+    if (cbs->resume) {
+        err = cbs->resume(cbs->priv, info, &point);
         if (err != ESP_OK) {
-            ESP_LOGE(TAG, "Falha ao ler coredump (chunk %u)", (unsigned)chunk_index);
-            break;
+            ESP_LOGE(TAG, "Callback 'resume' falhou.");
+            goto release;
         }
-
-        const char *data_to_send = (const char *)read_chunk;
-        size_t len_to_send = bytes_to_read;
-        if (info->use_base64) {
-            size_t actual_b64_len = 0;
-            int b64_ret = mbedtls_base64_encode(b64_buf, b64_buf_capacity, &actual_b64_len, read_chunk, bytes_to_read);
-            if (b64_ret != 0) {
-                ESP_LOGE(TAG, "Base64 falhou (chunk %u, mbedtls=-0x%04x)", (unsigned)chunk_index, -b64_ret);
-                err = ESP_FAIL;
-                break;
-            }
-            data_to_send = (const char *)b64_buf;
-            len_to_send = actual_b64_len;
+        if (!_resume_point_valid(info, &point)) {
+            ESP_LOGW(TAG, "Ponto de retomada inválido (parte %u, offset %u), reiniciando do zero.", (unsigned)point.next_chunk,
+                     (unsigned)point.stream_offset);
+            point = (coredump_uploader_resume_t){0};
         }
-
-        err = cbs->write(cbs->priv, data_to_send, len_to_send);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "Callback 'write' falhou (chunk %u)", (unsigned)chunk_index);
-            break;
+    }
+    if (point.stream_offset > 0) {
+        ESP_LOGI(TAG, "Retomando upload na parte %u (offset %u/%u)", (unsigned)(point.next_chunk + 1), (unsigned)point.stream_offset,
+                 (unsigned)info->compressed_size);
+#if CONFIG_COREDUMP_UPLOADER_COMPRESSION
+        // O fluxo comprimido é sequencial: descarta o trecho já confirmado
+        if (ctx.stream) {
+            size_t got = 0;
+            err = _stream_read(ctx.stream, NULL, point.stream_offset, &got);
+            if (err == ESP_OK && got != point.stream_offset)
+                err = ESP_ERR_INVALID_SIZE;
+            if (err != ESP_OK)
+                goto release;
         }
+#endif
+    }
+    ctx.next_part = point.next_chunk;
+    ctx.read_offset = point.stream_offset;
+    ctx.sent_offset = point.stream_offset;
+    taskENTER_CRITICAL(&s_status_lock);
+    s_stream_size = info->compressed_size;
+    s_stream_sent = ctx.sent_offset;
+    taskEXIT_CRITICAL(&s_status_lock);
+#if CONFIG_COREDUMP_UPLOADER_CRASH_TASK_FIRST
+    if (ctx.sent_offset > 0)
+        _check_prefix_sent(&ctx); // Retomada além do prefixo
+#endif
+#if UPLOAD_PACING
+    ctx.pace_start_us = esp_timer_get_time();
+    ctx.busy_since_us = ctx.pace_start_us;
+#endif
 
-        if (cbs->progress) {
-            esp_err_t p_err = cbs->progress(cbs->priv, info, chunk_index, len_to_send);
-            if (p_err != ESP_OK) {
-                ESP_LOGW(TAG, "Upload interrompido pelo callback de progresso (chunk %u)", (unsigned)chunk_index);
-                err = p_err;
-                break;
-            }
+    // Loop de envio
+#if CONFIG_COREDUMP_UPLOADER_PIPELINE
+    if (slot_count > 1 && info->compressed_size - ctx.read_offset > info->max_chunk_size) {
+        err = _upload_pipelined(cbs, &ctx, slots);
+        if (err == ESP_ERR_NO_MEM && ctx.read_offset == ctx.sent_offset) {
+            ESP_LOGW(TAG, "Pipeline indisponível, usando envio sequencial.");
+            err = _upload_sequential(cbs, &ctx, &slots[0]);
         }
+    } else
+#endif
+    {
+        err = _upload_sequential(cbs, &ctx, &slots[0]);
     }
 
+    // Particionamento final efetivamente usado (o adaptativo só é conhecido ao fim)
+    if (err == ESP_OK && ctx.last_part_size > 0)
+        _fill_layout(info, ctx.chunk_size, ctx.next_part, ctx.last_part_size);
+
     // Callback de fim
     if (cbs->end) {
         esp_err_t end_err = cbs->end(cbs->priv);
@@ -180,21 +1778,145 @@ esp_err_t coredump_upload(const coredump_uploader_callbacks_t *cbs, const coredu
             err = end_err;
         }
     }
+#if CONFIG_COREDUMP_UPLOADER_STATS
+    if (!s_stats.parts)
+        s_stats.chunk_min_us = 0;
+    s_stats.chunk_avg_us = s_stats.parts ? (uint32_t)(s_stats.publish_us / s_stats.parts) : 0;
+#endif
+#if CONFIG_COREDUMP_UPLOADER_METRICS
+    s_metrics.upload_end_us = esp_timer_get_time();
+    s_metrics.parts += s_stats.parts;
+    s_metrics.bytes += s_stats.bytes_sent;
+    s_metrics.read_us += s_stats.read_us;
+    s_metrics.encode_us += s_stats.encode_us;
+    s_metrics.publish_us += s_stats.publish_us;
+    if (s_stats.read_max_us > s_metrics.read_max_us)
+        s_metrics.read_max_us = s_stats.read_max_us;
+    if (s_stats.encode_max_us > s_metrics.encode_max_us)
+        s_metrics.encode_max_us = s_stats.encode_max_us;
+    if (s_stats.chunk_max_us > s_metrics.publish_max_us)
+        s_metrics.publish_max_us = s_stats.chunk_max_us;
+#endif
 
     if (err == ESP_OK) {
-        ESP_LOGI(TAG, "Coredump enviado com sucesso. Apagando da flash...");
-        esp_err_t erase_err = esp_core_dump_image_erase();
+        ESP_LOGI(TAG, "Coredump enviado com sucesso (%u partes). Apagando da flash...", (unsigned)info->chunk_count);
+        _source_release(&ctx.src); // A janela mapeada não pode sobreviver ao apagamento
+        esp_err_t erase_err = _image_erase();
         if (erase_err != ESP_OK) {
             ESP_LOGE(TAG, "Falha ao apagar coredump (%s)", esp_err_to_name(erase_err));
             err = erase_err; // Pode optar por não sobrescrever; aqui sobrescrevemos para alertar
         }
+#if CONFIG_COREDUMP_UPLOADER_METRICS
+        if (erase_err == ESP_OK)
+            s_metrics.erase_done_us = esp_timer_get_time();
+#endif
+#if CONFIG_COREDUMP_UPLOADER_RESUME
+        _checkpoint_clear();
+#endif
     } else {
         ESP_LOGW(TAG, "Upload incompleto. Coredump mantido para nova tentativa.");
     }
 
-    if (read_chunk)
-        free(read_chunk);
-    if (b64_buf)
-        free(b64_buf);
+release:
+#if CONFIG_COREDUMP_UPLOADER_CRASH_TASK_FIRST
+    if (ctx.prefix_sent && (UBaseType_t)CONFIG_COREDUMP_UPLOADER_REST_PRIORITY < ctx.base_priority)
+        vTaskPrioritySet(NULL, ctx.base_priority);
+#endif
+#if CONFIG_COREDUMP_UPLOADER_COMPRESSION
+    _work_free(ctx.stream);
+#endif
+    _source_release(&ctx.src);
+    _work_free(buffers);
+    _work_reset();
     return err;
 }
+
+// --- Serviço de upload em segundo plano ---
+
+#define SERVICE_DONE_BIT BIT0
+
+static struct {
+    coredump_uploader_job_cb_t job;
+    void *arg;
+    volatile coredump_uploader_service_state_t state;
+    volatile esp_err_t result;
+    EventGroupHandle_t events;       // SERVICE_DONE_BIT ao concluir
+    StaticEventGroup_t events_buf;
+#if CONFIG_COREDUMP_UPLOADER_STATIC_ARENA
+    // Fora da arena: a arena é reiniciada a cada coredump_upload() feito pela própria task
+    StaticTask_t tcb;
+    StackType_t stack[CONFIG_COREDUMP_UPLOADER_SERVICE_STACK_SIZE];
+#endif
+} s_service;
+
+static void _service_task(void *arg) {
+    (void)arg;
+    esp_err_t err = s_service.job(s_service.arg);
+    taskENTER_CRITICAL(&s_status_lock);
+    s_service.result = err;
+    s_service.state = (err == ESP_OK) ? COREDUMP_UPLOADER_SERVICE_DONE : COREDUMP_UPLOADER_SERVICE_FAILED;
+    taskEXIT_CRITICAL(&s_status_lock);
+    ESP_LOGI(TAG, "Serviço de upload concluído (%s)", esp_err_to_name(err));
+    xEventGroupSetBits(s_service.events, SERVICE_DONE_BIT);
+    // O serviço roda uma vez por boot: TCB e pilha estáticos não são reaproveitados
+    vTaskDelete(NULL);
+}
+
+esp_err_t coredump_uploader_service_start(coredump_uploader_job_cb_t job, void *arg) {
+    if (!job)
+        return ESP_ERR_INVALID_ARG;
+    // Verifica e reserva o serviço de uma vez: duas chamadas simultâneas não criam duas tasks
+    taskENTER_CRITICAL(&s_status_lock);
+    bool idle = s_service.state == COREDUMP_UPLOADER_SERVICE_IDLE;
+    if (idle)
+        s_service.state = COREDUMP_UPLOADER_SERVICE_RUNNING;
+    taskEXIT_CRITICAL(&s_status_lock);
+    if (!idle)
+        return ESP_ERR_INVALID_STATE;
+    s_service.job = job;
+    s_service.arg = arg;
+    s_service.events = xEventGroupCreateStatic(&s_service.events_buf);
+
+    BaseType_t core = CONFIG_COREDUMP_UPLOADER_SERVICE_CORE < 0 ? tskNO_AFFINITY : CONFIG_COREDUMP_UPLOADER_SERVICE_CORE;
+#if CONFIG_COREDUMP_UPLOADER_STATIC_ARENA
+    TaskHandle_t task = xTaskCreateStaticPinnedToCore(_service_task, "cd_service", CONFIG_COREDUMP_UPLOADER_SERVICE_STACK_SIZE, NULL,
+                                                      CONFIG_COREDUMP_UPLOADER_SERVICE_PRIORITY, s_service.stack, &s_service.tcb, core);
+    if (!task) {
+#else
+    if (xTaskCreatePinnedToCore(_service_task, "cd_service", CONFIG_COREDUMP_UPLOADER_SERVICE_STACK_SIZE, NULL,
+                                CONFIG_COREDUMP_UPLOADER_SERVICE_PRIORITY, NULL, core) != pdPASS) {
+#endif
+        ESP_LOGE(TAG, "Falha ao criar a task do serviço de upload.");
+        taskENTER_CRITICAL(&s_status_lock);
+        s_service.state = COREDUMP_UPLOADER_SERVICE_IDLE;
+        taskEXIT_CRITICAL(&s_status_lock);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void coredump_uploader_service_get_status(coredump_uploader_service_status_t *out) {
+    if (!out)
+        return;
+    taskENTER_CRITICAL(&s_status_lock);
+    out->state = s_service.state;
+    out->result = s_service.result;
+    out->stream_size = s_stream_size;
+    out->stream_sent = s_stream_sent;
+    taskEXIT_CRITICAL(&s_status_lock);
+}
+
+esp_err_t coredump_uploader_service_wait(uint32_t timeout_ms) {
+    taskENTER_CRITICAL(&s_status_lock);
+    bool idle = s_service.state == COREDUMP_UPLOADER_SERVICE_IDLE;
+    taskEXIT_CRITICAL(&s_status_lock);
+    if (idle)
+        return ESP_OK;
+    TickType_t ticks = (timeout_ms == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    if (!(xEventGroupWaitBits(s_service.events, SERVICE_DONE_BIT, pdFALSE, pdTRUE, ticks) & SERVICE_DONE_BIT))
+        return ESP_ERR_TIMEOUT;
+    taskENTER_CRITICAL(&s_status_lock);
+    esp_err_t result = s_service.result;
+    taskEXIT_CRITICAL(&s_status_lock);
+    return result;
+}
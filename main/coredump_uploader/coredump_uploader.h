@@ -2,8 +2,10 @@
 #define COREDUMP_UPLOADER_H
 
 #include "esp_err.h"
+#include "esp_partition.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * @brief Ponteiro de função chamado antes do início da leitura do coredump.
@@ -18,12 +20,28 @@ typedef esp_err_t (*coredump_upload_start_cb_t)(void *priv);
  * @brief Ponteiro de função chamado para enviar um bloco de dados do coredump.
  *
  * @param priv Ponteiro para dados de contexto do usuário.
- * @param data Buffer contendo o bloco de dados.
+ * @param data Buffer contendo o bloco de dados. Com CONFIG_COREDUMP_UPLOADER_MMAP pode
+ *             apontar para a flash mapeada: válido apenas durante a chamada.
  * @param len Comprimento do buffer de dados.
  * @return ESP_OK se bem-sucedido.
  */
 typedef esp_err_t (*coredump_upload_write_cb_t)(void *priv, const char *data, size_t len);
 
+/**
+ * @brief Variante de 'write' que recebe também o CRC32 do bloco (opcional).
+ *
+ * Se definido, é usado no lugar de 'write'. O CRC32 (o mesmo de zlib.crc32) é calculado
+ * sobre os bytes exatamente como entregues em 'data', já codificados em Base64 se
+ * aplicável, e permite ao receptor rejeitar uma parte corrompida assim que chega.
+ *
+ * @param priv Ponteiro para dados de contexto do usuário.
+ * @param data Buffer contendo o bloco de dados (mesmas regras de 'write').
+ * @param len Comprimento do buffer de dados.
+ * @param crc CRC32 de 'data'.
+ * @return ESP_OK se bem-sucedido.
+ */
+typedef esp_err_t (*coredump_upload_write_chunk_cb_t)(void *priv, const char *data, size_t len, uint32_t crc);
+
 /**
  * @brief Ponteiro de função chamado após o término da leitura do coredump.
  *
@@ -44,7 +62,7 @@ struct coredump_uploader_info;
  *
  * @param priv Contexto do usuário (callbacks->priv)
  * @param info Ponteiro para estrutura informativa do coredump (const)
- * @param chunk_index Índice do chunk enviado (0-based)
+ * @param chunk_index Índice da parte enviada (0-based)
  * @param bytes_sent Quantidade de bytes efetivamente enviados neste chunk
  *                   (já codificados em Base64 se aplicável)
  * @return ESP_OK para continuar. Qualquer erro aborta o upload.
@@ -54,28 +72,74 @@ typedef esp_err_t (*coredump_upload_progress_cb_t)(void *priv,
                                                    size_t chunk_index,
                                                    size_t bytes_sent);
 
+/**
+ * @brief Ponto de retomada de um upload: progresso já confirmado pelo receptor.
+ */
+typedef struct {
+    size_t next_chunk;     // Índice (0-based) da próxima parte a enviar
+    size_t stream_offset;  // Bytes do fluxo (antes do Base64) já confirmados
+} coredump_uploader_resume_t;
+
+/**
+ * @brief Callback de retomada chamado após 'start' e antes da primeira parte (opcional).
+ *
+ * Na entrada, '*point' traz o progresso salvo em NVS para esta imagem ({0, 0} se
+ * não houver). O callback pode substituí-lo pelo progresso informado pelo receptor,
+ * que é a fonte autoritativa. O fluxo é enviado a partir de point->stream_offset e
+ * a próxima chamada a 'write' corresponde à parte point->next_chunk.
+ *
+ * @param priv Contexto do usuário (callbacks->priv)
+ * @param info Ponteiro para estrutura informativa do coredump (const)
+ * @param point Entrada/saída: ponto de retomada.
+ * @return ESP_OK para continuar. Qualquer erro aborta o upload.
+ */
+typedef esp_err_t (*coredump_upload_resume_cb_t)(void *priv,
+                                                 const struct coredump_uploader_info *info,
+                                                 coredump_uploader_resume_t *point);
+
 typedef struct {
     coredump_upload_start_cb_t start;     // Chamado antes de iniciar a escrita.
     coredump_upload_write_cb_t write;     // Chamado para cada bloco de dados.
+    coredump_upload_write_chunk_cb_t write_chunk; // Substitui 'write', recebendo o CRC32 do bloco.
     coredump_upload_end_cb_t end;         // Chamado ao finalizar a escrita.
     coredump_upload_progress_cb_t progress; // Chamado após cada chunk enviado.
+    coredump_upload_resume_cb_t resume;   // Define o ponto de retomada do envio.
     void *priv;                           // Ponteiro privado para dados de contexto.
 } coredump_uploader_callbacks_t;
 
+/** Máximo de segmentos do ELF enviados no prefixo (notas, TCB e pilha da task que falhou). */
+#define COREDUMP_UPLOADER_MAX_FIRST_SEGMENTS 6
+
 /**
  * @brief Estrutura com metadados sobre o coredump e particionamento em chunks.
  */
 typedef struct coredump_uploader_info {
     size_t flash_addr;            // Endereço na flash onde começa o coredump
     size_t total_size;            // Tamanho total bruto (binário) do coredump
-    size_t chunk_size;            // Tamanho configurado (bruto) de cada chunk (exceto último)
+    uint32_t image_crc;           // Checksum gravado no fim da imagem (identifica o coredump)
+    uint32_t image_digest;        // CRC32 da imagem bruta inteira (total_size bytes), na ordem de envio
+    bool compressed;              // Se o fluxo enviado é comprimido (raw deflate)
+    size_t compressed_size;       // Tamanho do fluxo enviado antes do Base64 (== total_size sem compressão)
+    // Particionamento do fluxo enviado (comprimido, se 'compressed'), antes do Base64.
+    // No modo adaptativo, chunk_size é o tamanho inicial e chunk_count/last_chunk_size
+    // são estimativas; coredump_upload() os substitui pelo particionamento final.
+    bool adaptive;                // Se o tamanho das partes é ajustado durante o envio
+    size_t min_chunk_size;        // Menor chunk usado pelo modo adaptativo
+    size_t max_chunk_size;        // Maior chunk (dimensiona os buffers)
+    size_t chunk_size;            // Tamanho de cada chunk (exceto último)
     size_t chunk_count;           // Número total de chunks (>=1)
-    size_t last_chunk_size;       // Tamanho bruto do último chunk
+    size_t last_chunk_size;       // Tamanho do último chunk
     bool use_base64;              // Se será usado Base64
     // Informações de tamanho quando Base64 está habilitado
     size_t b64_total_size;        // Total estimado após Base64
     size_t b64_chunk_size;        // Tamanho codificado típico de um chunk completo
     size_t b64_last_chunk_size;   // Tamanho codificado do último chunk
+    // Ordem de envio (CONFIG_COREDUMP_UPLOADER_CRASH_TASK_FIRST): cabeçalhos do ELF e os segmentos
+    // de first_segments formam um prefixo interpretável; os demais bytes seguem na ordem da flash.
+    size_t prefix_size;           // Bytes brutos do prefixo (0 = imagem inteira na ordem da flash)
+    size_t prefix_stream_size;    // Bytes do fluxo enviado (antes do Base64) até o fim do prefixo
+    size_t first_count;           // Segmentos no prefixo
+    uint16_t first_segments[COREDUMP_UPLOADER_MAX_FIRST_SEGMENTS]; // Índices dos program headers, em ordem
 } coredump_uploader_info_t;
 
 /**
@@ -94,21 +158,345 @@ bool coredump_uploader_need_upload(void);
  *  2. Opcionalmente use callbacks->start para enviar meta (ex: JSON com chunk_count).
  *  3. Esta função fará o envio chunk a chunk.
  *
- * @param cbs Callbacks de comunicação (write obrigatório).
- * @param info Informações previamente calculadas. Se NULL será calculada com default.
+ * Com CONFIG_COREDUMP_UPLOADER_RESUME, os chunks já confirmados (checkpoint em NVS
+ * ou callbacks->resume) não são reenviados, e o checkpoint é apagado junto com a imagem.
+ *
+ * Com CONFIG_COREDUMP_UPLOADER_PIPELINE, a leitura da flash e a codificação Base64
+ * rodam numa task produtora que preenche um anel de CONFIG_COREDUMP_UPLOADER_PIPELINE_DEPTH
+ * buffers enquanto a task chamadora executa 'write'. Os callbacks continuam sendo
+ * chamados sempre a partir da task chamadora e na ordem dos chunks.
+ *
+ * Com CONFIG_COREDUMP_UPLOADER_MMAP, a partição de coredump é lida por uma janela
+ * mapeada de CONFIG_COREDUMP_UPLOADER_MMAP_WINDOW_SIZE bytes. Sem compressão nem Base64,
+ * 'write' recebe ponteiros direto para a flash, sem buffers nem pipeline.
+ *
+ * Com CONFIG_COREDUMP_UPLOADER_STATIC_ARENA, toda a memória de trabalho vem de uma
+ * arena estática de CONFIG_COREDUMP_UPLOADER_ARENA_SIZE bytes e o upload não usa o
+ * heap. A arena é única: get_info e upload não devem rodar em paralelo.
+ *
+ * Com CONFIG_COREDUMP_UPLOADER_CRASH_TASK_FIRST, o fluxo segue a ordem descrita em
+ * info->first_segments (sem leitura direta do mapeamento) e, entregue o prefixo, a task
+ * chamadora passa para CONFIG_COREDUMP_UPLOADER_REST_PRIORITY até o fim do upload.
+ *
+ * Com CONFIG_COREDUMP_UPLOADER_ADAPTIVE_CHUNK, o envio começa com max_chunk_size e
+ * ajusta o tamanho das partes pela latência medida de cada 'write', entre
+ * min_chunk_size e max_chunk_size (múltiplos de 3 em Base64). Uma falha de 'write'
+ * reduz o chunk pela metade e reenvia a mesma parte, até
+ * CONFIG_COREDUMP_UPLOADER_ADAPTIVE_MAX_RETRIES vezes seguidas.
+ *
+ * @param cbs Callbacks de comunicação (write ou write_chunk obrigatório).
+ * @param info Informações previamente calculadas (atualizadas com o particionamento
+ *             final em caso de sucesso). Se NULL será calculada com default.
  * @return ESP_OK se enviado e apagado com sucesso.
  */
-esp_err_t coredump_upload(const coredump_uploader_callbacks_t *cbs, const coredump_uploader_info_t *info);
+esp_err_t coredump_upload(const coredump_uploader_callbacks_t *cbs, coredump_uploader_info_t *info);
 
 /**
  * @brief Obtém informações sobre o coredump atual e particionamento em chunks.
  *
  * @param out Estrutura de saída preenchida em caso de sucesso.
  * @param desired_chunk_size Tamanho desejado de chunk (bruto). Se 0, usa default interno.
+ *                           No modo adaptativo é o tamanho inicial e máximo, tipicamente
+ *                           o maior payload aceito pelo transporte. Com a arena
+ *                           estática, é limitado ao maior chunk que cabe nela.
  * @param use_base64 Define se cálculo deve considerar codificação Base64.
+ *
+ * Com CONFIG_COREDUMP_UPLOADER_COMPRESSION a imagem é comprimida uma vez (sem guardar
+ * a saída) para obter compressed_size, e os chunks passam a particionar o fluxo comprimido.
+ * A mesma leitura calcula image_digest; sem compressão, a imagem é lida uma vez para isso.
+ *
+ * Com CONFIG_COREDUMP_UPLOADER_CRASH_TASK_FIRST, os program headers do ELF são lidos para
+ * montar o prefixo: segmentos PT_NOTE e os PT_LOAD do TCB da task que falhou
+ * (esp_core_dump_get_summary()) e da pilha que o segue. Com compressão, o prefixo é um
+ * fluxo deflate completo e o restante, outro, concatenado a ele.
  * @return ESP_OK se um coredump foi encontrado e info preenchida.
  * @return Erro de esp_core_dump_image_get caso não exista ou falhe.
  */
 esp_err_t coredump_uploader_get_info(coredump_uploader_info_t *out, size_t desired_chunk_size, bool use_base64);
 
+/**
+ * @brief Descreve a imagem armazenada sem lê-la inteira, para servir intervalos sob demanda.
+ *
+ * Preenche flash_addr, total_size, image_crc e, com CONFIG_COREDUMP_UPLOADER_CRASH_TASK_FIRST,
+ * prefix_size/first_count/first_segments: o índice que o receptor usa para pedir só os
+ * segmentos de que precisa. Não há compressão nem particionamento (compressed_size é o
+ * tamanho da imagem); image_digest fica zerado.
+ *
+ * @param out Estrutura de saída.
+ * @return ESP_OK se um coredump foi encontrado.
+ * @return Erro de esp_core_dump_image_get caso não exista ou falhe.
+ */
+esp_err_t coredump_uploader_get_index(coredump_uploader_info_t *out);
+
+/**
+ * @brief Lê um intervalo da imagem armazenada, na ordem da flash.
+ *
+ * Usa o mesmo caminho de leitura do upload (janela mapeada com
+ * CONFIG_COREDUMP_UPLOADER_MMAP) e não usa a arena: pode rodar em paralelo a um upload.
+ *
+ * @param info Imagem obtida com coredump_uploader_get_index() ou coredump_uploader_get_info().
+ * @param offset Posição do intervalo na imagem.
+ * @param buf Destino de 'len' bytes.
+ * @param len Tamanho do intervalo.
+ * @return ESP_OK se lido.
+ * @return ESP_ERR_INVALID_SIZE se o intervalo passar do fim da imagem.
+ */
+esp_err_t coredump_uploader_read(const coredump_uploader_info_t *info, size_t offset, void *buf, size_t len);
+
+/** Bytes do SHA256 de cada bloco usados como endereço no manifesto de blocos. */
+#define COREDUMP_UPLOADER_BLOCK_HASH_SIZE 8
+
+/**
+ * @brief Calcula o manifesto de blocos da imagem: o endereço de conteúdo de cada bloco.
+ *
+ * A imagem é dividida, na ordem da flash e sem compressão, em blocos de 'block_size' bytes
+ * (o último pode ser menor); cada bloco é identificado pelos primeiros
+ * COREDUMP_UPLOADER_BLOCK_HASH_SIZE bytes do seu SHA256. Imagens do mesmo firmware e da
+ * mesma falha repetem a maior parte dos blocos, que o receptor já guarda e não precisam
+ * ser reenviados. Lê a imagem uma vez pelo caminho de coredump_uploader_read(), sem a arena.
+ *
+ * @param info Imagem obtida com coredump_uploader_get_index().
+ * @param block_size Tamanho de cada bloco.
+ * @param out Destino de COREDUMP_UPLOADER_BLOCK_HASH_SIZE bytes por bloco.
+ * @param max_blocks Capacidade de 'out', em blocos.
+ * @param out_count Blocos da imagem.
+ * @param out_digest Opcional: CRC32 da imagem inteira, para o receptor conferir a remontagem.
+ * @return ESP_OK se calculado.
+ * @return ESP_ERR_INVALID_SIZE se a imagem tiver mais de 'max_blocks' blocos.
+ * @return ESP_ERR_NOT_SUPPORTED se CONFIG_COREDUMP_UPLOADER_BLOCK_DEDUP estiver desabilitado.
+ */
+esp_err_t coredump_uploader_block_hashes(const coredump_uploader_info_t *info, size_t block_size, uint8_t *out, size_t max_blocks,
+                                        size_t *out_count, uint32_t *out_digest);
+
+/**
+ * @brief Registra em NVS o progresso que o receptor confirmou para esta imagem.
+ *
+ * Deve ser chamada pelo transporte ao receber uma confirmação (ACK) do receptor,
+ * de qualquer task. O checkpoint vale apenas para a mesma imagem e o mesmo fluxo
+ * (Base64, compressão) e é usado como ponto de retomada no próximo coredump_upload().
+ *
+ * @param info Informações do upload em andamento.
+ * @param point Partes contíguas confirmadas a partir da primeira e bytes do fluxo correspondentes.
+ * @return ESP_OK se gravado (ou inalterado).
+ * @return ESP_ERR_INVALID_ARG se o ponto não corresponder a uma fronteira de parte válida.
+ * @return ESP_ERR_NOT_SUPPORTED se CONFIG_COREDUMP_UPLOADER_RESUME estiver desabilitado.
+ */
+esp_err_t coredump_uploader_checkpoint_save(const coredump_uploader_info_t *info, const coredump_uploader_resume_t *point);
+
+/**
+ * @brief Gera um resumo compacto do coredump em JSON, a partir de esp_core_dump_get_summary().
+ *
+ * O resumo é pequeno o bastante para uma única mensagem e pode ser publicado antes da
+ * imagem completa, permitindo ao receptor triar a falha sem interpretar o ELF:
+ * {"task":"...","pc":"0x...","cause":N,"vaddr":"0x...","bt":["0x...",...],"bt_corrupted":false,"elf":"..."}
+ * Com a captura reduzida, acrescenta o que ficou fora da imagem:
+ * "trim":{"tasks":N,"dropped":N,"capped":N,"saved":B}.
+ *
+ * @param buf Buffer de saída (terminado em NUL).
+ * @param size Capacidade de 'buf'; 512 bytes comportam o backtrace completo.
+ * @param out_len Opcional: tamanho do JSON gerado, sem o terminador.
+ * @return ESP_OK se gerado.
+ * @return ESP_ERR_INVALID_SIZE se 'buf' for pequeno demais.
+ * @return ESP_ERR_NOT_SUPPORTED se CONFIG_COREDUMP_UPLOADER_SUMMARY estiver desabilitado.
+ * @return Erro de esp_core_dump_get_summary caso não haja imagem válida.
+ */
+esp_err_t coredump_uploader_summary_json(char *buf, size_t size, size_t *out_len);
+
+/**
+ * @brief Calcula a impressão digital da falha registrada no coredump.
+ *
+ * CRC32 do SHA256 do ELF, da causa da exceção e dos primeiros endereços do backtrace
+ * normalizados: estável entre ocorrências da mesma falha no mesmo firmware.
+ *
+ * @param out Impressão digital.
+ * @return ESP_OK se calculada.
+ * @return ESP_ERR_NOT_SUPPORTED se CONFIG_COREDUMP_UPLOADER_DEDUP estiver desabilitado.
+ * @return Erro de esp_core_dump_get_summary caso não haja imagem válida.
+ */
+esp_err_t coredump_uploader_fingerprint(uint32_t *out);
+
+/**
+ * @brief Registra uma ocorrência da impressão digital na tabela em NVS.
+ *
+ * A tabela guarda as CONFIG_COREDUMP_UPLOADER_DEDUP_TABLE_SIZE impressões usadas mais
+ * recentemente. A primeira ocorrência e uma a cada CONFIG_COREDUMP_UPLOADER_DEDUP_FULL_EVERY
+ * pedem o envio da imagem completa; nas demais basta informar o contador ao receptor.
+ *
+ * @param fingerprint Impressão digital obtida com coredump_uploader_fingerprint().
+ * @param out_count Ocorrências registradas, incluindo esta.
+ * @param out_full true se a imagem completa deve ser enviada.
+ * @return ESP_OK se registrada (o resultado vale mesmo se a gravação em NVS falhar).
+ * @return ESP_ERR_NOT_SUPPORTED se CONFIG_COREDUMP_UPLOADER_DEDUP estiver desabilitado.
+ */
+esp_err_t coredump_uploader_dedup_record(uint32_t fingerprint, uint32_t *out_count, bool *out_full);
+
+/**
+ * @brief Descarta o coredump sem enviá-lo (apaga a imagem e o checkpoint).
+ *
+ * Usado quando o receptor já conhece a falha e basta o incremento do contador.
+ * @return ESP_OK se apagado.
+ */
+esp_err_t coredump_uploader_discard(void);
+
+/**
+ * @brief Imagem de coredump guardada fora da partição de coredump (p.ex. um slot do spool).
+ *
+ * O resumo, a impressão digital e o TCB da task que falhou vêm de esp_core_dump_get_summary(),
+ * que só lê a partição de coredump: para uma cópia, precisam ser gravados junto com ela.
+ */
+typedef struct {
+    const esp_partition_t *partition; // Partição que contém a imagem (leitura mapeada)
+    size_t flash_addr;                // Início da imagem na flash
+    size_t size;                      // Tamanho da imagem, incluindo a soma de verificação final
+    uint32_t crashed_tcb;             // TCB da task que falhou (0 = desconhecido: prefixo só com as notas)
+    const char *summary_json;         // Resumo de coredump_uploader_summary_json() (NULL = indisponível)
+    bool has_fingerprint;             // 'fingerprint' calculada ao gravar a cópia
+    uint32_t fingerprint;
+    esp_err_t (*release)(void *arg);  // Chamado no lugar de apagar a partição de coredump
+    void *release_arg;
+} coredump_uploader_image_t;
+
+/**
+ * @brief Seleciona a imagem usada pelas demais funções do uploader.
+ *
+ * get_info, get_index, read, coredump_upload, summary_json, fingerprint e discard passam a
+ * operar sobre 'image'; enviada ou descartada, a imagem é liberada com image->release em
+ * vez de esp_core_dump_image_erase(). A estrutura é copiada, mas 'summary_json' e
+ * 'release_arg' devem continuar válidos enquanto a seleção durar.
+ *
+ * @param image Imagem a usar, ou NULL para voltar à partição de coredump.
+ * @return ESP_OK, ou ESP_ERR_INVALID_ARG se 'image' não tiver tamanho ou partição.
+ */
+esp_err_t coredump_uploader_select_image(const coredump_uploader_image_t *image);
+
+/**
+ * @brief Estatísticas de um coredump_upload(), para ajuste sem depender de logs.
+ *
+ * Durações em microssegundos (esp_timer_get_time()). "Chunk" é cada chamada bem-sucedida
+ * de 'write'; sua latência é o tempo dentro do callback.
+ */
+typedef struct {
+    uint64_t bytes_read;        // Bytes da imagem lidos da flash (inclui o trecho descartado ao retomar comprimido)
+    uint64_t bytes_sent;        // Bytes entregues ao transporte (após o Base64)
+    uint32_t parts;             // Chunks entregues
+    uint64_t read_us;           // Leitura da flash
+    uint32_t read_max_us;
+    uint64_t encode_us;         // Compressão e Base64
+    uint32_t encode_max_us;
+    uint64_t publish_us;        // Tempo total dentro de 'write'
+    uint32_t chunk_min_us;      // Latência de 'write' por chunk
+    uint32_t chunk_max_us;
+    uint32_t chunk_avg_us;
+    uint64_t throttled_us;      // Pausas impostas pelos orçamentos de banda e de CPU
+    uint32_t retries;           // Novas tentativas após falha de 'write' (modo adaptativo)
+    uint32_t failures;          // Falhas de 'write', incluindo a que encerrou o upload
+    size_t peak_work_bytes;     // Maior uso de memória de trabalho (buffers e compressor; arena ou heap)
+} coredump_uploader_stats_t;
+
+/**
+ * @brief Obtém as estatísticas do coredump_upload() em andamento ou do último concluído.
+ *
+ * Zeradas no início de cada coredump_upload(). A passada de compressão de
+ * coredump_uploader_get_info() soma em read_us/bytes_read até o upload seguinte.
+ * @param out Estrutura de saída.
+ * @return ESP_OK se disponível.
+ * @return ESP_ERR_NOT_SUPPORTED se CONFIG_COREDUMP_UPLOADER_STATS estiver desabilitado.
+ */
+esp_err_t coredump_uploader_get_stats(coredump_uploader_stats_t *out);
+
+/**
+ * @brief Tempos de envio medidos com esp_timer_get_time().
+ *
+ * Marcos em microssegundos desde o boot (0 = não ocorreu). As etapas somam as
+ * coredump_uploader_stats_t de cada tentativa sobre a imagem e guardam o pior caso:
+ * leitura da flash, codificação (compressão e Base64) e publicação (callback 'write').
+ */
+typedef struct {
+    uint32_t info_us;         // Duração de coredump_uploader_get_info() (inclui a passada de compressão)
+    int64_t upload_start_us;  // Início do primeiro coredump_upload() desta imagem
+    int64_t upload_end_us;    // Fim do último, após o callback 'end'
+    int64_t erase_done_us;    // Imagem apagada da flash (enviada ou descartada)
+    uint32_t parts;           // Partes entregues ao transporte
+    uint64_t bytes;           // Bytes entregues ao transporte (após o Base64)
+    uint64_t read_us;
+    uint32_t read_max_us;
+    uint64_t encode_us;
+    uint32_t encode_max_us;
+    uint64_t publish_us;
+    uint32_t publish_max_us;
+} coredump_uploader_metrics_t;
+
+/**
+ * @brief Obtém os tempos medidos desde o último coredump_uploader_get_info().
+ *
+ * Tentativas repetidas de coredump_upload() sobre a mesma imagem acumulam nas etapas.
+ * @param out Estrutura de saída.
+ * @return ESP_OK se disponível.
+ * @return ESP_ERR_NOT_SUPPORTED se CONFIG_COREDUMP_UPLOADER_METRICS estiver desabilitado.
+ */
+esp_err_t coredump_uploader_get_metrics(coredump_uploader_metrics_t *out);
+
+/**
+ * @brief Tarefa executada pelo serviço de upload em segundo plano.
+ *
+ * Tipicamente verifica coredump_uploader_need_upload(), prepara o transporte e chama
+ * coredump_upload().
+ * @param arg Argumento informado em coredump_uploader_service_start().
+ * @return Resultado do upload, exposto em coredump_uploader_service_status_t::result.
+ */
+typedef esp_err_t (*coredump_uploader_job_cb_t)(void *arg);
+
+/**
+ * @brief Estado do serviço de upload em segundo plano.
+ */
+typedef enum {
+    COREDUMP_UPLOADER_SERVICE_IDLE = 0, // Não iniciado
+    COREDUMP_UPLOADER_SERVICE_RUNNING,  // Tarefa em execução
+    COREDUMP_UPLOADER_SERVICE_DONE,     // Tarefa concluída com ESP_OK
+    COREDUMP_UPLOADER_SERVICE_FAILED,   // Tarefa concluída com erro
+} coredump_uploader_service_state_t;
+
+/**
+ * @brief Situação do serviço e progresso do upload em andamento.
+ */
+typedef struct {
+    coredump_uploader_service_state_t state;
+    esp_err_t result;     // Retorno da tarefa (válido em DONE/FAILED)
+    size_t stream_size;   // Tamanho do fluxo do último coredump_upload() (0 se nenhum)
+    size_t stream_sent;   // Bytes desse fluxo já entregues ao transporte
+} coredump_uploader_service_status_t;
+
+/**
+ * @brief Executa 'job' em uma task dedicada, liberando o chamador imediatamente.
+ *
+ * A task usa CONFIG_COREDUMP_UPLOADER_SERVICE_PRIORITY, _CORE e _STACK_SIZE; os envios
+ * feitos por coredump_upload() respeitam CONFIG_COREDUMP_UPLOADER_RATE_LIMIT e
+ * CONFIG_COREDUMP_UPLOADER_CPU_BUDGET. O serviço roda uma única vez por boot.
+ *
+ * @param job Tarefa a executar.
+ * @param arg Argumento repassado a 'job'.
+ * @return ESP_OK se a task foi criada.
+ * @return ESP_ERR_INVALID_STATE se o serviço já foi iniciado.
+ * @return ESP_ERR_NO_MEM se não foi possível criar a task.
+ */
+esp_err_t coredump_uploader_service_start(coredump_uploader_job_cb_t job, void *arg);
+
+/**
+ * @brief Obtém a situação do serviço. Pode ser chamada de qualquer task.
+ *
+ * Estado, resultado e progresso são lidos juntos, numa única seção crítica.
+ *
+ * @param out Estrutura de saída (NULL é ignorado).
+ */
+void coredump_uploader_service_get_status(coredump_uploader_service_status_t *out);
+
+/**
+ * @brief Aguarda a conclusão do serviço.
+ *
+ * @param timeout_ms Tempo máximo de espera; UINT32_MAX aguarda indefinidamente.
+ * @return Resultado da tarefa se concluída (ESP_OK se o serviço nunca foi iniciado).
+ * @return ESP_ERR_TIMEOUT se ainda estiver em execução ao fim do prazo.
+ */
+esp_err_t coredump_uploader_service_wait(uint32_t timeout_ms);
+
 #endif // COREDUMP_UPLOADER_H
@@ -0,0 +1,123 @@
+#include "fault_campaign.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "faults.h"
+#include "nvs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "fault_campaign";
+
+#define CAMPAIGN_NVS_NAMESPACE "fault_camp"
+#define CAMPAIGN_NVS_KEY "spec"
+#define CAMPAIGN_VERSION 1
+#define CAMPAIGN_DEFAULT_DELAY_MS 1000
+
+static long _json_long(const char *json, const char *key, long fallback) {
+    char pattern[40];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *field = strstr(json, pattern);
+    return field ? strtol(field + strlen(pattern), NULL, 10) : fallback;
+}
+
+static uint32_t _xorshift32(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+esp_err_t fault_campaign_parse(const char *spec, fault_campaign_t *out) {
+    if (!spec || !out)
+        return ESP_ERR_INVALID_ARG;
+    long count = _json_long(spec, "count", -1);
+    long delay = _json_long(spec, "delay_ms", CAMPAIGN_DEFAULT_DELAY_MS);
+    long jitter = _json_long(spec, "jitter_ms", 0);
+    if (count < 1 || count > UINT16_MAX || delay < 0 || jitter < 0)
+        return ESP_ERR_INVALID_ARG;
+
+    memset(out, 0, sizeof(*out));
+    out->version = CAMPAIGN_VERSION;
+    out->last = -1;
+    out->total = (uint16_t)count;
+    out->delay_ms = (uint32_t)delay;
+    out->jitter_ms = (uint32_t)jitter;
+    out->rng = (uint32_t)_json_long(spec, "seed", 0);
+    if (out->rng == 0)
+        out->rng = esp_random() | 1; // xorshift não sai do zero
+
+    size_t n_types;
+    const fault_type_t *types = faults_get_types(&n_types);
+    bool any = false;
+    for (size_t i = 0; i < n_types && i < FAULT_CAMPAIGN_MAX_TYPES; ++i) {
+        long w = _json_long(spec, types[i].name, 0);
+        out->weights[i] = (uint8_t)(w < 0 ? 0 : (w > UINT8_MAX ? UINT8_MAX : w));
+        any |= out->weights[i] > 0;
+    }
+    return any ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t fault_campaign_save(const fault_campaign_t *c) {
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(CAMPAIGN_NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK)
+        return err;
+    err = nvs_set_blob(h, CAMPAIGN_NVS_KEY, c, sizeof(*c));
+    if (err == ESP_OK)
+        err = nvs_commit(h);
+    nvs_close(h);
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "Falha ao gravar campanha (%s)", esp_err_to_name(err));
+    return err;
+}
+
+bool fault_campaign_load(fault_campaign_t *out) {
+    nvs_handle_t h;
+    if (nvs_open(CAMPAIGN_NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK)
+        return false;
+    size_t len = sizeof(*out);
+    esp_err_t err = nvs_get_blob(h, CAMPAIGN_NVS_KEY, out, &len);
+    nvs_close(h);
+    return err == ESP_OK && len == sizeof(*out) && out->version == CAMPAIGN_VERSION;
+}
+
+esp_err_t fault_campaign_clear(void) {
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(CAMPAIGN_NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK)
+        return err;
+    err = nvs_erase_key(h, CAMPAIGN_NVS_KEY);
+    if (err == ESP_OK)
+        err = nvs_commit(h);
+    nvs_close(h);
+    return err == ESP_ERR_NVS_NOT_FOUND ? ESP_OK : err;
+}
+
+int fault_campaign_next(fault_campaign_t *c, uint32_t *delay_ms) {
+    if (!c || c->done >= c->total)
+        return -1;
+    size_t n_types;
+    faults_get_types(&n_types);
+    uint32_t sum = 0;
+    for (size_t i = 0; i < n_types && i < FAULT_CAMPAIGN_MAX_TYPES; ++i)
+        sum += c->weights[i];
+    if (sum == 0)
+        return -1;
+
+    // Sorteio ponderado pelos pesos; o estado do gerador segue gravado, a sequência é reprodutível
+    uint32_t r = _xorshift32(&c->rng) % sum;
+    int type = 0;
+    while (r >= c->weights[type])
+        r -= c->weights[type++];
+    uint32_t jitter = c->jitter_ms ? _xorshift32(&c->rng) % (c->jitter_ms + 1) : 0;
+
+    c->done++;
+    c->last = (int8_t)type;
+    if (fault_campaign_save(c) != ESP_OK)
+        return -1; // Sem o progresso gravado a campanha repetiria a mesma falha para sempre
+    if (delay_ms)
+        *delay_ms = c->delay_ms + jitter;
+    return type;
+}
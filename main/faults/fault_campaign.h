@@ -0,0 +1,84 @@
+#pragma once
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Campanha de injeção de falhas executada pelo próprio dispositivo: a especificação
+ * fica em NVS e, após cada boot com o upload concluído, a aplicação sorteia e provoca
+ * a próxima falha, sem novo comando pela rede.
+ *
+ * Especificação (JSON plano, payload de até 255 bytes):
+ *   {"count":100,"delay_ms":2000,"jitter_ms":500,"seed":7,"LoadProhibited":3,"StoreProhibited":1}
+ *
+ *   count      Falhas a provocar (1 a 65535, obrigatório)
+ *   delay_ms   Espera após o upload antes de cada falha (padrão 1000)
+ *   jitter_ms  Variação aleatória somada à espera, de 0 a jitter_ms (padrão 0)
+ *   seed       Semente do sorteio, para campanhas reprodutíveis (padrão aleatória)
+ *   <nome>     Peso (1 a 255) de cada tipo de faults_get_types(); tipos ausentes não são sorteados
+ */
+
+// Máximo de tipos de falha que uma campanha comporta
+#define FAULT_CAMPAIGN_MAX_TYPES 8
+
+/**
+ * @brief Estado da campanha, gravado em NVS.
+ */
+typedef struct {
+    uint8_t version;                            // Formato do registro em NVS
+    int8_t last;                                // Tipo da última falha provocada (-1 = nenhuma)
+    uint16_t total;                             // Falhas a provocar
+    uint16_t done;                              // Falhas já provocadas
+    uint32_t delay_ms;                          // Espera após o upload antes da próxima falha
+    uint32_t jitter_ms;                         // Variação máxima somada à espera
+    uint32_t rng;                               // Estado do sorteio (xorshift32)
+    uint8_t weights[FAULT_CAMPAIGN_MAX_TYPES];  // Peso de cada tipo, índice em faults_get_types()
+} fault_campaign_t;
+
+/**
+ * @brief Interpreta uma especificação de campanha.
+ *
+ * @param spec Texto JSON terminado em NUL.
+ * @param out Campanha pronta para fault_campaign_save(), com done = 0.
+ *
+ * @return ESP_OK ou ESP_ERR_INVALID_ARG (count ausente/fora do intervalo ou nenhum peso).
+ */
+esp_err_t fault_campaign_parse(const char *spec, fault_campaign_t *out);
+
+/**
+ * @brief Grava a campanha em NVS, substituindo a anterior.
+ */
+esp_err_t fault_campaign_save(const fault_campaign_t *c);
+
+/**
+ * @brief Carrega a campanha de NVS.
+ *
+ * @return true se houver campanha gravada (concluída ou não).
+ */
+bool fault_campaign_load(fault_campaign_t *out);
+
+/**
+ * @brief Remove a campanha de NVS.
+ */
+esp_err_t fault_campaign_clear(void);
+
+/**
+ * @brief Sorteia a próxima falha e grava o progresso antes de ela ser provocada.
+ *
+ * O contador é incrementado em NVS primeiro: a falha reinicia o dispositivo e a
+ * campanha continua da seguinte no próximo boot.
+ *
+ * @param c Campanha carregada; atualizada com o novo progresso.
+ * @param delay_ms Recebe a espera sorteada antes de provocar a falha.
+ *
+ * @return Índice em faults_get_types(), ou -1 se a campanha já terminou ou a gravação falhou.
+ */
+int fault_campaign_next(fault_campaign_t *c, uint32_t *delay_ms);
+
+#ifdef __cplusplus
+}
+#endif
@@ -44,4 +44,19 @@ void stack_overflow_task(void * pvParameters) {
 
 void stack_overflow_start(void) {
     xTaskCreate(stack_overflow_task, "StackOverflow", 2048, NULL, 5, NULL);
-}
\ No newline at end of file
+}
+
+// A ordem é parte do formato das campanhas gravadas em NVS: novos tipos entram no fim
+static const fault_type_t fault_types[] = {
+    {"IllegalInstructionCause", illegal_instruction_start, "instrução ilegal"},
+    {"LoadProhibited", load_prohibited_start, "acesso a memória inválida"},
+    {"StoreProhibited", store_prohibited_start, "escrita em memória inválida"},
+    {"IntegerDivideByZero", integer_divide_by_zero_start, "divisão por zero"},
+    {"Stack Overflow", stack_overflow_start, "estouro de pilha"},
+};
+
+const fault_type_t *faults_get_types(size_t *count) {
+    if (count)
+        *count = sizeof(fault_types) / sizeof(fault_types[0]);
+    return fault_types;
+}
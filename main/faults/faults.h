@@ -1,9 +1,28 @@
 #pragma once
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Tipo de falha que pode ser provocada por comando ou campanha.
+ */
+typedef struct {
+    const char *name;         // Nome do comando MQTT (payload exato)
+    void (*start)(void);      // Função que provoca a falha
+    const char *description;  // Descrição para os logs
+} fault_type_t;
+
+/**
+ * @brief Obtém a tabela dos tipos de falha disponíveis.
+ *
+ * @param count Recebe a quantidade de entradas.
+ *
+ * @return Tabela estática, na ordem usada pelos índices das campanhas.
+ */
+const fault_type_t *faults_get_types(size_t *count);
+
 /**
  * @brief Cria uma falha de instrução ilegal.
  */
@@ -1,162 +1,1261 @@
+#include "coredump_capture.h"
+#include "coredump_http.h"
+#include "coredump_spool.h"
 #include "coredump_uploader.h"
+#include "esp_core_dump.h"
 #include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "fault_campaign.h"
 #include "faults.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "mqtt_app.h"
+#include "mqtt_dispatch.h"
+#include "mqtt_tls.h"
 #include "nvs_flash.h"
+#include "sdkconfig.h"
 #include "wifi.h"
+#include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 static const char *TAG = "APP";
 
-/** Fila para mensagens MQTT recebidas */
-static QueueHandle_t mqtt_queue = NULL;
+// Codificação das partes do coredump (binário por padrão; Base64 via menuconfig)
+#if CONFIG_COREDUMP_UPLOADER_USE_BASE64
+#define COREDUMP_USE_BASE64 true
+#else
+#define COREDUMP_USE_BASE64 false
+#endif
+
+// Tópico dos comandos de injeção de falha
+#define FAULT_INJECTION_TOPIC "device/fault_injection"
+// Especificação e comandos ("abort", "resume", "status") das campanhas; progresso em "<tópico>/status"
+#define FAULT_CAMPAIGN_TOPIC "device/fault_campaign"
+#define FAULT_CAMPAIGN_STATUS_TOPIC FAULT_CAMPAIGN_TOPIC "/status"
+
+#if CONFIG_COREDUMP_UPLOADER_METRICS
+// Marcos do boot (esp_timer_get_time), publicados junto com os tempos do upload
+static struct {
+    int64_t app_us;   // Entrada em app_main
+    int64_t ip_us;    // Wi-Fi conectado com IP
+    int64_t mqtt_us;  // Cliente MQTT conectado
+} s_boot_times;
+#endif
+
+#if CONFIG_MQTT_APP_PROTOCOL_V5
+// MQTT 5: todas as partes em "<topic>/part", numeradas pelos dados de correlação
+#define MQTT_PART_TOPIC_SUFFIX "part"
+// Dados de correlação de cada parte: n, CRC32 e, com particionamento fixo, o total (uint32 big-endian)
+#define MQTT_PART_CORRELATION_MAX 12
+// Comprimento das propriedades (4) + dados de correlação (identificador e comprimento: 3)
+#define MQTT_PART_PROPERTIES_SIZE (4 + 3 + MQTT_PART_CORRELATION_MAX)
+#endif
 
 // Contexto para upload do coredump via MQTT
 typedef struct {
     char topic[128];      // Tópico MQTT para envio do coredump
     int part_quantity;    // Quantidade total de partes do coredump
     int part_count;       // Contador de partes já enviadas
+    bool use_base64;      // Codificação das partes declarada na mensagem inicial
+    char ack_topic[140];  // Tópico onde o backend confirma as partes recebidas
+    const coredump_uploader_info_t *info; // Upload em andamento (fluxo, checkpoint), sob 'info_lock'
+    SemaphoreHandle_t info_lock;          // Protege 'info' entre a task de upload e o callback de ACK
+    SemaphoreHandle_t ack_sem;            // Sinalizado a cada ACK recebido
+    volatile bool acked;                  // Recebeu ao menos um ACK válido
+    volatile bool rejected;               // Backend rejeitou uma parte (CRC) e pediu reenvio
+    bool has_fingerprint;                 // 'fingerprint' calculada (declarada na mensagem inicial)
+    uint32_t fingerprint;                 // Impressão digital da falha
+    volatile bool full_requested;         // Backend pediu a imagem completa de uma falha repetida
+    coredump_uploader_resume_t ack;       // Último progresso confirmado pelo backend, sob 'info_lock'
+    volatile bool checkpoint_pending;     // 'ack' ainda não gravado em NVS pela task de upload
+    const char *extra_meta;               // Campos JSON extras da mensagem inicial (",\"seq\":..."), ou NULL
 } mqtt_coredump_ctx_t;
 
 // --- Callbacks para upload do coredump via MQTT ---
 
+#if CONFIG_COREDUMP_UPLOADER_TRANSPORT_MQTT || CONFIG_COREDUMP_UPLOADER_TRANSPORT_PULL
+// Acrescenta a uma mensagem JSON os campos do prefixo com a task que falhou ("pfx"/"first"), se houver
+static int format_prefix_fields(char *buf, size_t size, const coredump_uploader_info_t *info) {
+    if (!info->prefix_size)
+        return 0;
+    int n = snprintf(buf, size, ",\"pfx\":%u,\"first\":[", (unsigned)info->prefix_size);
+    for (size_t i = 0; i < info->first_count; i++)
+        n += snprintf(buf + n, size - n, i ? ",%u" : "%u", (unsigned)info->first_segments[i]);
+    n += snprintf(buf + n, size - n, "]");
+    return n;
+}
+#endif
+#if CONFIG_COREDUMP_UPLOADER_TRANSPORT_MQTT
 // Callback chamado no início do upload do coredump
 static esp_err_t mqtt_coredump_start(void *priv) {
     mqtt_coredump_ctx_t *ctx = (mqtt_coredump_ctx_t *)priv;
     ESP_LOGI(TAG, "Iniciando envio do coredump para o tópico: %s (%d partes)", ctx->topic, ctx->part_quantity);
-    char start_msg[64];
-    // Publica mensagem inicial informando a quantidade de partes
-    snprintf(start_msg, sizeof(start_msg), "{\"parts\":%d}", ctx->part_quantity);
+    const coredump_uploader_info_t *info = ctx->info;
+    // Descarta ACKs de uma tentativa anterior: o próximo ACK responde a esta mensagem inicial
+    ctx->acked = false;
+    ctx->rejected = false;
+    if (ctx->ack_sem)
+        xSemaphoreTake(ctx->ack_sem, 0);
+    char start_msg[320];
+    // Publica mensagem inicial: tamanho do fluxo ("bytes"), codificação, tamanho e CRC32 da imagem
+    // ("size"/"crc"), compressão, com a imagem reordenada o prefixo ("pfx"/"first") e, vinda do
+    // spool, a origem da imagem. A quantidade de partes só é conhecida de antemão sem o
+    // particionamento adaptativo.
+    int n = snprintf(start_msg, sizeof(start_msg), "{\"bytes\":%u,\"enc\":\"%s\",\"id\":\"%08" PRIx32 "\",\"size\":%u,\"crc\":\"%08" PRIx32 "\"",
+                     (unsigned)info->compressed_size, ctx->use_base64 ? "base64" : "raw", info->image_crc, (unsigned)info->total_size,
+                     info->image_digest);
+    if (!info->adaptive)
+        n += snprintf(start_msg + n, sizeof(start_msg) - n, ",\"parts\":%d", ctx->part_quantity);
+    if (ctx->has_fingerprint)
+        n += snprintf(start_msg + n, sizeof(start_msg) - n, ",\"fp\":\"%08" PRIx32 "\"", ctx->fingerprint);
+    if (info->compressed)
+        n += snprintf(start_msg + n, sizeof(start_msg) - n, ",\"comp\":\"deflate\"");
+    n += format_prefix_fields(start_msg + n, sizeof(start_msg) - n, info);
+    if (ctx->extra_meta)
+        n += snprintf(start_msg + n, sizeof(start_msg) - n, "%s", ctx->extra_meta);
+    snprintf(start_msg + n, sizeof(start_msg) - n, "}");
     publish_message(ctx->topic, start_msg, strlen(start_msg), 1);
     return ESP_OK;
 }
+#endif
 
-// Callback chamado para enviar cada parte do coredump
-static esp_err_t mqtt_coredump_write(void *priv, const char *data, size_t len) {
+// Lê um campo inteiro não negativo de um JSON simples; -1 se ausente
+static long json_field_long(const char *json, const char *key) {
+    char pattern[24];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *field = strstr(json, pattern);
+    return field ? strtol(field + strlen(pattern), NULL, 10) : -1;
+}
+
+// Callback do tópico de ACK: {"next":N,"bytes":B} = partes contíguas e bytes do fluxo já recebidos;
+// "resend" indica que uma parte foi rejeitada e o envio deve ser retomado a partir de N.
+// {"full":0|1} responde ao contador de uma falha repetida.
+static void mqtt_coredump_ack(const char *data, int len, void *arg) {
+    mqtt_coredump_ctx_t *ctx = (mqtt_coredump_ctx_t *)arg;
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*s", len, data);
+    long full = json_field_long(buf, "full");
+    if (full >= 0) {
+        ctx->full_requested = full > 0;
+        xSemaphoreGive(ctx->ack_sem);
+        return;
+    }
+    long next = json_field_long(buf, "next");
+    long bytes = json_field_long(buf, "bytes");
+    // A task de upload limpa 'info' ao terminar: lido e usado sob o mesmo lock
+    xSemaphoreTake(ctx->info_lock, portMAX_DELAY);
+    const coredump_uploader_info_t *info = ctx->info;
+    if (!info) {
+        xSemaphoreGive(ctx->info_lock);
+        return; // Upload ainda não começou (ou já terminou)
+    }
+    if (next < 0 || bytes < 0 || (size_t)bytes > info->compressed_size) {
+        xSemaphoreGive(ctx->info_lock);
+        ESP_LOGW(TAG, "ACK inválido: %s", buf);
+        return;
+    }
+    ctx->ack = (coredump_uploader_resume_t){.next_chunk = (size_t)next, .stream_offset = (size_t)bytes};
+    ctx->acked = true;
+    if (json_field_long(buf, "resend") >= 0)
+        ctx->rejected = true;
+    // O commit em NVS fica com a task de upload: aqui, na task do cliente MQTT, pararia o keepalive
+    ctx->checkpoint_pending = true;
+    xSemaphoreGive(ctx->info_lock);
+    xSemaphoreGive(ctx->ack_sem);
+}
+
+#if CONFIG_COREDUMP_UPLOADER_TRANSPORT_MQTT
+// Grava em NVS o último progresso confirmado, se houver um novo. Só na task de upload, dona de 'info'.
+static void mqtt_coredump_save_checkpoint(mqtt_coredump_ctx_t *ctx) {
+    if (!ctx->checkpoint_pending)
+        return;
+    xSemaphoreTake(ctx->info_lock, portMAX_DELAY);
+    coredump_uploader_resume_t point = ctx->ack;
+    const coredump_uploader_info_t *info = ctx->info;
+    ctx->checkpoint_pending = false;
+    xSemaphoreGive(ctx->info_lock);
+    if (info)
+        coredump_uploader_checkpoint_save(info, &point);
+}
+
+// Callback de retomada: aguarda o backend informar quantas partes já possui
+static esp_err_t mqtt_coredump_resume(void *priv, const coredump_uploader_info_t *info, coredump_uploader_resume_t *point) {
     mqtt_coredump_ctx_t *ctx = (mqtt_coredump_ctx_t *)priv;
-    ctx->part_count++;
+#if CONFIG_COREDUMP_UPLOADER_RESUME
+    if (xSemaphoreTake(ctx->ack_sem, pdMS_TO_TICKS(CONFIG_COREDUMP_UPLOADER_RESUME_ACK_TIMEOUT_MS)) == pdTRUE && ctx->acked) {
+        mqtt_coredump_save_checkpoint(ctx);
+        xSemaphoreTake(ctx->info_lock, portMAX_DELAY);
+        *point = ctx->ack;
+        xSemaphoreGive(ctx->info_lock);
+    } else {
+        ESP_LOGW(TAG, "Sem ACK do backend, usando checkpoint local (%u partes).", (unsigned)point->next_chunk);
+    }
+#else
+    *point = (coredump_uploader_resume_t){0};
+#endif
+    // As partes são numeradas a partir de 1: a próxima publicada é next_chunk + 1
+    ctx->part_count = (int)point->next_chunk;
+    return ESP_OK;
+}
 
-    // O tópico dinâmico para indicar a parte atual
-    char part_topic[150];
-    snprintf(part_topic, sizeof(part_topic), "%s/%d", ctx->topic, ctx->part_count);
+#if CONFIG_MQTT_APP_PROTOCOL_V5
+static void put_be32(uint8_t *out, uint32_t v) {
+    out[0] = (uint8_t)(v >> 24);
+    out[1] = (uint8_t)(v >> 16);
+    out[2] = (uint8_t)(v >> 8);
+    out[3] = (uint8_t)v;
+}
+#endif
+
+// Callback chamado para enviar cada parte do coredump
+static esp_err_t mqtt_coredump_write(void *priv, const char *data, size_t len, uint32_t crc) {
+    mqtt_coredump_ctx_t *ctx = (mqtt_coredump_ctx_t *)priv;
+    mqtt_coredump_save_checkpoint(ctx); // Um commit por ACK recebido, entre as partes
+    int part = ctx->part_count + 1;
+    char part_topic[160];
+#if CONFIG_MQTT_APP_PROTOCOL_V5
+    // Tópico único "<topic>/part"; parte, CRC32 e total vão em binário nos dados de correlação,
+    // mais curtos que as propriedades de usuário equivalentes
+    uint8_t correlation[MQTT_PART_CORRELATION_MAX];
+    uint16_t correlation_len = 8;
+    snprintf(part_topic, sizeof(part_topic), "%s/" MQTT_PART_TOPIC_SUFFIX, ctx->topic);
+    put_be32(correlation, (uint32_t)part);
+    put_be32(correlation + 4, crc);
+    if (ctx->part_quantity > 0) {
+        put_be32(correlation + 8, (uint32_t)ctx->part_quantity);
+        correlation_len = 12;
+    }
+#else
+    // O tópico dinâmico indica a parte atual e o CRC32 do payload: "<topic>/<n>/<crc>"
+    snprintf(part_topic, sizeof(part_topic), "%s/%d/%08" PRIx32, ctx->topic, part, crc);
+#endif
 
-    ESP_LOGI(TAG, "Enviando parte %d do coredump (%d bytes)", ctx->part_count, len);
-    // Publica a parte atual do coredump
-    if (publish_message(part_topic, data, len, 1) == false) {
+#if CONFIG_COREDUMP_UPLOADER_CHUNK_LOGS
+    ESP_LOGI(TAG, "Enviando parte %d do coredump (%d bytes)", part, len);
+#endif
+    // Publica a parte atual do coredump; só avança a numeração se foi aceita (o uploader pode reenviar)
+#if CONFIG_MQTT_APP_PROTOCOL_V5
+    bool published = publish_message_v5(part_topic, data, len, 1, NULL, 0, correlation, correlation_len);
+#else
+    bool published = publish_message(part_topic, data, len, 1);
+#endif
+    if (!published) {
         ESP_LOGE(TAG, "Falha ao publicar coredump via MQTT.");
         return ESP_FAIL;
     }
+    ctx->part_count = part;
     return ESP_OK;
 }
 
+#if CONFIG_COREDUMP_UPLOADER_CHUNK_LOGS
 // Callback de progresso do upload
 static esp_err_t progress_cb(void *priv, const coredump_uploader_info_t *info, size_t chunk_index, size_t bytes_sent) {
     ESP_LOGI(TAG, "Chunk %u/%u (%u bytes enviados este passo)", (unsigned)(chunk_index + 1), (unsigned)info->chunk_count, (unsigned)bytes_sent);
     return ESP_OK;
 }
+#endif
 
 // Callback chamado ao finalizar o upload do coredump
 static esp_err_t mqtt_coredump_end(void *priv) {
     mqtt_coredump_ctx_t *ctx = (mqtt_coredump_ctx_t *)priv;
     ESP_LOGI(TAG, "Finalizado envio do coredump em %d partes.", ctx->part_count);
+    mqtt_app_publish_stats_t stats;
+    mqtt_app_get_publish_stats(&stats);
+    ESP_LOGI(TAG, "Janela MQTT: K=%d, pico em voo=%d, bloqueios=%u (%u ms), timeouts=%u", stats.window, stats.peak_in_flight,
+             (unsigned)stats.stalls, (unsigned)stats.stall_ms, (unsigned)stats.timeouts);
+
+    // Só libera o apagamento da imagem quando o backend confirmar o fluxo inteiro. Sem nenhum
+    // ACK (backend legado) mantém o comportamento anterior.
+    if (!ctx->ack_sem)
+        return ESP_OK;
+    size_t total = ctx->info->compressed_size;
+    while (!ctx->rejected && !(ctx->acked && ctx->ack.stream_offset >= total)) {
+        if (xSemaphoreTake(ctx->ack_sem, pdMS_TO_TICKS(CONFIG_COREDUMP_UPLOADER_ACK_TIMEOUT_MS)) != pdTRUE)
+            break;
+    }
+    mqtt_coredump_save_checkpoint(ctx);
+    if (ctx->rejected || (ctx->acked && ctx->ack.stream_offset < total)) {
+        ESP_LOGW(TAG, "Backend confirmou %u de %u bytes%s.", (unsigned)ctx->ack.stream_offset, (unsigned)total,
+                 ctx->rejected ? " (parte rejeitada por CRC)" : "");
+        return ESP_ERR_INVALID_CRC;
+    }
     return ESP_OK;
 }
+#endif
 
-// --- Lógica principal da aplicação ---
+#if CONFIG_COREDUMP_UPLOADER_SUMMARY
+// Publica o resumo da falha antes da imagem completa: o backend tria sem esperar a montagem
+static void mqtt_coredump_publish_summary(const char *topic) {
+    char summary[512];
+    size_t len = 0;
+    if (coredump_uploader_summary_json(summary, sizeof(summary), &len) != ESP_OK)
+        return;
+    char summary_topic[140];
+    snprintf(summary_topic, sizeof(summary_topic), "%s/summary", topic);
+    if (publish_message(summary_topic, summary, len, 1))
+        ESP_LOGI(TAG, "Resumo do coredump publicado (%u bytes): %s", (unsigned)len, summary);
+    else
+        ESP_LOGW(TAG, "Falha ao publicar resumo do coredump.");
+}
+#endif
 
-// Verifica se há coredump para enviar e realiza o upload via MQTT
-void check_and_upload_coredump(void) {
-    if (coredump_uploader_need_upload()) {
-        ESP_LOGW(TAG, "Detectada condição de falha. Tentando enviar coredump...");
+#if CONFIG_COREDUMP_UPLOADER_DEDUP
+// Falha repetida: publica só o contador em "<topic>/dup" e descarta a imagem, a menos que seja a
+// vez do envio completo ou que o backend peça a imagem. Retorna true se a imagem deve ser enviada.
+static bool mqtt_coredump_dedup(mqtt_coredump_ctx_t *ctx) {
+    uint32_t count = 0;
+    bool full = true;
+    if (coredump_uploader_fingerprint(&ctx->fingerprint) != ESP_OK ||
+        coredump_uploader_dedup_record(ctx->fingerprint, &count, &full) != ESP_OK)
+        return true;
+    ctx->has_fingerprint = true;
+    if (full)
+        return true;
+
+    char topic[140];
+    char msg[64];
+    snprintf(topic, sizeof(topic), "%s/dup", ctx->topic);
+    int len = snprintf(msg, sizeof(msg), "{\"fp\":\"%08" PRIx32 "\",\"count\":%" PRIu32 "}", ctx->fingerprint, count);
+    ctx->full_requested = false;
+    if (ctx->ack_sem)
+        xSemaphoreTake(ctx->ack_sem, 0);
+    if (!publish_message(topic, msg, len, 1))
+        return true; // Sem confirmação de que o backend contou a ocorrência: envia a imagem
+
+    // O backend responde {"full":1} se não tiver a falha registrada (p.ex. banco recriado); sem
+    // resposta não há como saber se a ocorrência foi contada, então a imagem é enviada
+    if (!ctx->ack_sem || xSemaphoreTake(ctx->ack_sem, pdMS_TO_TICKS(CONFIG_COREDUMP_UPLOADER_ACK_TIMEOUT_MS)) != pdTRUE) {
+        ESP_LOGW(TAG, "Sem resposta do backend ao contador, enviando imagem completa.");
+        return true;
+    }
+    if (ctx->full_requested) {
+        ESP_LOGI(TAG, "Backend pediu a imagem completa da falha %08" PRIx32 ".", ctx->fingerprint);
+        return true;
+    }
+    ESP_LOGI(TAG, "Falha %08" PRIx32 " repetida (%" PRIu32 "x): enviado apenas o contador.", ctx->fingerprint, count);
+    coredump_uploader_discard();
+    return false;
+}
+#endif
+
+#if CONFIG_COREDUMP_UPLOADER_METRICS
+// Publica em "metrics/<mac>" os marcos do boot e do upload (ms desde o boot; ausentes são
+// omitidos), o caminho da conexão Wi-Fi (wifi_connect_path_t), o último handshake TLS, as imagens
+// enviadas na sessão e, do último upload, o tempo somado e o pior caso por parte de leitura,
+// codificação e publicação (us)
+static void mqtt_publish_metrics(const char *mac, esp_err_t result, size_t images) {
+    coredump_uploader_metrics_t m;
+    coredump_uploader_get_metrics(&m);
+    wifi_connect_info_t wifi;
+    wifi_get_connect_info(&wifi);
+    mqtt_tls_stats_t tls;
+    mqtt_tls_get_stats(&tls);
+    const struct {
+        const char *key;
+        int64_t us;
+    } marks[] = {
+        {"boot_ms", s_boot_times.app_us},
+        {"wifi_ms", wifi.start_us},
+        {"ip_ms", s_boot_times.ip_us},
+        {"mqtt_ms", s_boot_times.mqtt_us},
+        {"start_ms", m.upload_start_us},
+        {"end_ms", m.upload_end_us},
+        {"erase_ms", m.erase_done_us},
+    };
+    char msg[512];
+    int n = snprintf(msg, sizeof(msg), "{\"reset\":%d,\"result\":%d,\"wifi_path\":%d,\"images\":%u", (int)esp_reset_reason(), (int)result,
+                     (int)wifi.path, (unsigned)images);
+    for (size_t i = 0; i < sizeof(marks) / sizeof(marks[0]); ++i) {
+        if (marks[i].us > 0)
+            n += snprintf(msg + n, sizeof(msg) - n, ",\"%s\":%" PRId64, marks[i].key, marks[i].us / 1000);
+    }
+    if (tls.handshakes)
+        n += snprintf(msg + n, sizeof(msg) - n, ",\"tls_us\":%" PRId64 ",\"tls_resume\":%d", tls.handshake_us, tls.session_offered);
+    snprintf(msg + n, sizeof(msg) - n,
+             ",\"info_us\":%" PRIu32 ",\"parts\":%" PRIu32 ",\"bytes\":%" PRIu64 ",\"read_us\":%" PRIu64 ",\"read_max_us\":%" PRIu32
+             ",\"enc_us\":%" PRIu64 ",\"enc_max_us\":%" PRIu32 ",\"pub_us\":%" PRIu64 ",\"pub_max_us\":%" PRIu32 "}",
+             m.info_us, m.parts, m.bytes, m.read_us, m.read_max_us, m.encode_us, m.encode_max_us, m.publish_us, m.publish_max_us);
+
+    char topic[32];
+    snprintf(topic, sizeof(topic), "metrics/%s", mac);
+    if (publish_message(topic, msg, strlen(msg), 1))
+        ESP_LOGI(TAG, "Métricas publicadas: %s", msg);
+    else
+        ESP_LOGW(TAG, "Falha ao publicar métricas.");
+}
+#endif
+
+#if !CONFIG_COREDUMP_UPLOADER_TRANSPORT_PULL
+// Um único resumo no lugar dos logs por parte
+static void log_upload_stats(void) {
+#if CONFIG_COREDUMP_UPLOADER_STATS
+    coredump_uploader_stats_t stats;
+    if (coredump_uploader_get_stats(&stats) == ESP_OK) {
+        ESP_LOGI(TAG, "Upload: %" PRIu32 " partes, %" PRIu64 " bytes lidos, %" PRIu64 " enviados, pico de memória %u bytes", stats.parts,
+                 stats.bytes_read, stats.bytes_sent, (unsigned)stats.peak_work_bytes);
+        ESP_LOGI(TAG, "Tempos (us): leitura %" PRIu64 ", codificação %" PRIu64 ", publicação %" PRIu64 " (chunk min/méd/max %" PRIu32 "/%" PRIu32
+                 "/%" PRIu32 "), pausas %" PRIu64 "; %" PRIu32 " novas tentativas, %" PRIu32 " falhas",
+                 stats.read_us, stats.encode_us, stats.publish_us, stats.chunk_min_us, stats.chunk_avg_us, stats.chunk_max_us, stats.throttled_us,
+                 stats.retries, stats.failures);
+    }
+#endif
+}
+#endif
+
+#if CONFIG_COREDUMP_UPLOADER_TRANSPORT_MQTT
+// Obtém o particionamento e envia o coredump pelos callbacks MQTT
+static esp_err_t mqtt_coredump_upload(mqtt_coredump_ctx_t *ctx) {
+    coredump_uploader_info_t info;
+#if CONFIG_MQTT_APP_PROTOCOL_V5
+    // Partes dimensionadas pelo buffer de saída: tópico "<topic>/part" (as partes são QoS 1 e
+    // sempre levam o nome) e os dados de correlação em todas
+    size_t max_chunk = mqtt_app_max_payload(strlen(ctx->topic) + 1 + strlen(MQTT_PART_TOPIC_SUFFIX) + MQTT_PART_PROPERTIES_SIZE);
+#else
+    // Partes dimensionadas pelo buffer de saída do cliente MQTT (tópico "<topic>/<n>/<crc>")
+    size_t max_chunk = mqtt_app_max_payload(strlen(ctx->topic) + 15);
+#endif
+    if (ctx->use_base64)
+        max_chunk = (max_chunk / 4) * 3; // Tamanho bruto cujo Base64 cabe no payload
+#if !CONFIG_COREDUMP_UPLOADER_ADAPTIVE_CHUNK
+    max_chunk = 0; // Particionamento fixo: usa o chunk padrão do uploader
+#endif
+    esp_err_t err = coredump_uploader_get_info(&info, max_chunk, ctx->use_base64);
+    if (err != ESP_OK) {
+        ESP_LOGI("APP", "Sem coredump ou erro (%s).", esp_err_to_name(err));
+        return err;
+    }
+    ctx->part_quantity = info.chunk_count;
+    if (ctx->info_lock)
+        xSemaphoreTake(ctx->info_lock, portMAX_DELAY);
+    ctx->info = &info;
+    if (ctx->info_lock)
+        xSemaphoreGive(ctx->info_lock);
+
+    coredump_uploader_callbacks_t uploader_cbs = {
+        .start = mqtt_coredump_start,
+        .write_chunk = mqtt_coredump_write,
+#if CONFIG_COREDUMP_UPLOADER_CHUNK_LOGS
+        .progress = progress_cb,
+#endif
+        .end = mqtt_coredump_end,
+        .resume = ctx->ack_sem ? mqtt_coredump_resume : NULL,
+        .priv = ctx,
+    };
+
+    // Binário ou Base64, conforme menuconfig. Se o backend rejeitar partes, uma nova
+    // tentativa retoma a partir da primeira parte faltante.
+    err = coredump_upload(&uploader_cbs, &info);
+    if (err == ESP_ERR_INVALID_CRC) {
+        ESP_LOGW(TAG, "Reenviando partes rejeitadas pelo backend...");
+        err = coredump_upload(&uploader_cbs, &info);
+    }
+    // 'info' sai de escopo: nenhum ACK em andamento pode continuar usando-o
+    if (ctx->info_lock)
+        xSemaphoreTake(ctx->info_lock, portMAX_DELAY);
+    ctx->info = NULL;
+    if (ctx->info_lock)
+        xSemaphoreGive(ctx->info_lock);
+    log_upload_stats();
+    return err;
+}
+#endif
+
+#if CONFIG_COREDUMP_UPLOADER_BLOCK_DEDUP
+// --- Envio por blocos endereçados pelo conteúdo ---
+
+// O manifesto vai em "<tópico>/manifest" com o endereço (SHA256 truncado) de cada bloco; o backend
+// responde em "<tópico>/need" com {"id":"...","need":"<bitmap hex>"} os blocos que não tem no seu
+// armazenamento, publicados em "<tópico>/block/<índice>/<crc>", e {"id":"...","done":1} ao remontar
+#define BLOCK_MANIFEST_MAX 128 // Blocos por imagem: 128 KB com blocos de 1 KB
+#define BLOCK_ATTEMPTS 4       // Rodadas de envio (ou de reenvio do manifesto) antes de desistir
+
+static struct {
+    char need_topic[140];
+    SemaphoreHandle_t reply;  // Sinalizado a cada resposta do backend à imagem atual
+    uint32_t image_crc;       // "id" esperado nas respostas
+    volatile bool done;       // Backend remontou a imagem
+    uint8_t need[BLOCK_MANIFEST_MAX / 8]; // Bit i (LSB primeiro): bloco i não está no backend
+    uint8_t hashes[BLOCK_MANIFEST_MAX * COREDUMP_UPLOADER_BLOCK_HASH_SIZE];
+    char manifest[BLOCK_MANIFEST_MAX * COREDUMP_UPLOADER_BLOCK_HASH_SIZE * 2 + 320];
+    uint8_t buf[CONFIG_COREDUMP_UPLOADER_BLOCK_SIZE];
+} s_blocks;
 
-        // 1. Configura o contexto para os callbacks
-        mqtt_coredump_ctx_t mqtt_ctx = {
-            .part_count = 0,
-            .part_quantity = 0,
-        };
+static int hex_nibble(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Callback de "<tópico>/need": respostas de outra imagem (p.ex. de uma sessão anterior) são ignoradas
+static void block_reply_handler(const char *data, int len, void *arg) {
+    (void)arg;
+    char buf[BLOCK_MANIFEST_MAX / 4 + 64];
+    snprintf(buf, sizeof(buf), "%.*s", len, data);
+    const char *id = strstr(buf, "\"id\":\"");
+    if (!id || strtoul(id + 6, NULL, 16) != s_blocks.image_crc)
+        return;
+    if (json_field_long(buf, "done") > 0) {
+        s_blocks.done = true;
+        xSemaphoreGive(s_blocks.reply);
+        return;
+    }
+    const char *need = strstr(buf, "\"need\":\"");
+    if (!need)
+        return;
+    need += 8;
+    memset(s_blocks.need, 0, sizeof(s_blocks.need));
+    for (size_t i = 0; i < sizeof(s_blocks.need); ++i) {
+        int hi = hex_nibble(need[2 * i]);
+        int lo = hi < 0 ? -1 : hex_nibble(need[2 * i + 1]);
+        if (lo < 0)
+            break;
+        s_blocks.need[i] = (uint8_t)(hi << 4 | lo);
+    }
+    xSemaphoreGive(s_blocks.reply);
+}
 
-        // Adiciona um identificador único ao tópico, como o MAC address
-        uint8_t mac[6] = {0x16, 0x03, 0x25, 0x22, 0x07, 0x02};
-        // esp_efuse_mac_get_default(mac);
-        snprintf(mqtt_ctx.topic, sizeof(mqtt_ctx.topic), "coredump/%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+// JSON do manifesto: metadados da mensagem inicial e os endereços concatenados em hex ("h")
+static int block_format_manifest(const mqtt_coredump_ctx_t *ctx, const coredump_uploader_info_t *info, size_t count, uint32_t digest) {
+    char *msg = s_blocks.manifest;
+    size_t size = sizeof(s_blocks.manifest);
+    int n = snprintf(msg, size, "{\"id\":\"%08" PRIx32 "\",\"size\":%u,\"crc\":\"%08" PRIx32 "\",\"bs\":%u", info->image_crc,
+                     (unsigned)info->total_size, digest, (unsigned)CONFIG_COREDUMP_UPLOADER_BLOCK_SIZE);
+    if (ctx->has_fingerprint)
+        n += snprintf(msg + n, size - n, ",\"fp\":\"%08" PRIx32 "\"", ctx->fingerprint);
+    if (ctx->extra_meta)
+        n += snprintf(msg + n, size - n, "%s", ctx->extra_meta);
+    n += snprintf(msg + n, size - n, ",\"h\":\"");
+    for (size_t i = 0; i < count * COREDUMP_UPLOADER_BLOCK_HASH_SIZE; ++i)
+        n += snprintf(msg + n, size - n, "%02x", s_blocks.hashes[i]);
+    n += snprintf(msg + n, size - n, "\"}");
+    return n;
+}
 
-        // 2. Obtém informações do coredump
-        coredump_uploader_info_t info;
-        esp_err_t err = coredump_uploader_get_info(&info, 0, true);
+// Publica os blocos marcados em 'need'; retorna quantos foram enviados, ou -1 em falha
+static int block_send_needed(const mqtt_coredump_ctx_t *ctx, const coredump_uploader_info_t *info, const uint8_t *need,
+                             size_t count, size_t *bytes) {
+    int sent = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!(need[i / 8] & (1u << (i % 8))))
+            continue;
+        size_t off = i * CONFIG_COREDUMP_UPLOADER_BLOCK_SIZE;
+        size_t n = info->total_size - off < CONFIG_COREDUMP_UPLOADER_BLOCK_SIZE ? info->total_size - off : CONFIG_COREDUMP_UPLOADER_BLOCK_SIZE;
+        esp_err_t err = coredump_uploader_read(info, off, s_blocks.buf, n);
         if (err != ESP_OK) {
-            ESP_LOGI("APP", "Sem coredump ou erro (%s).", esp_err_to_name(err));
-            return;
+            ESP_LOGE(TAG, "Falha ao ler o bloco %u (%s)", (unsigned)i, esp_err_to_name(err));
+            return -1;
+        }
+        char topic[160];
+        snprintf(topic, sizeof(topic), "%s/block/%u/%08" PRIx32, ctx->topic, (unsigned)i, esp_rom_crc32_le(0, s_blocks.buf, n));
+        if (!publish_message(topic, (const char *)s_blocks.buf, (int)n, 1)) {
+            ESP_LOGE(TAG, "Falha ao publicar o bloco %u.", (unsigned)i);
+            return -1;
         }
+        sent++;
+        *bytes += n;
+    }
+    return sent;
+}
 
-        mqtt_ctx.part_quantity = info.chunk_count;
+// Envia o manifesto e só os blocos que o backend não tem. ESP_ERR_NOT_SUPPORTED (imagem grande
+// demais ou backend sem resposta ao manifesto) faz o chamador seguir com o envio em partes.
+static esp_err_t block_coredump_upload(mqtt_coredump_ctx_t *ctx) {
+    coredump_uploader_info_t info;
+    esp_err_t err = coredump_uploader_get_index(&info);
+    if (err != ESP_OK) {
+        ESP_LOGI(TAG, "Sem coredump ou erro (%s).", esp_err_to_name(err));
+        return err;
+    }
+    size_t block_topic_len = strlen(ctx->topic) + 7 + 10 + 1 + 8; // "<tópico>/block/<índice>/<crc>"
+    if (CONFIG_COREDUMP_UPLOADER_BLOCK_SIZE > mqtt_app_max_payload(block_topic_len)) {
+        ESP_LOGW(TAG, "Blocos de %d bytes não cabem numa mensagem MQTT; envio em partes.", CONFIG_COREDUMP_UPLOADER_BLOCK_SIZE);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    size_t count = 0;
+    uint32_t digest = 0;
+    err = coredump_uploader_block_hashes(&info, CONFIG_COREDUMP_UPLOADER_BLOCK_SIZE, s_blocks.hashes, BLOCK_MANIFEST_MAX, &count, &digest);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Manifesto de blocos indisponível (%s); envio em partes.", esp_err_to_name(err));
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    char manifest_topic[140];
+    snprintf(manifest_topic, sizeof(manifest_topic), "%s/manifest", ctx->topic);
+    int manifest_len = block_format_manifest(ctx, &info, count, digest);
+    if ((size_t)manifest_len >= sizeof(s_blocks.manifest) || (size_t)manifest_len > mqtt_app_max_payload(strlen(manifest_topic))) {
+        ESP_LOGW(TAG, "Manifesto de %d bytes não cabe numa mensagem MQTT; envio em partes.", manifest_len);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
 
-        // 3. Preenche a estrutura de callbacks
-        coredump_uploader_callbacks_t uploader_cbs = {
-            .start = mqtt_coredump_start,
-            .write = mqtt_coredump_write,
-            .progress = progress_cb,
-            .end = mqtt_coredump_end,
-            .priv = &mqtt_ctx,
-        };
+    if (!s_blocks.reply)
+        s_blocks.reply = xSemaphoreCreateBinary();
+    snprintf(s_blocks.need_topic, sizeof(s_blocks.need_topic), "%s/need", ctx->topic);
+    if (!s_blocks.reply || !mqtt_app_set_topic_handler(s_blocks.need_topic, block_reply_handler, NULL))
+        return ESP_ERR_NOT_SUPPORTED;
+    subscribe_to_topic(s_blocks.need_topic, 1);
+    s_blocks.image_crc = info.image_crc;
+    s_blocks.done = false;
+    xSemaphoreTake(s_blocks.reply, 0);
 
-        // 4. Realiza o upload do coredump (usando Base64)
+    ESP_LOGI(TAG, "Manifesto publicado: %u blocos de %d bytes (%d bytes).", (unsigned)count, CONFIG_COREDUMP_UPLOADER_BLOCK_SIZE, manifest_len);
+    publish_message(manifest_topic, s_blocks.manifest, manifest_len, 1);
+    bool answered = false;
+    size_t blocks_sent = 0, bytes_sent = 0;
+    err = ESP_ERR_TIMEOUT;
+    for (int attempt = 0; attempt < BLOCK_ATTEMPTS; ++attempt) {
+        if (xSemaphoreTake(s_blocks.reply, pdMS_TO_TICKS(CONFIG_COREDUMP_UPLOADER_BLOCK_REPLY_TIMEOUT_MS)) != pdTRUE) {
+            if (!answered) {
+                ESP_LOGW(TAG, "Backend não respondeu ao manifesto; envio em partes.");
+                err = ESP_ERR_NOT_SUPPORTED;
+                break;
+            }
+            // Resposta perdida: com o manifesto, o backend recalcula o que ainda falta
+            ESP_LOGW(TAG, "Sem resposta do backend aos blocos, reenviando o manifesto...");
+            publish_message(manifest_topic, s_blocks.manifest, manifest_len, 1);
+            continue;
+        }
+        answered = true;
+        if (s_blocks.done) {
+            err = ESP_OK;
+            break;
+        }
+        // Copia antes de enviar: a próxima resposta pode chegar durante o envio
+        uint8_t need[sizeof(s_blocks.need)];
+        memcpy(need, s_blocks.need, sizeof(need));
+        int sent = block_send_needed(ctx, &info, need, count, &bytes_sent);
+        if (sent < 0) {
+            err = ESP_FAIL;
+            break;
+        }
+        blocks_sent += (size_t)sent;
+    }
+    mqtt_app_set_topic_handler(s_blocks.need_topic, NULL, NULL);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Coredump remontado pelo backend: %u de %u blocos enviados (%u de %u bytes).", (unsigned)blocks_sent,
+                 (unsigned)count, (unsigned)bytes_sent, (unsigned)info.total_size);
+        err = coredump_uploader_discard();
+    } else if (err != ESP_ERR_NOT_SUPPORTED) {
+        ESP_LOGE(TAG, "Envio por blocos incompleto (%s): %u blocos enviados.", esp_err_to_name(err), (unsigned)blocks_sent);
+    }
+    return err;
+}
+#endif
+
+#if CONFIG_COREDUMP_UPLOADER_TRANSPORT_HTTP
+// Envia a imagem num único POST chunked; resumo, deduplicação e métricas continuam no MQTT
+static esp_err_t http_coredump_upload(const char *mac_str, const mqtt_coredump_ctx_t *mqtt_ctx) {
+    coredump_uploader_info_t info;
+    // O corpo HTTP é binário: sem Base64, e chunks grandes para encher os registros TLS
+    esp_err_t err = coredump_uploader_get_info(&info, CONFIG_COREDUMP_UPLOADER_HTTP_CHUNK_SIZE, false);
+    if (err != ESP_OK) {
+        ESP_LOGI(TAG, "Sem coredump ou erro (%s).", esp_err_to_name(err));
+        return err;
+    }
+    coredump_http_config_t http_cfg = {
+        .url = CONFIG_COREDUMP_UPLOADER_HTTP_URL,
+        .device_id = mac_str,
+        .token = CONFIG_COREDUMP_UPLOADER_HTTP_TOKEN,
+        .timeout_ms = CONFIG_COREDUMP_UPLOADER_HTTP_TIMEOUT_MS,
+        .has_fingerprint = mqtt_ctx->has_fingerprint,
+        .fingerprint = mqtt_ctx->fingerprint,
+    };
+    coredump_http_transport_t http;
+    err = coredump_http_init(&http, &http_cfg);
+    if (err != ESP_OK)
+        return err;
+    coredump_uploader_callbacks_t uploader_cbs;
+    coredump_http_callbacks(&http, &info, &uploader_cbs);
+    err = coredump_upload(&uploader_cbs, &info);
+    if (err != ESP_OK && http.status == 0) {
+        // Falha de conexão ou escrita: uma nova tentativa reabre a conexão
+        ESP_LOGW(TAG, "Reenviando coredump via HTTP...");
         err = coredump_upload(&uploader_cbs, &info);
+    }
+    coredump_http_deinit(&http);
+    log_upload_stats();
+    return err;
+}
+#endif
+
+#if CONFIG_COREDUMP_UPLOADER_TRANSPORT_PULL
+// --- Busca de intervalos pelo backend ---
+
+// Nada é enviado por iniciativa do dispositivo: a imagem é anunciada em "coredump/<mac>" e o backend
+// pede intervalos em "<tópico>/fetch", respondidos em "<tópico>/range/<offset>/<crc>"
+static struct {
+    char topic[128];                 // "coredump/<mac>": anúncio da imagem
+    char fetch_topic[140];           // Pedidos do backend: {"off":N,"len":L,"id":I}, "index" e {"release":I}
+    char status_topic[140];          // Liberação e pedidos recusados
+    coredump_uploader_info_t index;  // Imagem anunciada
+    volatile bool ready;             // 'index' anunciado e ainda selecionado no uploader
+    SemaphoreHandle_t released;      // Sinalizado pelo comando "release"
+    SemaphoreHandle_t lock;          // 'index'/'ready' entre o serviço e a task de comandos
+    uint8_t buf[CONFIG_COREDUMP_UPLOADER_PULL_RANGE_SIZE];
+} s_pull;
+
+// Maior intervalo por mensagem: buffer de resposta e buffer de saída do cliente MQTT
+static size_t pull_max_range(void) {
+    // "<tópico>/range/<offset até 10 dígitos>/<crc>"
+    size_t max = mqtt_app_max_payload(strlen(s_pull.topic) + 7 + 10 + 1 + 8);
+    return max < sizeof(s_pull.buf) ? max : sizeof(s_pull.buf);
+}
+
+static void pull_publish_status(const char *msg) {
+    publish_message(s_pull.status_topic, msg, strlen(msg), 1);
+}
+
+// Anúncio: tamanho, checksum, maior intervalo por mensagem e, se houver, os segmentos da task que falhou
+static void pull_announce(const mqtt_coredump_ctx_t *ctx) {
+    const coredump_uploader_info_t *info = &s_pull.index;
+    char msg[320];
+    int n = snprintf(msg, sizeof(msg), "{\"pull\":1,\"size\":%u,\"id\":\"%08" PRIx32 "\",\"max\":%u", (unsigned)info->total_size,
+                     info->image_crc, (unsigned)pull_max_range());
+    if (ctx && ctx->has_fingerprint)
+        n += snprintf(msg + n, sizeof(msg) - n, ",\"fp\":\"%08" PRIx32 "\"", ctx->fingerprint);
+    n += format_prefix_fields(msg + n, sizeof(msg) - n, info);
+    if (ctx && ctx->extra_meta)
+        n += snprintf(msg + n, sizeof(msg) - n, "%s", ctx->extra_meta);
+    snprintf(msg + n, sizeof(msg) - n, "}");
+    publish_message(s_pull.topic, msg, strlen(msg), 1);
+    ESP_LOGI(TAG, "Coredump anunciado para busca pelo backend: %s", msg);
+}
+
+// Campo "id" (CRC da imagem, 8 dígitos hex) de um pedido do backend; false se ausente ou inválido
+static bool json_field_id(const char *json, const char *key, uint32_t *out) {
+    char pattern[24];
+    snprintf(pattern, sizeof(pattern), "\"%s\":\"", key);
+    const char *field = strstr(json, pattern);
+    if (!field)
+        return false;
+    char *end = NULL;
+    unsigned long v = strtoul(field + strlen(pattern), &end, 16);
+    if (!end || *end != '"')
+        return false;
+    *out = (uint32_t)v;
+    return true;
+}
+
+// "release" e pedidos de intervalo valem só para a imagem anunciada agora: um pedido atrasado
+// (busca anterior, imagem já trocada ou liberação expirada) não é atendido
+static bool pull_matches_image(const char *json, const char *key) {
+    uint32_t id;
+    return s_pull.ready && json_field_id(json, key, &id) && id == s_pull.index.image_crc;
+}
+
+// {"release":"<id>"}: o backend já tem o que precisa, a imagem pode ser apagada
+static void pull_release(const mqtt_message_t *msg) {
+    xSemaphoreTake(s_pull.lock, portMAX_DELAY);
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+    if (pull_matches_image(msg->payload, "release")) {
+        err = coredump_uploader_discard();
+        if (err == ESP_OK) {
+            s_pull.ready = false;
+            xSemaphoreGive(s_pull.released);
+            ESP_LOGI(TAG, "Coredump liberado pelo backend e apagado.");
+        }
+    } else {
+        ESP_LOGW(TAG, "Liberação ignorada (imagem não anunciada ou de outra imagem): %s", msg->payload);
+    }
+    xSemaphoreGive(s_pull.lock);
+    char status[64];
+    snprintf(status, sizeof(status), "{\"released\":%d,\"result\":\"%s\"}", err == ESP_OK, esp_err_to_name(err));
+    pull_publish_status(status);
+}
+
+// {"off":N,"len":L,"id":"<id>"}: responde com mensagens consecutivas de até pull_max_range() bytes
+static void pull_range_handler(const mqtt_message_t *msg, void *arg) {
+    (void)arg;
+    if (strstr(msg->payload, "\"release\"")) {
+        pull_release(msg);
+        return;
+    }
+    const coredump_uploader_info_t *info = &s_pull.index;
+    long off = json_field_long(msg->payload, "off");
+    long len = json_field_long(msg->payload, "len");
+    // Sob o lock: o serviço não troca nem retira a imagem no meio da resposta
+    xSemaphoreTake(s_pull.lock, portMAX_DELAY);
+    bool current = pull_matches_image(msg->payload, "id");
+    if (!current || off < 0 || len <= 0 || (size_t)off >= info->total_size) {
+        xSemaphoreGive(s_pull.lock);
+        ESP_LOGW(TAG, "Pedido de intervalo recusado: %s", msg->payload);
+        char status[80];
+        snprintf(status, sizeof(status), "{\"error\":\"%s\",\"off\":%ld,\"len\":%ld}", current ? "range" : "no_image", off, len);
+        pull_publish_status(status);
+        return;
+    }
+    size_t end = (size_t)len > info->total_size - (size_t)off ? info->total_size : (size_t)off + (size_t)len;
+    size_t max = pull_max_range();
+    for (size_t pos = (size_t)off; pos < end;) {
+        size_t n = end - pos < max ? end - pos : max;
+        esp_err_t err = coredump_uploader_read(info, pos, s_pull.buf, n);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Falha ao ler intervalo %u+%u (%s)", (unsigned)pos, (unsigned)n, esp_err_to_name(err));
+            pull_publish_status("{\"error\":\"read\"}");
+            break;
+        }
+        char topic[160];
+        snprintf(topic, sizeof(topic), "%s/range/%u/%08" PRIx32, s_pull.topic, (unsigned)pos, esp_rom_crc32_le(0, s_pull.buf, n));
+        if (!publish_message(topic, (const char *)s_pull.buf, (int)n, 1)) {
+            ESP_LOGW(TAG, "Falha ao publicar intervalo %u+%u", (unsigned)pos, (unsigned)n);
+            break; // O backend pede de novo o que faltar
+        }
+        pos += n;
+    }
+    xSemaphoreGive(s_pull.lock);
+}
+
+// "index": repete o anúncio (ex.: backend reiniciado durante a busca)
+static void pull_index_handler(const mqtt_message_t *msg, void *arg) {
+    (void)msg;
+    (void)arg;
+    xSemaphoreTake(s_pull.lock, portMAX_DELAY);
+    bool ready = s_pull.ready;
+    if (ready)
+        pull_announce(NULL);
+    xSemaphoreGive(s_pull.lock);
+    if (!ready)
+        pull_publish_status("{\"error\":\"no_image\"}");
+}
+
+// "release" sem o id da imagem (backend anterior): recusado, pois pode chegar depois de a
+// imagem anunciada ter sido trocada e apagaria outra
+static void pull_release_handler(const mqtt_message_t *msg, void *arg) {
+    (void)arg;
+    pull_release(msg);
+}
+
+static void pull_init(const char *mac_str) {
+    snprintf(s_pull.topic, sizeof(s_pull.topic), "coredump/%s", mac_str);
+    snprintf(s_pull.fetch_topic, sizeof(s_pull.fetch_topic), "%s/fetch", s_pull.topic);
+    snprintf(s_pull.status_topic, sizeof(s_pull.status_topic), "%s/pull", s_pull.topic);
+    s_pull.released = xSemaphoreCreateBinary();
+    s_pull.lock = xSemaphoreCreateMutex();
+    // Antes do anúncio: os primeiros pedidos do backend já encontram a inscrição
+    subscribe_to_topic(s_pull.fetch_topic, 1);
+}
+
+// Anuncia a imagem e aguarda o backend buscá-la e liberá-la. Os pedidos são atendidos na task
+// de comandos; o serviço fica ocupado até a liberação, adiando novas falhas injetadas.
+static esp_err_t pull_coredump_serve(const mqtt_coredump_ctx_t *ctx) {
+    if (!s_pull.released || !s_pull.lock)
+        return ESP_ERR_NO_MEM;
+    xSemaphoreTake(s_pull.lock, portMAX_DELAY);
+    esp_err_t err = coredump_uploader_get_index(&s_pull.index);
+    if (err != ESP_OK) {
+        xSemaphoreGive(s_pull.lock);
+        ESP_LOGI(TAG, "Sem coredump ou erro (%s).", esp_err_to_name(err));
+        return err;
+    }
+    xSemaphoreTake(s_pull.released, 0);
+    s_pull.ready = true;
+    pull_announce(ctx);
+    xSemaphoreGive(s_pull.lock);
+    if (xSemaphoreTake(s_pull.released, pdMS_TO_TICKS(CONFIG_COREDUMP_UPLOADER_PULL_RELEASE_TIMEOUT_S * 1000)) == pdTRUE)
+        return ESP_OK;
+    // Retira o anúncio antes de a imagem deixar de estar selecionada: pedidos e liberações
+    // atrasados passam a ser recusados em vez de atingir outra imagem
+    xSemaphoreTake(s_pull.lock, portMAX_DELAY);
+    bool released = !s_pull.ready; // Liberada entre o timeout e o lock
+    s_pull.ready = false;
+    memset(&s_pull.index, 0, sizeof(s_pull.index));
+    xSemaphoreGive(s_pull.lock);
+    if (released)
+        return ESP_OK;
+    ESP_LOGW(TAG, "Backend não liberou o coredump em %d s; imagem mantida para o próximo boot.", CONFIG_COREDUMP_UPLOADER_PULL_RELEASE_TIMEOUT_S);
+    return ESP_ERR_TIMEOUT;
+}
+#endif
+
+// Identificador do dispositivo nos tópicos MQTT e no endpoint HTTP
+static void device_mac_str(char *out, size_t size) {
+    uint8_t mac[6] = {0x16, 0x03, 0x25, 0x22, 0x07, 0x02};
+    // esp_efuse_mac_get_default(mac);
+    snprintf(out, size, "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+// --- Lógica principal da aplicação ---
+
+// Envia a imagem selecionada no uploader (partição de coredump ou slot do spool): resumo,
+// deduplicação e upload pelo transporte configurado. 'extra_meta' vai na mensagem inicial.
+static esp_err_t upload_selected_image(const char *mac_str, const char *extra_meta) {
+    esp_err_t err = ESP_OK;
+
+    // 1. Configura o contexto para os callbacks
+    mqtt_coredump_ctx_t mqtt_ctx = {
+        .part_count = 0,
+        .part_quantity = 0,
+        .use_base64 = COREDUMP_USE_BASE64,
+        .extra_meta = extra_meta,
+    };
+
+    // Adiciona um identificador único ao tópico, como o MAC address
+    snprintf(mqtt_ctx.topic, sizeof(mqtt_ctx.topic), "coredump/%s", mac_str);
+    snprintf(mqtt_ctx.ack_topic, sizeof(mqtt_ctx.ack_topic), "%s/ack", mqtt_ctx.topic);
+
+#if CONFIG_COREDUMP_UPLOADER_SUMMARY
+    // Resumo primeiro: pequeno, sai antes do cálculo de compressão e da imagem completa
+    mqtt_coredump_publish_summary(mqtt_ctx.topic);
+#endif
+
+    // 2. Respostas do backend: deduplicação, ponto de retomada e checkpoint em NVS durante o envio
+    mqtt_ctx.ack_sem = xSemaphoreCreateBinary();
+    mqtt_ctx.info_lock = xSemaphoreCreateMutex();
+    if (!mqtt_ctx.ack_sem || !mqtt_ctx.info_lock) {
+        // Sem ACKs: upload no modo legado, sem retomada nem confirmação do fluxo
+        if (mqtt_ctx.ack_sem)
+            vSemaphoreDelete(mqtt_ctx.ack_sem);
+        mqtt_ctx.ack_sem = NULL;
+    } else if (mqtt_app_set_topic_handler(mqtt_ctx.ack_topic, mqtt_coredump_ack, &mqtt_ctx)) {
+        subscribe_to_topic(mqtt_ctx.ack_topic, 1);
+    }
+
+    // 3. Falhas repetidas só incrementam o contador no backend; as demais seguem para o upload
+    bool upload = true;
+#if CONFIG_COREDUMP_UPLOADER_DEDUP
+    // Campanhas repetem falhas de propósito: todas as imagens seguem completas para o backend
+    fault_campaign_t campaign;
+    if (!fault_campaign_load(&campaign))
+        upload = mqtt_coredump_dedup(&mqtt_ctx);
+#endif
+    if (upload) {
+#if CONFIG_COREDUMP_UPLOADER_TRANSPORT_HTTP
+        err = http_coredump_upload(mac_str, &mqtt_ctx);
+#elif CONFIG_COREDUMP_UPLOADER_TRANSPORT_PULL
+        err = pull_coredump_serve(&mqtt_ctx);
+#else
+#if CONFIG_COREDUMP_UPLOADER_BLOCK_DEDUP
+        err = block_coredump_upload(&mqtt_ctx);
+        if (err == ESP_ERR_NOT_SUPPORTED)
+#endif
+            err = mqtt_coredump_upload(&mqtt_ctx);
+#endif
         if (err == ESP_OK)
             ESP_LOGI(TAG, "Upload do coredump concluído com sucesso!");
         else
             ESP_LOGE(TAG, "Falha no processo de upload do coredump: %s", esp_err_to_name(err));
-    } else {
-        ESP_LOGI(TAG, "Inicialização normal, nenhum coredump a ser enviado.");
     }
+
+    // O contexto sai de escopo: remove o callback antes de liberar o semáforo
+    if (mqtt_ctx.ack_sem) {
+        mqtt_app_set_topic_handler(mqtt_ctx.ack_topic, NULL, NULL);
+        vSemaphoreDelete(mqtt_ctx.ack_sem);
+    }
+    if (mqtt_ctx.info_lock)
+        vSemaphoreDelete(mqtt_ctx.info_lock);
+    return err;
+}
+
+#if CONFIG_COREDUMP_UPLOADER_SPOOL
+// Envia as imagens do spool da mais antiga para a mais nova, na mesma conexão MQTT. Para no
+// primeiro erro: as restantes ficam para a próxima sessão. Retorna em 'out_sent' quantas saíram.
+static esp_err_t spool_drain(const char *mac_str, size_t *out_sent) {
+    static coredump_spool_entry_t entry; // Inclui o resumo: fora da pilha do serviço
+    size_t queued = coredump_spool_pending();
+    esp_err_t err = ESP_OK;
+    // Limite de voltas: um slot que não puder ser marcado como enviado não prende o serviço
+    for (size_t i = 0; i < CONFIG_COREDUMP_UPLOADER_SPOOL_SLOTS && coredump_spool_next(&entry) == ESP_OK; ++i) {
+        ESP_LOGW(TAG, "Enviando coredump %u/%u do spool (seq %" PRIu32 ", reset %" PRIu32 ")...", (unsigned)(i + 1), (unsigned)queued,
+                 entry.seq, entry.reset_reason);
+        char meta[96];
+        snprintf(meta, sizeof(meta), ",\"seq\":%" PRIu32 ",\"rst\":%" PRIu32 ",\"up\":%" PRIu32 ",\"queued\":%u", entry.seq,
+                 entry.reset_reason, entry.uptime_s, (unsigned)queued);
+        err = coredump_spool_select(&entry);
+        if (err == ESP_OK)
+            err = upload_selected_image(mac_str, meta);
+        coredump_uploader_select_image(NULL);
+        if (err != ESP_OK)
+            break;
+        (*out_sent)++;
+    }
+    return err;
+}
+#endif
+
+// Verifica se há coredumps para enviar e realiza o upload via MQTT. Executada pelo serviço de
+// upload em segundo plano.
+esp_err_t check_and_upload_coredump(void *arg) {
+    (void)arg;
+    esp_err_t err = ESP_OK;
+    size_t images = 0;
+    char mac_str[18];
+    device_mac_str(mac_str, sizeof(mac_str));
+
+    bool direct = coredump_uploader_need_upload();
+#if CONFIG_COREDUMP_UPLOADER_SPOOL
+    // Imagens copiadas neste boot e as que nenhuma sessão anterior conseguiu enviar
+    if (coredump_spool_pending()) {
+        ESP_LOGW(TAG, "%u coredump(s) no spool. Tentando enviar...", (unsigned)coredump_spool_pending());
+        err = spool_drain(mac_str, &images);
+    }
+    // Na partição de coredump só fica o que não coube no spool (anel cheio ou imagem grande)
+    direct = err == ESP_OK && esp_core_dump_image_check() == ESP_OK;
+#endif
+    if (direct) {
+        ESP_LOGW(TAG, "Detectada condição de falha. Tentando enviar coredump...");
+        err = upload_selected_image(mac_str, NULL);
+        if (err == ESP_OK)
+            images++;
+    } else if (!images) {
+#if CONFIG_COREDUMP_UPLOADER_TRANSPORT_PULL && !CONFIG_COREDUMP_UPLOADER_SPOOL
+        // A imagem só sai da flash com "release": uma não liberada num boot anterior é anunciada de novo
+        if (esp_core_dump_image_check() == ESP_OK) {
+            ESP_LOGI(TAG, "Coredump de um boot anterior aguardando liberação pelo backend.");
+            return pull_coredump_serve(NULL);
+        }
+#endif
+        if (err == ESP_OK)
+            ESP_LOGI(TAG, "Inicialização normal, nenhum coredump a ser enviado.");
+    }
+#if CONFIG_COREDUMP_UPLOADER_METRICS
+    if (direct || images || err != ESP_OK)
+        mqtt_publish_metrics(mac_str, err, images);
+#endif
+    return err;
+}
+
+// --- Comandos recebidos via MQTT ---
+
+// Comando de injeção de falha: 'arg' aponta a entrada de faults_get_types() do payload
+static volatile bool s_fault_deferred = false; // Comando de falha aguardando o fim do upload
+
+// Comando recebido durante o upload: espera o serviço fora da task de comandos, que continua
+// atendendo ACKs e os pedidos "range"/"release" do backend
+static void fault_deferred_task(void *arg) {
+    const fault_type_t *cmd = (const fault_type_t *)arg;
+    coredump_uploader_service_wait(UINT32_MAX);
+    ESP_LOGW(TAG, "Upload concluído. Forçando falha de %s...", cmd->description);
+    cmd->start();
+    s_fault_deferred = false; // Falhas que não reiniciam (ex.: stack overflow em outra task)
+    vTaskDelete(NULL);
+}
+
+static void fault_command_handler(const mqtt_message_t *msg, void *arg) {
+    const fault_type_t *cmd = (const fault_type_t *)arg;
+    // Uma nova falha sobrescreveria o coredump ainda em envio: adia até o serviço concluir
+    coredump_uploader_service_status_t status;
+    coredump_uploader_service_get_status(&status);
+    if (status.state == COREDUMP_UPLOADER_SERVICE_RUNNING) {
+        if (s_fault_deferred) {
+            ESP_LOGW(TAG, "Comando de falha ignorado: outro já aguarda o fim do upload.");
+            return;
+        }
+        ESP_LOGW(TAG, "Upload do coredump em andamento (%u/%u bytes), falha de %s adiada até a conclusão.",
+                 (unsigned)status.stream_sent, (unsigned)status.stream_size, cmd->description);
+        s_fault_deferred = true;
+        if (xTaskCreate(fault_deferred_task, "fault_deferred", 4096, (void *)cmd, 5, NULL) != pdPASS) {
+            s_fault_deferred = false;
+            ESP_LOGE(TAG, "Falha ao criar a task do comando adiado; comando descartado.");
+        }
+        return;
+    }
+    ESP_LOGW(TAG, "Comando de falha recebido via MQTT. Forçando falha de %s...", cmd->description);
+    cmd->start();
+}
+
+// --- Campanhas de injeção de falhas ---
+
+static volatile uint32_t s_campaign_gen = 0; // Muda com nova especificação ou "abort": invalida a task em espera
+
+// Publica o progresso da campanha em um único tópico de status
+static void campaign_publish_status(const char *state, const fault_campaign_t *c, int next, uint32_t delay_ms, const esp_err_t *upload) {
+    const fault_type_t *types = faults_get_types(NULL);
+    char msg[224];
+    int len = snprintf(msg, sizeof(msg), "{\"state\":\"%s\"", state);
+    if (c) {
+        len += snprintf(msg + len, sizeof(msg) - len, ",\"done\":%u,\"total\":%u", (unsigned)c->done, (unsigned)c->total);
+        if (c->last >= 0)
+            len += snprintf(msg + len, sizeof(msg) - len, ",\"last\":\"%s\"", types[c->last].name);
+    }
+    if (next >= 0)
+        len += snprintf(msg + len, sizeof(msg) - len, ",\"next\":\"%s\",\"delay_ms\":%" PRIu32, types[next].name, delay_ms);
+    if (upload)
+        len += snprintf(msg + len, sizeof(msg) - len, ",\"upload\":\"%s\"", esp_err_to_name(*upload));
+    len += snprintf(msg + len, sizeof(msg) - len, "}");
+    publish_message(FAULT_CAMPAIGN_STATUS_TOPIC, msg, len, 1);
+}
+
+// Um passo da campanha: aguarda o upload da falha anterior, sorteia a próxima e a provoca
+static void campaign_task(void *arg) {
+    uint32_t gen = (uint32_t)(uintptr_t)arg;
+    esp_err_t upload = coredump_uploader_service_wait(UINT32_MAX);
+    fault_campaign_t c;
+    if (gen != s_campaign_gen || !fault_campaign_load(&c)) {
+        vTaskDelete(NULL);
+        return;
+    }
+    if (upload != ESP_OK) {
+        // A imagem continua na flash: "resume" (ou o próximo boot) tenta de novo
+        ESP_LOGW(TAG, "Campanha pausada: upload falhou (%s)", esp_err_to_name(upload));
+        campaign_publish_status("paused", &c, -1, 0, &upload);
+        vTaskDelete(NULL);
+        return;
+    }
+    uint32_t delay_ms = 0;
+    int type = fault_campaign_next(&c, &delay_ms);
+    if (type < 0) {
+        bool finished = c.done >= c.total;
+        campaign_publish_status(finished ? "completed" : "error", &c, -1, 0, &upload);
+        if (finished)
+            fault_campaign_clear();
+        vTaskDelete(NULL);
+        return;
+    }
+    campaign_publish_status("running", &c, type, delay_ms, &upload);
+    vTaskDelay(pdMS_TO_TICKS(delay_ms));
+    if (gen == s_campaign_gen) {
+        const fault_type_t *types = faults_get_types(NULL);
+        ESP_LOGW(TAG, "Campanha %u/%u: forçando falha de %s...", (unsigned)c.done, (unsigned)c.total, types[type].description);
+        types[type].start();
+    }
+    // Tipos que falham em task própria (instrução ilegal, estouro de pilha) retornam aqui
+    vTaskDelete(NULL);
+}
+
+static void campaign_start_task(void) {
+    if (xTaskCreate(campaign_task, "fault_campaign", 4096, (void *)(uintptr_t)s_campaign_gen, 5, NULL) != pdPASS)
+        ESP_LOGE(TAG, "Falha ao criar a task da campanha");
+}
+
+// Payload que não é um dos comandos: nova especificação, substitui a campanha em andamento
+static void campaign_spec_handler(const mqtt_message_t *msg, void *arg) {
+    (void)arg;
+    fault_campaign_t c;
+    if (fault_campaign_parse(msg->payload, &c) != ESP_OK) {
+        ESP_LOGW(TAG, "Especificação de campanha inválida: %s", msg->payload);
+        campaign_publish_status("rejected", NULL, -1, 0, NULL);
+        return;
+    }
+    if (fault_campaign_save(&c) != ESP_OK) {
+        campaign_publish_status("error", &c, -1, 0, NULL);
+        return;
+    }
+    s_campaign_gen++;
+    ESP_LOGI(TAG, "Campanha aceita: %u falhas", (unsigned)c.total);
+    campaign_publish_status("accepted", &c, -1, 0, NULL);
+    campaign_start_task();
+}
+
+static void campaign_abort_handler(const mqtt_message_t *msg, void *arg) {
+    (void)msg;
+    (void)arg;
+    fault_campaign_t c;
+    bool had = fault_campaign_load(&c);
+    s_campaign_gen++;
+    fault_campaign_clear();
+    campaign_publish_status("aborted", had ? &c : NULL, -1, 0, NULL);
+}
+
+static void campaign_resume_handler(const mqtt_message_t *msg, void *arg) {
+    (void)msg;
+    (void)arg;
+    fault_campaign_t c;
+    if (!fault_campaign_load(&c)) {
+        campaign_publish_status("idle", NULL, -1, 0, NULL);
+        return;
+    }
+    s_campaign_gen++; // Uma única task ativa por vez
+    campaign_start_task();
+}
+
+static void campaign_status_handler(const mqtt_message_t *msg, void *arg) {
+    (void)msg;
+    (void)arg;
+    fault_campaign_t c;
+    if (fault_campaign_load(&c))
+        campaign_publish_status("running", &c, -1, 0, NULL); // Concluída só após o upload da última falha
+    else
+        campaign_publish_status("idle", NULL, -1, 0, NULL);
+}
+
+static void unknown_command_handler(const mqtt_message_t *msg, void *arg) {
+    (void)arg;
+    ESP_LOGW(TAG, "Comando desconhecido recebido via MQTT: %s", msg->payload);
+}
+
+// O mqtt_app avisa cada (re)conexão ao broker com uma mensagem sem tópico
+static void client_connected_handler(const mqtt_message_t *msg, void *arg) {
+    (void)msg;
+    (void)arg;
+    ESP_LOGI(TAG, "Cliente MQTT reconectado.");
+}
+
+static void register_commands(void) {
+    size_t n_types;
+    const fault_type_t *types = faults_get_types(&n_types);
+    for (size_t i = 0; i < n_types; ++i)
+        mqtt_dispatch_register(FAULT_INJECTION_TOPIC, types[i].name, fault_command_handler, (void *)&types[i]);
+    mqtt_dispatch_register(FAULT_INJECTION_TOPIC, NULL, unknown_command_handler, NULL);
+    mqtt_dispatch_register(FAULT_CAMPAIGN_TOPIC, "abort", campaign_abort_handler, NULL);
+    mqtt_dispatch_register(FAULT_CAMPAIGN_TOPIC, "resume", campaign_resume_handler, NULL);
+    mqtt_dispatch_register(FAULT_CAMPAIGN_TOPIC, "status", campaign_status_handler, NULL);
+    mqtt_dispatch_register(FAULT_CAMPAIGN_TOPIC, NULL, campaign_spec_handler, NULL);
+    mqtt_dispatch_register("", "client_connected", client_connected_handler, NULL);
+#if CONFIG_COREDUMP_UPLOADER_TRANSPORT_PULL
+    mqtt_dispatch_register(s_pull.fetch_topic, "release", pull_release_handler, NULL);
+    mqtt_dispatch_register(s_pull.fetch_topic, "index", pull_index_handler, NULL);
+    mqtt_dispatch_register(s_pull.fetch_topic, NULL, pull_range_handler, NULL);
+#endif
 }
 
 // Função principal da aplicação
 void app_main(void) {
+#if CONFIG_COREDUMP_UPLOADER_METRICS
+    s_boot_times.app_us = esp_timer_get_time();
+#endif
+    // Antes do spool: o resumo copiado junto da imagem leva o corte da captura
+    coredump_capture_init();
     ESP_ERROR_CHECK(nvs_flash_init());
+#if CONFIG_COREDUMP_UPLOADER_SPOOL
+    // Antes da rede: uma nova falha durante a conexão não sobrescreve a imagem deste boot
+    coredump_spool_ingest();
+#endif
     ESP_LOGI(TAG, "Inicializando Wi-Fi...");
     if (wifi_init_start() == ESP_OK) {
+#if CONFIG_COREDUMP_UPLOADER_METRICS
+        s_boot_times.ip_us = esp_timer_get_time();
+#endif
         ESP_LOGI(TAG, "Inicializando MQTT...");
-        mqtt_queue = xQueueCreate(10, sizeof(mqtt_message_t));
-        ESP_ERROR_CHECK(mqtt_app_start(mqtt_queue));
+        ESP_ERROR_CHECK(mqtt_app_start());
     } else {
         ESP_LOGE(TAG, "Abortando inicialização do MQTT devido a falha no Wi-Fi");
     }
-    mqtt_message_t msg;
-    if (xQueueReceive(mqtt_queue, &msg, portMAX_DELAY) == pdTRUE) {
-        if (strcmp(msg.payload, "client_connected") == 0) {
+    // A primeira mensagem do mqtt_app é o aviso de conexão
+    mqtt_message_t *msg;
+    if (mqtt_app_receive(&msg, portMAX_DELAY)) {
+        if (strcmp(msg->payload, "client_connected") == 0) {
             ESP_LOGI(TAG, "Cliente MQTT conectado, iniciando verificação de coredump...");
+#if CONFIG_COREDUMP_UPLOADER_METRICS
+            s_boot_times.mqtt_us = esp_timer_get_time();
+#endif
         }
-        memset(&msg, 0, sizeof(msg));
+        mqtt_app_release(msg);
     }
-    check_and_upload_coredump();
+#if CONFIG_COREDUMP_UPLOADER_TRANSPORT_PULL
+    char mac_str[18];
+    device_mac_str(mac_str, sizeof(mac_str));
+    pull_init(mac_str);
+#endif
+    // O upload segue em segundo plano: a aplicação fica pronta sem esperar o envio
+    if (coredump_uploader_service_start(check_and_upload_coredump, NULL) != ESP_OK)
+        check_and_upload_coredump(NULL);
 
-    subscribe_to_topic("device/fault_injection", 2);
+    register_commands();
+    subscribe_to_topic(FAULT_INJECTION_TOPIC, 2);
+    subscribe_to_topic(FAULT_CAMPAIGN_TOPIC, 1);
     publish_message("device/ready", "Device Ready!", 14, 2);
-    while(1) {
-        if (xQueueReceive(mqtt_queue, &msg, portMAX_DELAY) == pdTRUE) {
-            ESP_LOGI(TAG, "Processando mensagem do tópico %s: %s", msg.topic, msg.payload);
-            if (strcmp(msg.payload, "IllegalInstructionCause") == 0) {
-                ESP_LOGW(TAG, "Comando de falha recebido via MQTT. Forçando falha de instrução ilegal...");
-                illegal_instruction_start();
-            } else if (strcmp(msg.payload, "LoadProhibited") == 0) {
-                ESP_LOGW(TAG, "Comando de falha recebido via MQTT. Forçando falha de acesso a memória inválida...");
-                load_prohibited_start();
-            } else if (strcmp(msg.payload, "StoreProhibited") == 0) {
-                ESP_LOGW(TAG, "Comando de falha recebido via MQTT. Forçando falha de escrita em memória inválida...");
-                store_prohibited_start();
-            } else if (strcmp(msg.payload, "IntegerDivideByZero") == 0) {
-                ESP_LOGW(TAG, "Comando de falha recebido via MQTT. Forçando falha de divisão por zero...");
-                integer_divide_by_zero_start();
-            } else if (strcmp(msg.payload, "Stack Overflow") == 0) {
-                ESP_LOGW(TAG, "Comando de falha recebido via MQTT. Forçando falha de estouro de pilha...");
-                stack_overflow_start();
-            } else {
-                ESP_LOGW(TAG, "Comando desconhecido recebido via MQTT: %s", msg.payload);
-            }
-        }
-        memset(&msg, 0, sizeof(msg));
-        vTaskDelay(pdMS_TO_TICKS(100));
-    }
+    // Campanha gravada: a próxima falha sai sozinha assim que o upload deste boot terminar
+    fault_campaign_t campaign;
+    if (fault_campaign_load(&campaign))
+        campaign_start_task();
+    // Cada comando é tratado assim que chega, sem espera fixa entre mensagens
+    while (1)
+        mqtt_dispatch_process(portMAX_DELAY);
 }
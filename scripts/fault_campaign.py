@@ -0,0 +1,144 @@
+"""Envia uma campanha de injeção de falhas ao dispositivo e acompanha o progresso.
+
+O dispositivo grava a especificação em NVS e, após cada reboot e upload concluído,
+provoca sozinho a próxima falha; este script só publica a especificação em
+DEVICE_FAULT_CAMPAIGN_TOPIC e imprime as mensagens de <tópico>/status.
+
+Exemplos:
+  python scripts/fault_campaign.py --count 100 --weight LoadProhibited=3 --weight StoreProhibited=1
+  python scripts/fault_campaign.py --count 50 --all --delay-ms 2000 --jitter-ms 1000 --seed 7
+  python scripts/fault_campaign.py --status
+  python scripts/fault_campaign.py --abort
+"""
+from __future__ import annotations
+
+import argparse
+import json
+import os
+import sys
+import threading
+
+from dotenv import load_dotenv
+from paho import mqtt
+import paho.mqtt.client as paho
+
+# Carrega variáveis de ambiente do arquivo .env
+load_dotenv()
+
+MQTT_HOST: str = os.getenv("MQTT_HOST")
+MQTT_PORT_STR: str = os.getenv("MQTT_PORT")
+MQTT_USER: str = os.getenv("MQTT_USER")
+MQTT_PASS: str = os.getenv("MQTT_PASS")
+
+if not MQTT_HOST or not MQTT_PORT_STR or not MQTT_USER or not MQTT_PASS:
+    raise ValueError("MQTT_HOST, MQTT_PORT, MQTT_USER e MQTT_PASS devem estar definidos no .env ou no ambiente.")
+
+MQTT_PORT: int = int(MQTT_PORT_STR)
+DEVICE_FAULT_CAMPAIGN_TOPIC: str = os.getenv("DEVICE_FAULT_CAMPAIGN_TOPIC", "device/fault_campaign")
+STATUS_TOPIC: str = f"{DEVICE_FAULT_CAMPAIGN_TOPIC}/status"
+
+# Mesmos nomes dos comandos de device/fault_injection (main/faults/faults.c)
+FAULT_TYPES = [
+    "IllegalInstructionCause",
+    "LoadProhibited",
+    "StoreProhibited",
+    "IntegerDivideByZero",
+    "Stack Overflow",
+]
+
+# Estados após os quais não há mais progresso a acompanhar
+FINAL_STATES = ("completed", "aborted", "rejected", "error", "idle")
+
+
+def build_spec(args: argparse.Namespace) -> str:
+    weights = {name: 1 for name in FAULT_TYPES} if args.all else {}
+    for item in args.weight:
+        name, _, value = item.rpartition("=")
+        if name not in FAULT_TYPES:
+            raise SystemExit(f"Tipo de falha desconhecido: {name!r} (opções: {', '.join(FAULT_TYPES)})")
+        weights[name] = int(value)
+    if not weights:
+        raise SystemExit("Informe ao menos um --weight NOME=PESO ou --all")
+    spec = {"count": args.count, "delay_ms": args.delay_ms, "jitter_ms": args.jitter_ms}
+    if args.seed:
+        spec["seed"] = args.seed
+    spec.update(weights)
+    payload = json.dumps(spec, separators=(",", ":"))
+    # O firmware recebe payloads de até 255 bytes
+    if len(payload) > 255:
+        raise SystemExit(f"Especificação com {len(payload)} bytes excede 255")
+    return payload
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Campanha de injeção de falhas executada no dispositivo")
+    parser.add_argument("--count", type=int, default=10, help="falhas a provocar (padrão: 10)")
+    parser.add_argument("--weight", action="append", default=[], metavar="NOME=PESO",
+                        help="peso de um tipo de falha (repetível)")
+    parser.add_argument("--all", action="store_true", help="todos os tipos com peso 1")
+    parser.add_argument("--delay-ms", type=int, default=1000, help="espera após cada upload (padrão: 1000)")
+    parser.add_argument("--jitter-ms", type=int, default=0, help="variação aleatória da espera (padrão: 0)")
+    parser.add_argument("--seed", type=int, default=0, help="semente do sorteio (padrão: aleatória)")
+    parser.add_argument("--status", action="store_true", help="consulta o progresso e sai")
+    parser.add_argument("--abort", action="store_true", help="cancela a campanha em andamento")
+    parser.add_argument("--no-follow", action="store_true", help="não acompanha o status após enviar")
+    args = parser.parse_args()
+
+    if args.abort:
+        payload = "abort"
+    elif args.status:
+        payload = "status"
+    else:
+        payload = build_spec(args)
+    follow = not args.no_follow and not args.abort
+
+    done = threading.Event()
+    subscribed = threading.Event()
+
+    def on_connect(client: paho.Client, userdata, flags, rc, properties=None) -> None:
+        if rc != 0:
+            print(f"mqtt.falha_conexao rc={rc}")
+            done.set()
+            return
+        client.subscribe(STATUS_TOPIC, qos=1)
+
+    def on_subscribe(client: paho.Client, userdata, mid, reason_codes, properties=None) -> None:
+        subscribed.set()
+
+    def on_message(client: paho.Client, userdata, msg: paho.MQTTMessage) -> None:
+        try:
+            status = json.loads(msg.payload.decode("utf-8"))
+        except ValueError:
+            return
+        print(json.dumps(status, ensure_ascii=False))
+        if status.get("state") in FINAL_STATES or (args.status and status.get("state") == "running"):
+            done.set()
+
+    client = paho.Client(callback_api_version=paho.CallbackAPIVersion.VERSION2)
+    client.on_connect = on_connect
+    client.on_subscribe = on_subscribe
+    client.on_message = on_message
+    client.username_pw_set(MQTT_USER, MQTT_PASS)
+    client.tls_set(tls_version=mqtt.client.ssl.PROTOCOL_TLS)
+    client.connect(MQTT_HOST, MQTT_PORT, 60)
+    client.loop_start()
+    try:
+        # Inscrito antes de publicar: a primeira resposta do dispositivo não se perde
+        if not subscribed.wait(30):
+            print("Timeout aguardando inscrição no broker")
+            return 1
+        print(f"Enviando para {DEVICE_FAULT_CAMPAIGN_TOPIC}: {payload}")
+        client.publish(DEVICE_FAULT_CAMPAIGN_TOPIC, payload, qos=1).wait_for_publish(30)
+        if follow:
+            done.wait()
+        return 0
+    except KeyboardInterrupt:
+        print("Interrompido pelo usuário (a campanha continua no dispositivo)")
+        return 130
+    finally:
+        client.loop_stop()
+        client.disconnect()
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,437 @@
+"""Gerador de carga para o receptor de coredumps.
+
+Simula uma frota de dispositivos virtuais que reproduzem o protocolo de upload
+do firmware (mqtt_coredump_start / mqtt_coredump_write em main/main.c) a partir
+de amostras `.cdmp` gravadas:
+
+  1. mensagem inicial em `<BASE_TOPIC>/<mac>` com "bytes", "enc", "id", "size",
+     "crc", "parts" (e "comp" com --deflate);
+  2. partes em `<BASE_TOPIC>/<mac>/<n>/<crc32 do payload>`, numeradas a partir de 1;
+  3. ACKs do backend em `<BASE_TOPIC>/<mac>/ack`: a conclusão é o ACK que confirma
+     o fluxo inteiro, publicado depois que o coredump foi montado e gravado em disco.
+
+Perda, reordenação e duplicação de partes são injetadas do lado do dispositivo.
+Como o firmware, uma tentativa sem confirmação completa (ou com parte rejeitada)
+é repetida com nova mensagem inicial, retomando a partir do ACK do backend.
+
+Os MACs gerados não estão cadastrados: o backend monta e grava cada coredump,
+mas não o registra no banco (dispositivo.nao_encontrado). Apague os arquivos de
+COREDUMP_RAWS_OUTPUT_DIR gerados pelo teste ao final.
+"""
+from __future__ import annotations
+
+import argparse
+import base64
+import json
+import os
+import random
+import statistics
+import sys
+import threading
+import time
+import zlib
+from dataclasses import asdict, dataclass
+from pathlib import Path
+from typing import Dict, List, Optional
+
+from dotenv import load_dotenv
+from paho import mqtt
+import paho.mqtt.client as paho
+
+# Carrega variáveis de ambiente do arquivo .env
+load_dotenv()
+
+# Variáveis obrigatórias - falham se não estiverem definidas
+MQTT_HOST: str = os.getenv("MQTT_HOST")
+MQTT_PORT_STR: str = os.getenv("MQTT_PORT")
+MQTT_USER: str = os.getenv("MQTT_USER")
+MQTT_PASS: str = os.getenv("MQTT_PASS")
+
+if not MQTT_HOST:
+    raise ValueError("MQTT_HOST não está definido. Configure no arquivo .env ou como variável de ambiente.")
+if not MQTT_PORT_STR:
+    raise ValueError("MQTT_PORT não está definido. Configure no arquivo .env ou como variável de ambiente.")
+if not MQTT_USER:
+    raise ValueError("MQTT_USER não está definido. Configure no arquivo .env ou como variável de ambiente.")
+if not MQTT_PASS:
+    raise ValueError("MQTT_PASS não está definido. Configure no arquivo .env ou como variável de ambiente.")
+
+MQTT_PORT: int = int(MQTT_PORT_STR)
+
+# Variáveis opcionais - com valores padrão
+BASE_TOPIC: str = os.getenv("MQTT_BASE_TOPIC", "coredump")
+ACK_TOPIC_SUFFIX: str = "ack"
+
+
+@dataclass
+class DeviceResult:
+    mac: str
+    sample: str
+    ok: bool
+    latency_s: Optional[float]  # Da primeira mensagem inicial ao ACK do fluxo inteiro
+    attempts: int
+    parts_sent: int  # Publicações de partes, incluindo duplicatas e reenvios
+    bytes_sent: int  # Bytes de payload publicados (após o Base64)
+    resends: int  # ACKs com "resend" recebidos
+    error: Optional[str] = None
+
+
+class Counters:
+    """Contadores globais do teste, compartilhados pelas threads dos dispositivos."""
+
+    def __init__(self) -> None:
+        self.lock = threading.Lock()
+        self.messages = 0
+        self.bytes = 0
+        self.acks = 0
+
+    def add(self, messages: int = 0, nbytes: int = 0, acks: int = 0) -> None:
+        with self.lock:
+            self.messages += messages
+            self.bytes += nbytes
+            self.acks += acks
+
+
+class VirtualDevice:
+    def __init__(
+        self,
+        mac: str,
+        sample: Path,
+        image: bytes,
+        client: paho.Client,
+        args: argparse.Namespace,
+        counters: Counters,
+        rng: random.Random,
+    ) -> None:
+        self.mac = mac
+        self.sample = sample
+        self.client = client
+        self.args = args
+        self.counters = counters
+        self.rng = rng
+        self.topic = f"{BASE_TOPIC}/{mac}"
+
+        stream = image
+        if args.deflate:
+            compressor = zlib.compressobj(level=6, wbits=-zlib.MAX_WBITS)
+            stream = compressor.compress(image) + compressor.flush()
+        self.stream_size = len(stream)
+        self.meta: Dict[str, object] = {
+            "bytes": len(stream),
+            "enc": "base64" if args.base64 else "raw",
+            # Como no firmware, o id é o checksum gravado nos 4 últimos bytes da imagem
+            "id": f"{int.from_bytes(image[-4:], 'little'):08x}",
+            "size": len(image),
+            "crc": f"{zlib.crc32(image):08x}",
+        }
+        if args.deflate:
+            self.meta["comp"] = "deflate"
+        chunks = [stream[i : i + args.chunk] for i in range(0, len(stream), args.chunk)]
+        self.meta["parts"] = len(chunks)
+        self.payloads = [base64.b64encode(c) if args.base64 else c for c in chunks]
+
+        self._cond = threading.Condition()
+        self._ack_seq = 0
+        self._acked_parts = 0
+        self._acked_bytes = 0
+        self._rejected_from: Optional[int] = None
+        self.result = DeviceResult(mac, sample.name, False, None, 0, 0, 0, 0)
+
+    def on_ack(self, body: Dict[str, object]) -> None:
+        """Chamado pela thread do cliente MQTT a cada ACK deste dispositivo."""
+        if "next" not in body or "bytes" not in body:
+            return
+        with self._cond:
+            self._ack_seq += 1
+            self._acked_parts = int(body["next"])
+            self._acked_bytes = int(body["bytes"])
+            if "resend" in body:
+                self._rejected_from = int(body["resend"])
+                self.result.resends += 1
+            self._cond.notify_all()
+        self.counters.add(acks=1)
+
+    def _publish(self, topic: str, payload: bytes) -> None:
+        self.client.publish(topic, payload, qos=self.args.qos)
+        self.counters.add(messages=1, nbytes=len(payload))
+
+    def _wait_ack(self, after_seq: int) -> bool:
+        """Aguarda um ACK posterior a 'after_seq'; False se nenhum chegar em --ack-timeout."""
+        with self._cond:
+            return self._cond.wait_for(lambda: self._ack_seq > after_seq, timeout=self.args.ack_timeout)
+
+    def _wait_done(self) -> bool:
+        """Aguarda o ACK do fluxo inteiro enquanto houver progresso; False em rejeição ou silêncio."""
+        with self._cond:
+            while True:
+                if self._rejected_from is not None:
+                    return False
+                if self._acked_bytes >= self.stream_size:
+                    return True
+                seq = self._ack_seq
+                if not self._cond.wait_for(lambda: self._ack_seq > seq, timeout=self.args.ack_timeout):
+                    return False
+
+    def _send_parts(self, first: int) -> None:
+        """Publica as partes a partir de 'first' (1-based) com perda, duplicação e reordenação."""
+        order: List[int] = []
+        for n in range(first, len(self.payloads) + 1):
+            if self.rng.random() < self.args.loss:
+                continue
+            order.append(n)
+            if self.rng.random() < self.args.dup:
+                order.append(n)
+        # Reordenação: troca cada parte com uma das próximas --reorder-window posições
+        for i in range(len(order)):
+            if self.rng.random() < self.args.reorder:
+                j = min(len(order) - 1, i + self.rng.randint(1, self.args.reorder_window))
+                order[i], order[j] = order[j], order[i]
+        for n in order:
+            payload = self.payloads[n - 1]
+            self._publish(f"{self.topic}/{n}/{zlib.crc32(payload):08x}", payload)
+            self.result.parts_sent += 1
+            self.result.bytes_sent += len(payload)
+            if self.args.part_interval > 0:
+                time.sleep(self.args.part_interval / 1000.0)
+
+    def run(self) -> DeviceResult:
+        start = time.monotonic()
+        try:
+            for attempt in range(1, self.args.attempts + 1):
+                self.result.attempts = attempt
+                with self._cond:
+                    seq = self._ack_seq
+                    self._rejected_from = None
+                self._publish(self.topic, json.dumps(self.meta).encode("utf-8"))
+                # O backend responde à mensagem inicial com o ponto de retomada
+                if not self._wait_ack(seq):
+                    self.result.error = "sem ACK da mensagem inicial"
+                    continue
+                with self._cond:
+                    acked_parts, acked_bytes = self._acked_parts, self._acked_bytes
+                if acked_bytes < self.stream_size:
+                    self._send_parts(acked_parts + 1)
+                    if not self._wait_done():
+                        self.result.error = "parte rejeitada" if self._rejected_from is not None else "fluxo incompleto"
+                        continue
+                self.result.ok = True
+                self.result.error = None
+                self.result.latency_s = time.monotonic() - start
+                break
+        except Exception as exc:  # Uma falha de um dispositivo não derruba o teste
+            self.result.error = f"excecao: {exc}"
+        return self.result
+
+
+class Fleet:
+    """Conexões MQTT compartilhadas pelos dispositivos e roteamento dos ACKs por MAC."""
+
+    def __init__(self, args: argparse.Namespace) -> None:
+        self.args = args
+        self.devices: Dict[str, VirtualDevice] = {}
+        self.devices_lock = threading.Lock()
+        self.clients: List[paho.Client] = []
+        self._connected = threading.Semaphore(0)
+
+    def start(self) -> None:
+        for i in range(self.args.connections):
+            client = paho.Client(
+                callback_api_version=paho.CallbackAPIVersion.VERSION2,
+                client_id=f"fleet-load-{os.getpid()}-{i}",
+            )
+            client.on_connect = self._on_connect
+            client.on_message = self._on_message
+            client.username_pw_set(MQTT_USER, MQTT_PASS)
+            if not self.args.no_tls:
+                client.tls_set(tls_version=mqtt.client.ssl.PROTOCOL_TLS)
+            client.max_inflight_messages_set(self.args.inflight)
+            client.max_queued_messages_set(0)
+            client.connect(MQTT_HOST, MQTT_PORT, 60)
+            client.loop_start()
+            self.clients.append(client)
+        for _ in self.clients:
+            if not self._connected.acquire(timeout=30):
+                raise RuntimeError("timeout conectando ao broker MQTT")
+
+    def stop(self) -> None:
+        for client in self.clients:
+            try:
+                client.loop_stop()
+                client.disconnect()
+            except Exception:
+                pass
+        self.clients = []
+
+    def register(self, device: VirtualDevice) -> None:
+        with self.devices_lock:
+            self.devices[device.mac] = device
+
+    def _on_connect(self, client: paho.Client, userdata: any, flags: dict, rc: int, properties: any | None = None) -> None:
+        if rc == 0:
+            client.subscribe(f"{BASE_TOPIC}/+/{ACK_TOPIC_SUFFIX}", qos=1)
+            self._connected.release()
+        else:
+            print(f"mqtt.falha_conexao rc={rc}")
+
+    def _on_message(self, client: paho.Client, userdata: any, msg: paho.MQTTMessage) -> None:
+        seg = msg.topic.split("/")
+        if len(seg) != 3 or seg[2] != ACK_TOPIC_SUFFIX:
+            return
+        with self.devices_lock:
+            device = self.devices.get(seg[1])
+        if device is None:
+            return
+        try:
+            body = json.loads(msg.payload.decode("utf-8"))
+        except ValueError:
+            return
+        if isinstance(body, dict):
+            device.on_ack(body)
+
+
+def load_samples(path: Path) -> List[Path]:
+    files = sorted(path.glob("*.cdmp")) if path.is_dir() else [path]
+    return [f for f in files if f.is_file() and f.stat().st_size >= 8]
+
+
+def percentile(values: List[float], p: float) -> Optional[float]:
+    if not values:
+        return None
+    ordered = sorted(values)
+    k = min(len(ordered) - 1, max(0, int(round(p / 100.0 * (len(ordered) - 1)))))
+    return ordered[k]
+
+
+def parse_args(argv: Optional[List[str]] = None) -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Gerador de carga do receptor de coredumps (frota de dispositivos virtuais)")
+    parser.add_argument("--samples", type=Path, default=Path(os.getenv("COREDUMP_RAWS_OUTPUT_DIR", "db/coredumps/raws")),
+                        help="arquivo .cdmp ou diretório com amostras (padrão: COREDUMP_RAWS_OUTPUT_DIR)")
+    parser.add_argument("--devices", type=int, default=100, help="total de dispositivos virtuais")
+    parser.add_argument("--concurrency", type=int, default=100, help="dispositivos enviando ao mesmo tempo")
+    parser.add_argument("--connections", type=int, default=4, help="conexões MQTT compartilhadas pelos dispositivos")
+    parser.add_argument("--ramp", type=float, default=0.0, help="segundos para iniciar todos os dispositivos")
+    parser.add_argument("--chunk", type=int, default=1536, help="bytes do fluxo por parte (antes do Base64)")
+    parser.add_argument("--base64", action="store_true", help="envia as partes em Base64")
+    parser.add_argument("--deflate", action="store_true", help="envia o fluxo comprimido (raw deflate)")
+    parser.add_argument("--qos", type=int, choices=(0, 1, 2), default=1)
+    parser.add_argument("--inflight", type=int, default=100, help="publicações QoS>0 sem confirmação por conexão")
+    parser.add_argument("--part-interval", type=float, default=0.0, help="ms entre partes de um mesmo dispositivo")
+    parser.add_argument("--loss", type=float, default=0.0, help="probabilidade de perder cada parte")
+    parser.add_argument("--dup", type=float, default=0.0, help="probabilidade de duplicar cada parte")
+    parser.add_argument("--reorder", type=float, default=0.0, help="probabilidade de reordenar cada parte")
+    parser.add_argument("--reorder-window", type=int, default=4, help="distância máxima de uma parte reordenada")
+    parser.add_argument("--attempts", type=int, default=3, help="tentativas por dispositivo (nova mensagem inicial)")
+    parser.add_argument("--ack-timeout", type=float, default=30.0, help="segundos sem ACK até desistir da tentativa")
+    parser.add_argument("--mac-prefix", default="02:4c:47", help="três primeiros octetos dos MACs gerados")
+    parser.add_argument("--seed", type=int, default=None, help="semente para perda/duplicação/reordenação")
+    parser.add_argument("--json-out", type=Path, default=None, help="grava o relatório e os resultados por dispositivo")
+    parser.add_argument("--no-tls", action="store_true", help="conecta sem TLS (broker local)")
+    args = parser.parse_args(argv)
+    if args.devices < 1 or args.concurrency < 1 or args.connections < 1 or args.chunk < 1 or args.attempts < 1:
+        parser.error("--devices, --concurrency, --connections, --chunk e --attempts devem ser >= 1")
+    if args.devices > 1 << 24:
+        parser.error("--devices excede os MACs disponíveis com o prefixo")
+    for name in ("loss", "dup", "reorder"):
+        if not 0.0 <= getattr(args, name) < 1.0:
+            parser.error(f"--{name} deve estar em [0, 1)")
+    return args
+
+
+def main(argv: Optional[List[str]] = None) -> int:
+    args = parse_args(argv)
+    samples = load_samples(args.samples)
+    if not samples:
+        print(f"Nenhuma amostra .cdmp encontrada em {args.samples}")
+        return 1
+    images = {s: s.read_bytes() for s in samples}
+    print(f"{len(samples)} amostras carregadas; {args.devices} dispositivos, {args.concurrency} simultâneos, "
+          f"{args.connections} conexões")
+
+    fleet = Fleet(args)
+    fleet.start()
+    counters = Counters()
+    seed_rng = random.Random(args.seed)
+    slots = threading.Semaphore(args.concurrency)
+    results: List[DeviceResult] = []
+    results_lock = threading.Lock()
+
+    def run_device(device: VirtualDevice) -> None:
+        try:
+            result = device.run()
+            with results_lock:
+                results.append(result)
+        finally:
+            slots.release()
+
+    threads: List[threading.Thread] = []
+    t0 = time.monotonic()
+    try:
+        for i in range(args.devices):
+            if args.ramp > 0:
+                delay = t0 + args.ramp * i / args.devices - time.monotonic()
+                if delay > 0:
+                    time.sleep(delay)
+            slots.acquire()
+            mac = f"{args.mac_prefix}:{(i >> 16) & 0xff:02x}:{(i >> 8) & 0xff:02x}:{i & 0xff:02x}"
+            sample = samples[i % len(samples)]
+            device = VirtualDevice(mac, sample, images[sample], fleet.clients[i % len(fleet.clients)], args, counters,
+                                   random.Random(seed_rng.getrandbits(32)))
+            fleet.register(device)
+            thread = threading.Thread(target=run_device, args=(device,), name=f"vdev-{i}", daemon=True)
+            thread.start()
+            threads.append(thread)
+        for thread in threads:
+            thread.join()
+    except KeyboardInterrupt:
+        print("Interrompido pelo usuário")
+    finally:
+        elapsed = time.monotonic() - t0
+        fleet.stop()
+
+    ok = [r for r in results if r.ok]
+    latencies = [r.latency_s for r in ok if r.latency_s is not None]
+    report = {
+        "devices": args.devices,
+        "completed": len(ok),
+        "failed": len(results) - len(ok),
+        "elapsed_s": round(elapsed, 3),
+        "messages": counters.messages,
+        "payload_bytes": counters.bytes,
+        "acks": counters.acks,
+        "msgs_per_s": round(counters.messages / elapsed, 1) if elapsed > 0 else None,
+        "kbytes_per_s": round(counters.bytes / elapsed / 1024, 1) if elapsed > 0 else None,
+        "coredumps_per_s": round(len(ok) / elapsed, 2) if elapsed > 0 else None,
+        "latency_s": {
+            "p50": percentile(latencies, 50),
+            "p90": percentile(latencies, 90),
+            "p99": percentile(latencies, 99),
+            "max": max(latencies) if latencies else None,
+            "mean": statistics.fmean(latencies) if latencies else None,
+        },
+        "attempts_mean": statistics.fmean([r.attempts for r in results]) if results else None,
+        "resends": sum(r.resends for r in results),
+        "params": {k: (str(v) if isinstance(v, Path) else v) for k, v in vars(args).items() if k != "json_out"},
+    }
+
+    lat = report["latency_s"]
+    fmt = lambda v: f"{v:.3f}s" if v is not None else "-"
+    print(f"\nConcluídos: {len(ok)}/{args.devices} em {elapsed:.1f}s ({report['coredumps_per_s']} coredumps/s)")
+    print(f"Vazão: {report['msgs_per_s']} msgs/s, {report['kbytes_per_s']} KB/s de payload, {counters.acks} ACKs")
+    print(f"Latência fim a fim: p50={fmt(lat['p50'])} p90={fmt(lat['p90'])} p99={fmt(lat['p99'])} max={fmt(lat['max'])}")
+    print(f"Tentativas por dispositivo: {report['attempts_mean']}, reenvios pedidos: {report['resends']}")
+    failures: Dict[str, int] = {}
+    for r in results:
+        if not r.ok:
+            failures[r.error or "?"] = failures.get(r.error or "?", 0) + 1
+    for error, count in sorted(failures.items(), key=lambda kv: -kv[1]):
+        print(f"  falha: {error} ({count})")
+
+    if args.json_out:
+        args.json_out.write_text(json.dumps({"report": report, "devices": [asdict(r) for r in results]}, indent=2),
+                                 encoding="utf-8")
+        print(f"Relatório gravado em {args.json_out}")
+    return 0 if len(ok) == args.devices else 2
+
+
+if __name__ == "__main__":
+    sys.exit(main())
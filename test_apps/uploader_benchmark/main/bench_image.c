@@ -0,0 +1,72 @@
+#include "bench_image.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include <string.h>
+
+static const char *TAG = "BENCH_IMAGE";
+
+#define BLOCK_SIZE 4096 // Um setor: a imagem é gerada e gravada bloco a bloco
+#define REGION_WORDS 64  // Cada região de conteúdo ocupa 256 bytes
+
+static uint32_t _next(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u; // LCG de Numerical Recipes
+    return *state;
+}
+
+// Preenche um bloco com regiões de tipos sorteados, na proporção aproximada de um dump real
+static void _fill_block(uint32_t *words, size_t count, uint32_t *state) {
+    for (size_t i = 0; i < count; i += REGION_WORDS) {
+        size_t n = count - i < REGION_WORDS ? count - i : REGION_WORDS;
+        uint32_t kind = _next(state) >> 28;
+        for (size_t k = 0; k < n; ++k) {
+            if (kind < 4)
+                words[i + k] = 0xa5a5a5a5; // Pilha nunca usada
+            else if (kind < 8)
+                words[i + k] = 0;
+            else if (kind < 13)
+                words[i + k] = 0x3ffb0000 | (_next(state) >> 16 & 0xfffc); // Ponteiros para a DRAM
+            else
+                words[i + k] = _next(state);
+        }
+    }
+}
+
+esp_err_t bench_image_write(size_t size, uint32_t seed) {
+    if (size < BENCH_IMAGE_MIN_SIZE || size > BENCH_IMAGE_MAX_SIZE || (size & 3))
+        return ESP_ERR_INVALID_ARG;
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_COREDUMP, NULL);
+    if (!part) {
+        ESP_LOGE(TAG, "Partição de coredump não encontrada.");
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (part->size < size) {
+        ESP_LOGE(TAG, "Partição de coredump (%u bytes) menor que a imagem (%u bytes).", (unsigned)part->size, (unsigned)size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    esp_err_t err = esp_partition_erase_range(part, 0, (size + part->erase_size - 1) / part->erase_size * part->erase_size);
+    if (err != ESP_OK)
+        return err;
+
+    static uint32_t block[BLOCK_SIZE / sizeof(uint32_t)];
+    uint32_t state = seed;
+    uint32_t crc = 0;
+    for (size_t offset = 0; offset < size; offset += BLOCK_SIZE) {
+        size_t len = size - offset < BLOCK_SIZE ? size - offset : BLOCK_SIZE;
+        _fill_block(block, len / sizeof(uint32_t), &state);
+        if (offset == 0)
+            block[0] = (uint32_t)size;
+        // O CRC cobre tudo menos a própria palavra final
+        bool last = offset + len == size;
+        crc = esp_rom_crc32_le(crc, (const uint8_t *)block, last ? len - sizeof(uint32_t) : len);
+        if (last)
+            block[len / sizeof(uint32_t) - 1] = crc;
+        err = esp_partition_write(part, offset, block, len);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Falha ao gravar a imagem em 0x%x (%s)", (unsigned)offset, esp_err_to_name(err));
+            return err;
+        }
+    }
+    ESP_LOGI(TAG, "Imagem sintética de %u bytes gravada (crc=0x%08x)", (unsigned)size, (unsigned)crc);
+    return ESP_OK;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "esp_err.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Menor e maior imagem sintética aceitas por bench_image_write(). */
+#define BENCH_IMAGE_MIN_SIZE (4 * 1024)
+#define BENCH_IMAGE_MAX_SIZE (256 * 1024)
+
+/**
+ * @brief Grava uma imagem sintética de coredump na partição de coredump.
+ *
+ * A imagem segue o mínimo que esp_core_dump_image_get() e o uploader exigem:
+ * o tamanho total na primeira palavra e o CRC32 dos bytes anteriores nos 4
+ * últimos. O conteúdo imita um dump real (regiões preenchidas, zeros,
+ * palavras com cara de ponteiro para a DRAM e trechos aleatórios), para que
+ * a taxa de compressão fique próxima da de um coredump de verdade. A mesma
+ * semente gera sempre a mesma imagem.
+ *
+ * @param size Tamanho total, entre BENCH_IMAGE_MIN_SIZE e BENCH_IMAGE_MAX_SIZE (múltiplo de 4).
+ * @param seed Semente do gerador pseudoaleatório.
+ *
+ * @return ESP_OK em caso de sucesso, ESP_ERR_INVALID_ARG (tamanho), ESP_ERR_NOT_FOUND
+ *         (partição ausente), ESP_ERR_INVALID_SIZE (partição pequena) ou erro da flash.
+ */
+esp_err_t bench_image_write(size_t size, uint32_t seed);
+
+#ifdef __cplusplus
+}
+#endif
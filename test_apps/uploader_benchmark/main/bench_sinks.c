@@ -0,0 +1,169 @@
+#include "bench_sinks.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include <string.h>
+#if CONFIG_BENCH_SINK_LOOPBACK
+#include "lwip/sockets.h"
+#endif
+#if CONFIG_BENCH_SINK_MQTT
+#include "mqtt_app.h"
+#endif
+
+static const char *TAG = "BENCH_SINK";
+
+// Null: mede o custo do uploader sem transporte algum (sempre presente, é a referência)
+static esp_err_t _null_open(void) {
+    return ESP_OK;
+}
+
+static esp_err_t _null_write(const char *data, size_t len) {
+    (void)data;
+    (void)len;
+    return ESP_OK;
+}
+
+static esp_err_t _null_close(void) {
+    return ESP_OK;
+}
+
+#if CONFIG_BENCH_SINK_LOOPBACK
+// Loopback: conexão TCP para 127.0.0.1, drenada por uma task receptora no próprio chip
+static int s_listen_fd = -1;
+static int s_client_fd = -1;
+static SemaphoreHandle_t s_drained;
+static volatile size_t s_received;
+static size_t s_sent;
+
+static void _loopback_server_task(void *arg) {
+    static char buf[1460];
+    while (1) {
+        int fd = accept(s_listen_fd, NULL, NULL);
+        if (fd < 0) {
+            ESP_LOGE(TAG, "accept falhou (errno %d)", errno);
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        int n;
+        while ((n = recv(fd, buf, sizeof(buf), 0)) > 0)
+            s_received += (size_t)n;
+        close(fd);
+        xSemaphoreGive(s_drained);
+    }
+}
+
+static esp_err_t _loopback_listen(void) {
+    s_drained = xSemaphoreCreateBinary();
+    s_listen_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (!s_drained || s_listen_fd < 0)
+        return ESP_ERR_NO_MEM;
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_BENCH_LOOPBACK_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (bind(s_listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(s_listen_fd, 1) != 0) {
+        ESP_LOGE(TAG, "Falha ao escutar na porta %d (errno %d)", CONFIG_BENCH_LOOPBACK_PORT, errno);
+        close(s_listen_fd);
+        s_listen_fd = -1;
+        return ESP_FAIL;
+    }
+    if (xTaskCreate(_loopback_server_task, "bench_loopback", 3072, NULL, tskIDLE_PRIORITY + 5, NULL) != pdPASS)
+        return ESP_ERR_NO_MEM;
+    return ESP_OK;
+}
+
+static esp_err_t _loopback_open(void) {
+    if (s_listen_fd < 0) {
+        esp_err_t err = _loopback_listen();
+        if (err != ESP_OK)
+            return err;
+    }
+    s_received = 0;
+    s_sent = 0;
+    s_client_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (s_client_fd < 0)
+        return ESP_ERR_NO_MEM;
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_BENCH_LOOPBACK_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (connect(s_client_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        ESP_LOGE(TAG, "connect falhou (errno %d)", errno);
+        close(s_client_fd);
+        s_client_fd = -1;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t _loopback_write(const char *data, size_t len) {
+    while (len > 0) {
+        int n = send(s_client_fd, data, len, 0);
+        if (n < 0) {
+            ESP_LOGE(TAG, "send falhou (errno %d)", errno);
+            return ESP_FAIL;
+        }
+        s_sent += (size_t)n;
+        data += n;
+        len -= (size_t)n;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t _loopback_close(void) {
+    if (s_client_fd < 0)
+        return ESP_ERR_INVALID_STATE;
+    close(s_client_fd);
+    s_client_fd = -1;
+    // A receptora sinaliza ao ver o fim da conexão, depois de ler todos os bytes
+    if (xSemaphoreTake(s_drained, pdMS_TO_TICKS(10000)) != pdTRUE)
+        return ESP_ERR_TIMEOUT;
+    if (s_received != s_sent) {
+        ESP_LOGE(TAG, "Recebidos %u de %u bytes", (unsigned)s_received, (unsigned)s_sent);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+#endif // CONFIG_BENCH_SINK_LOOPBACK
+
+#if CONFIG_BENCH_SINK_MQTT
+// MQTT: publicações reais pelo mqtt_app, com a mesma janela de confirmações do firmware
+static esp_err_t _mqtt_open(void) {
+    return ESP_OK;
+}
+
+static esp_err_t _mqtt_write(const char *data, size_t len) {
+    return publish_message(CONFIG_BENCH_MQTT_TOPIC, data, (int)len, CONFIG_BENCH_MQTT_QOS) ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t _mqtt_close(void) {
+    // Com QoS 1 a rodada só termina quando o broker confirmou tudo
+    for (int waited_ms = 0; waited_ms < CONFIG_MQTT_APP_PUBLISH_TIMEOUT_MS; waited_ms += 10) {
+        mqtt_app_publish_stats_t stats;
+        mqtt_app_get_publish_stats(&stats);
+        if (stats.in_flight == 0)
+            return ESP_OK;
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return ESP_ERR_TIMEOUT;
+}
+#endif // CONFIG_BENCH_SINK_MQTT
+
+static const bench_sink_t s_sinks[] = {
+    {"null", _null_open, _null_write, _null_close},
+#if CONFIG_BENCH_SINK_LOOPBACK
+    {"loopback", _loopback_open, _loopback_write, _loopback_close},
+#endif
+#if CONFIG_BENCH_SINK_MQTT
+    {"mqtt", _mqtt_open, _mqtt_write, _mqtt_close},
+#endif
+};
+
+const bench_sink_t *bench_sinks_get(size_t *count) {
+    *count = sizeof(s_sinks) / sizeof(s_sinks[0]);
+    return s_sinks;
+}
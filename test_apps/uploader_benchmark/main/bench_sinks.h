@@ -0,0 +1,34 @@
+#pragma once
+#include "esp_err.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Destino dos chunks de uma rodada do benchmark.
+ *
+ * 'close' só retorna quando todos os bytes escritos chegaram ao outro lado
+ * (socket drenado, publicações confirmadas), para que o tempo medido inclua
+ * a entrega e não apenas o enfileiramento.
+ */
+typedef struct {
+    const char *name;
+    esp_err_t (*open)(void);
+    esp_err_t (*write)(const char *data, size_t len);
+    esp_err_t (*close)(void);
+} bench_sink_t;
+
+/**
+ * @brief Obtém os sinks habilitados no menuconfig.
+ *
+ * @param count Saída com a quantidade de entradas da tabela.
+ *
+ * @return Tabela de sinks, válida por toda a execução.
+ */
+const bench_sink_t *bench_sinks_get(size_t *count);
+
+#ifdef __cplusplus
+}
+#endif
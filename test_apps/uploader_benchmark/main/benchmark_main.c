@@ -0,0 +1,142 @@
+#include "bench_image.h"
+#include "bench_sinks.h"
+#include "coredump_uploader.h"
+#include "esp_core_dump.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "nvs_flash.h"
+#include "sdkconfig.h"
+#include "unity.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if CONFIG_BENCH_SINK_MQTT
+#include "mqtt_app.h"
+#include "wifi.h"
+#endif
+
+static const char *TAG = "BENCH";
+
+#define BENCH_MAX_VALUES 16
+#define BENCH_SEED 0x5eed1234u
+
+// Lista "a,b,c" do menuconfig; entradas inválidas ou excedentes são ignoradas
+static size_t _parse_list(const char *list, long *out, size_t max) {
+    size_t count = 0;
+    const char *p = list;
+    while (*p && count < max) {
+        char *end;
+        long v = strtol(p, &end, 10);
+        if (end == p)
+            break;
+        out[count++] = v;
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return count;
+}
+
+static esp_err_t _sink_start(void *priv) {
+    return ((const bench_sink_t *)priv)->open();
+}
+
+static esp_err_t _sink_write(void *priv, const char *data, size_t len) {
+    return ((const bench_sink_t *)priv)->write(data, len);
+}
+
+// Encerra a rodada sem apagar a imagem: o erro faz o uploader mantê-la para a próxima
+static esp_err_t _sink_end(void *priv) {
+    esp_err_t err = ((const bench_sink_t *)priv)->close();
+    return err == ESP_OK ? ESP_ERR_INVALID_STATE : err;
+}
+
+static void _run_cell(const bench_sink_t *sink, size_t image_size, size_t chunk, bool b64, int rep) {
+    coredump_uploader_info_t info;
+    int64_t t0 = esp_timer_get_time();
+    TEST_ASSERT_EQUAL(ESP_OK, coredump_uploader_get_info(&info, chunk, b64));
+    int64_t info_us = esp_timer_get_time() - t0;
+
+    coredump_uploader_callbacks_t cbs = {
+        .start = _sink_start,
+        .write = _sink_write,
+        .end = _sink_end,
+        .priv = (void *)sink,
+    };
+    t0 = esp_timer_get_time();
+    esp_err_t err = coredump_upload(&cbs, &info);
+    int64_t upload_us = esp_timer_get_time() - t0;
+    TEST_ASSERT_EQUAL_MESSAGE(ESP_ERR_INVALID_STATE, err, "transporte falhou durante a rodada");
+
+    coredump_uploader_stats_t st;
+    TEST_ASSERT_EQUAL(ESP_OK, coredump_uploader_get_stats(&st));
+    // Uma linha JSON por rodada, prefixada para ser filtrada do restante do log
+    printf("BENCH {\"sink\":\"%s\",\"image\":%u,\"stream\":%u,\"comp\":%d,\"chunk\":%u,\"b64\":%d,\"rep\":%d,"
+           "\"info_us\":%" PRId64 ",\"us\":%" PRId64 ",\"kBps\":%.1f,\"bytes\":%" PRIu64 ",\"parts\":%" PRIu32 ","
+           "\"read_us\":%" PRIu64 ",\"read_max_us\":%" PRIu32 ",\"enc_us\":%" PRIu64 ",\"enc_max_us\":%" PRIu32 ","
+           "\"pub_us\":%" PRIu64 ",\"chunk_avg_us\":%" PRIu32 ",\"chunk_max_us\":%" PRIu32 ",\"peak\":%u}\n",
+           sink->name, (unsigned)image_size, (unsigned)info.compressed_size, info.compressed, (unsigned)info.chunk_size,
+           b64, rep, info_us, upload_us, upload_us > 0 ? (double)image_size * 1000.0 / (double)upload_us : 0.0,
+           st.bytes_sent, st.parts, st.read_us, st.read_max_us, st.encode_us, st.encode_max_us, st.publish_us,
+           st.chunk_avg_us, st.chunk_max_us, (unsigned)st.peak_work_bytes);
+}
+
+TEST_CASE("synthetic image is accepted as a coredump", "[image]") {
+    TEST_ASSERT_EQUAL(ESP_OK, bench_image_write(BENCH_IMAGE_MIN_SIZE, BENCH_SEED));
+    size_t addr = 0, size = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_core_dump_image_get(&addr, &size));
+    TEST_ASSERT_EQUAL(BENCH_IMAGE_MIN_SIZE, size);
+
+    coredump_uploader_info_t info;
+    TEST_ASSERT_EQUAL(ESP_OK, coredump_uploader_get_info(&info, 0, false));
+    TEST_ASSERT_EQUAL(BENCH_IMAGE_MIN_SIZE, info.total_size);
+    TEST_ASSERT_NOT_EQUAL(0xFFFFFFFF, info.image_crc); // Palavra final gravada, não flash apagada
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bench_image_write(BENCH_IMAGE_MIN_SIZE - 4, BENCH_SEED));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, bench_image_write(BENCH_IMAGE_MAX_SIZE + 4, BENCH_SEED));
+}
+
+TEST_CASE("upload throughput grid", "[benchmark][timeout=3600]") {
+    long images[BENCH_MAX_VALUES], chunks[BENCH_MAX_VALUES], modes[BENCH_MAX_VALUES];
+    size_t n_images = _parse_list(CONFIG_BENCH_IMAGE_SIZES_KB, images, BENCH_MAX_VALUES);
+    size_t n_chunks = _parse_list(CONFIG_BENCH_CHUNK_SIZES, chunks, BENCH_MAX_VALUES);
+    size_t n_modes = _parse_list(CONFIG_BENCH_BASE64_MODES, modes, BENCH_MAX_VALUES);
+    size_t n_sinks;
+    const bench_sink_t *sinks = bench_sinks_get(&n_sinks);
+    TEST_ASSERT_TRUE(n_images > 0 && n_chunks > 0 && n_modes > 0);
+
+    for (size_t i = 0; i < n_images; ++i) {
+        size_t image_size = (size_t)images[i] * 1024;
+        TEST_ASSERT_EQUAL(ESP_OK, bench_image_write(image_size, BENCH_SEED + i));
+        for (size_t c = 0; c < n_chunks; ++c)
+            for (size_t m = 0; m < n_modes; ++m)
+                for (size_t s = 0; s < n_sinks; ++s)
+                    for (int rep = 0; rep < CONFIG_BENCH_REPEAT; ++rep)
+                        _run_cell(&sinks[s], image_size, (size_t)chunks[c], modes[m] != 0, rep);
+    }
+    // Não deixa a imagem sintética para o firmware de produção
+    TEST_ASSERT_EQUAL(ESP_OK, coredump_uploader_discard());
+}
+
+void app_main(void) {
+    ESP_ERROR_CHECK(nvs_flash_init());
+#if CONFIG_BENCH_SINK_MQTT
+    ESP_LOGI(TAG, "Inicializando Wi-Fi e MQTT para o sink real...");
+    ESP_ERROR_CHECK(wifi_init_start());
+    ESP_ERROR_CHECK(mqtt_app_start());
+    mqtt_message_t *msg;
+    while (mqtt_app_receive(&msg, portMAX_DELAY)) {
+        bool connected = strcmp(msg->payload, "client_connected") == 0;
+        mqtt_app_release(msg);
+        if (connected)
+            break;
+    }
+#else
+    // O sink loopback ainda precisa da pilha TCP/IP
+    ESP_LOGI(TAG, "Sink MQTT desabilitado: apenas null e loopback.");
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+#endif
+    unity_run_menu();
+}